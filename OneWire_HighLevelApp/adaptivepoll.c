@@ -0,0 +1,202 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "adaptivepoll.h"
+#include "sleep.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/// <summary>
+/// The read interval of a device.
+/// </summary>
+typedef struct {
+    OneWireRomId rom;
+    struct timespec lastRead;
+    int intervalMilli;
+    int16_t lastRaw;
+    bool hasRaw;
+    TemperatureClass lastClass;
+} AdaptivePollDevice;
+
+static AdaptivePollDevice *AdaptivePollFind(OneWireRomId rom);
+static AdaptivePollDevice *AdaptivePollGetDevice(OneWireRomId rom);
+static bool IsEarlier(const struct timespec *a, const struct timespec *b);
+
+/// <summary>
+/// The devices that have been read.
+/// </summary>
+static AdaptivePollDevice pollDevices[ADAPTIVE_POLL_MAX_DEVICES];
+
+/// <summary>
+/// The number of entries in pollDevices.
+/// </summary>
+static int pollDeviceCount = 0;
+
+/// <summary>
+/// The range of the read interval.
+/// </summary>
+static int pollMinIntervalMilli = 0;
+static int pollMaxIntervalMilli = 0;
+
+/// <summary>
+/// Sets the range of the read interval of each device, and forgets every device.
+/// </summary>
+/// <param name="minIntervalMilli">The shortest interval between reads of a device, used for new
+/// devices, devices that failed, and temperatures at or outside the thresholds.</param>
+/// <param name="maxIntervalMilli">The longest interval between reads of a device.</param>
+void AdaptivePollInit(int minIntervalMilli, int maxIntervalMilli)
+{
+    pollMinIntervalMilli = minIntervalMilli;
+    pollMaxIntervalMilli =
+        maxIntervalMilli > minIntervalMilli ? maxIntervalMilli : minIntervalMilli;
+    pollDeviceCount = 0;
+}
+
+/// <summary>
+/// Returns the time until the device should next be read.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>The time in milliseconds until the device is due (0 if it is due now, or has not
+/// been read.)</returns>
+long AdaptivePollGetDueMilli(OneWireRomId rom)
+{
+    const AdaptivePollDevice *device = AdaptivePollFind(rom);
+    if (device == NULL) {
+        return 0;
+    }
+
+    long long elapsedMilli = ElapsedMilli(&device->lastRead);
+    return elapsedMilli >= device->intervalMilli ? 0
+                                                 : (long)(device->intervalMilli - elapsedMilli);
+}
+
+/// <summary>
+/// Returns the class of the last temperature read from the device.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>The class, or TemperatureClass_Invalid if the device has not been read (or the last
+/// read failed.)</returns>
+TemperatureClass AdaptivePollGetClass(OneWireRomId rom)
+{
+    const AdaptivePollDevice *device = AdaptivePollFind(rom);
+    return device != NULL ? device->lastClass : TemperatureClass_Invalid;
+}
+
+/// <summary>
+/// Records a temperature read from the device and chooses when to read it next.  The interval is
+/// half the time the temperature would take to reach the nearest threshold at the rate it changed
+/// since the last read, so a device that is stable and far from the thresholds is read less
+/// often.  The interval at most doubles on each read, and stays within the range given to
+/// <see src="AdaptivePollInit"/>.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <param name="raw">The temperature in 1/16 degrees celsius.</param>
+/// <param name="thresholds">The thresholds the temperature is classified against.</param>
+void AdaptivePollRecord(OneWireRomId rom, int16_t raw, const Ds18b20Thresholds *thresholds)
+{
+    AdaptivePollDevice *device = AdaptivePollGetDevice(rom);
+    TemperatureClass class = Ds18b20ClassifyTemperature(raw, thresholds);
+
+    long long intervalMilli = pollMinIntervalMilli;
+    if (device->hasRaw && class == TemperatureClass_Normal) {
+        long long elapsedMilli = ElapsedMilli(&device->lastRead);
+        int change = raw > device->lastRaw ? raw - device->lastRaw : device->lastRaw - raw;
+        int distance = raw - thresholds->low < thresholds->high - raw ? raw - thresholds->low
+                                                                       : thresholds->high - raw;
+
+        // A change of less than the resolution is treated as 1/16 degree, so a stable device
+        // still has a finite rate.
+        intervalMilli = distance * elapsedMilli / (2LL * (change > 0 ? change : 1));
+        if (intervalMilli > 2LL * device->intervalMilli) {
+            intervalMilli = 2LL * device->intervalMilli;
+        }
+        if (intervalMilli > pollMaxIntervalMilli) {
+            intervalMilli = pollMaxIntervalMilli;
+        }
+        if (intervalMilli < pollMinIntervalMilli) {
+            intervalMilli = pollMinIntervalMilli;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &device->lastRead);
+    device->intervalMilli = (int)intervalMilli;
+    device->lastRaw = raw;
+    device->hasRaw = true;
+    device->lastClass = class;
+}
+
+/// <summary>
+/// Records that the device could not be read, so it is read again after the minimum interval.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+void AdaptivePollReportFailure(OneWireRomId rom)
+{
+    AdaptivePollDevice *device = AdaptivePollGetDevice(rom);
+    clock_gettime(CLOCK_MONOTONIC, &device->lastRead);
+    device->intervalMilli = pollMinIntervalMilli;
+    device->hasRaw = false;
+    device->lastClass = TemperatureClass_Invalid;
+}
+
+/// <summary>
+/// Returns the device with the ROM identifier.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>The device, or NULL if the device has not been read.</returns>
+static AdaptivePollDevice *AdaptivePollFind(OneWireRomId rom)
+{
+    for (int i = 0; i < pollDeviceCount; i++) {
+        if (pollDevices[i].rom == rom) {
+            return &pollDevices[i];
+        }
+    }
+
+    return NULL;
+}
+
+/// <summary>
+/// Returns the device with the ROM identifier, adding it if it has not been read.  If every
+/// entry is in use, the device that was read longest ago is replaced.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>The device.</returns>
+static AdaptivePollDevice *AdaptivePollGetDevice(OneWireRomId rom)
+{
+    AdaptivePollDevice *device = AdaptivePollFind(rom);
+    if (device != NULL) {
+        return device;
+    }
+
+    if (pollDeviceCount < ADAPTIVE_POLL_MAX_DEVICES) {
+        device = &pollDevices[pollDeviceCount++];
+    } else {
+        device = &pollDevices[0];
+        for (int i = 1; i < pollDeviceCount; i++) {
+            if (IsEarlier(&pollDevices[i].lastRead, &device->lastRead)) {
+                device = &pollDevices[i];
+            }
+        }
+    }
+
+    *device = (AdaptivePollDevice){
+        .rom = rom,
+        .intervalMilli = pollMinIntervalMilli,
+        .hasRaw = false,
+        .lastClass = TemperatureClass_Invalid,
+    };
+    return device;
+}
+
+/// <summary>
+/// Returns true if the first time is before the second.  The times are compared directly, rather
+/// than by elapsed time, so the result is right however long ago they were.
+/// </summary>
+/// <param name="a">The first time (from clock_gettime using CLOCK_MONOTONIC).</param>
+/// <param name="b">The second time (from clock_gettime using CLOCK_MONOTONIC).</param>
+/// <returns>true if a is before b.</returns>
+static bool IsEarlier(const struct timespec *a, const struct timespec *b)
+{
+    return a->tv_sec != b->tv_sec ? a->tv_sec < b->tv_sec : a->tv_nsec < b->tv_nsec;
+}
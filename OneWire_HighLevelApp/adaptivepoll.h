@@ -0,0 +1,58 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ds18b20.h"
+#include "onewirerom.h"
+
+/// <summary>
+/// The number of devices whose read interval is tracked.  When more devices are read, the device
+/// that was read longest ago is forgotten (and is read at the minimum interval again.)
+/// </summary>
+#define ADAPTIVE_POLL_MAX_DEVICES 64
+
+/// <summary>
+/// Sets the range of the read interval of each device, and forgets every device.
+/// </summary>
+/// <param name="minIntervalMilli">The shortest interval between reads of a device, used for new
+/// devices, devices that failed, and temperatures at or outside the thresholds.</param>
+/// <param name="maxIntervalMilli">The longest interval between reads of a device.</param>
+void AdaptivePollInit(int minIntervalMilli, int maxIntervalMilli);
+
+/// <summary>
+/// Returns the time until the device should next be read.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>The time in milliseconds until the device is due (0 if it is due now, or has not
+/// been read.)</returns>
+long AdaptivePollGetDueMilli(OneWireRomId rom);
+
+/// <summary>
+/// Returns the class of the last temperature read from the device.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>The class, or TemperatureClass_Invalid if the device has not been read (or the last
+/// read failed.)</returns>
+TemperatureClass AdaptivePollGetClass(OneWireRomId rom);
+
+/// <summary>
+/// Records a temperature read from the device and chooses when to read it next.  The interval is
+/// half the time the temperature would take to reach the nearest threshold at the rate it changed
+/// since the last read, so a device that is stable and far from the thresholds is read less
+/// often.  The interval at most doubles on each read, and stays within the range given to
+/// <see src="AdaptivePollInit"/>.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <param name="raw">The temperature in 1/16 degrees celsius.</param>
+/// <param name="thresholds">The thresholds the temperature is classified against.</param>
+void AdaptivePollRecord(OneWireRomId rom, int16_t raw, const Ds18b20Thresholds *thresholds);
+
+/// <summary>
+/// Records that the device could not be read, so it is read again after the minimum interval.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+void AdaptivePollReportFailure(OneWireRomId rom);
@@ -0,0 +1,534 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Measures the OneWire search, enumeration, match, scratchpad read and temperature reads on the simulated
+// OneWire bus for 1 to 100 devices.  The slots and transfers per operation are exactly what the UART transport would
+// generate, so a change that adds slots or UART transfers shows up here before it is deployed.  The conversions of
+// the devices in 1 to 8 groups (see conversionGroupCount in main.c) are then run on a modelled timeline, to measure
+// the readings per second each number of groups gets from the bus.
+
+#include "crc16.h"
+#include "ds18b20.h"
+#include "onewire.h"
+#include "onewiredriver.h"
+#include "onewirelog.h"
+#include "onewirerom.h"
+#include "onewiresearch.h"
+#include "onewiresim.h"
+#include "onewirestats.h"
+#include "sleep.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/// <summary>
+/// The number of devices on the simulated bus for each benchmark run.
+/// </summary>
+static const int benchmarkDeviceCounts[] = {1, 2, 5, 10, 20, 50, 100};
+
+/// <summary>
+/// The number of groups the devices are converted in for each group schedule run.
+/// </summary>
+static const int benchmarkGroupCounts[] = {1, 2, 4, 8};
+
+/// <summary>
+/// The maximum number of groups in a group schedule run.
+/// </summary>
+#define BENCHMARK_MAX_GROUPS 8
+
+/// <summary>
+/// The time (in microseconds) the UART transport takes for a reset pulse (one byte at 9600 baud)
+/// and for a time slot (one byte at 115200 baud.)  The simulated bus takes no time, so the group
+/// schedule uses these to model the time the bus is in use.
+/// </summary>
+#define BENCHMARK_RESET_MICRO 1042
+#define BENCHMARK_SLOT_MICRO 87
+
+/// <summary>
+/// The conversion time (in milliseconds) of a DS18B20 at 12 bit resolution, used by the group
+/// schedule.
+/// </summary>
+#define BENCHMARK_CONVERSION_MILLI 750
+
+/// <summary>
+/// The check period (in milliseconds) of the group schedule with a single group and with more
+/// groups (minReadIntervalMilli and groupReadIntervalMilli in main.c.)
+/// </summary>
+#define BENCHMARK_SWEEP_PERIOD_MILLI 3000
+#define BENCHMARK_GROUP_PERIOD_MILLI 1000
+
+/// <summary>
+/// The modelled time (in milliseconds) each group schedule runs for.
+/// </summary>
+#define BENCHMARK_SCHEDULE_MILLI 30000
+
+/// <summary>
+/// The results of one benchmark operation.
+/// </summary>
+typedef struct {
+    long operations;
+    long successes;
+    long elapsedMicro;
+    OneWireSimCounters counters;
+} BenchmarkResult;
+
+/// <summary>
+/// A temperature register of a device family, and the temperature it decodes to.
+/// </summary>
+typedef struct {
+    uint8_t familyId;
+    uint8_t bytes[8];
+    bool valid;
+    int16_t raw;
+} DecodeVector;
+
+/// <summary>
+/// The temperatures of the DS18B20 and DS18S20 (from the temperature/data relationship tables of
+/// DS18B20.pdf and DS18S20.pdf, the DS18S20 extended with COUNT_REMAIN) and of the DS2438 (from its temperature table, and values with the
+/// 1/32 degree bit set, which round down to 1/16 degrees like the DS18B20.)
+/// </summary>
+static const DecodeVector decodeVectors[] = {
+    // DS18B20: temperature LSB and MSB, TH, TL, configuration, and 3 reserved bytes.
+    {0x28, {0xD0, 0x07, 75, 70, 0x7F, 0xFF, 0x10, 0x10}, true, 125 * 16},
+    {0x28, {0x50, 0x05, 75, 70, 0x7F, 0xFF, 0x10, 0x10}, true, 85 * 16},
+    {0x28, {0x91, 0x01, 75, 70, 0x7F, 0xFF, 0x0F, 0x10}, true, 25 * 16 + 1},
+    {0x28, {0x00, 0x00, 75, 70, 0x7F, 0xFF, 0x10, 0x10}, true, 0},
+    {0x28, {0xFF, 0xFF, 75, 70, 0x7F, 0xFF, 0x01, 0x10}, true, -1},
+    {0x28, {0x90, 0xFC, 75, 70, 0x7F, 0xFF, 0x10, 0x10}, true, -55 * 16},
+    {0x28, {0x50, 0x05, 75, 70, 0x7F, 0xFF, 0x0C, 0x10}, false, 0},
+    // DS18S20: temperature LSB and MSB, TH, TL, 2 reserved bytes, COUNT_REMAIN and COUNT_PER_C.
+    {0x10, {0x32, 0x00, 75, 70, 0xFF, 0xFF, 0x0C, 0x10}, true, 25 * 16},
+    {0x10, {0x32, 0x00, 75, 70, 0xFF, 0xFF, 0x0B, 0x10}, true, 25 * 16 + 1},
+    {0x10, {0x33, 0x00, 75, 70, 0xFF, 0xFF, 0x04, 0x10}, true, 25 * 16 + 8},
+    {0x10, {0x01, 0x00, 75, 70, 0xFF, 0xFF, 0x04, 0x10}, true, 8},
+    {0x10, {0x00, 0x00, 75, 70, 0xFF, 0xFF, 0x0C, 0x10}, true, 0},
+    {0x10, {0xFF, 0xFF, 75, 70, 0xFF, 0xFF, 0x04, 0x10}, true, -8},
+    {0x10, {0xCE, 0xFF, 75, 70, 0xFF, 0xFF, 0x0C, 0x10}, true, -25 * 16},
+    {0x10, {0x92, 0xFF, 75, 70, 0xFF, 0xFF, 0x0C, 0x10}, true, -55 * 16},
+    {0x10, {0xAA, 0x00, 75, 70, 0xFF, 0xFF, 0x0C, 0x10}, false, 0},
+    {0x10, {0x32, 0x00, 75, 70, 0xFF, 0xFF, 0x0C, 0x0F}, false, 0},
+    // DS2438: status, temperature LSB and MSB (1/256 degrees), voltage, current and threshold.
+    {0x26, {0x00, 0x00, 0x7D, 0, 0, 0, 0, 0}, true, 125 * 16},
+    {0x26, {0x00, 0x10, 0x19, 0, 0, 0, 0, 0}, true, 25 * 16 + 1},
+    {0x26, {0x00, 0x20, 0x0A, 0, 0, 0, 0, 0}, true, 10 * 16 + 2},
+    {0x26, {0x00, 0x80, 0x00, 0, 0, 0, 0, 0}, true, 8},
+    {0x26, {0x00, 0x00, 0x00, 0, 0, 0, 0, 0}, true, 0},
+    {0x26, {0x00, 0x80, 0xFF, 0, 0, 0, 0, 0}, true, -8},
+    {0x26, {0x00, 0xE0, 0xF5, 0, 0, 0, 0, 0}, true, -10 * 16 - 2},
+    {0x26, {0x00, 0xF0, 0xE6, 0, 0, 0, 0, 0}, true, -25 * 16 - 1},
+    {0x26, {0x00, 0x00, 0xC9, 0, 0, 0, 0, 0}, true, -55 * 16},
+    {0x26, {0x00, 0xF8, 0xFF, 0, 0, 0, 0, 0}, true, -1},
+    {0x26, {0x00, 0xD8, 0xF5, 0, 0, 0, 0, 0}, true, -10 * 16 - 3},
+    {0x26, {0x00, 0x18, 0x19, 0, 0, 0, 0, 0}, true, 25 * 16 + 1},
+    {0x26, {0x00, 0x04, 0x19, 0, 0, 0, 0, 0}, false, 0},
+};
+
+static bool CheckDecodeVectors(void);
+static void AddSimulatedDevices(int deviceCount, bool allVccPowered, int conversionTimeMilli);
+static bool RunGroupSchedule(const OneWireRomId *roms, int romCount, int groupCount);
+static long GetBusMicro(const OneWireSimCounters *start);
+static void StartResult(BenchmarkResult *result, struct timespec *start);
+static void FinishResult(BenchmarkResult *result, const struct timespec *start);
+static void PrintResult(const char *name, int deviceCount, const BenchmarkResult *result);
+
+/// <summary>
+/// Decodes each of decodeVectors with the driver of its family, and checks the CRC16 of the
+/// standard check string ("123456789", 0xBB3D before it is inverted.)  Prints each value that
+/// does not match.
+/// </summary>
+/// <returns>true if every value matched, otherwise false.</returns>
+static bool CheckDecodeVectors(void)
+{
+    int count = (int)(sizeof(decodeVectors) / sizeof(decodeVectors[0]));
+    int passed = 0;
+    for (int i = 0; i < count; i++) {
+        const DecodeVector *vector = &decodeVectors[i];
+        OneWireRomId rom = OneWireSimMakeRomId(vector->familyId, (uint64_t)i + 1);
+        Ds18b20Scratchpad scratchpad;
+        memset(&scratchpad, 0, sizeof(scratchpad));
+        memcpy(scratchpad.bytes, vector->bytes, sizeof(vector->bytes));
+
+        const Ds18b20Thresholds thresholds = {.low = -55 * 16, .high = 125 * 16};
+        int16_t raw = 0;
+        TemperatureClass class;
+        bool valid = OneWireDriverDecodeScratchpads(&rom, &scratchpad, 1, &thresholds, &raw,
+                                                    &class) == 1;
+        if (valid == vector->valid && (!valid || raw == vector->raw)) {
+            passed++;
+        } else {
+            printf("decode %d: family 0x%02x %02x%02x gave %s %d instead of %s %d\n", i,
+                   vector->familyId, vector->bytes[1], vector->bytes[0],
+                   valid ? "valid" : "invalid", raw, vector->valid ? "valid" : "invalid",
+                   vector->raw);
+        }
+    }
+
+    const char *checkString = "123456789";
+    uint16_t crc = Crc16Compute((const uint8_t *)checkString, strlen(checkString), 0);
+    bool crcMatched = crc == 0xBB3D;
+    if (!crcMatched) {
+        printf("crc16: 0x%04x instead of 0xbb3d\n", crc);
+    }
+
+    // The decoders log the implausible values, which are expected here.
+    OneWireLogFlush();
+    printf("%-10s %7s %7d/%-7d\n\n", "decode", "-", passed, count);
+    return passed == count && crcMatched;
+}
+
+/// <summary>
+/// Adds DS18B20 devices with pseudo random serial numbers to the simulated bus.
+/// </summary>
+/// <param name="deviceCount">The number of devices to add.</param>
+/// <param name="allVccPowered">true if every device is VCC powered, false if half of them
+/// are.</param>
+/// <param name="conversionTimeMilli">The time each device takes to convert.</param>
+static void AddSimulatedDevices(int deviceCount, bool allVccPowered, int conversionTimeMilli)
+{
+    uint64_t serialNumber = 0x0000123456789ABCULL;
+    for (int i = 0; i < deviceCount; i++) {
+        serialNumber = serialNumber * 6364136223846793005ULL + 1442695040888963407ULL;
+        OneWireSimDeviceConfig config = {
+            .rom = OneWireSimMakeRomId(0x28, serialNumber >> 16),
+            .vccPowered = allVccPowered || (i % 2) == 0,
+            .temperature = (int16_t)((20 + i % 10) * 16),
+            .conversionTimeMilli = conversionTimeMilli,
+        };
+        OneWireSimAddDevice(&config);
+    }
+}
+
+/// <summary>
+/// Runs the convert and read cycles of the devices split into groups, like the scheduler does
+/// (see onewirescheduler.h), on a modelled timeline: each step uses the bus for the time of its
+/// reset pulses and time slots, and a conversion takes BENCHMARK_CONVERSION_MILLI.  The cycles of
+/// the groups are staggered across the check period, and a step that falls due while the bus is
+/// in use waits for it.  A single group converts every device with Skip ROM; more groups convert
+/// each device with Match ROM.  Prints the readings per second and the time the bus is in use.
+/// </summary>
+/// <param name="roms">The ROM identifiers of the devices (every device is VCC powered, and
+/// converts straight away.)</param>
+/// <param name="romCount">The number of devices.</param>
+/// <param name="groupCount">The number of groups (1 to BENCHMARK_MAX_GROUPS.)</param>
+/// <returns>true if every conversion was started and every scratchpad was read, otherwise
+/// false.</returns>
+static bool RunGroupSchedule(const OneWireRomId *roms, int romCount, int groupCount)
+{
+    long periodMicro =
+        (groupCount > 1 ? BENCHMARK_GROUP_PERIOD_MILLI : BENCHMARK_SWEEP_PERIOD_MILLI) * 1000L;
+    long nextMicro[BENCHMARK_MAX_GROUPS];
+    long cycleStartMicro[BENCHMARK_MAX_GROUPS];
+    bool converting[BENCHMARK_MAX_GROUPS];
+    for (int group = 0; group < groupCount; group++) {
+        nextMicro[group] = group * periodMicro / groupCount;
+        converting[group] = false;
+    }
+
+    long busFreeMicro = 0;
+    long busyMicro = 0;
+    long readings = 0;
+    long failures = 0;
+    const long endMicro = BENCHMARK_SCHEDULE_MILLI * 1000L;
+    for (;;) {
+        int group = 0;
+        for (int i = 1; i < groupCount; i++) {
+            if (nextMicro[i] < nextMicro[group]) {
+                group = i;
+            }
+        }
+
+        long nowMicro = nextMicro[group] > busFreeMicro ? nextMicro[group] : busFreeMicro;
+        if (nowMicro >= endMicro) {
+            break;
+        }
+
+        OneWireRomId groupRoms[ONEWIRE_SIM_MAX_DEVICES];
+        int count = 0;
+        for (int i = group; i < romCount; i += groupCount) {
+            groupRoms[count++] = roms[i];
+        }
+
+        OneWireSimCounters start;
+        OneWireSimGetCounters(&start);
+        if (!converting[group]) {
+            bool started[ONEWIRE_SIM_MAX_DEVICES];
+            bool status = groupCount > 1 ? Ds18b20StartConvertTs(groupRoms, count, started) == count
+                                         : OneWireReset() == DevicePresent && OneWireSkipROM() &&
+                                               Ds18b20StartConvertT(false);
+            failures += status ? 0 : 1;
+            cycleStartMicro[group] = nowMicro;
+        } else {
+            Ds18b20Scratchpad scratchpads[ONEWIRE_SIM_MAX_DEVICES];
+            bool valid[ONEWIRE_SIM_MAX_DEVICES];
+            int validCount = Ds18b20ReadScratchpads(groupRoms, count, scratchpads, valid);
+            readings += validCount;
+            failures += count - validCount;
+        }
+
+        long stepMicro = GetBusMicro(&start);
+        busyMicro += stepMicro;
+        busFreeMicro = nowMicro + stepMicro;
+        if (!converting[group]) {
+            nextMicro[group] = busFreeMicro + BENCHMARK_CONVERSION_MILLI * 1000L;
+        } else {
+            nextMicro[group] = cycleStartMicro[group] + periodMicro;
+        }
+        converting[group] = !converting[group];
+    }
+
+    printf("%-10s %7d %6d %10ld %11.1f %7.1f%% %6ld\n", "groups", romCount, groupCount,
+           periodMicro / 1000, readings * 1000000.0 / endMicro, busyMicro * 100.0 / endMicro,
+           failures);
+    return failures == 0;
+}
+
+/// <summary>
+/// Returns the modelled time the bus was in use for the reset pulses and time slots generated
+/// since the counters were read.
+/// </summary>
+/// <param name="start">The counters at the start.</param>
+/// <returns>The time in microseconds.</returns>
+static long GetBusMicro(const OneWireSimCounters *start)
+{
+    OneWireSimCounters counters;
+    OneWireSimGetCounters(&counters);
+    return (counters.resets - start->resets) * BENCHMARK_RESET_MICRO +
+           (counters.slots - start->slots) * BENCHMARK_SLOT_MICRO;
+}
+
+/// <summary>
+/// Starts measuring an operation.
+/// </summary>
+/// <param name="result">The result, which is cleared.</param>
+/// <param name="start">Receives the start time.</param>
+static void StartResult(BenchmarkResult *result, struct timespec *start)
+{
+    *result = (BenchmarkResult){0};
+    OneWireSimGetCounters(&result->counters);
+    clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+/// <summary>
+/// Finishes measuring an operation: the elapsed time, and the signals generated on the bus since
+/// <see src="StartResult"/>.
+/// </summary>
+/// <param name="result">The result.</param>
+/// <param name="start">The start time.</param>
+static void FinishResult(BenchmarkResult *result, const struct timespec *start)
+{
+    result->elapsedMicro = ElapsedMicro(start);
+
+    OneWireSimCounters counters;
+    OneWireSimGetCounters(&counters);
+    result->counters.resets = counters.resets - result->counters.resets;
+    result->counters.slots = counters.slots - result->counters.slots;
+    result->counters.transfers = counters.transfers - result->counters.transfers;
+    result->counters.noiseErrors = counters.noiseErrors - result->counters.noiseErrors;
+}
+
+/// <summary>
+/// Prints a row of the results: the successful operations, and the time, resets, slots and
+/// transfers per operation.
+/// </summary>
+/// <param name="name">The name of the operation.</param>
+/// <param name="deviceCount">The number of devices on the bus.</param>
+/// <param name="result">The result.</param>
+static void PrintResult(const char *name, int deviceCount, const BenchmarkResult *result)
+{
+    double operations = result->operations > 0 ? (double)result->operations : 1.0;
+    printf("%-10s %7d %7ld/%-7ld %10.2f %8.2f %9.1f %9.2f %6ld\n", name, deviceCount,
+           result->successes, result->operations, result->elapsedMicro / operations,
+           result->counters.resets / operations, result->counters.slots / operations,
+           result->counters.transfers / operations, result->counters.noiseErrors);
+}
+
+/// <summary>
+/// Runs the benchmark.
+/// </summary>
+/// <param name="argc">The number of arguments.</param>
+/// <param name="argv">[maxDevices] [iterations] [noiseErrorsPerMillion]</param>
+/// <returns>0 if every operation succeeded (without noise), otherwise 1.</returns>
+int main(int argc, char *argv[])
+{
+    int maxDevices = argc > 1 ? atoi(argv[1]) : 100;
+    int iterations = argc > 2 ? atoi(argv[2]) : 10;
+    int noiseErrorsPerMillion = argc > 3 ? atoi(argv[3]) : 0;
+    if (iterations < 1) {
+        iterations = 1;
+    }
+
+    OneWireSetTransport(OneWireSimGetTransport());
+    OneWireStatsReset();
+
+    bool allSucceeded = CheckDecodeVectors();
+    printf("%-10s %7s %15s %10s %8s %9s %9s %6s\n", "operation", "devices", "ok/total",
+           "us/op", "resets/op", "slots/op", "xfers/op", "noise");
+    for (size_t run = 0; run < sizeof(benchmarkDeviceCounts) / sizeof(benchmarkDeviceCounts[0]);
+         run++) {
+        int deviceCount = benchmarkDeviceCounts[run];
+        if (deviceCount > maxDevices) {
+            break;
+        }
+
+        OneWireSimInit((unsigned int)(run + 1));
+        AddSimulatedDevices(deviceCount, false, BENCHMARK_CONVERSION_MILLI);
+
+        // The temperature reads need a completed conversion, as the power on value (85C) is not a
+        // valid temperature.
+        bool converted = OneWireReset() == DevicePresent && OneWireSkipROM() &&
+                         Ds18b20ConvertT(false, ThermometerResolution12bits);
+        OneWireSimSetNoise(noiseErrorsPerMillion);
+
+        // Search: each operation finds one device.
+        OneWireRomId roms[ONEWIRE_SIM_MAX_DEVICES];
+        int romCount = 0;
+        BenchmarkResult search;
+        struct timespec start;
+        StartResult(&search, &start);
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            OneWireSearchContext context;
+            OneWireSearchContextReset(&context);
+            int found = 0;
+            while (OneWireSearchNext(&context, false)) {
+                if (iteration == 0 && romCount < ONEWIRE_SIM_MAX_DEVICES) {
+                    roms[romCount++] = context.rom;
+                }
+                found++;
+            }
+            search.operations += deviceCount;
+            search.successes += found;
+        }
+        FinishResult(&search, &start);
+        PrintResult("search", deviceCount, &search);
+
+        // Enumerate: find every device in one call, without and with the previous topology.
+        OneWireRomId enumerated[ONEWIRE_SIM_MAX_DEVICES];
+        BenchmarkResult enumerate;
+        StartResult(&enumerate, &start);
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            // A search that fails part way (-1) finds none of the devices.
+            int found = OneWireSearchAll(0, false, NULL, 0, enumerated, ONEWIRE_SIM_MAX_DEVICES,
+                                         NULL);
+            enumerate.operations += deviceCount;
+            enumerate.successes += found > 0 ? found : 0;
+        }
+        FinishResult(&enumerate, &start);
+        PrintResult("enumerate", deviceCount, &enumerate);
+
+        BenchmarkResult warm;
+        StartResult(&warm, &start);
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            int found = OneWireSearchAll(0, false, roms, romCount, enumerated,
+                                         ONEWIRE_SIM_MAX_DEVICES, NULL);
+            warm.operations += deviceCount;
+            warm.successes += found > 0 ? found : 0;
+        }
+        FinishResult(&warm, &start);
+        PrintResult("enum-warm", deviceCount, &warm);
+
+        // Match: address each device that was found.
+        BenchmarkResult match;
+        StartResult(&match, &start);
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            for (int i = 0; i < romCount; i++) {
+                match.operations++;
+                match.successes += OneWireMatchRomId(roms[i]) ? 1 : 0;
+            }
+        }
+        FinishResult(&match, &start);
+        PrintResult("match", deviceCount, &match);
+
+        // Match and read the scratchpad of each device that was found.
+        BenchmarkResult read;
+        StartResult(&read, &start);
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            for (int i = 0; i < romCount; i++) {
+                read.operations++;
+                if (OneWireMatchRomId(roms[i]) && Ds18b20ReadScratchpad()) {
+                    read.successes++;
+                }
+            }
+        }
+        FinishResult(&read, &start);
+        PrintResult("scratchpad", deviceCount, &read);
+
+        // Match and read only the temperature bytes of each device that was found.
+        BenchmarkResult temperature;
+        StartResult(&temperature, &start);
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            for (int i = 0; i < romCount; i++) {
+                int16_t raw;
+                temperature.operations++;
+                if (OneWireMatchRomId(roms[i]) &&
+                    Ds18b20ReadTemperature(ThermometerResolution12bits, &raw)) {
+                    temperature.successes++;
+                }
+            }
+        }
+        FinishResult(&temperature, &start);
+        PrintResult("temp", deviceCount, &temperature);
+
+        // Read the temperature bytes of every device that was found in one pipelined pass.
+        ThermometerResolution resolutions[ONEWIRE_SIM_MAX_DEVICES];
+        int16_t raw[ONEWIRE_SIM_MAX_DEVICES];
+        bool valid[ONEWIRE_SIM_MAX_DEVICES];
+        for (int i = 0; i < romCount; i++) {
+            resolutions[i] = ThermometerResolution12bits;
+        }
+        BenchmarkResult pipelined;
+        StartResult(&pipelined, &start);
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            pipelined.operations += romCount;
+            pipelined.successes +=
+                Ds18b20ReadTemperatures(roms, resolutions, romCount, raw, valid);
+        }
+        FinishResult(&pipelined, &start);
+        PrintResult("pipelined", deviceCount, &pipelined);
+
+        allSucceeded = allSucceeded && converted && search.successes == search.operations &&
+                       enumerate.successes == enumerate.operations &&
+                       warm.successes == warm.operations &&
+                       match.successes == match.operations && read.successes == read.operations &&
+                       temperature.successes == temperature.operations &&
+                       pipelined.successes == pipelined.operations;
+    }
+
+    // The group schedule uses the most devices of the runs above, all VCC powered as the group
+    // conversions need; the conversion time is modelled, so the simulated devices convert at once.
+    int scheduleDeviceCount = 0;
+    for (size_t run = 0; run < sizeof(benchmarkDeviceCounts) / sizeof(benchmarkDeviceCounts[0]);
+         run++) {
+        if (benchmarkDeviceCounts[run] <= maxDevices) {
+            scheduleDeviceCount = benchmarkDeviceCounts[run];
+        }
+    }
+
+    if (scheduleDeviceCount > 0) {
+        OneWireSimInit(1);
+        AddSimulatedDevices(scheduleDeviceCount, true, 0);
+        OneWireSimSetNoise(noiseErrorsPerMillion);
+        OneWireRomId roms[ONEWIRE_SIM_MAX_DEVICES];
+        int romCount = OneWireSearchAll(0, false, NULL, 0, roms, ONEWIRE_SIM_MAX_DEVICES, NULL);
+        allSucceeded = allSucceeded && romCount == scheduleDeviceCount;
+        if (romCount < 0) {
+            romCount = 0;
+        }
+
+        printf("\n%-10s %7s %6s %10s %11s %8s %6s\n", "schedule", "devices", "groups",
+               "period ms", "readings/s", "bus use", "failed");
+        for (size_t run = 0; run < sizeof(benchmarkGroupCounts) / sizeof(benchmarkGroupCounts[0]);
+             run++) {
+            allSucceeded =
+                RunGroupSchedule(roms, romCount, benchmarkGroupCounts[run]) && allSucceeded;
+        }
+    }
+
+    OneWireLogFlush();
+    OneWireStatsDump();
+    OneWireSetTransport(NULL);
+    return (allSucceeded || noiseErrorsPerMillion > 0) ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Replays a OneWire trace recorded on a device (see onewiretrace.h) through the OneWire search
+// and the DS18B20 scratchpad read, and summarizes the recorded transactions.  The trace is either
+// a binary encoded trace or a copy of the device output, from which the "TRACE: " lines are read
+// (each "OneWire trace of" line starts another trace.)
+
+#include "ds18b20.h"
+#include "onewire.h"
+#include "onewirelog.h"
+#include "onewirereplay.h"
+#include "onewiresearch.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// <summary>
+/// The largest trace file that can be read.
+/// </summary>
+#define REPLAY_MAX_FILE_SIZE (64 * 1024 * 1024)
+
+/// <summary>
+/// The maximum number of devices found by the replayed search.
+/// </summary>
+#define REPLAY_MAX_DEVICES 256
+
+/// <summary>
+/// The number of slowest transactions listed.
+/// </summary>
+#define REPLAY_SLOWEST_COUNT 5
+
+static bool LoadTraceFile(const char *path, int bus);
+static bool LoadLogTraces(char *text, int bus, uint8_t *buffer);
+static int HexDigit(char c);
+static void PrintSummary(void);
+static void ReplaySearchAndRead(uint8_t familyId);
+
+/// <summary>
+/// Reads a trace file and loads the traces of the bus.
+/// </summary>
+/// <param name="path">The path of the file.</param>
+/// <param name="bus">The bus to replay.</param>
+/// <returns>true if every trace was loaded, otherwise false.</returns>
+static bool LoadTraceFile(const char *path, int bus)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "ERROR: Could not open %s.\n", path);
+        return false;
+    }
+
+    uint8_t *data = malloc(REPLAY_MAX_FILE_SIZE + 1);
+    size_t length = data != NULL ? fread(data, 1, REPLAY_MAX_FILE_SIZE, file) : 0;
+    fclose(file);
+    if (data == NULL || length == REPLAY_MAX_FILE_SIZE) {
+        fprintf(stderr, "ERROR: %s is too large.\n", path);
+        free(data);
+        return false;
+    }
+
+    bool loaded;
+    if (length >= 3 && memcmp(data, "OWT", 3) == 0) {
+        loaded = OneWireReplayLoad(data, length, bus);
+    } else {
+        // The decoded trace is never longer than its text, so it is decoded into a buffer of
+        // the same size.
+        data[length] = '\0';
+        uint8_t *buffer = malloc(length + 1);
+        loaded = buffer != NULL && LoadLogTraces((char *)data, bus, buffer);
+        free(buffer);
+    }
+
+    free(data);
+    if (!loaded) {
+        fprintf(stderr, "ERROR: %s has an invalid trace.\n", path);
+    }
+    return loaded;
+}
+
+/// <summary>
+/// Loads the traces logged by OneWireTraceLog from a copy of the device output.
+/// </summary>
+/// <param name="text">The device output (modified.)</param>
+/// <param name="bus">The bus to replay.</param>
+/// <param name="buffer">Used to decode the traces (at least the length of the text.)</param>
+/// <returns>true if every trace was loaded, otherwise false.</returns>
+static bool LoadLogTraces(char *text, int bus, uint8_t *buffer)
+{
+    bool loaded = true;
+    size_t length = 0;
+    for (char *line = strtok(text, "\r\n"); line != NULL; line = strtok(NULL, "\r\n")) {
+        if (strstr(line, "OneWire trace of") != NULL) {
+            if (length > 0) {
+                loaded = OneWireReplayLoad(buffer, length, bus) && loaded;
+            }
+            length = 0;
+            continue;
+        }
+
+        const char *hex = strstr(line, "TRACE: ");
+        if (hex == NULL) {
+            continue;
+        }
+        for (hex += strlen("TRACE: "); HexDigit(hex[0]) >= 0 && HexDigit(hex[1]) >= 0;
+             hex += 2) {
+            buffer[length++] = (uint8_t)(HexDigit(hex[0]) << 4 | HexDigit(hex[1]));
+        }
+    }
+
+    if (length > 0) {
+        loaded = OneWireReplayLoad(buffer, length, bus) && loaded;
+    }
+    return loaded;
+}
+
+/// <summary>
+/// Returns the value of a hexadecimal digit.
+/// </summary>
+/// <param name="c">The digit.</param>
+/// <returns>The value, or -1 if it is not a hexadecimal digit.</returns>
+static int HexDigit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/// <summary>
+/// Prints the number of transactions for each ROM command, the failures, and the slowest
+/// transactions.
+/// </summary>
+static void PrintSummary(void)
+{
+    int count = OneWireReplayGetTransactionCount();
+    long romCommands[256] = {0};
+    long shortTransactions = 0;
+    long failedResets = 0;
+    long failedTransactions = 0;
+    long slots = 0;
+    long totalMicro = 0;
+    int slowest[REPLAY_SLOWEST_COUNT];
+    int slowestCount = 0;
+    for (int i = 0; i < count; i++) {
+        OneWireReplayTransaction transaction;
+        OneWireReplayGetTransaction(i, &transaction);
+        if (transaction.romCommand >= 0) {
+            romCommands[transaction.romCommand]++;
+        } else {
+            shortTransactions++;
+        }
+        failedResets += transaction.reset != DevicePresent ? 1 : 0;
+        failedTransactions += transaction.failed ? 1 : 0;
+        slots += transaction.slotCount;
+        totalMicro += transaction.durationMicro;
+
+        // Keep the slowest transactions in order, slowest first.
+        int position = slowestCount < REPLAY_SLOWEST_COUNT ? slowestCount++ : slowestCount;
+        while (position > 0) {
+            OneWireReplayTransaction other;
+            OneWireReplayGetTransaction(slowest[position - 1], &other);
+            if (other.durationMicro >= transaction.durationMicro) {
+                break;
+            }
+            if (position < REPLAY_SLOWEST_COUNT) {
+                slowest[position] = slowest[position - 1];
+            }
+            position--;
+        }
+        if (position < REPLAY_SLOWEST_COUNT) {
+            slowest[position] = i;
+        }
+    }
+
+    printf("%d transactions, %ld slots, %ld us on the bus\n", count, slots, totalMicro);
+    printf("%ld resets without a presence pulse, %ld failed transactions\n", failedResets,
+           failedTransactions);
+    for (int command = 0; command < 256; command++) {
+        if (romCommands[command] > 0) {
+            printf("  ROM command 0x%02x: %ld\n", command, romCommands[command]);
+        }
+    }
+    if (shortTransactions > 0) {
+        printf("  no ROM command: %ld\n", shortTransactions);
+    }
+
+    printf("slowest transactions:\n");
+    for (int i = 0; i < slowestCount; i++) {
+        OneWireReplayTransaction transaction;
+        OneWireReplayGetTransaction(slowest[i], &transaction);
+        printf("  #%d: %ld us, %d slots, reset %d", slowest[i], transaction.durationMicro,
+               transaction.slotCount, transaction.reset);
+        if (transaction.romCommand >= 0) {
+            printf(", ROM command 0x%02x", transaction.romCommand);
+        }
+        printf("%s\n", transaction.failed ? ", failed" : "");
+    }
+}
+
+/// <summary>
+/// Replays a search for the devices of a family, and a scratchpad read of each device found.
+/// </summary>
+/// <param name="familyId">The family identifier of the devices, or 0 for all devices.</param>
+static void ReplaySearchAndRead(uint8_t familyId)
+{
+    OneWireReplayRewind();
+    OneWireSetTransport(OneWireReplayGetTransport());
+
+    OneWireRomId roms[REPLAY_MAX_DEVICES];
+    long searchSlots = 0;
+    int found = OneWireSearchAll(familyId, false, NULL, 0, roms, REPLAY_MAX_DEVICES, &searchSlots);
+    if (found < 0) {
+        printf("search failed after %ld slots\n", searchSlots);
+        found = 0;
+    } else {
+        printf("search found %d devices in %ld slots\n", found, searchSlots);
+    }
+
+    for (int i = 0; i < found; i++) {
+        if (OneWireMatchRomId(roms[i]) && Ds18b20ReadScratchpad()) {
+            int32_t centi = Ds18b20RawToCentiCelsius(GetScratchpadRaw());
+            printf("  %016llx: %ld.%02ld C\n", (unsigned long long)roms[i], (long)centi / 100,
+                   labs((long)centi % 100));
+        } else {
+            printf("  %016llx: read failed\n", (unsigned long long)roms[i]);
+        }
+    }
+
+    OneWireReplayCounters counters;
+    OneWireReplayGetCounters(&counters);
+    printf("replayed %ld resets, %ld slots, %ld transfers, %ld us recorded\n", counters.resets,
+           counters.slots, counters.transfers, counters.recordedMicro);
+    printf("%ld slots were not recorded, %ld transactions were reordered\n",
+           counters.unrecordedSlots, counters.reorderedTransactions);
+
+    OneWireLogFlush();
+    OneWireSetTransport(NULL);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <trace file> [bus] [familyId (hex, default 28)]\n", argv[0]);
+        return 2;
+    }
+
+    int bus = argc > 2 ? atoi(argv[2]) : 0;
+    uint8_t familyId = argc > 3 ? (uint8_t)strtoul(argv[3], NULL, 16) : 0x28;
+    bool loaded = LoadTraceFile(argv[1], bus);
+    if (OneWireReplayGetTransactionCount() == 0) {
+        fprintf(stderr, "ERROR: No transactions on bus %d.\n", bus);
+        return 1;
+    }
+
+    PrintSummary();
+    ReplaySearchAndRead(familyId);
+    return loaded ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host replacement for the Azure Sphere applibs GPIO API, used by the OneWire benchmark.  There
+// is no GPIO on the host, so opening a GPIO always fails.
+
+#pragma once
+
+#include <errno.h>
+
+typedef int GPIO_Id;
+
+typedef enum {
+    GPIO_Value_Low = 0,
+    GPIO_Value_High = 1,
+} GPIO_Value_Type;
+
+typedef enum {
+    GPIO_OutputMode_PushPull = 0,
+    GPIO_OutputMode_OpenDrain = 1,
+    GPIO_OutputMode_OpenSource = 2,
+} GPIO_OutputMode_Type;
+
+/// <summary>
+/// Fails with ENODEV.
+/// </summary>
+static inline int GPIO_OpenAsOutput(GPIO_Id gpioId, GPIO_OutputMode_Type outputMode,
+                                    GPIO_Value_Type initialValue)
+{
+    (void)gpioId;
+    (void)outputMode;
+    (void)initialValue;
+    errno = ENODEV;
+    return -1;
+}
+
+/// <summary>
+/// Fails with EBADF.
+/// </summary>
+static inline int GPIO_SetValue(int gpioFd, GPIO_Value_Type value)
+{
+    (void)gpioFd;
+    (void)value;
+    errno = EBADF;
+    return -1;
+}
@@ -0,0 +1,22 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host replacement for the Azure Sphere applibs log API, used by the OneWire benchmark.  The log
+// is written to stderr so that the benchmark results on stdout are not mixed with it.
+
+#pragma once
+
+#include <stdarg.h>
+#include <stdio.h>
+
+/// <summary>
+/// Writes the formatted message to stderr.
+/// </summary>
+static inline int Log_Debug(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int result = vfprintf(stderr, fmt, args);
+    va_end(args);
+    return result;
+}
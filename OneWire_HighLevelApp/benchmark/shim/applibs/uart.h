@@ -0,0 +1,52 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host replacement for the Azure Sphere applibs UART API, used by the OneWire benchmark.  There
+// is no UART on the host, so opening a UART always fails.
+
+#pragma once
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef int UART_Id;
+typedef uint32_t UART_BaudRate_Type;
+typedef uint8_t UART_BlockingMode_Type;
+typedef uint8_t UART_DataBits_Type;
+typedef uint8_t UART_Parity_Type;
+typedef uint8_t UART_StopBits_Type;
+typedef uint8_t UART_FlowControl_Type;
+
+enum { UART_FlowControl_None = 0 };
+enum { UART_Parity_None = 0 };
+enum { UART_DataBits_Eight = 3 };
+enum { UART_StopBits_One = 1 };
+
+typedef struct {
+    UART_BaudRate_Type baudRate;
+    UART_BlockingMode_Type blockingMode;
+    UART_DataBits_Type dataBits;
+    UART_Parity_Type parity;
+    UART_StopBits_Type stopBits;
+    UART_FlowControl_Type flowControl;
+} UART_Config;
+
+/// <summary>
+/// Clears the UART configuration.
+/// </summary>
+static inline void UART_InitConfig(UART_Config *uartConfig)
+{
+    memset(uartConfig, 0, sizeof(*uartConfig));
+}
+
+/// <summary>
+/// Fails with ENODEV.
+/// </summary>
+static inline int UART_Open(UART_Id uartId, const UART_Config *uartConfig)
+{
+    (void)uartId;
+    (void)uartConfig;
+    errno = ENODEV;
+    return -1;
+}
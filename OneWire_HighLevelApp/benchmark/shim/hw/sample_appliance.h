@@ -0,0 +1,7 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host replacement for the hardware definition header, used by the OneWire benchmark.  The
+// benchmark uses the simulated OneWire bus, so no peripherals are defined.
+
+#pragma once
@@ -0,0 +1,34 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// By default the CRC uses a 256 entry lookup table.  Define CRC_USE_NIBBLE_TABLES to use a 16
+// entry table instead, which saves flash but is slower.
+
+/// <summary>
+/// Calculates the Maxim (Dallas) CRC16 of a buffer.  The CRC16 is used by devices such as the
+/// DS2408 and DS2438 to protect the data they send.  Pass the previous result as the seed to
+/// continue a CRC over more data (e.g. the command bytes followed by the data read.)
+/// </summary>
+/// <param name="data">The data to use in the CRC16 calculation.</param>
+/// <param name="length">The number of bytes of data.</param>
+/// <param name="seed">The initial CRC value (0 for a new calculation.)</param>
+/// <returns>The CRC16 value.</returns>
+uint16_t Crc16Compute(const uint8_t *data, size_t length, uint16_t seed);
+
+/// <summary>
+/// Checks the CRC16 sent by a OneWire device.  The devices send the inverted CRC16 (least
+/// significant byte first) after the data, so the CRC16 of the data and the two CRC bytes is
+/// always 0xB001 when they match.
+/// </summary>
+/// <param name="data">The data followed by the two inverted CRC16 bytes sent by the device.</param>
+/// <param name="length">The number of bytes, including the two CRC16 bytes.</param>
+/// <param name="seed">The CRC16 of any bytes before the data that are covered by the CRC (e.g. the
+/// command bytes), or 0.</param>
+/// <returns>true if the CRC16 matched, otherwise false.</returns>
+bool Crc16Check(const uint8_t *data, size_t length, uint16_t seed);
@@ -35,11 +35,18 @@ in the Dallas Semiconductor Branding Policy.
 
 #include "crc8.h"
 
+#include <stddef.h>
+#include <stdint.h>
+
 // The global crc8 value.
 static uint8_t OneWireCrc8 = 0;
 
+static uint8_t Crc8UpdateByte(uint8_t crc, uint8_t value);
+
+#ifndef CRC_USE_NIBBLE_TABLES
+
 // Copied from https://www.maximintegrated.com/en/design/technical-documents/app-notes/1/187.html
-static unsigned char dscrc_table[] = {
+static const uint8_t dscrc_table[256] = {
     0,   94,  188, 226, 97,  63,  221, 131, 194, 156, 126, 32,  163, 253, 31,  65,  157, 195, 33,
     127, 252, 162, 64,  30,  95,  1,   227, 189, 62,  96,  130, 220, 35,  125, 159, 193, 66,  28,
     254, 160, 225, 191, 93,  3,   128, 222, 60,  98,  190, 224, 2,   92,  223, 129, 99,  61,  124,
@@ -55,6 +62,107 @@ static unsigned char dscrc_table[] = {
     136, 214, 52,  106, 43,  117, 151, 201, 74,  20,  246, 168, 116, 42,  200, 150, 21,  75,  169,
     247, 182, 232, 10,  84,  215, 137, 107, 53};
 
+// The slice-by-4 tables.  crc8SliceTableN[x] is dscrc_table[x] followed by N zero bytes, so four
+// bytes can be combined with one lookup each (the CRC is linear, so the lookups are XORed.)
+static const uint8_t crc8SliceTable1[256] = {
+    0x00, 0xc4, 0x91, 0x55, 0x3b, 0xff, 0xaa, 0x6e, 0x76, 0xb2, 0xe7, 0x23, 0x4d, 0x89, 0xdc, 0x18,
+    0xec, 0x28, 0x7d, 0xb9, 0xd7, 0x13, 0x46, 0x82, 0x9a, 0x5e, 0x0b, 0xcf, 0xa1, 0x65, 0x30, 0xf4,
+    0xc1, 0x05, 0x50, 0x94, 0xfa, 0x3e, 0x6b, 0xaf, 0xb7, 0x73, 0x26, 0xe2, 0x8c, 0x48, 0x1d, 0xd9,
+    0x2d, 0xe9, 0xbc, 0x78, 0x16, 0xd2, 0x87, 0x43, 0x5b, 0x9f, 0xca, 0x0e, 0x60, 0xa4, 0xf1, 0x35,
+    0x9b, 0x5f, 0x0a, 0xce, 0xa0, 0x64, 0x31, 0xf5, 0xed, 0x29, 0x7c, 0xb8, 0xd6, 0x12, 0x47, 0x83,
+    0x77, 0xb3, 0xe6, 0x22, 0x4c, 0x88, 0xdd, 0x19, 0x01, 0xc5, 0x90, 0x54, 0x3a, 0xfe, 0xab, 0x6f,
+    0x5a, 0x9e, 0xcb, 0x0f, 0x61, 0xa5, 0xf0, 0x34, 0x2c, 0xe8, 0xbd, 0x79, 0x17, 0xd3, 0x86, 0x42,
+    0xb6, 0x72, 0x27, 0xe3, 0x8d, 0x49, 0x1c, 0xd8, 0xc0, 0x04, 0x51, 0x95, 0xfb, 0x3f, 0x6a, 0xae,
+    0x2f, 0xeb, 0xbe, 0x7a, 0x14, 0xd0, 0x85, 0x41, 0x59, 0x9d, 0xc8, 0x0c, 0x62, 0xa6, 0xf3, 0x37,
+    0xc3, 0x07, 0x52, 0x96, 0xf8, 0x3c, 0x69, 0xad, 0xb5, 0x71, 0x24, 0xe0, 0x8e, 0x4a, 0x1f, 0xdb,
+    0xee, 0x2a, 0x7f, 0xbb, 0xd5, 0x11, 0x44, 0x80, 0x98, 0x5c, 0x09, 0xcd, 0xa3, 0x67, 0x32, 0xf6,
+    0x02, 0xc6, 0x93, 0x57, 0x39, 0xfd, 0xa8, 0x6c, 0x74, 0xb0, 0xe5, 0x21, 0x4f, 0x8b, 0xde, 0x1a,
+    0xb4, 0x70, 0x25, 0xe1, 0x8f, 0x4b, 0x1e, 0xda, 0xc2, 0x06, 0x53, 0x97, 0xf9, 0x3d, 0x68, 0xac,
+    0x58, 0x9c, 0xc9, 0x0d, 0x63, 0xa7, 0xf2, 0x36, 0x2e, 0xea, 0xbf, 0x7b, 0x15, 0xd1, 0x84, 0x40,
+    0x75, 0xb1, 0xe4, 0x20, 0x4e, 0x8a, 0xdf, 0x1b, 0x03, 0xc7, 0x92, 0x56, 0x38, 0xfc, 0xa9, 0x6d,
+    0x99, 0x5d, 0x08, 0xcc, 0xa2, 0x66, 0x33, 0xf7, 0xef, 0x2b, 0x7e, 0xba, 0xd4, 0x10, 0x45, 0x81,
+};
+
+static const uint8_t crc8SliceTable2[256] = {
+    0x00, 0xab, 0x4f, 0xe4, 0x9e, 0x35, 0xd1, 0x7a, 0x25, 0x8e, 0x6a, 0xc1, 0xbb, 0x10, 0xf4, 0x5f,
+    0x4a, 0xe1, 0x05, 0xae, 0xd4, 0x7f, 0x9b, 0x30, 0x6f, 0xc4, 0x20, 0x8b, 0xf1, 0x5a, 0xbe, 0x15,
+    0x94, 0x3f, 0xdb, 0x70, 0x0a, 0xa1, 0x45, 0xee, 0xb1, 0x1a, 0xfe, 0x55, 0x2f, 0x84, 0x60, 0xcb,
+    0xde, 0x75, 0x91, 0x3a, 0x40, 0xeb, 0x0f, 0xa4, 0xfb, 0x50, 0xb4, 0x1f, 0x65, 0xce, 0x2a, 0x81,
+    0x31, 0x9a, 0x7e, 0xd5, 0xaf, 0x04, 0xe0, 0x4b, 0x14, 0xbf, 0x5b, 0xf0, 0x8a, 0x21, 0xc5, 0x6e,
+    0x7b, 0xd0, 0x34, 0x9f, 0xe5, 0x4e, 0xaa, 0x01, 0x5e, 0xf5, 0x11, 0xba, 0xc0, 0x6b, 0x8f, 0x24,
+    0xa5, 0x0e, 0xea, 0x41, 0x3b, 0x90, 0x74, 0xdf, 0x80, 0x2b, 0xcf, 0x64, 0x1e, 0xb5, 0x51, 0xfa,
+    0xef, 0x44, 0xa0, 0x0b, 0x71, 0xda, 0x3e, 0x95, 0xca, 0x61, 0x85, 0x2e, 0x54, 0xff, 0x1b, 0xb0,
+    0x62, 0xc9, 0x2d, 0x86, 0xfc, 0x57, 0xb3, 0x18, 0x47, 0xec, 0x08, 0xa3, 0xd9, 0x72, 0x96, 0x3d,
+    0x28, 0x83, 0x67, 0xcc, 0xb6, 0x1d, 0xf9, 0x52, 0x0d, 0xa6, 0x42, 0xe9, 0x93, 0x38, 0xdc, 0x77,
+    0xf6, 0x5d, 0xb9, 0x12, 0x68, 0xc3, 0x27, 0x8c, 0xd3, 0x78, 0x9c, 0x37, 0x4d, 0xe6, 0x02, 0xa9,
+    0xbc, 0x17, 0xf3, 0x58, 0x22, 0x89, 0x6d, 0xc6, 0x99, 0x32, 0xd6, 0x7d, 0x07, 0xac, 0x48, 0xe3,
+    0x53, 0xf8, 0x1c, 0xb7, 0xcd, 0x66, 0x82, 0x29, 0x76, 0xdd, 0x39, 0x92, 0xe8, 0x43, 0xa7, 0x0c,
+    0x19, 0xb2, 0x56, 0xfd, 0x87, 0x2c, 0xc8, 0x63, 0x3c, 0x97, 0x73, 0xd8, 0xa2, 0x09, 0xed, 0x46,
+    0xc7, 0x6c, 0x88, 0x23, 0x59, 0xf2, 0x16, 0xbd, 0xe2, 0x49, 0xad, 0x06, 0x7c, 0xd7, 0x33, 0x98,
+    0x8d, 0x26, 0xc2, 0x69, 0x13, 0xb8, 0x5c, 0xf7, 0xa8, 0x03, 0xe7, 0x4c, 0x36, 0x9d, 0x79, 0xd2,
+};
+
+static const uint8_t crc8SliceTable3[256] = {
+    0x00, 0x8f, 0x07, 0x88, 0x0e, 0x81, 0x09, 0x86, 0x1c, 0x93, 0x1b, 0x94, 0x12, 0x9d, 0x15, 0x9a,
+    0x38, 0xb7, 0x3f, 0xb0, 0x36, 0xb9, 0x31, 0xbe, 0x24, 0xab, 0x23, 0xac, 0x2a, 0xa5, 0x2d, 0xa2,
+    0x70, 0xff, 0x77, 0xf8, 0x7e, 0xf1, 0x79, 0xf6, 0x6c, 0xe3, 0x6b, 0xe4, 0x62, 0xed, 0x65, 0xea,
+    0x48, 0xc7, 0x4f, 0xc0, 0x46, 0xc9, 0x41, 0xce, 0x54, 0xdb, 0x53, 0xdc, 0x5a, 0xd5, 0x5d, 0xd2,
+    0xe0, 0x6f, 0xe7, 0x68, 0xee, 0x61, 0xe9, 0x66, 0xfc, 0x73, 0xfb, 0x74, 0xf2, 0x7d, 0xf5, 0x7a,
+    0xd8, 0x57, 0xdf, 0x50, 0xd6, 0x59, 0xd1, 0x5e, 0xc4, 0x4b, 0xc3, 0x4c, 0xca, 0x45, 0xcd, 0x42,
+    0x90, 0x1f, 0x97, 0x18, 0x9e, 0x11, 0x99, 0x16, 0x8c, 0x03, 0x8b, 0x04, 0x82, 0x0d, 0x85, 0x0a,
+    0xa8, 0x27, 0xaf, 0x20, 0xa6, 0x29, 0xa1, 0x2e, 0xb4, 0x3b, 0xb3, 0x3c, 0xba, 0x35, 0xbd, 0x32,
+    0xd9, 0x56, 0xde, 0x51, 0xd7, 0x58, 0xd0, 0x5f, 0xc5, 0x4a, 0xc2, 0x4d, 0xcb, 0x44, 0xcc, 0x43,
+    0xe1, 0x6e, 0xe6, 0x69, 0xef, 0x60, 0xe8, 0x67, 0xfd, 0x72, 0xfa, 0x75, 0xf3, 0x7c, 0xf4, 0x7b,
+    0xa9, 0x26, 0xae, 0x21, 0xa7, 0x28, 0xa0, 0x2f, 0xb5, 0x3a, 0xb2, 0x3d, 0xbb, 0x34, 0xbc, 0x33,
+    0x91, 0x1e, 0x96, 0x19, 0x9f, 0x10, 0x98, 0x17, 0x8d, 0x02, 0x8a, 0x05, 0x83, 0x0c, 0x84, 0x0b,
+    0x39, 0xb6, 0x3e, 0xb1, 0x37, 0xb8, 0x30, 0xbf, 0x25, 0xaa, 0x22, 0xad, 0x2b, 0xa4, 0x2c, 0xa3,
+    0x01, 0x8e, 0x06, 0x89, 0x0f, 0x80, 0x08, 0x87, 0x1d, 0x92, 0x1a, 0x95, 0x13, 0x9c, 0x14, 0x9b,
+    0x49, 0xc6, 0x4e, 0xc1, 0x47, 0xc8, 0x40, 0xcf, 0x55, 0xda, 0x52, 0xdd, 0x5b, 0xd4, 0x5c, 0xd3,
+    0x71, 0xfe, 0x76, 0xf9, 0x7f, 0xf0, 0x78, 0xf7, 0x6d, 0xe2, 0x6a, 0xe5, 0x63, 0xec, 0x64, 0xeb,
+};
+
+#else
+
+// The 16 entry table used when CRC_USE_NIBBLE_TABLES is defined, to save flash.  Each byte is
+// processed as two 4 bit lookups.
+static const uint8_t crc8NibbleTable[16] = {
+    0x00, 0x9d, 0x23, 0xbe, 0x46, 0xdb, 0x65, 0xf8, 0x8c, 0x11, 0xaf, 0x32, 0xca, 0x57, 0xe9, 0x74,
+};
+
+#endif
+
+/// <summary>
+/// Calculates the Maxim (Dallas) CRC8 of a buffer.  This does not use the global crc8 value, so
+/// it can be used by multiple buses or callers at the same time.  Pass the previous result as
+/// the seed to continue a CRC over more data.  A buffer that ends with its own CRC byte has a
+/// CRC of 0.
+/// </summary>
+/// <param name="data">The data to use in the CRC8 calculation.</param>
+/// <param name="length">The number of bytes of data.</param>
+/// <param name="seed">The initial CRC value (0 for a new calculation.)</param>
+/// <returns>The CRC8 value.</returns>
+uint8_t Crc8Compute(const uint8_t *data, size_t length, uint8_t seed)
+{
+    uint8_t crc = seed;
+
+#ifndef CRC_USE_NIBBLE_TABLES
+    while (length >= 4) {
+        crc = crc8SliceTable3[crc ^ data[0]] ^ crc8SliceTable2[data[1]] ^
+              crc8SliceTable1[data[2]] ^ dscrc_table[data[3]];
+        data += 4;
+        length -= 4;
+    }
+#endif
+
+    while (length > 0) {
+        crc = Crc8UpdateByte(crc, *data);
+        data++;
+        length--;
+    }
+
+    return crc;
+}
+
 /// <summary>
 /// Modified from https://www.maximintegrated.com/en/design/technical-documents/app-notes/1/187.html
 /// --------------------------------------------------------------------------
@@ -65,7 +173,7 @@ static unsigned char dscrc_table[] = {
 /// <returns>The current global crc8 value.</returns>
 uint8_t DoCrc8(uint8_t value)
 {
-    OneWireCrc8 = dscrc_table[OneWireCrc8 ^ value];
+    OneWireCrc8 = Crc8UpdateByte(OneWireCrc8, value);
     return OneWireCrc8;
 }
 
@@ -84,3 +192,19 @@ uint8_t GetCrc8(void)
 {
     return OneWireCrc8;
 }
+
+/// <summary>
+/// Calculates the CRC8 of one more byte of data.
+/// </summary>
+/// <param name="crc">The CRC8 of the previous data.</param>
+/// <param name="value">The next byte of data.</param>
+/// <returns>The CRC8 value.</returns>
+static uint8_t Crc8UpdateByte(uint8_t crc, uint8_t value)
+{
+#ifndef CRC_USE_NIBBLE_TABLES
+    return dscrc_table[crc ^ value];
+#else
+    crc = (uint8_t)((crc >> 4) ^ crc8NibbleTable[(crc ^ value) & 0x0F]);
+    return (uint8_t)((crc >> 4) ^ crc8NibbleTable[(crc ^ (value >> 4)) & 0x0F]);
+#endif
+}
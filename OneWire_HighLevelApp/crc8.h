@@ -1,7 +1,23 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
+// By default the CRC uses 1KB of lookup tables and processes 4 bytes at a time (slice-by-4).
+// Define CRC_USE_NIBBLE_TABLES to use 16 entry tables instead, which saves flash but is slower.
+
+/// <summary>
+/// Calculates the Maxim (Dallas) CRC8 of a buffer.  This does not use the global crc8 value, so
+/// it can be used by multiple buses or callers at the same time.  Pass the previous result as
+/// the seed to continue a CRC over more data.  A buffer that ends with its own CRC byte has a
+/// CRC of 0.
+/// </summary>
+/// <param name="data">The data to use in the CRC8 calculation.</param>
+/// <param name="length">The number of bytes of data.</param>
+/// <param name="seed">The initial CRC value (0 for a new calculation.)</param>
+/// <returns>The CRC8 value.</returns>
+uint8_t Crc8Compute(const uint8_t *data, size_t length, uint8_t seed);
+
 /// <summary>
 /// Modified from https://www.maximintegrated.com/en/design/technical-documents/app-notes/1/187.html
 /// --------------------------------------------------------------------------
@@ -8,9 +8,14 @@
 
 #include "ds18b20.h"
 #include "onewire.h"
+#include "onewirelog.h"
+#include "onewirestats.h"
 #include "sleep.h"
 #include "crc8.h"
 
+#include <string.h>
+#include <time.h>
+
 #include "applibs_versions.h"
 #include <applibs/log.h>
 
@@ -22,10 +27,34 @@
 // 3 - Tl register (low temp)
 // 4 - configuration (bits 5 and 6 for resolution)
 // 5 - reserved (0xFF)
-// 6 - reserved
+// 6 - reserved (0x0C default power on)
 // 7 - reserved (0x10)
 // 8 - CRC8 value
-static uint8_t Ds18b20ScratchPad[9];
+static uint8_t Ds18b20ScratchPad[DS18B20_SCRATCHPAD_SIZE];
+
+/// <summary>
+/// The temperature register of a device that has not completed a conversion since it was
+/// powered on (85C).
+/// </summary>
+#define DS18B20_POWER_ON_TEMPERATURE 0x0550
+
+/// <summary>
+/// Byte 6 of the scratchpad of a device that has not completed a conversion since it was powered
+/// on.  A conversion sets it to 0x10 minus the 1/16 degree bits of the temperature, so a
+/// conversion that reads 85C leaves 0x10.
+/// </summary>
+#define DS18B20_POWER_ON_BYTE6 0x0C
+
+/// <summary>
+/// The number of scratchpads Ds18b20Provision reads back in each pipelined pass.
+/// </summary>
+#define DS18B20_PROVISION_BLOCK 16
+
+static bool Ds18b20WaitForConversion(int timeoutMs);
+static bool Ds18b20DecodeTemperature(const uint8_t *data, ThermometerResolution resolution,
+                                     int16_t *raw);
+static bool Ds18b20IsPlausible(const uint8_t *data);
+static int16_t Ds18b20MaskResolution(int16_t raw, ThermometerResolution resolution);
 
 /// <summary>
 /// Determines if the device is using VCC or parasitic power from the OneWire bus.  You must be
@@ -46,11 +75,34 @@ bool Ds18b20ReadPowerSupplyVCC(void)
     return status;
 }
 
+/// <summary>
+/// Returns the maximum time a temperature conversion takes at the specified resolution (from
+/// the DS18B20 datasheet.)
+/// </summary>
+/// <param name="resolution">The resolution the device is configured for.</param>
+/// <returns>The conversion time in milliseconds.</returns>
+int Ds18b20GetConversionTimeMilli(ThermometerResolution resolution)
+{
+    switch (resolution) {
+    case ThermometerResolution9bits:
+        return 94;
+    case ThermometerResolution10bits:
+        return 188;
+    case ThermometerResolution11bits:
+        return 375;
+    case ThermometerResolution12bits:
+    default:
+        return 750;
+    }
+}
+
 /// <summary>
 /// Performs a temperature conversion, storing the result in the devices internal
 /// scratchpad & setting the alert state based on the Temp LSB and Th and Tl registers.
 /// You must be sure to select a device (or all devices) prior to using this command.
-/// Enable the strong pullup if parasitic power is required.
+/// Enable the strong pullup if parasitic power is required.  When the strong pullup is not
+/// enabled the devices must be VCC powered; they are polled and this returns as soon as the
+/// conversion completes (waiting at most the conversion time for the resolution.)
 /// </summary>
 /// <param name="enableStrongPullUp">true to enable the parasitic power, otherwise false.</param>
 /// <param name="currentResolution">The resolution the device is configured for.  You can
@@ -59,37 +111,102 @@ bool Ds18b20ReadPowerSupplyVCC(void)
 /// <returns>true if no error was detected, otherwise false.</returns>
 bool Ds18b20ConvertT(bool enableStrongPullUp, ThermometerResolution currentResolution)
 {
-    bool status = enableStrongPullUp ? OneWireSendByteWithPullup(0x44) : OneWireSendByte(0x44);    
-
-    int delay;
-    switch (currentResolution) {
-    case ThermometerResolution9bits:
-        delay = 94;
-        break;
-    case ThermometerResolution10bits:
-        delay = 188;
-        break;
-    case ThermometerResolution11bits:
-        delay = 375;
-        break;
-    case ThermometerResolution12bits:
-    default:
-        delay = 750;
-        break;
-    }
+    bool status = Ds18b20StartConvertT(enableStrongPullUp);
 
+    int delay = Ds18b20GetConversionTimeMilli(currentResolution);
     if (enableStrongPullUp) {
         SleepMilli(delay);
         OneWireDisableStrongPullup();
-    } else {
-        // TODO: PERF: You can poll to see when you receive a 1, which indicates the conversion 
-        // completed instead of waiting the full duration.
-        SleepMilli(delay);
+    } else if (status) {
+        status = Ds18b20WaitForConversion(delay);
     }
 
     return status;
 }
 
+/// <summary>
+/// Starts a temperature conversion and returns without waiting for it to complete.  You must be
+/// sure to select a device (or all devices) prior to using this command.  The conversion takes up
+/// to <see src="Ds18b20GetConversionTimeMilli"/> milliseconds.  If the strong pullup is enabled,
+/// call OneWireDisableStrongPullup once the conversion time has elapsed and do not use the
+/// OneWire bus until then.
+/// </summary>
+/// <param name="enableStrongPullUp">true to enable the parasitic power, otherwise false.</param>
+/// <returns>true if no error was detected, otherwise false.</returns>
+bool Ds18b20StartConvertT(bool enableStrongPullUp)
+{
+    return enableStrongPullUp ? OneWireSendByteWithPullup(0x44) : OneWireSendByte(0x44);
+}
+
+/// <summary>
+/// Starts a temperature conversion on each device, addressed with Match ROM, so the devices can
+/// be converted in groups (a different group can be read while one group converts.)  The Match
+/// ROM and Convert T command of each device are sent in a single transfer, with one reset per
+/// device (and one after the last device.)  The strong pullup is not used, so every device must
+/// be VCC powered.
+/// </summary>
+/// <param name="roms">The ROM identifiers of the devices.</param>
+/// <param name="count">The number of devices.</param>
+/// <param name="started">Receives true for each device the command was sent to.</param>
+/// <returns>The number of devices the command was sent to.</returns>
+int Ds18b20StartConvertTs(const OneWireRomId *roms, int count, bool *started)
+{
+    // Match ROM (0x55), the 8 byte ROM identifier and Convert T (0x44); a device that is
+    // converting keeps converting through the resets that address the other devices.
+    uint8_t frame[10];
+    int startedCount = 0;
+    bool present = OneWireReset() == DevicePresent;
+    for (int i = 0; i < count; i++) {
+        frame[0] = 0x55;
+        OneWireRomIdToBytes(roms[i], &frame[1]);
+        frame[9] = 0x44;
+
+        // Every slot is a write, so the frame only echoes back unchanged if the transfer worked.
+        uint8_t sent[sizeof(frame)];
+        memcpy(sent, frame, sizeof(sent));
+        started[i] = present && OneWireTouchBlock(frame, sizeof(frame)) &&
+                     memcmp(sent, frame, sizeof(sent)) == 0;
+        if (started[i]) {
+            startedCount++;
+        }
+
+        // This reset ends the transfer of this device and starts the transfer of the next device.
+        present = OneWireReset() == DevicePresent;
+    }
+
+    return startedCount;
+}
+
+/// <summary>
+/// Polls VCC powered devices until their temperature conversion completes.  While converting,
+/// a device responds to read slots with a 0 and once the conversion is done it responds with a
+/// 1.  When multiple devices are converting, the bus reads 0 until all of them are done.
+/// </summary>
+/// <param name="timeoutMs">The maximum time to wait for the conversion.</param>
+/// <returns>true if the conversion completed, otherwise false.</returns>
+static bool Ds18b20WaitForConversion(int timeoutMs)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (;;) {
+        int bit = OneWireReadBit();
+        if (bit == 1) {
+            return true;
+        } else if (bit == -1) {
+            Log_Debug("ERROR: Failed polling for conversion complete.\n");
+            return false;
+        }
+
+        if (ElapsedMicro(&start) >= timeoutMs * 1000L) {
+            Log_Debug("WARN: Conversion did not complete within %dms.\n", timeoutMs);
+            return false;
+        }
+
+        SleepMilli(1);
+    }
+}
+
 /// <summary>
 /// Writes data to the scratchpad on the selected device. You must be sure to select a device 
 /// (or all devices) prior to using this command.  If you are not going to use the alert function
@@ -102,30 +219,28 @@ bool Ds18b20ConvertT(bool enableStrongPullUp, ThermometerResolution currentResol
 /// <returns>true if no error was detected, otherwise false.</returns>
 bool Ds18b20WriteScratchpad(int8_t tHigh, int8_t tLow, ThermometerResolution resolution) 
 {
-    bool status = OneWireSendByte(0x4E);
-    if (status) {
-        status &= OneWireSendByte((uint8_t)tHigh);
-        status &= OneWireSendByte((uint8_t)tLow);
-        status &= OneWireSendByte((uint8_t)(resolution << 5));    
-    }
-
-    return status;
+    uint8_t frame[4] = {0x4E, (uint8_t)tHigh, (uint8_t)tLow, (uint8_t)(resolution << 5)};
+    return OneWireWriteBlock(frame, sizeof(frame));
 }
 
 /// <summary>
 /// Copies data from the device scratchpad to the EEPROM, which will be read on power-up, and has
-/// a 10 year+ data retenion.  You must be sure to select a device prior to using this command.
-/// Enable the strong pullup if parasitic power is required.
+/// a 10 year+ data retenion.  You must be sure to select a device (or all devices) prior to using
+/// this command.  Enable the strong pullup if parasitic power is required; it is disabled again
+/// once the EEPROM is written.
 /// </summary>
 /// <param name="enableStrongPullUp">true to enable the parasitic power, otherwise false.</param>
 /// <returns>true if no error was detected, otherwise false.</returns>
 bool Ds18b20CopyScratchpad(bool enableStrongPullUp)
 {
-    bool status = enableStrongPullUp ? OneWireSendByteWithPullup(0x44) : OneWireSendByte(0x44);
+    bool status = enableStrongPullUp ? OneWireSendByteWithPullup(0x48) : OneWireSendByte(0x48);
     
     // The documentation says to wait 10 milliseconds after sending the command to ensure the 
     // EEPROM is written to.
     SleepMilli(10);
+    if (enableStrongPullUp) {
+        OneWireDisableStrongPullup();
+    }
     return status;
 }
 
@@ -136,27 +251,192 @@ bool Ds18b20CopyScratchpad(bool enableStrongPullUp)
 /// <returns>true if no error was detected, otherwise false.</returns>
 bool Ds18b20ReadScratchpad(void)
 {
-    bool status = OneWireSendByte(0xBE);
-    if (status) {
-        ClearCrc8();
-        for (int i = 0; i < 9; i++) {
-            int b = OneWireReceiveByte();
-            if (b == -1) {
-                Ds18b20ScratchPad[i] = 0xFF; 
-                status = false;
-            } else {
-                Ds18b20ScratchPad[i] = (uint8_t)b;
-                DoCrc8((uint8_t)b);
-            }
+    // Send the Read Scratchpad command followed by read slots for the 9 bytes of the scratchpad.
+    uint8_t frame[1 + sizeof(Ds18b20ScratchPad)];
+    memset(frame, 0xFF, sizeof(frame));
+    frame[0] = 0xBE;
+    bool status = OneWireTouchBlock(frame, sizeof(frame)) && frame[0] == 0xBE;
+    if (!status) {
+        memset(Ds18b20ScratchPad, 0xFF, sizeof(Ds18b20ScratchPad));
+        return false;
+    }
+
+    memcpy(Ds18b20ScratchPad, &frame[1], sizeof(Ds18b20ScratchPad));
+    // The last byte of the scratchpad is the CRC of the first 8 bytes.
+    if (Crc8Compute(Ds18b20ScratchPad, sizeof(Ds18b20ScratchPad), 0) != 0) {
+        OneWireStatsAddCrcFailure();
+        ONEWIRE_LOG_DEFER_WARN("WARN: CRC mismatch reading scratchpad.\n");
+        status = false;
+    }
+
+    return status;
+}
+
+/// <summary>
+/// Reads only the temperature (the first 2 bytes of the scratchpad) of the selected device, and
+/// ends the transfer with a reset.  This takes 16 read slots instead of the 72 read slots of
+/// <see src="Ds18b20ReadScratchpad"/>, but the CRC is not read: the temperature is only checked
+/// to be within the range of the device, and 85C (the power on value) and -0.0625C (0xFFFF, which
+/// is also what a device that does not respond is read as) are treated as a failed reading.  You
+/// must be sure to select a device prior to using this command.
+/// </summary>
+/// <param name="resolution">The resolution the device is configured for.</param>
+/// <param name="raw">Receives the temperature in 1/16 degrees celsius.</param>
+/// <returns>true if a plausible temperature was read, otherwise false.</returns>
+bool Ds18b20ReadTemperature(ThermometerResolution resolution, int16_t *raw)
+{
+    // Send the Read Scratchpad command followed by read slots for the 2 temperature bytes.
+    uint8_t frame[3] = {0xBE, 0xFF, 0xFF};
+    bool status = OneWireTouchBlock(frame, sizeof(frame)) && frame[0] == 0xBE;
+
+    // The device keeps sending the rest of the scratchpad until it is reset.
+    bool reset = OneWireReset() == DevicePresent;
+    return status && reset && Ds18b20DecodeTemperature(&frame[1], resolution, raw);
+}
+
+/// <summary>
+/// Reads only the temperature of each device, like <see src="Ds18b20ReadTemperature"/>, with the
+/// Match ROM, Read Scratchpad command and temperature read slots of each device sent in a single
+/// transfer.  The reset that ends the transfer of one device also starts the transfer of the next
+/// device, so there is one reset per device (and one after the last device.)
+/// </summary>
+/// <param name="roms">The ROM identifiers of the devices.</param>
+/// <param name="resolutions">The resolution each device is configured for.</param>
+/// <param name="count">The number of devices.</param>
+/// <param name="raw">Receives the temperature of each device in 1/16 degrees celsius.</param>
+/// <param name="valid">Receives true for each device that returned a plausible temperature.</param>
+/// <returns>The number of devices that returned a plausible temperature.</returns>
+int Ds18b20ReadTemperatures(const OneWireRomId *roms, const ThermometerResolution *resolutions,
+                            int count, int16_t *raw, bool *valid)
+{
+    // Match ROM (0x55), the 8 byte ROM identifier, Read Scratchpad (0xBE) and the 2 temperature
+    // bytes.
+    uint8_t frame[12];
+    int validCount = 0;
+    bool present = OneWireReset() == DevicePresent;
+    for (int i = 0; i < count; i++) {
+        frame[0] = 0x55;
+        OneWireRomIdToBytes(roms[i], &frame[1]);
+        frame[9] = 0xBE;
+        frame[10] = 0xFF;
+        frame[11] = 0xFF;
+
+        // The frame only echoes back unchanged (apart from the read slots) if the transfer worked.
+        uint8_t sent[10];
+        memcpy(sent, frame, sizeof(sent));
+        valid[i] = present && OneWireTouchBlock(frame, sizeof(frame)) &&
+                   memcmp(sent, frame, sizeof(sent)) == 0;
+
+        // This reset ends the transfer of this device and starts the transfer of the next device.
+        present = OneWireReset() == DevicePresent;
+        valid[i] = valid[i] && Ds18b20DecodeTemperature(&frame[10], resolutions[i], &raw[i]);
+        if (valid[i]) {
+            validCount++;
         }
+    }
+
+    return validCount;
+}
+
+/// <summary>
+/// Reads the scratchpad of each device, like <see src="Ds18b20ReadScratchpad"/>, with the Match
+/// ROM, Read Scratchpad command and scratchpad read slots of each device sent in a single
+/// transfer, and one reset per device (and one after the last device.)
+/// </summary>
+/// <param name="roms">The ROM identifiers of the devices.</param>
+/// <param name="count">The number of devices.</param>
+/// <param name="scratchpads">Receives the scratchpad of each device.</param>
+/// <param name="valid">Receives true for each device whose scratchpad passed its CRC check.</param>
+/// <returns>The number of devices whose scratchpad passed its CRC check.</returns>
+int Ds18b20ReadScratchpads(const OneWireRomId *roms, int count, Ds18b20Scratchpad *scratchpads,
+                           bool *valid)
+{
+    // Match ROM (0x55), the 8 byte ROM identifier, Read Scratchpad (0xBE) and the 9 scratchpad
+    // bytes.
+    uint8_t frame[10 + DS18B20_SCRATCHPAD_SIZE];
+    int validCount = 0;
+    bool present = OneWireReset() == DevicePresent;
+    for (int i = 0; i < count; i++) {
+        frame[0] = 0x55;
+        OneWireRomIdToBytes(roms[i], &frame[1]);
+        frame[9] = 0xBE;
+        memset(&frame[10], 0xFF, DS18B20_SCRATCHPAD_SIZE);
 
-        if (GetCrc8() != 0) {
-            Log_Debug("WARN: CRC mismatch reading scratchpad.\n");
-            status = false;
+        // The frame only echoes back unchanged (apart from the read slots) if the transfer worked.
+        uint8_t sent[10];
+        memcpy(sent, frame, sizeof(sent));
+        valid[i] = present && OneWireTouchBlock(frame, sizeof(frame)) &&
+                   memcmp(sent, frame, sizeof(sent)) == 0;
+        memcpy(scratchpads[i].bytes, &frame[10], DS18B20_SCRATCHPAD_SIZE);
+
+        // This reset ends the transfer of this device and starts the transfer of the next device.
+        present = OneWireReset() == DevicePresent;
+        if (valid[i] && Crc8Compute(scratchpads[i].bytes, DS18B20_SCRATCHPAD_SIZE, 0) != 0) {
+            OneWireStatsAddCrcFailure();
+            ONEWIRE_LOG_DEFER_WARN("WARN: CRC mismatch reading the scratchpad of device %d.\n", i);
+            valid[i] = false;
+        }
+        if (valid[i]) {
+            validCount++;
         }
     }
 
-    return status;
+    return validCount;
+}
+
+/// <summary>
+/// Configures every DS18B20 device on the selected bus at once: the alarm thresholds and
+/// resolution are written to all of them with Skip ROM, copied to their EEPROM with a single
+/// Copy Scratchpad, and then the scratchpad of each device is read back (see
+/// <see src="Ds18b20ReadScratchpads"/>) to check that it has the new configuration.
+/// </summary>
+/// <param name="roms">The ROM identifiers of the devices on the bus to check.</param>
+/// <param name="count">The number of devices.</param>
+/// <param name="tHigh">The high temperature in celsius (or a user defined byte)</param>
+/// <param name="tLow">The low temperature in celsius (or a user defined byte)</param>
+/// <param name="resolution">The resolution of temperature sampling.</param>
+/// <param name="enableStrongPullUp">true to enable the parasitic power during the copy, otherwise
+/// false.</param>
+/// <param name="configured">Receives true for each device that has the new configuration.</param>
+/// <returns>The number of devices that have the new configuration, or -1 if the configuration
+/// could not be sent.</returns>
+int Ds18b20Provision(const OneWireRomId *roms, int count, int8_t tHigh, int8_t tLow,
+                     ThermometerResolution resolution, bool enableStrongPullUp, bool *configured)
+{
+    memset(configured, 0, (size_t)count * sizeof(configured[0]));
+    if (!OneWireSkipROM() || !Ds18b20WriteScratchpad(tHigh, tLow, resolution)) {
+        ONEWIRE_LOG_DEFER_ERROR("ERROR: Could not write the scratchpads.\n");
+        return -1;
+    }
+
+    if (!OneWireSkipROM() || !Ds18b20CopyScratchpad(enableStrongPullUp)) {
+        ONEWIRE_LOG_DEFER_ERROR("ERROR: Could not copy the scratchpads to EEPROM.\n");
+        return -1;
+    }
+
+    // A failed EEPROM write is not detected here: the scratchpad has the configuration until the
+    // device is power cycled.  The devices are read back in blocks, to bound the stack used.
+    Ds18b20Scratchpad scratchpads[DS18B20_PROVISION_BLOCK];
+    int configuredCount = 0;
+    for (int first = 0; first < count; first += DS18B20_PROVISION_BLOCK) {
+        int blockCount = count - first;
+        if (blockCount > DS18B20_PROVISION_BLOCK) {
+            blockCount = DS18B20_PROVISION_BLOCK;
+        }
+
+        Ds18b20ReadScratchpads(&roms[first], blockCount, scratchpads, &configured[first]);
+        for (int i = 0; i < blockCount; i++) {
+            const uint8_t *bytes = scratchpads[i].bytes;
+            bool *deviceConfigured = &configured[first + i];
+            *deviceConfigured = *deviceConfigured && bytes[2] == (uint8_t)tHigh &&
+                                bytes[3] == (uint8_t)tLow && ((bytes[4] >> 5) & 3) == resolution;
+            if (*deviceConfigured) {
+                configuredCount++;
+            }
+        }
+    }
+
+    return configuredCount;
 }
 
 /// <summary>
@@ -189,6 +469,39 @@ ThermometerResolution GetScratchpadResolution(void)
     return (Ds18b20ScratchPad[4]>>5) & 3;
 }
 
+/// <summary>
+/// Copies the last read scratchpad.  You must call <see src="Ds18b20ReadScratchpad"/> to
+/// populate the scratchpad first.
+/// </summary>
+/// <param name="scratchpad">Receives the scratchpad.</param>
+void Ds18b20GetScratchpad(Ds18b20Scratchpad *scratchpad)
+{
+    memcpy(scratchpad->bytes, Ds18b20ScratchPad, sizeof(scratchpad->bytes));
+}
+
+/// <summary>
+/// Returns the resolution a scratchpad copied with <see src="Ds18b20GetScratchpad"/> (or read
+/// with <see src="Ds18b20ReadScratchpads"/>) is configured for.
+/// </summary>
+/// <param name="scratchpad">The scratchpad.</param>
+/// <returns>The resolution.</returns>
+ThermometerResolution Ds18b20GetResolution(const Ds18b20Scratchpad *scratchpad)
+{
+    return (ThermometerResolution)((scratchpad->bytes[4] >> 5) & 3);
+}
+
+/// <summary>
+/// Returns the temperature in 1/16 degrees celsius from the last read scratchpad (the undefined
+/// low bits for the resolution are cleared.)  You must call <see src="Ds18b20ReadScratchpad"/> to
+/// populate the scratchpad first.
+/// </summary>
+/// <returns>returns temperature in 1/16 degrees celsius</returns>
+int16_t GetScratchpadRaw(void)
+{
+    int16_t t = (int16_t)((Ds18b20ScratchPad[1] << 8) | Ds18b20ScratchPad[0]);
+    return Ds18b20MaskResolution(t, GetScratchpadResolution());
+}
+
 /// <summary>
 /// Returns the temperature in celsius from the last read scratchpad.  You
 /// must call <see src="Ds18b20ReadScratchpad"/> to populate the scratchpad first.
@@ -196,25 +509,7 @@ ThermometerResolution GetScratchpadResolution(void)
 /// <returns>returns temperature in celsius</returns>
 float GetScratchpadCelsius(void)
 {
-    int t = ((Ds18b20ScratchPad[1] << 8) | Ds18b20ScratchPad[0]);
-    switch (GetScratchpadResolution()) {
-        case ThermometerResolution9bits:
-        t &= 0xFFF8; // clear bottom 3 bits.
-            break;
-        case ThermometerResolution10bits:
-            t &= 0xFFFC; // clear bottom 2 bits.
-            break;
-
-        case ThermometerResolution11bits:
-            t &= 0xFFFE; // clear bottom 1 bits.
-            break;
-
-        case ThermometerResolution12bits:
-            // don't clear any bits.
-            break;
-    }
-
-    return ((float)t / 16.0F);
+    return (float)GetScratchpadRaw() / 16.0F;
 }
 
 /// <summary>
@@ -225,4 +520,156 @@ float GetScratchpadCelsius(void)
 float GetScratchpadFahrenheit(void)
 {
     return GetScratchpadCelsius() * 1.8F + 32.0F;
-}
\ No newline at end of file
+}
+
+/// <summary>
+/// Converts a temperature in 1/16 degrees celsius to hundredths of a degree celsius (rounded to
+/// the nearest.)
+/// </summary>
+/// <param name="raw">The temperature in 1/16 degrees celsius.</param>
+/// <returns>The temperature in hundredths of a degree celsius.</returns>
+int32_t Ds18b20RawToCentiCelsius(int16_t raw)
+{
+    // 100/16 = 25/4; the bias rounds away from zero.
+    int32_t scaled = (int32_t)raw * 25;
+    return (scaled + (scaled < 0 ? -2 : 2)) / 4;
+}
+
+/// <summary>
+/// Converts a temperature in 1/16 degrees celsius to hundredths of a degree fahrenheit (rounded
+/// to the nearest.)
+/// </summary>
+/// <param name="raw">The temperature in 1/16 degrees celsius.</param>
+/// <returns>The temperature in hundredths of a degree fahrenheit.</returns>
+int32_t Ds18b20RawToCentiFahrenheit(int16_t raw)
+{
+    // F = C * 9/5 + 32, so hundredths of F = raw * 180/16 + 3200 = (raw * 45 + 12800) / 4.
+    int32_t scaled = (int32_t)raw * 45 + 12800;
+    return (scaled + (scaled < 0 ? -2 : 2)) / 4;
+}
+
+/// <summary>
+/// Classifies a temperature against the thresholds.
+/// </summary>
+/// <param name="raw">The temperature in 1/16 degrees celsius.</param>
+/// <param name="thresholds">The thresholds.</param>
+/// <returns>TemperatureClass_Low, TemperatureClass_Normal or TemperatureClass_High.</returns>
+TemperatureClass Ds18b20ClassifyTemperature(int16_t raw, const Ds18b20Thresholds *thresholds)
+{
+    if (raw < thresholds->low) {
+        return TemperatureClass_Low;
+    }
+    if (raw > thresholds->high) {
+        return TemperatureClass_High;
+    }
+
+    return TemperatureClass_Normal;
+}
+
+/// <summary>
+/// Decodes the temperature of a scratchpad, clearing the undefined low bits for the resolution
+/// in the scratchpad.  The scratchpad must already have passed its CRC check (see
+/// <see src="Ds18b20ReadScratchpad"/>.)  The scratchpad of a device that has not completed a
+/// conversion since it was powered on (85C) is not a valid temperature.
+/// </summary>
+/// <param name="scratchpad">The scratchpad.</param>
+/// <param name="raw">Receives the temperature in 1/16 degrees celsius.</param>
+/// <returns>true if the temperature is within the -55C to 125C range of the device, otherwise
+/// false.</returns>
+bool Ds18b20DecodeScratchpad(const Ds18b20Scratchpad *scratchpad, int16_t *raw)
+{
+    const uint8_t *bytes = scratchpad->bytes;
+    // A temperature of 85C is only a reading if byte 6 shows a conversion has completed.
+    int16_t t = (int16_t)((bytes[1] << 8) | bytes[0]);
+    if (!Ds18b20IsPlausible(bytes) ||
+        (t == DS18B20_POWER_ON_TEMPERATURE && bytes[6] == DS18B20_POWER_ON_BYTE6)) {
+        ONEWIRE_LOG_DEFER_WARN("WARN: Implausible temperature 0x%04x read.\n", (uint16_t)t);
+        return false;
+    }
+
+    *raw = Ds18b20MaskResolution((int16_t)((bytes[1] << 8) | bytes[0]),
+                                 Ds18b20GetResolution(scratchpad));
+    return true;
+}
+
+/// <summary>
+/// Decodes the temperature of each scratchpad (clearing the undefined low bits for the resolution
+/// in the scratchpad) and classifies it against the thresholds, using only integer arithmetic.
+/// The scratchpads must already have passed their CRC check (see
+/// <see src="Ds18b20ReadScratchpad"/>); a temperature outside the -55C to 125C range of the
+/// device is TemperatureClass_Invalid.
+/// </summary>
+/// <param name="scratchpads">The scratchpads.</param>
+/// <param name="count">The number of scratchpads.</param>
+/// <param name="thresholds">The thresholds.</param>
+/// <param name="raw">Receives the temperature of each scratchpad in 1/16 degrees celsius.</param>
+/// <param name="classes">Receives the class of each temperature.</param>
+/// <returns>The number of temperatures that are not TemperatureClass_Invalid.</returns>
+int Ds18b20DecodeScratchpads(const Ds18b20Scratchpad *scratchpads, int count,
+                             const Ds18b20Thresholds *thresholds, int16_t *raw,
+                             TemperatureClass *classes)
+{
+    int validCount = 0;
+    for (int i = 0; i < count; i++) {
+        if (!Ds18b20DecodeScratchpad(&scratchpads[i], &raw[i])) {
+            raw[i] = 0;
+            classes[i] = TemperatureClass_Invalid;
+            continue;
+        }
+
+        classes[i] = Ds18b20ClassifyTemperature(raw[i], thresholds);
+        validCount++;
+    }
+
+    return validCount;
+}
+
+/// <summary>
+/// Converts the 2 temperature bytes of the scratchpad to 1/16 degrees celsius, checking the
+/// value is plausible (see <see src="Ds18b20IsPlausible"/>.)
+/// </summary>
+/// <param name="data">The temperature LSB and MSB.</param>
+/// <param name="resolution">The resolution the device is configured for (the undefined low bits
+/// are cleared.)</param>
+/// <param name="raw">Receives the temperature in 1/16 degrees celsius.</param>
+/// <returns>true if the temperature is plausible, otherwise false.</returns>
+static bool Ds18b20DecodeTemperature(const uint8_t *data, ThermometerResolution resolution,
+                                     int16_t *raw)
+{
+    // Without the rest of the scratchpad, 85C can not be told apart from a device that was power
+    // cycled before the conversion, and -0.0625C (0xFFFF) from a device that does not respond (or
+    // was removed); both are treated as a failed reading.
+    int t = (data[1] << 8) | data[0];
+    if (!Ds18b20IsPlausible(data) || t == DS18B20_POWER_ON_TEMPERATURE || t == 0xFFFF) {
+        ONEWIRE_LOG_DEFER_WARN("WARN: Implausible temperature 0x%04x read.\n", t);
+        return false;
+    }
+
+    *raw = Ds18b20MaskResolution((int16_t)((data[1] << 8) | data[0]), resolution);
+    return true;
+}
+
+/// <summary>
+/// Returns true if the 2 temperature bytes of the scratchpad are plausible: the 5 sign bits must
+/// match and the temperature must be within the -55C to 125C range of the device.
+/// </summary>
+/// <param name="data">The temperature LSB and MSB.</param>
+/// <returns>true if the temperature is plausible, otherwise false.</returns>
+static bool Ds18b20IsPlausible(const uint8_t *data)
+{
+    int16_t t = (int16_t)((data[1] << 8) | data[0]);
+    int signBits = (data[1] >> 3) & 0x1F;
+    return (signBits == 0 || signBits == 0x1F) && t >= -55 * 16 && t <= 125 * 16;
+}
+
+/// <summary>
+/// Clears the low bits of a temperature that are undefined at the resolution (e.g. the bottom 3
+/// bits at 9 bit resolution.)
+/// </summary>
+/// <param name="raw">The temperature in 1/16 degrees celsius.</param>
+/// <param name="resolution">The resolution the device is configured for.</param>
+/// <returns>The temperature with the undefined bits cleared.</returns>
+static int16_t Ds18b20MaskResolution(int16_t raw, ThermometerResolution resolution)
+{
+    return (int16_t)(raw & ~((1 << (ThermometerResolution12bits - resolution)) - 1));
+}
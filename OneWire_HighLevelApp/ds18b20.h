@@ -6,6 +6,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "onewirerom.h"
+
 typedef enum {
     /// <summary>
     /// 9 bit, 0.5C resolution, 93.75ms sample time
@@ -28,6 +30,44 @@ typedef enum {
     ThermometerResolution12bits = 3,
 } ThermometerResolution;
 
+/// <summary>
+/// The size of the DS18B20 scratchpad in bytes (including the CRC.)
+/// </summary>
+#define DS18B20_SCRATCHPAD_SIZE 9
+
+/// <summary>
+/// A copy of a DS18B20 scratchpad, for decoding with <see src="Ds18b20DecodeScratchpads"/>.
+/// </summary>
+typedef struct {
+    uint8_t bytes[DS18B20_SCRATCHPAD_SIZE];
+} Ds18b20Scratchpad;
+
+/// <summary>
+/// The temperature limits used to classify readings, in 1/16 degrees celsius (the units of the
+/// DS18B20 temperature register.)
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// Temperatures below this are TemperatureClass_Low.
+    /// </summary>
+    int16_t low;
+
+    /// <summary>
+    /// Temperatures above this are TemperatureClass_High.
+    /// </summary>
+    int16_t high;
+} Ds18b20Thresholds;
+
+/// <summary>
+/// The class of a temperature reading.
+/// </summary>
+typedef enum {
+    TemperatureClass_Invalid = 0,
+    TemperatureClass_Low = 1,
+    TemperatureClass_Normal = 2,
+    TemperatureClass_High = 3,
+} TemperatureClass;
+
 /// <summary>
 /// Determines if the device is using VCC or parasitic power from the OneWire bus.  You must be
 /// sure to select a device prior to using this command.  If the device is using parasitic power
@@ -38,11 +78,21 @@ typedef enum {
 /// <returns>true if the device is using VCC power, otherwise returns false.</returns>
 bool Ds18b20ReadPowerSupplyVCC(void);
 
+/// <summary>
+/// Returns the maximum time a temperature conversion takes at the specified resolution (from
+/// the DS18B20 datasheet.)
+/// </summary>
+/// <param name="resolution">The resolution the device is configured for.</param>
+/// <returns>The conversion time in milliseconds.</returns>
+int Ds18b20GetConversionTimeMilli(ThermometerResolution resolution);
+
 /// <summary>
 /// Performs a temperature conversion, storing the result in the devices internal
 /// scratchpad & setting the alert state based on the Temp LSB and Th and Tl registers.
 /// You must be sure to select a device (or all devices) prior to using this command.
-/// Enable the strong pullup if parasitic power is required.
+/// Enable the strong pullup if parasitic power is required.  When the strong pullup is not
+/// enabled the devices must be VCC powered; they are polled and this returns as soon as the
+/// conversion completes (waiting at most the conversion time for the resolution.)
 /// </summary>
 /// <param name="enableStrongPullUp">true to enable the parasitic power, otherwise false.</param>
 /// <param name="currentResolution">The resolution the device is configured for.  You can
@@ -51,6 +101,30 @@ bool Ds18b20ReadPowerSupplyVCC(void);
 /// <returns>true if no error was detected, otherwise false.</returns>
 bool Ds18b20ConvertT(bool enableStrongPullUp, ThermometerResolution currentResolution);
 
+/// <summary>
+/// Starts a temperature conversion and returns without waiting for it to complete.  You must be
+/// sure to select a device (or all devices) prior to using this command.  The conversion takes up
+/// to <see src="Ds18b20GetConversionTimeMilli"/> milliseconds.  If the strong pullup is enabled,
+/// call OneWireDisableStrongPullup once the conversion time has elapsed and do not use the
+/// OneWire bus until then.
+/// </summary>
+/// <param name="enableStrongPullUp">true to enable the parasitic power, otherwise false.</param>
+/// <returns>true if no error was detected, otherwise false.</returns>
+bool Ds18b20StartConvertT(bool enableStrongPullUp);
+
+/// <summary>
+/// Starts a temperature conversion on each device, addressed with Match ROM, so the devices can
+/// be converted in groups (a different group can be read while one group converts.)  The Match
+/// ROM and Convert T command of each device are sent in a single transfer, with one reset per
+/// device (and one after the last device.)  The strong pullup is not used, so every device must
+/// be VCC powered.
+/// </summary>
+/// <param name="roms">The ROM identifiers of the devices.</param>
+/// <param name="count">The number of devices.</param>
+/// <param name="started">Receives true for each device the command was sent to.</param>
+/// <returns>The number of devices the command was sent to.</returns>
+int Ds18b20StartConvertTs(const OneWireRomId *roms, int count, bool *started);
+
 /// <summary>
 /// Writes data to the scratchpad on the selected device. You must be sure to select a device
 /// (or all devices) prior to using this command.  If you are not going to use the alert function
@@ -65,8 +139,9 @@ bool Ds18b20WriteScratchpad(int8_t tHigh, int8_t tLow, ThermometerResolution res
 
 /// <summary>
 /// Copies data from the device scratchpad to the EEPROM, which will be read on power-up, and has
-/// a 10 year+ data retenion.  You must be sure to select a device prior to using this command.
-/// Enable the strong pullup if parasitic power is required.
+/// a 10 year+ data retenion.  You must be sure to select a device (or all devices) prior to using
+/// this command.  Enable the strong pullup if parasitic power is required; it is disabled again
+/// once the EEPROM is written.
 /// </summary>
 /// <param name="enableStrongPullUp">true to enable the parasitic power, otherwise false.</param>
 /// <returns>true if no error was detected, otherwise false.</returns>
@@ -79,6 +154,66 @@ bool Ds18b20CopyScratchpad(bool enableStrongPullUp);
 /// <returns>true if no error was detected, otherwise false.</returns>
 bool Ds18b20ReadScratchpad(void);
 
+/// <summary>
+/// Reads only the temperature (the first 2 bytes of the scratchpad) of the selected device, and
+/// ends the transfer with a reset.  This takes 16 read slots instead of the 72 read slots of
+/// <see src="Ds18b20ReadScratchpad"/>, but the CRC is not read: the temperature is only checked
+/// to be within the range of the device, and 85C (the power on value) and -0.0625C (0xFFFF, which
+/// is also what a device that does not respond is read as) are treated as a failed reading.  You
+/// must be sure to select a device prior to using this command.
+/// </summary>
+/// <param name="resolution">The resolution the device is configured for.</param>
+/// <param name="raw">Receives the temperature in 1/16 degrees celsius.</param>
+/// <returns>true if a plausible temperature was read, otherwise false.</returns>
+bool Ds18b20ReadTemperature(ThermometerResolution resolution, int16_t *raw);
+
+/// <summary>
+/// Reads only the temperature of each device, like <see src="Ds18b20ReadTemperature"/>, with the
+/// Match ROM, Read Scratchpad command and temperature read slots of each device sent in a single
+/// transfer.  The reset that ends the transfer of one device also starts the transfer of the next
+/// device, so there is one reset per device (and one after the last device.)
+/// </summary>
+/// <param name="roms">The ROM identifiers of the devices.</param>
+/// <param name="resolutions">The resolution each device is configured for.</param>
+/// <param name="count">The number of devices.</param>
+/// <param name="raw">Receives the temperature of each device in 1/16 degrees celsius.</param>
+/// <param name="valid">Receives true for each device that returned a plausible temperature.</param>
+/// <returns>The number of devices that returned a plausible temperature.</returns>
+int Ds18b20ReadTemperatures(const OneWireRomId *roms, const ThermometerResolution *resolutions,
+                            int count, int16_t *raw, bool *valid);
+
+/// <summary>
+/// Reads the scratchpad of each device, like <see src="Ds18b20ReadScratchpad"/>, with the Match
+/// ROM, Read Scratchpad command and scratchpad read slots of each device sent in a single
+/// transfer, and one reset per device (and one after the last device.)
+/// </summary>
+/// <param name="roms">The ROM identifiers of the devices.</param>
+/// <param name="count">The number of devices.</param>
+/// <param name="scratchpads">Receives the scratchpad of each device.</param>
+/// <param name="valid">Receives true for each device whose scratchpad passed its CRC check.</param>
+/// <returns>The number of devices whose scratchpad passed its CRC check.</returns>
+int Ds18b20ReadScratchpads(const OneWireRomId *roms, int count, Ds18b20Scratchpad *scratchpads,
+                           bool *valid);
+
+/// <summary>
+/// Configures every DS18B20 device on the selected bus at once: the alarm thresholds and
+/// resolution are written to all of them with Skip ROM, copied to their EEPROM with a single
+/// Copy Scratchpad, and then the scratchpad of each device is read back (see
+/// <see src="Ds18b20ReadScratchpads"/>) to check that it has the new configuration.
+/// </summary>
+/// <param name="roms">The ROM identifiers of the devices on the bus to check.</param>
+/// <param name="count">The number of devices.</param>
+/// <param name="tHigh">The high temperature in celsius (or a user defined byte)</param>
+/// <param name="tLow">The low temperature in celsius (or a user defined byte)</param>
+/// <param name="resolution">The resolution of temperature sampling.</param>
+/// <param name="enableStrongPullUp">true to enable the parasitic power during the copy, otherwise
+/// false.</param>
+/// <param name="configured">Receives true for each device that has the new configuration.</param>
+/// <returns>The number of devices that have the new configuration, or -1 if the configuration
+/// could not be sent.</returns>
+int Ds18b20Provision(const OneWireRomId *roms, int count, int8_t tHigh, int8_t tLow,
+                     ThermometerResolution resolution, bool enableStrongPullUp, bool *configured);
+
 /// <summary>
 /// Returns the tHigh (or user defined byte) from the last read scratchpad.  You
 /// must call <see src="Ds18b20ReadScratchpad"/> to populate the scratchpad first.
@@ -100,6 +235,29 @@ uint8_t GetScratchpadtLow(void);
 /// <returns>returns temperature resolution</returns>
 ThermometerResolution GetScratchpadResolution(void);
 
+/// <summary>
+/// Copies the last read scratchpad.  You must call <see src="Ds18b20ReadScratchpad"/> to
+/// populate the scratchpad first.
+/// </summary>
+/// <param name="scratchpad">Receives the scratchpad.</param>
+void Ds18b20GetScratchpad(Ds18b20Scratchpad *scratchpad);
+
+/// <summary>
+/// Returns the resolution a scratchpad copied with <see src="Ds18b20GetScratchpad"/> (or read
+/// with <see src="Ds18b20ReadScratchpads"/>) is configured for.
+/// </summary>
+/// <param name="scratchpad">The scratchpad.</param>
+/// <returns>The resolution.</returns>
+ThermometerResolution Ds18b20GetResolution(const Ds18b20Scratchpad *scratchpad);
+
+/// <summary>
+/// Returns the temperature in 1/16 degrees celsius from the last read scratchpad (the undefined
+/// low bits for the resolution are cleared.)  You must call <see src="Ds18b20ReadScratchpad"/> to
+/// populate the scratchpad first.
+/// </summary>
+/// <returns>returns temperature in 1/16 degrees celsius</returns>
+int16_t GetScratchpadRaw(void);
+
 /// <summary>
 /// Returns the temperature in celsius from the last read scratchpad.  You
 /// must call <see src="Ds18b20ReadScratchpad"/> to populate the scratchpad first.
@@ -113,3 +271,56 @@ float GetScratchpadCelsius(void);
 /// </summary>
 /// <returns>returns temperature in fahrenheit</returns>
 float GetScratchpadFahrenheit(void);
+
+/// <summary>
+/// Converts a temperature in 1/16 degrees celsius to hundredths of a degree celsius (rounded to
+/// the nearest.)
+/// </summary>
+/// <param name="raw">The temperature in 1/16 degrees celsius.</param>
+/// <returns>The temperature in hundredths of a degree celsius.</returns>
+int32_t Ds18b20RawToCentiCelsius(int16_t raw);
+
+/// <summary>
+/// Converts a temperature in 1/16 degrees celsius to hundredths of a degree fahrenheit (rounded
+/// to the nearest.)
+/// </summary>
+/// <param name="raw">The temperature in 1/16 degrees celsius.</param>
+/// <returns>The temperature in hundredths of a degree fahrenheit.</returns>
+int32_t Ds18b20RawToCentiFahrenheit(int16_t raw);
+
+/// <summary>
+/// Classifies a temperature against the thresholds.
+/// </summary>
+/// <param name="raw">The temperature in 1/16 degrees celsius.</param>
+/// <param name="thresholds">The thresholds.</param>
+/// <returns>TemperatureClass_Low, TemperatureClass_Normal or TemperatureClass_High.</returns>
+TemperatureClass Ds18b20ClassifyTemperature(int16_t raw, const Ds18b20Thresholds *thresholds);
+
+/// <summary>
+/// Decodes the temperature of a scratchpad, clearing the undefined low bits for the resolution
+/// in the scratchpad.  The scratchpad must already have passed its CRC check (see
+/// <see src="Ds18b20ReadScratchpad"/>.)  The scratchpad of a device that has not completed a
+/// conversion since it was powered on (85C) is not a valid temperature.
+/// </summary>
+/// <param name="scratchpad">The scratchpad.</param>
+/// <param name="raw">Receives the temperature in 1/16 degrees celsius.</param>
+/// <returns>true if the temperature is within the -55C to 125C range of the device, otherwise
+/// false.</returns>
+bool Ds18b20DecodeScratchpad(const Ds18b20Scratchpad *scratchpad, int16_t *raw);
+
+/// <summary>
+/// Decodes the temperature of each scratchpad (clearing the undefined low bits for the resolution
+/// in the scratchpad) and classifies it against the thresholds, using only integer arithmetic.
+/// The scratchpads must already have passed their CRC check (see
+/// <see src="Ds18b20ReadScratchpad"/>); a temperature outside the -55C to 125C range of the
+/// device is TemperatureClass_Invalid.
+/// </summary>
+/// <param name="scratchpads">The scratchpads.</param>
+/// <param name="count">The number of scratchpads.</param>
+/// <param name="thresholds">The thresholds.</param>
+/// <param name="raw">Receives the temperature of each scratchpad in 1/16 degrees celsius.</param>
+/// <param name="classes">Receives the class of each temperature.</param>
+/// <returns>The number of temperatures that are not TemperatureClass_Invalid.</returns>
+int Ds18b20DecodeScratchpads(const Ds18b20Scratchpad *scratchpads, int count,
+                             const Ds18b20Thresholds *thresholds, int16_t *raw,
+                             TemperatureClass *classes);
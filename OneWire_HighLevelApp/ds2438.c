@@ -0,0 +1,98 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+//
+// The values used throughout this code are based on the following data sheet
+// https://datasheets.maximintegrated.com/en/ds/DS2438.pdf
+//
+
+#include "ds2438.h"
+#include "crc8.h"
+#include "onewire.h"
+#include "onewirelog.h"
+#include "onewirestats.h"
+
+#include <string.h>
+
+// Page 0 of the DS2438 memory.  Figure 8 of DS2438.pdf shows the memory map defined as the
+// following:
+// 0 - status/configuration
+// 1 - Temp LSB (bits 3 to 7 are 1/32 to 1/2 degrees)
+// 2 - Temp MSB (whole degrees, two's complement)
+// 3 - Voltage LSB
+// 4 - Voltage MSB
+// 5 - Current LSB
+// 6 - Current MSB
+// 7 - Threshold
+// 8 - CRC8 value
+
+/// <summary>
+/// Copies page 0 of the device memory (the status, temperature, voltage and current registers) to
+/// its scratchpad, so it can be read with <see src="Ds2438ReadPage0"/>.  The registers are only
+/// updated in memory by a conversion (Convert T, 0x44, is the same command as the DS18B20.)  You
+/// must be sure to select a device prior to using this command, and select it again before
+/// reading the scratchpad.
+/// </summary>
+/// <returns>true if no error was detected, otherwise false.</returns>
+bool Ds2438RecallPage0(void)
+{
+    // Recall Memory (0xB8) followed by the page number.
+    const uint8_t frame[2] = {0xB8, 0x00};
+    return OneWireWriteBlock(frame, sizeof(frame));
+}
+
+/// <summary>
+/// Reads page 0 from the scratchpad of the selected device, after
+/// <see src="Ds2438RecallPage0"/>.  You must be sure to select a device prior to using this
+/// command.
+/// </summary>
+/// <param name="page">Receives the 8 bytes of the page and its CRC.</param>
+/// <returns>true if the page was read and passed its CRC check, otherwise false.</returns>
+bool Ds2438ReadPage0(uint8_t *page)
+{
+    // Send the Read Scratchpad command and the page number, followed by read slots for the page.
+    uint8_t frame[2 + DS2438_PAGE_SIZE];
+    memset(frame, 0xFF, sizeof(frame));
+    frame[0] = 0xBE;
+    frame[1] = 0x00;
+    bool status = OneWireTouchBlock(frame, sizeof(frame)) && frame[0] == 0xBE && frame[1] == 0x00;
+    if (!status) {
+        memset(page, 0xFF, DS2438_PAGE_SIZE);
+        return false;
+    }
+
+    memcpy(page, &frame[2], DS2438_PAGE_SIZE);
+    // The last byte of the page is the CRC of the first 8 bytes.
+    if (Crc8Compute(page, DS2438_PAGE_SIZE, 0) != 0) {
+        OneWireStatsAddCrcFailure();
+        ONEWIRE_LOG_DEFER_WARN("WARN: CRC mismatch reading page 0.\n");
+        return false;
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Converts the temperature register of page 0 to 1/16 degrees celsius, checking the value is
+/// plausible: the 3 unused low bits must be clear and the temperature must be within the -55C to
+/// 125C range of the device.  The register has a resolution of 1/32 degrees; the lowest bit is
+/// dropped.
+/// </summary>
+/// <param name="page">The page (see <see src="Ds2438ReadPage0"/>.)</param>
+/// <param name="raw">Receives the temperature in 1/16 degrees celsius.</param>
+/// <returns>true if the temperature is plausible, otherwise false.</returns>
+bool Ds2438DecodeTemperature(const uint8_t *page, int16_t *raw)
+{
+    // The register is in 1/256 degrees, with only the top 5 bits of the LSB used.
+    int16_t t = (int16_t)((page[2] << 8) | page[1]);
+    if ((page[1] & 0x07) != 0 || t < -55 * 256 || t > 125 * 256) {
+        ONEWIRE_LOG_DEFER_WARN("WARN: Implausible temperature 0x%04x read.\n",
+                               (page[2] << 8) | page[1]);
+        return false;
+    }
+
+    // Clearing the 1/32 degree bit first makes the division exact, so negative temperatures are
+    // rounded down like the DS18B20 register.
+    *raw = (int16_t)((t & ~0x0F) / 16);
+    return true;
+}
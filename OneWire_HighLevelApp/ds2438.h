@@ -0,0 +1,47 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// <summary>
+/// The size of a DS2438 memory page in bytes (including the CRC.)
+/// </summary>
+#define DS2438_PAGE_SIZE 9
+
+/// <summary>
+/// The maximum time a DS2438 temperature conversion takes (from the DS2438 datasheet.)
+/// </summary>
+#define DS2438_CONVERSION_TIME_MILLI 10
+
+/// <summary>
+/// Copies page 0 of the device memory (the status, temperature, voltage and current registers) to
+/// its scratchpad, so it can be read with <see src="Ds2438ReadPage0"/>.  The registers are only
+/// updated in memory by a conversion (Convert T, 0x44, is the same command as the DS18B20.)  You
+/// must be sure to select a device prior to using this command, and select it again before
+/// reading the scratchpad.
+/// </summary>
+/// <returns>true if no error was detected, otherwise false.</returns>
+bool Ds2438RecallPage0(void);
+
+/// <summary>
+/// Reads page 0 from the scratchpad of the selected device, after
+/// <see src="Ds2438RecallPage0"/>.  You must be sure to select a device prior to using this
+/// command.
+/// </summary>
+/// <param name="page">Receives the 8 bytes of the page and its CRC.</param>
+/// <returns>true if the page was read and passed its CRC check, otherwise false.</returns>
+bool Ds2438ReadPage0(uint8_t *page);
+
+/// <summary>
+/// Converts the temperature register of page 0 to 1/16 degrees celsius, checking the value is
+/// plausible: the 3 unused low bits must be clear and the temperature must be within the -55C to
+/// 125C range of the device.  The register has a resolution of 1/32 degrees; the lowest bit is
+/// dropped.
+/// </summary>
+/// <param name="page">The page (see <see src="Ds2438ReadPage0"/>.)</param>
+/// <param name="raw">Receives the temperature in 1/16 degrees celsius.</param>
+/// <returns>true if the temperature is plausible, otherwise false.</returns>
+bool Ds2438DecodeTemperature(const uint8_t *page, int16_t *raw);
@@ -11,13 +11,25 @@
 // - GPIO (digital input for button)
 // - log (displays messages in the Device Output window during debugging)
 // - eventloop (system invokes handlers for timer events)
+// - networking (checks that the network is ready before connecting to the IoT hub)
 
+#include "adaptivepoll.h"
 #include "ds18b20.h"
 #include "eventloop_timer_utilities.h"
 #include "onewire.h"
+#include "onewiredriver.h"
+#include "onewirehealth.h"
+#include "onewireinventory.h"
+#include "onewirelog.h"
 #include "onewirerom.h"
+#include "onewirescheduler.h"
 #include "onewiresearch.h"
+#include "onewirestats.h"
+#include "onewiretrace.h"
 #include "onewireuart.h"
+#include "readingbuffer.h"
+#include "telemetry.h"
+#include "telemetryiothub.h"
 
 #include "sleep.h"
 
@@ -61,6 +73,11 @@ typedef enum {
     ExitCode_Init_TemperaturePollTimer = 4,
     ExitCode_Init_OpenLed = 5,
     ExitCode_Main_EventLoopFail = 6,
+    ExitCode_Init_OneWireBus = 7,
+    ExitCode_StatsTimer_Consume = 8,
+    ExitCode_Init_StatsTimer = 9,
+    ExitCode_TelemetryTimer_Consume = 10,
+    ExitCode_Init_TelemetryTimer = 11,
 } ExitCode;
 
 /// <summary>
@@ -88,15 +105,174 @@ static float tLow = 65.0;
 /// </summary>
 static float tHigh = 75.0;
 
+/// <summary>
+/// true to only read the devices that an alarm search finds (the alarm thresholds of every
+/// device are set from tLow and tHigh), false to read every device on every reading.
+/// </summary>
+static const bool alarmMonitoring = true;
+
+/// <summary>
+/// true to read only the temperature bytes of the devices an alarm search finds, in a single
+/// pipelined pass without a CRC (see Ds18b20ReadTemperatures), false to read their scratchpads.
+/// </summary>
+static const bool fastTemperatureReads = false;
+
+/// <summary>
+/// tLow and tHigh in 1/16 degrees celsius, for classifying the readings.
+/// </summary>
+static Ds18b20Thresholds temperatureThresholds;
+
+/// <summary>
+/// The DS18B20 alarm thresholds (in celsius), from tLow and tHigh.
+/// </summary>
+static int8_t alarmTLow;
+static int8_t alarmTHigh;
+
+/// <summary>
+/// true to write the alarm thresholds (from tLow and tHigh) and provisionResolution to the EEPROM
+/// of every device on every bus at startup, e.g. when commissioning a rack of sensors (see
+/// Ds18b20Provision.)  The configuration is sent to every device on a bus with Skip ROM, so a bus
+/// with a device that is not a DS18B20 or DS1822 is not configured.
+/// </summary>
+static const bool provisionOnStart = false;
+static const ThermometerResolution provisionResolution = ThermometerResolution12bits;
+
+/// <summary>
+/// The range of the interval (in milliseconds) between reads of each device.  Devices that are
+/// stable and far from tLow and tHigh are read less often (see AdaptivePollRecord.)  Devices that
+/// an alarm search finds are read on every reading.
+/// </summary>
+static const int minReadIntervalMilli = 3000;
+static const int maxReadIntervalMilli = 60000;
+
+/// <summary>
+/// The number of groups the devices on each bus are split into for their conversions (1 to
+/// ONEWIRE_SCHEDULER_MAX_GROUPS.)  With 1 group, every device on a bus is converted at once with
+/// Skip ROM and then read, so the bus is idle during the conversion and busy after it.  With more
+/// groups, the devices of each group that are due to be read are converted with Match ROM (see
+/// StartGroupConversion), and the groups are staggered across the check period, so one group is
+/// read while the others convert and the bus is used evenly.  The check period can then be
+/// shorter than a conversion plus a read of every device.  Only buses where every device is VCC
+/// powered are converted in groups (a conversion on the strong pullup holds the bus), and the
+/// alarm search is not used for group conversions.
+/// </summary>
+static const int conversionGroupCount = 1;
+
+/// <summary>
+/// The check period, and the shortest interval between reads of each device (in milliseconds),
+/// when the devices are converted in groups; minReadIntervalMilli is used with a single group.
+/// Each group is converted and read once per period, so this only has to be longer than a
+/// conversion plus a read of one group, and a device can be read on every conversion of its
+/// group.
+/// </summary>
+static const int groupReadIntervalMilli = 1000;
+
+/// <summary>
+/// How often (in seconds) the OneWire bus is searched for devices that were added or removed.  The
+/// bus is also searched whenever a device fails to respond.
+/// </summary>
+static const int inventoryRefreshIntervalSeconds = 300;
+
 /// <summary>
 /// Event loop used for dispatching events during the main program.
 /// </summary>
 EventLoop *eventLoop = NULL;
 
 /// <summary>
-/// Event loop timer that triggers periodically to take a temperature reading.
+/// Event loop timer that triggers periodically to log the OneWire statistics.
+/// </summary>
+EventLoopTimer *statsDumpTimer = NULL;
+
+/// <summary>
+/// How often (in seconds) the OneWire statistics are logged.
+/// </summary>
+static const int statsDumpIntervalSeconds = 60;
+
+/// <summary>
+/// Event loop timer that triggers periodically to batch the readings and send the batches.
+/// </summary>
+EventLoopTimer *telemetryTimer = NULL;
+
+/// <summary>
+/// How often (in seconds) the readings are moved into the telemetry batch and the IoT Hub client
+/// does its work.
+/// </summary>
+static const int telemetryIntervalSeconds = 1;
+
+/// <summary>
+/// How long (in seconds) a telemetry batch collects readings before it is sent, unless it fills
+/// up first.
+/// </summary>
+static const int telemetryMaxBatchAgeSeconds = 60;
+
+/// <summary>
+/// The ID scope of the Azure IoT Hub Device Provisioning Service, from the first command line
+/// argument (CmdArgs in app_manifest.json), or NULL to only log the telemetry batches.
+/// </summary>
+static const char *iotHubScopeId = NULL;
+
+/// <summary>
+/// A OneWire bus: the UART used for communication, the UART used for reset pulses (or
+/// ONEWIRE_NO_RESET_UART to change the baud rate of the first UART) and the GPIO used for the
+/// strong pullup.
 /// </summary>
-EventLoopTimer *temperaturePollTimer = NULL;
+typedef struct {
+    UART_Id uart;
+    UART_Id resetUart;
+    GPIO_Id pullupGpio;
+} OneWireBusConfig;
+
+/// <summary>
+/// The OneWire buses to read.  To add a bus, add its UART and pullup GPIO here and to the
+/// Capabilities in app_manifest.json.  Up to ONEWIRE_MAX_BUSES buses are supported.
+/// </summary>
+static const OneWireBusConfig oneWireBuses[] = {
+    // Header3, pin 1 = VCC
+    // Header3, pin 2 = GND
+    // Header2, pin 1 = RX  (SAMPLE_NRF52_UART)
+    // Header2, pin 2 = TX  (SAMPLE_NRF52_UART)
+    // Header2, pin 4 = 680 ohm resistor connected to RX (one wire bus).   (SAMPLE_NRF52_RESET)
+    {.uart = SAMPLE_NRF52_UART, .resetUart = ONEWIRE_NO_RESET_UART, .pullupGpio = SAMPLE_NRF52_RESET},
+};
+
+/// <summary>
+/// The temperature ranges of the readings from the last read of each bus.
+/// </summary>
+static bool busTempLow[ONEWIRE_MAX_BUSES];
+static bool busTempHigh[ONEWIRE_MAX_BUSES];
+static bool busTempNormal[ONEWIRE_MAX_BUSES];
+
+/// <summary>
+/// The conversion time (in milliseconds) allowed for the last conversion on each bus.
+/// </summary>
+static int busConversionMilli[ONEWIRE_MAX_BUSES];
+
+/// <summary>
+/// true if the last conversion started by a group was a conversion of every device on the bus
+/// (which is read by ReadTemperatures), false if it was a group conversion (which is read by
+/// ReadGroup.)
+/// </summary>
+static bool groupConvertedBus[ONEWIRE_MAX_BUSES][ONEWIRE_SCHEDULER_MAX_GROUPS];
+
+/// <summary>
+/// The conversion time (in milliseconds) allowed for the last group conversion of each group.
+/// </summary>
+static int groupConversionMilli[ONEWIRE_MAX_BUSES][ONEWIRE_SCHEDULER_MAX_GROUPS];
+
+/// <summary>
+/// The devices on each bus that a group conversion started and that have not been read yet, and
+/// the group that converted each of them.  The ROM identifiers are kept rather than the inventory
+/// indexes, as a search while another group converts can reorder the inventory.
+/// </summary>
+static OneWireRomId groupConvertingRoms[ONEWIRE_MAX_BUSES][ONEWIRE_INVENTORY_MAX_DEVICES];
+static int groupConvertingGroups[ONEWIRE_MAX_BUSES][ONEWIRE_INVENTORY_MAX_DEVICES];
+static int groupConvertingCount[ONEWIRE_MAX_BUSES];
+
+/// <summary>
+/// true once every device in the inventory on the bus has been read and has its alarm thresholds
+/// set, so the bus can be read with an alarm search.
+/// </summary>
+static bool busAlarmThresholdsSet[ONEWIRE_MAX_BUSES];
 
 /// <summary>
 /// The exit code for the application.
@@ -104,7 +280,36 @@ EventLoopTimer *temperaturePollTimer = NULL;
 static volatile sig_atomic_t exitCode = ExitCode_Success;
 
 static void TerminationHandler(int signalNumber);
-static void TemperatureTimerEventHandler(EventLoopTimer *timer);
+static int StartConversion(int bus, int group, bool *holdsBus);
+static int StartGroupConversion(int bus, int group);
+static bool IsGroupConverting(int bus, OneWireRomId rom);
+static int GetConversionMilli(int device);
+static int GetBusConversionMilli(int bus);
+static bool BusNeedsStrongPullup(int bus);
+static int ReadConversion(int bus, int group);
+static void RefreshInventory(int bus);
+static int ReadTemperatures(int bus);
+static int ReadGroup(int bus, int group);
+static bool IsDeviceDue(int device);
+static int GetMinReadIntervalMilli(void);
+static int GetNextConversionMilli(int bus);
+static void ReadAlarmedDevices(int bus, bool *tempLow, bool *tempHigh, bool *tempNormal);
+static bool ReadTemperature(int bus, int device, int conversionMilli,
+                            Ds18b20Scratchpad *scratchpad);
+static int RecordScratchpads(int bus, const int *devices, const Ds18b20Scratchpad *scratchpads,
+                             int count, bool *tempLow, bool *tempHigh, bool *tempNormal);
+static void RecordReading(int bus, int device, int16_t raw, TemperatureClass class, bool *tempLow,
+                          bool *tempHigh, bool *tempNormal);
+static void RecordLastClass(int device, bool *tempLow, bool *tempHigh, bool *tempNormal);
+static void AddReading(int bus, int device, int16_t raw, ReadingStatus status);
+static int16_t GetRawThreshold(float fahrenheit, bool roundUp);
+static int8_t GetAlarmThreshold(float fahrenheit);
+static void SchedulerFailed(void);
+static void ProvisionBuses(void);
+static void UpdateTemperatureLED(void);
+static void StatsTimerEventHandler(EventLoopTimer *timer);
+static void TelemetryTimerEventHandler(EventLoopTimer *timer);
+static bool LogTelemetryBatch(const uint8_t *batch, size_t length);
 static void SetTemperatureLED(bool tempLow, bool tempHigh, bool tempNormal);
 static ExitCode InitPeripheralsAndHandlers(void);
 static void CloseFdAndPrintError(int fd, const char *fdName);
@@ -121,95 +326,887 @@ static void TerminationHandler(int signalNumber)
 }
 
 /// <summary>
-/// Requests the latest temperature from all connected DS18B20 devices and
-/// sets LED2 based on the temperature ranges.
+/// Starts a temperature conversion on all devices connected to the bus, whatever their family, or
+/// on the devices of a group (see conversionGroupCount.)  The results are read by
+/// <see src="ReadConversion"/> once the conversion time has elapsed.
 /// </summary>
-/// <param name="timer">The timer that invoked the handler.</param>
-static void TemperatureTimerEventHandler(EventLoopTimer *timer)
+/// <param name="bus">The bus number (the bus is already selected).</param>
+/// <param name="group">The group number.</param>
+/// <param name="holdsBus">Set to true if the conversion runs on the strong pullup.</param>
+/// <returns>The conversion time in milliseconds, or -1 if the conversion was not started.</returns>
+static int StartConversion(int bus, int group, bool *holdsBus)
 {
     bool status;
 
-    if (ConsumeEventLoopTimerEvent(timer) != 0) {
-        exitCode = ExitCode_TemperatureTimer_Consume;
-        return;
+    groupConvertedBus[bus][group] = false;
+    if (conversionGroupCount > 1) {
+        RefreshInventory(bus);
+        if (!BusNeedsStrongPullup(bus)) {
+            return StartGroupConversion(bus, group);
+        }
+        if (group != 0) {
+            // The first group converts every device on the bus.
+            return 0;
+        }
     }
+    groupConvertedBus[bus][group] = true;
 
     // Using SkipROM will cause the next command will go to all devices connected on the OneWire bus.
     status = OneWireSkipROM();
-    Log_Debug("INFO: OneWireSkipROM returned %s.\n", status ? "true" : "false");
+    ONEWIRE_LOG_DEBUG("INFO: OneWireSkipROM on bus %d returned %s.\n", bus,
+                      status ? "true" : "false");
+    if (!status) {
+        OneWireLogFlush();
+        return -1;
+    }
+
+    // Request the devices to a temperature conversion; every supported family converts on the same
+    // Convert T command.  The strong pullup is only enabled if a device on the bus uses parasitic
+    // power (or has not been read yet), and the conversion time is the longest of the devices on
+    // the bus (for their family and resolution), so they are read as soon as possible.
+    bool strongPullup = BusNeedsStrongPullup(bus);
+    status = Ds18b20StartConvertT(strongPullup);
+    ONEWIRE_LOG_DEBUG("INFO: Ds18b20StartConvertT returned %s.\n", status ? "true" : "false");
+
+    // The strong pullup stays on while the devices convert; the event loop keeps running (and the
+    // other buses keep being read) until the scheduler calls ReadTemperatures.
+    *holdsBus = strongPullup;
+    busConversionMilli[bus] = GetBusConversionMilli(bus);
+    OneWireLogFlush();
+    ONEWIRE_LOG_INFO("INFO: Waiting %dms for conversion%s.\n", busConversionMilli[bus],
+                     strongPullup ? " with strong pullup" : "");
+    return busConversionMilli[bus];
+}
+
+/// <summary>
+/// Starts a temperature conversion on the devices of a group that are due to be read, addressing
+/// each device with Match ROM.  The devices on the bus are split into the groups in inventory
+/// order.  The results are read by <see src="ReadGroup"/> once the conversion time has elapsed.
+/// Every device on the bus must be VCC powered.
+/// </summary>
+/// <param name="bus">The bus number (the bus is already selected).</param>
+/// <param name="group">The group number.</param>
+/// <returns>The conversion time in milliseconds (0 if no device in the group is due.)</returns>
+static int StartGroupConversion(int bus, int group)
+{
+    int devices[ONEWIRE_INVENTORY_MAX_DEVICES];
+    OneWireRomId roms[ONEWIRE_INVENTORY_MAX_DEVICES];
+    bool started[ONEWIRE_INVENTORY_MAX_DEVICES];
+    int conversionMilli = 0;
+    int count = 0;
+    int position = 0;
+    for (int device = 0; device < OneWireInventoryGetCount(); device++) {
+        if (OneWireInventoryGetBus(device) != bus || position++ % conversionGroupCount != group) {
+            continue;
+        }
+
+        // A device that another group is still converting (the inventory was reordered by a
+        // search) is read by that group.
+        OneWireRomId rom = OneWireInventoryGetRomId(device);
+        if (!IsDeviceDue(device) || IsGroupConverting(bus, rom)) {
+            continue;
+        }
+
+        int deviceMilli = GetConversionMilli(device);
+        if (deviceMilli > conversionMilli) {
+            conversionMilli = deviceMilli;
+        }
+        roms[count] = rom;
+        devices[count++] = device;
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    int startedCount = Ds18b20StartConvertTs(roms, count, started);
+    for (int i = 0; i < count; i++) {
+        if (started[i]) {
+            groupConvertingRoms[bus][groupConvertingCount[bus]] = roms[i];
+            groupConvertingGroups[bus][groupConvertingCount[bus]++] = group;
+        } else {
+            // The device may have been removed, so the bus will be searched on the next reading.
+            ONEWIRE_LOG_WARN("WARN: Could not start the conversion of device %016llx.\n",
+                             (unsigned long long)roms[i]);
+            OneWireInventoryReportFailure(devices[i]);
+            AddReading(bus, devices[i], 0, ReadingStatus_Failed);
+        }
+    }
+
+    groupConversionMilli[bus][group] = conversionMilli;
+    OneWireLogFlush();
+    ONEWIRE_LOG_INFO("INFO: Waiting %dms for conversion of %d devices in group %d on bus %d.\n",
+                     conversionMilli, startedCount, group, bus);
+    return conversionMilli;
+}
+
+/// <summary>
+/// Returns true if a group conversion on the bus has started converting the device, and the
+/// device has not been read yet.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>true if the device is converting, otherwise false.</returns>
+static bool IsGroupConverting(int bus, OneWireRomId rom)
+{
+    for (int i = 0; i < groupConvertingCount[bus]; i++) {
+        if (groupConvertingRoms[bus][i] == rom) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/// <summary>
+/// Returns the conversion time of a device in the inventory, from the conversion time table of its
+/// family and its resolution.  A device that has not been read yet is given the time for 12 bits.
+/// </summary>
+/// <param name="device">The index of the device in the inventory.</param>
+/// <returns>The conversion time in milliseconds.</returns>
+static int GetConversionMilli(int device)
+{
+    int resolution = OneWireInventoryGetResolution(device);
+    if (resolution == ONEWIRE_INVENTORY_RESOLUTION_UNKNOWN) {
+        resolution = ThermometerResolution12bits;
+    }
+
+    // The inventory only keeps the families that have a driver.
+    const OneWireDriver *driver = OneWireDriverFindForRom(OneWireInventoryGetRomId(device));
+    return driver->getConversionTimeMilli((ThermometerResolution)resolution);
+}
+
+/// <summary>
+/// Returns the longest conversion time of the devices in the inventory on the bus.  If the bus has
+/// no devices in the inventory, the DS18B20 conversion time at 12 bits is returned, so that any
+/// device found by the next search has time to convert.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <returns>The conversion time to allow, in milliseconds.</returns>
+static int GetBusConversionMilli(int bus)
+{
+    int conversionMilli = -1;
+    for (int device = 0; device < OneWireInventoryGetCount(); device++) {
+        if (OneWireInventoryGetBus(device) == bus) {
+            int deviceMilli = GetConversionMilli(device);
+            if (deviceMilli > conversionMilli) {
+                conversionMilli = deviceMilli;
+            }
+        }
+    }
+
+    return conversionMilli < 0 ? Ds18b20GetConversionTimeMilli(ThermometerResolution12bits)
+                               : conversionMilli;
+}
+
+/// <summary>
+/// Returns true if a device in the inventory on the bus uses parasitic power, or has not had its
+/// power mode read yet (including when the bus has no devices in the inventory.)
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <returns>true if the strong pullup is needed during a conversion, otherwise false.</returns>
+static bool BusNeedsStrongPullup(int bus)
+{
+    bool hasDevices = false;
+    for (int device = 0; device < OneWireInventoryGetCount(); device++) {
+        if (OneWireInventoryGetBus(device) != bus) {
+            continue;
+        }
+
+        hasDevices = true;
+        if (OneWireInventoryGetPower(device) != OneWireInventoryPower_Vcc) {
+            return true;
+        }
+    }
+
+    return !hasDevices;
+}
+
+/// <summary>
+/// Writes the alarm thresholds and provisionResolution to the EEPROM of every device on every bus,
+/// with one broadcast write and copy per bus, and logs the devices that did not take the new
+/// configuration.  The buses are searched first if the inventory has no devices on them.  A bus
+/// with a device that does not have the DS18B20 registers is skipped, as the broadcast would write
+/// to its memory.
+/// </summary>
+static void ProvisionBuses(void)
+{
+    for (int bus = 0; bus < OneWireGetBusCount(); bus++) {
+        if (!OneWireSelectBus(bus)) {
+            continue;
+        }
+        OneWireInventoryRefreshIfNeeded();
+
+        int devices[ONEWIRE_INVENTORY_MAX_DEVICES];
+        OneWireRomId roms[ONEWIRE_INVENTORY_MAX_DEVICES];
+        bool configured[ONEWIRE_INVENTORY_MAX_DEVICES];
+        int count = 0;
+        bool compatible = true;
+        for (int device = 0; device < OneWireInventoryGetCount(); device++) {
+            if (OneWireInventoryGetBus(device) == bus) {
+                roms[count] = OneWireInventoryGetRomId(device);
+                devices[count++] = device;
+                const OneWireDriver *driver = OneWireDriverFindForRom(roms[count - 1]);
+                compatible = compatible && driver->ds18b20Compatible;
+            }
+        }
+        if (count == 0) {
+            continue;
+        }
+        if (!compatible) {
+            Log_Debug("WARN: Bus %d has devices that are not DS18B20 compatible; not configured.\n",
+                      bus);
+            continue;
+        }
+
+        int configuredCount = Ds18b20Provision(roms, count, alarmTHigh, alarmTLow,
+                                               provisionResolution, BusNeedsStrongPullup(bus),
+                                               configured);
+        for (int i = 0; i < count; i++) {
+            if (configured[i]) {
+                OneWireInventorySetResolution(devices[i], provisionResolution);
+            } else if (configuredCount >= 0) {
+                ONEWIRE_LOG_WARN("WARN: Device %016llx was not configured.\n",
+                                 (unsigned long long)roms[i]);
+            }
+        }
+        OneWireLogFlush();
+        Log_Debug("INFO: %d of %d devices on bus %d configured.\n",
+                  configuredCount < 0 ? 0 : configuredCount, count, bus);
+    }
+
+    OneWireInventorySave();
+}
+
+/// <summary>
+/// Called if the OneWire scheduler stops because of an error.
+/// </summary>
+static void SchedulerFailed(void)
+{
+    exitCode = ExitCode_TemperatureTimer_Consume;
+}
+
+/// <summary>
+/// Logs the OneWire statistics collected since the last time they were logged, and the OneWire
+/// trace if it is enabled (see onewiretrace.h).
+/// </summary>
+/// <param name="timer">The timer that invoked the handler.</param>
+static void StatsTimerEventHandler(EventLoopTimer *timer)
+{
+    if (ConsumeEventLoopTimerEvent(timer) != 0) {
+        exitCode = ExitCode_StatsTimer_Consume;
+        return;
+    }
+
+    OneWireStatsDump();
+    OneWireStatsReset();
+
+    TelemetryCounters counters;
+    TelemetryGetCounters(&counters);
+    Log_Debug("INFO: %u readings sent in %u batches (%u bytes), %u send failures, %d batches "
+              "pending, %u readings dropped.\n",
+              counters.readingsSent, counters.batchesSent, counters.bytesSent,
+              counters.sendFailures, counters.pendingBatches, ReadingBufferGetDropped());
+
+    OneWireTraceLog();
+}
+
+/// <summary>
+/// Moves the readings into the telemetry batches and sends the oldest batch that is waiting.
+/// </summary>
+/// <param name="timer">The timer that invoked the handler.</param>
+static void TelemetryTimerEventHandler(EventLoopTimer *timer)
+{
+    if (ConsumeEventLoopTimerEvent(timer) != 0) {
+        exitCode = ExitCode_TelemetryTimer_Consume;
+        return;
+    }
+
+    TelemetryCollect();
+    if (iotHubScopeId != NULL) {
+        TelemetryIotHubDoWork();
+    }
+    TelemetrySendNext();
+}
+
+/// <summary>
+/// Logs the size of a telemetry batch instead of sending it, when no IoT hub is configured.
+/// </summary>
+/// <param name="batch">The encoded batch.</param>
+/// <param name="length">The length of the batch in bytes.</param>
+/// <returns>true.</returns>
+static bool LogTelemetryBatch(const uint8_t *batch, size_t length)
+{
+    Log_Debug("INFO: Telemetry batch of %u readings in %u bytes.\n",
+              (unsigned)(batch[2] | (batch[3] << 8)), (unsigned)length);
+    TelemetryConfirm(true);
+    return true;
+}
 
-    // Request the devices to a temperature conversion.  We pass true for enabling the strong pullup, so
-    // the device doesn't need to have a separate VCC wire connected (it can use parasitic power).  We pass
-    // the maximum resolution of 12bits so that all devices have a chance to do conversion.  If you know all
-    // devices are using a different bit resolution, you can use that value and conversion will happen quicker.
-    status = Ds18b20ConvertT(true, ThermometerResolution12bits);
-    Log_Debug("INFO: Ds18b20ConvertT returned %s.\n", status ? "true" : "false");
+/// <summary>
+/// Reads the results of the last conversion started by a group (see
+/// <see src="StartConversion"/>.)
+/// </summary>
+/// <param name="bus">The bus number (the bus is already selected).</param>
+/// <param name="group">The group number.</param>
+/// <returns>The time in milliseconds until the next conversion of the group should start, or -1
+/// for the scheduler period.</returns>
+static int ReadConversion(int bus, int group)
+{
+    return groupConvertedBus[bus][group] ? ReadTemperatures(bus) : ReadGroup(bus, group);
+}
 
-    // The DS18B20 uses a family code of 0x28.  We will only search for OneWire devices starting with that ID,
-    // skiping any other device families that are on the OneWire bus. If you want to search for all OneWire 
-    // devices use OneWireResetSearch instead of OneWireTargetSetup.
-    OneWireTargetSetup(0x28);
+/// <summary>
+/// Searches the bus if the inventory is empty, stale or the refresh interval has elapsed;
+/// otherwise the devices found by the previous search are addressed directly.
+/// </summary>
+/// <param name="bus">The bus number (the bus is already selected).</param>
+static void RefreshInventory(int bus)
+{
+    if (OneWireInventoryRefreshIfNeeded()) {
+        ONEWIRE_LOG_INFO("INFO: OneWire bus searched, %d devices found.\n",
+                         OneWireInventoryGetCount());
+        busAlarmThresholdsSet[bus] = false;
+    }
+}
+
+/// <summary>
+/// Requests the latest temperature from the DS18B20 devices connected to the bus that are due to
+/// be read, and sets LED2 based on the temperature ranges.  The devices that are not due keep the
+/// temperature range of their last reading.
+/// </summary>
+/// <param name="bus">The bus number (the bus is already selected).</param>
+/// <returns>The time in milliseconds until the next conversion should start, or -1 for the
+/// scheduler period.</returns>
+static int ReadTemperatures(int bus)
+{
+    RefreshInventory(bus);
 
     bool tempNormal = false;
     bool tempHigh = false;
     bool tempLow = false;
 
-    bool searchStatus;
-    do {
-        // We pass false here, because we want to search fo all OneWire devices (within our family code) not
-        // just alerted devices.
-        searchStatus = OneWireSearchROM(false);
-        Log_Debug("INFO: OneWireSearchROM returned %s.\n", status ? "true" : "false");
-        if (!searchStatus) {
-            // No more devices were found, so exit the loop.
-            break;
+    bool alarmSearch = alarmMonitoring && busAlarmThresholdsSet[bus];
+    if (alarmSearch) {
+        ReadAlarmedDevices(bus, &tempLow, &tempHigh, &tempNormal);
+    } else {
+        // Every device is read until the alarm thresholds of all of them are set; after that the
+        // alarm search is used instead.  Without alarm monitoring only the devices that are due
+        // are read.
+        bool readAll = alarmMonitoring;
+        Ds18b20Scratchpad scratchpads[ONEWIRE_INVENTORY_MAX_DEVICES];
+        int devices[ONEWIRE_INVENTORY_MAX_DEVICES];
+        int readCount = 0;
+        int busDeviceCount = 0;
+        int deviceCount = OneWireInventoryGetCount();
+        for (int device = 0; device < deviceCount; device++) {
+            if (OneWireInventoryGetBus(device) != bus) {
+                continue;
+            }
+
+            busDeviceCount++;
+            if (readAll || IsDeviceDue(device)) {
+                if (ReadTemperature(bus, device, busConversionMilli[bus],
+                                    &scratchpads[readCount])) {
+                    devices[readCount++] = device;
+                }
+            } else {
+                RecordLastClass(device, &tempLow, &tempHigh, &tempNormal);
+            }
         }
-    
-        // Display the ROM number in the debug console.
-        OneWireDebugDumpROM();
 
-        // The next command is for the device with the matching ROM identifier.
-        status = OneWireMatchROM();
-        Log_Debug("INFO: OneWireMatchROM returned %s.\n", status ? "true" : "false");
+        int validCount = RecordScratchpads(bus, devices, scratchpads, readCount, &tempLow,
+                                           &tempHigh, &tempNormal);
+        busAlarmThresholdsSet[bus] = readAll && validCount == busDeviceCount && busDeviceCount > 0;
+    }
 
-        if (status) {
-            // Returns true if the device is connected to VCC, false if it is using single wire.
-            status = Ds18b20ReadPowerSupplyVCC();
-            Log_Debug("INFO: Ds18b20ReadPowerSupplyVCC returned %s.\n",
-                      status ? "VCC powered" : "OneWire powered");
+    // Only writes to mutable storage when a device was added or removed, or its settings changed.
+    OneWireInventorySave();
+
+    busTempLow[bus] = tempLow;
+    busTempHigh[bus] = tempHigh;
+    busTempNormal[bus] = tempNormal;
+    UpdateTemperatureLED();
+
+    // The messages from the bus transactions are only formatted once the bus has been read.
+    OneWireLogFlush();
+
+    // The alarm search needs a conversion every period to find the devices in the alarm state.
+    return alarmSearch ? -1 : GetNextConversionMilli(bus);
+}
+
+/// <summary>
+/// Reads the devices that the last group conversion of the group started (see
+/// <see src="StartGroupConversion"/>), and sets LED2 based on their temperature ranges and the
+/// last readings of the other devices on the bus.
+/// </summary>
+/// <param name="bus">The bus number (the bus is already selected).</param>
+/// <param name="group">The group number.</param>
+/// <returns>-1, for the scheduler period.</returns>
+static int ReadGroup(int bus, int group)
+{
+    Ds18b20Scratchpad scratchpads[ONEWIRE_INVENTORY_MAX_DEVICES];
+    int devices[ONEWIRE_INVENTORY_MAX_DEVICES];
+    bool attempted[ONEWIRE_INVENTORY_MAX_DEVICES] = {false};
+    int attemptedCount = 0;
+    int readCount = 0;
+    int i = 0;
+    while (i < groupConvertingCount[bus]) {
+        if (groupConvertingGroups[bus][i] != group) {
+            i++;
+            continue;
+        }
+
+        // A device that a search has removed since the conversion started is not read.
+        int device = OneWireInventoryGetIndex(groupConvertingRoms[bus][i]);
+        if (device >= 0 && OneWireInventoryGetBus(device) == bus) {
+            attempted[device] = true;
+            attemptedCount++;
+            if (ReadTemperature(bus, device, groupConversionMilli[bus][group],
+                                &scratchpads[readCount])) {
+                devices[readCount++] = device;
+            }
+        }
+
+        int last = --groupConvertingCount[bus];
+        groupConvertingRoms[bus][i] = groupConvertingRoms[bus][last];
+        groupConvertingGroups[bus][i] = groupConvertingGroups[bus][last];
+    }
+
+    if (attemptedCount == 0) {
+        return -1;
+    }
+
+    bool tempNormal = false;
+    bool tempHigh = false;
+    bool tempLow = false;
+    RecordScratchpads(bus, devices, scratchpads, readCount, &tempLow, &tempHigh, &tempNormal);
+    for (int device = 0; device < OneWireInventoryGetCount(); device++) {
+        if (OneWireInventoryGetBus(device) == bus && !attempted[device]) {
+            RecordLastClass(device, &tempLow, &tempHigh, &tempNormal);
+        }
+    }
+
+    OneWireInventorySave();
+
+    busTempLow[bus] = tempLow;
+    busTempHigh[bus] = tempHigh;
+    busTempNormal[bus] = tempNormal;
+    UpdateTemperatureLED();
+    OneWireLogFlush();
+    return -1;
+}
+
+/// <summary>
+/// Returns true if the device is due to be read.  Devices that are due within half of the
+/// minimum read interval are also read, so they share this conversion instead of needing their
+/// own.
+/// </summary>
+/// <param name="device">The index of the device in the inventory.</param>
+/// <returns>true if the device should be read, otherwise false.</returns>
+static bool IsDeviceDue(int device)
+{
+    return AdaptivePollGetDueMilli(OneWireInventoryGetRomId(device)) <=
+           GetMinReadIntervalMilli() / 2;
+}
+
+/// <summary>
+/// Returns the shortest interval between reads of each device, which is also the check period:
+/// groupReadIntervalMilli when the devices are converted in groups, otherwise
+/// minReadIntervalMilli.
+/// </summary>
+/// <returns>The interval in milliseconds.</returns>
+static int GetMinReadIntervalMilli(void)
+{
+    return conversionGroupCount > 1 ? groupReadIntervalMilli : minReadIntervalMilli;
+}
+
+/// <summary>
+/// Returns the time until the next conversion on the bus should start, so that it is read when
+/// the first of its devices is due.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <returns>The time in milliseconds, or -1 if the bus has no devices (the scheduler period is
+/// used.)</returns>
+static int GetNextConversionMilli(int bus)
+{
+    bool hasDevices = false;
+    long dueMilli = 0;
+    for (int device = 0; device < OneWireInventoryGetCount(); device++) {
+        if (OneWireInventoryGetBus(device) == bus) {
+            long deviceDueMilli = AdaptivePollGetDueMilli(OneWireInventoryGetRomId(device));
+            if (!hasDevices || deviceDueMilli < dueMilli) {
+                dueMilli = deviceDueMilli;
+            }
+            hasDevices = true;
         }
+    }
 
-        // The next command is for the device with the matching ROM identifier.
-        status = OneWireMatchROM();
-        Log_Debug("INFO: OneWireMatchROM returned %s.\n", status ? "true" : "false");
+    if (!hasDevices) {
+        return -1;
+    }
 
-        if (status) {
-            // Read the scratchpad (it has the temperature, resolution, tLow and tHigh values.)
-            status = Ds18b20ReadScratchpad();
-            Log_Debug("INFO: Ds18b20ReadScratchpad returned %s.\n", status ? "true" : "false");
+    // The conversion has to start before the device is due.
+    long startMilli = dueMilli - GetBusConversionMilli(bus);
+    return startMilli > 0 ? (int)startMilli : 0;
+}
+
+/// <summary>
+/// Searches for the devices on the bus in the alarm state, and only reads the temperature of
+/// those devices (and of the devices that are due to be read.)  The alarm thresholds of every
+/// device are at or inside tLow and tHigh, so any device that is not in the alarm state is within
+/// the normal range.  A device without a temperature alarm (e.g. a DS2438) is only read when it is
+/// due, and otherwise keeps the temperature range of its last reading.  If the bus failed during
+/// the search, no device is in the normal range: every device on the bus is reported as failed,
+/// and the bus is read in full on the next reading (which sets the alarm thresholds again.)
+/// </summary>
+/// <param name="bus">The bus number (the bus is already selected).</param>
+/// <param name="tempLow">Set to true if a device is below tLow.</param>
+/// <param name="tempHigh">Set to true if a device is above tHigh.</param>
+/// <param name="tempNormal">Set to true if a device is within the normal range.</param>
+static void ReadAlarmedDevices(int bus, bool *tempLow, bool *tempHigh, bool *tempNormal)
+{
+    // The whole alarm search is done before reading any device, as the reads would reset the bus in
+    // the middle of the search.
+    bool alarmed[ONEWIRE_INVENTORY_MAX_DEVICES] = {false};
+    OneWireSearchContext search;
+    OneWireSearchContextReset(&search);
+    for (int i = 0; i < ONEWIRE_INVENTORY_MAX_DEVICES && OneWireSearchNext(&search, true); i++) {
+        // Devices that are not in the inventory (e.g. added since the last search) are read once
+        // the next search finds them.
+        int device = OneWireInventoryGetIndex(search.rom);
+        if (device >= 0 && OneWireInventoryGetBus(device) == bus) {
+            alarmed[device] = true;
         }
+    }
 
-        if (status) {
-            Log_Debug("INFO: Resolution is %d bits.\n", 9 + GetScratchpadResolution());
+    // A search that stops early (a transfer error, a CRC failure, or no presence pulse) has not
+    // found every device in the alarm state, so none of the devices can be treated as normal.
+    bool busFailed = search.error || OneWireHealthIsOpen(bus);
 
-            Log_Debug("INFO: tLow is %d.\n", GetScratchpadtLow());
+    int deviceCount = OneWireInventoryGetCount();
+    if (busFailed) {
+        ONEWIRE_LOG_WARN("WARN: The alarm search of bus %d failed.\n", bus);
+        for (int device = 0; device < deviceCount; device++) {
+            if (OneWireInventoryGetBus(device) == bus) {
+                RecordReading(bus, device, 0, TemperatureClass_Invalid, tempLow, tempHigh,
+                              tempNormal);
+            }
+        }
 
-            Log_Debug("INFO: tHigh is %d.\n", GetScratchpadtHigh());
+        // The devices may have been power cycled, which restores the alarm thresholds from their
+        // EEPROM.
+        busAlarmThresholdsSet[bus] = false;
+        return;
+    }
 
-            float temp = GetScratchpadFahrenheit();
-            Log_Debug("INFO: Temp is %gF.\n", temp);
+    int alarmedCount = 0;
+    int readCount = 0;
+    OneWireRomId roms[ONEWIRE_INVENTORY_MAX_DEVICES];
+    ThermometerResolution resolutions[ONEWIRE_INVENTORY_MAX_DEVICES];
+    Ds18b20Scratchpad scratchpads[ONEWIRE_INVENTORY_MAX_DEVICES];
+    int devices[ONEWIRE_INVENTORY_MAX_DEVICES];
+    int fastDevices[ONEWIRE_INVENTORY_MAX_DEVICES];
+    int fastCount = 0;
+    for (int device = 0; device < deviceCount; device++) {
+        if (OneWireInventoryGetBus(device) != bus) {
+            continue;
+        }
 
-            if (temp < tLow) {
-                tempLow = true;
-            } else if (temp > tHigh) {
-                tempHigh = true;
+        const OneWireDriver *driver = OneWireDriverFindForRom(OneWireInventoryGetRomId(device));
+        if (alarmed[device]) {
+            alarmedCount++;
+        } else if (!IsDeviceDue(device)) {
+            if (driver->writeAlarmThresholds != NULL) {
+                *tempNormal = true;
             } else {
-                tempNormal = true;
+                RecordLastClass(device, tempLow, tempHigh, tempNormal);
+            }
+            continue;
+        }
+
+        if (fastTemperatureReads && driver->ds18b20Compatible) {
+            // Every device was read before the alarm search is used, so the resolution is known.
+            roms[fastCount] = OneWireInventoryGetRomId(device);
+            resolutions[fastCount] = (ThermometerResolution)OneWireInventoryGetResolution(device);
+            fastDevices[fastCount++] = device;
+        } else if (ReadTemperature(bus, device, busConversionMilli[bus],
+                                   &scratchpads[readCount])) {
+            devices[readCount++] = device;
+        }
+    }
+
+    // The scratchpads were read from the devices that could not use the fast read.
+    RecordScratchpads(bus, devices, scratchpads, readCount, tempLow, tempHigh, tempNormal);
+    if (fastCount > 0) {
+        int16_t raw[ONEWIRE_INVENTORY_MAX_DEVICES];
+        bool valid[ONEWIRE_INVENTORY_MAX_DEVICES];
+        Ds18b20ReadTemperatures(roms, resolutions, fastCount, raw, valid);
+        for (int i = 0; i < fastCount; i++) {
+            TemperatureClass class = TemperatureClass_Invalid;
+            if (valid[i]) {
+                class = Ds18b20ClassifyTemperature(raw[i], &temperatureThresholds);
             }
+            RecordReading(bus, fastDevices[i], raw[i], class, tempLow, tempHigh, tempNormal);
+        }
+    }
+
+    ONEWIRE_LOG_INFO("INFO: %d devices on bus %d are in the alarm state.\n", alarmedCount, bus);
+}
+
+/// <summary>
+/// Reads the scratchpad of a device with the driver of its family.  When alarm monitoring is
+/// enabled, the alarm thresholds of the device are also set (if its family has a temperature
+/// alarm.)
+/// </summary>
+/// <param name="bus">The bus number (the bus is already selected).</param>
+/// <param name="device">The index of the device in the inventory.</param>
+/// <param name="conversionMilli">The conversion time that was allowed.</param>
+/// <param name="scratchpad">Receives the scratchpad of the device.</param>
+/// <returns>true if the scratchpad was read, otherwise false.</returns>
+static bool ReadTemperature(int bus, int device, int conversionMilli,
+                            Ds18b20Scratchpad *scratchpad)
+{
+    bool status;
+
+    // The inventory only keeps the families that have a driver.
+    const OneWireDriver *driver = OneWireDriverFindForRom(OneWireInventoryGetRomId(device));
+
+    // The next command is for the device with the matching ROM identifier.
+    status = OneWireInventorySelect(device);
+    ONEWIRE_LOG_DEBUG("INFO: OneWireInventorySelect returned %s.\n", status ? "true" : "false");
+
+    // The power mode does not change, so it is only read once and then kept in the inventory.
+    if (status && OneWireInventoryGetPower(device) == OneWireInventoryPower_Unknown) {
+        if (driver->readPowerSupplyVcc == NULL) {
+            OneWireInventorySetPower(device, OneWireInventoryPower_Vcc);
         } else {
-            Log_Debug("WARN: Read scratchpad failed; so this device data will not be used.\n");
+            // Returns true if the device is connected to VCC, false if it is using single wire.
+            bool vccPowered = driver->readPowerSupplyVcc();
+            OneWireInventorySetPower(device, vccPowered ? OneWireInventoryPower_Vcc
+                                                        : OneWireInventoryPower_Parasitic);
+
+            // The next command is for the device with the matching ROM identifier.
+            status = OneWireInventorySelect(device);
+            ONEWIRE_LOG_DEBUG("INFO: OneWireInventorySelect returned %s.\n",
+                              status ? "true" : "false");
         }
-    } while (searchStatus);
+    }
+    ONEWIRE_LOG_DEBUG("INFO: %s is %s.\n", driver->name,
+                      OneWireInventoryGetPower(device) == OneWireInventoryPower_Vcc
+                          ? "VCC powered"
+                          : "OneWire powered");
+
+    if (status && driver->recallScratchpad != NULL) {
+        // The result is copied to the scratchpad first, and read in a new transaction.
+        status = driver->recallScratchpad() && OneWireInventorySelect(device);
+        ONEWIRE_LOG_DEBUG("INFO: Recall scratchpad returned %s.\n", status ? "true" : "false");
+    }
+
+    if (status) {
+        // Read the scratchpad (it has the temperature, and the resolution, tLow and tHigh values of
+        // the families that have them.)
+        status = driver->readScratchpad(scratchpad);
+        ONEWIRE_LOG_DEBUG("INFO: Read scratchpad returned %s.\n", status ? "true" : "false");
+    }
+
+    if (!status) {
+        // The device may have been removed, so the bus will be searched on the next reading.
+        ONEWIRE_LOG_WARN("WARN: Read scratchpad failed; so this device data will not be used.\n");
+        OneWireInventoryReportFailure(device);
+        AddReading(bus, device, 0, ReadingStatus_Failed);
+        return false;
+    }
+
+    ThermometerResolution resolution = driver->getResolution(scratchpad);
+    ONEWIRE_LOG_DEBUG("INFO: Resolution is %d bits.\n", 9 + resolution);
+    OneWireInventorySetResolution(device, resolution);
+
+    if (alarmMonitoring &&
+        !OneWireDriverHasAlarmThresholds(driver, scratchpad, alarmTHigh, alarmTLow)) {
+        // The thresholds are only written to the scratchpad (not the EEPROM), so they are set
+        // again after the device is power cycled; the bus is read in full after every search.
+        status = OneWireInventorySelect(device) &&
+                 driver->writeAlarmThresholds(alarmTHigh, alarmTLow, resolution);
+        ONEWIRE_LOG_DEBUG("INFO: Write alarm thresholds returned %s.\n",
+                          status ? "true" : "false");
+        if (!status) {
+            // The temperature is still used; the search this causes reads the bus in full again.
+            OneWireInventoryReportFailure(device);
+        }
+    }
+
+    // A device found since the conversion started may need longer than the conversion time that
+    // was used; it is given enough time on the next reading.
+    if (driver->getConversionTimeMilli(resolution) > conversionMilli) {
+        ONEWIRE_LOG_WARN("WARN: The conversion time was too short for this device.\n");
+        AddReading(bus, device, 0, ReadingStatus_Incomplete);
+        return false;
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Decodes the scratchpads read from the devices on the bus in one pass, with the driver of each
+/// device, and records the readings (see <see src="RecordReading"/>.)
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <param name="devices">The index of each device in the inventory.</param>
+/// <param name="scratchpads">The scratchpad read from each device.</param>
+/// <param name="count">The number of devices.</param>
+/// <param name="tempLow">Set to true if a device is below tLow.</param>
+/// <param name="tempHigh">Set to true if a device is above tHigh.</param>
+/// <param name="tempNormal">Set to true if a device is within the normal range.</param>
+/// <returns>The number of devices with a valid temperature.</returns>
+static int RecordScratchpads(int bus, const int *devices, const Ds18b20Scratchpad *scratchpads,
+                             int count, bool *tempLow, bool *tempHigh, bool *tempNormal)
+{
+    OneWireRomId roms[ONEWIRE_INVENTORY_MAX_DEVICES];
+    for (int i = 0; i < count; i++) {
+        roms[i] = OneWireInventoryGetRomId(devices[i]);
+    }
+
+    int16_t raw[ONEWIRE_INVENTORY_MAX_DEVICES];
+    TemperatureClass classes[ONEWIRE_INVENTORY_MAX_DEVICES];
+    int validCount = OneWireDriverDecodeScratchpads(roms, scratchpads, count,
+                                                    &temperatureThresholds, raw, classes);
+    for (int i = 0; i < count; i++) {
+        RecordReading(bus, devices[i], raw[i], classes[i], tempLow, tempHigh, tempNormal);
+    }
+
+    return validCount;
+}
+
+/// <summary>
+/// Adds the reading of a device to the reading buffer and sets the temperature range it is in.
+/// A reading that is not valid is reported as a failure of the device.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <param name="device">The index of the device in the inventory.</param>
+/// <param name="raw">The temperature in 1/16 degrees celsius.</param>
+/// <param name="class">The class of the temperature.</param>
+/// <param name="tempLow">Set to true if the device is below tLow.</param>
+/// <param name="tempHigh">Set to true if the device is above tHigh.</param>
+/// <param name="tempNormal">Set to true if the device is within the normal range.</param>
+static void RecordReading(int bus, int device, int16_t raw, TemperatureClass class, bool *tempLow,
+                          bool *tempHigh, bool *tempNormal)
+{
+    if (class == TemperatureClass_Invalid) {
+        ONEWIRE_LOG_WARN("WARN: Read temperature failed; so this device data will not be used.\n");
+        OneWireInventoryReportFailure(device);
+        AddReading(bus, device, 0, ReadingStatus_Failed);
+        return;
+    }
+
+    AddReading(bus, device, raw, ReadingStatus_Ok);
+
+    int32_t centiFahrenheit = Ds18b20RawToCentiFahrenheit(raw);
+    int32_t magnitude = centiFahrenheit < 0 ? -centiFahrenheit : centiFahrenheit;
+    ONEWIRE_LOG_INFO("INFO: Device %016llx temp is %s%d.%02dF.\n",
+                     (unsigned long long)OneWireInventoryGetRomId(device),
+                     centiFahrenheit < 0 ? "-" : "", (int)(magnitude / 100),
+                     (int)(magnitude % 100));
+    if (class == TemperatureClass_Low) {
+        *tempLow = true;
+    } else if (class == TemperatureClass_High) {
+        *tempHigh = true;
+    } else {
+        *tempNormal = true;
+    }
+}
+
+/// <summary>
+/// Sets the temperature range of a device that was not read from its last reading.
+/// </summary>
+/// <param name="device">The index of the device in the inventory.</param>
+/// <param name="tempLow">Set to true if the device was below tLow.</param>
+/// <param name="tempHigh">Set to true if the device was above tHigh.</param>
+/// <param name="tempNormal">Set to true if the device was within the normal range.</param>
+static void RecordLastClass(int device, bool *tempLow, bool *tempHigh, bool *tempNormal)
+{
+    TemperatureClass class = AdaptivePollGetClass(OneWireInventoryGetRomId(device));
+    if (class == TemperatureClass_Low) {
+        *tempLow = true;
+    } else if (class == TemperatureClass_High) {
+        *tempHigh = true;
+    } else if (class == TemperatureClass_Normal) {
+        *tempNormal = true;
+    }
+}
+
+/// <summary>
+/// Adds the reading of a device to the reading buffer, for the telemetry to upload, and chooses
+/// when the device is read next.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <param name="device">The index of the device in the inventory.</param>
+/// <param name="raw">The temperature in 1/16 degrees celsius (ignored unless the status is
+/// ReadingStatus_Ok.)</param>
+/// <param name="status">The result of reading the device.</param>
+static void AddReading(int bus, int device, int16_t raw, ReadingStatus status)
+{
+    OneWireRomId rom = OneWireInventoryGetRomId(device);
+    ReadingBufferAdd(rom, bus, raw, status);
+    if (status == ReadingStatus_Ok) {
+        AdaptivePollRecord(rom, raw, &temperatureThresholds);
+    } else {
+        AdaptivePollReportFailure(rom);
+    }
+}
+
+/// <summary>
+/// Returns the limit in 1/16 degrees celsius for classifying the temperatures from a threshold.
+/// Only called once at startup, so the readings are classified without floating point.
+/// </summary>
+/// <param name="fahrenheit">The threshold in fahrenheit.</param>
+/// <param name="roundUp">true to round up (for tLow: the readings below the limit are low),
+/// false to round down (for tHigh: the readings above the limit are high.)</param>
+/// <returns>The limit in 1/16 degrees celsius.</returns>
+static int16_t GetRawThreshold(float fahrenheit, bool roundUp)
+{
+    float raw = (fahrenheit - 32.0f) * 80.0f / 9.0f;
+    int limit = (int)raw;
+    if (roundUp && (float)limit < raw) {
+        limit++;
+    } else if (!roundUp && (float)limit > raw) {
+        limit--;
+    }
+
+    return (int16_t)limit;
+}
+
+/// <summary>
+/// Returns the DS18B20 alarm threshold for a temperature.  The device compares the whole degrees
+/// Celsius of the temperature with the threshold, so rounding down keeps the alarm range at or
+/// inside the temperature.
+/// </summary>
+/// <param name="fahrenheit">The temperature in fahrenheit.</param>
+/// <returns>The alarm threshold in celsius.</returns>
+static int8_t GetAlarmThreshold(float fahrenheit)
+{
+    float celsius = (fahrenheit - 32.0f) * 5.0f / 9.0f;
+    int threshold = (int)celsius;
+    if ((float)threshold > celsius) {
+        threshold--;
+    }
+
+    return (int8_t)threshold;
+}
+
+/// <summary>
+/// Sets LED2 based on the temperature ranges of the readings from every bus.
+/// </summary>
+static void UpdateTemperatureLED(void)
+{
+    bool tempLow = false;
+    bool tempHigh = false;
+    bool tempNormal = false;
+    for (int bus = 0; bus < OneWireGetBusCount(); bus++) {
+        tempLow |= busTempLow[bus];
+        tempHigh |= busTempHigh[bus];
+        tempNormal |= busTempNormal[bus];
+    }
 
     SetTemperatureLED(tempLow, tempHigh, tempNormal);
 }
@@ -311,12 +1308,30 @@ static ExitCode InitPeripheralsAndHandlers(void)
         return ExitCode_Init_OpenLed;
     }
 
-    // Header3, pin 1 = VCC
-    // Header3, pin 2 = GND
-    // Header2, pin 1 = RX  (SAMPLE_NRF52_UART)
-    // Header2, pin 2 = TX  (SAMPLE_NRF52_UART)
-    // Header2, pin 4 = 680 ohm resistor connected to RX (one wire bus).   (SAMPLE_NRF52_RESET)
-    OneWireInit(SAMPLE_NRF52_UART, SAMPLE_NRF52_RESET);
+    for (size_t i = 0; i < sizeof(oneWireBuses) / sizeof(oneWireBuses[0]); i++) {
+        if (OneWireAddBusWithResetUart(oneWireBuses[i].uart, oneWireBuses[i].resetUart,
+                                       oneWireBuses[i].pullupGpio) == -1) {
+            return ExitCode_Init_OneWireBus;
+        }
+    }
+    // The inventory keeps every family that has a driver; each bus is searched for each of them,
+    // skipping any other device families that are on the OneWire bus.
+    uint8_t familyIds[ONEWIRE_DRIVER_MAX_FAMILIES];
+    int familyCount = OneWireDriverGetFamilyIds(familyIds, ONEWIRE_DRIVER_MAX_FAMILIES);
+    OneWireInventoryInit(familyIds, familyCount, inventoryRefreshIntervalSeconds);
+    AdaptivePollInit(GetMinReadIntervalMilli(), maxReadIntervalMilli);
+    temperatureThresholds.low = GetRawThreshold(tLow, true);
+    temperatureThresholds.high = GetRawThreshold(tHigh, false);
+    alarmTLow = GetAlarmThreshold(tLow);
+    alarmTHigh = GetAlarmThreshold(tHigh);
+
+    // The devices found before the last restart are verified instead of searching the buses, so
+    // the first reading is taken one conversion period after starting.
+    Log_Debug("INFO: %d saved OneWire devices verified.\n", OneWireInventoryLoad());
+    OneWireLogFlush();
+    if (provisionOnStart) {
+        ProvisionBuses();
+    }
 
     eventLoop = EventLoop_Create();
     if (eventLoop == NULL) {
@@ -324,13 +1339,38 @@ static ExitCode InitPeripheralsAndHandlers(void)
         return ExitCode_Init_EventLoop;
     }
 
-    // Take a temperature reading every 3 seconds.
-    struct timespec checkPeriod1Second = {.tv_sec = 3, .tv_nsec = 0};
-    temperaturePollTimer = CreateEventLoopPeriodicTimer(eventLoop, TemperatureTimerEventHandler, &checkPeriod1Second);
-    if (temperaturePollTimer == NULL) {
+    // Take a temperature reading on every bus every 3 seconds, or every second in each group when
+    // the devices are converted in groups (or when its first device is due to be read, without
+    // alarm monitoring.)
+    int checkPeriodMilli = GetMinReadIntervalMilli();
+    struct timespec checkPeriod = {.tv_sec = checkPeriodMilli / 1000,
+                                   .tv_nsec = (checkPeriodMilli % 1000) * 1000000L};
+    if (!OneWireSchedulerInit(eventLoop, &checkPeriod, conversionGroupCount, StartConversion,
+                              ReadConversion, SchedulerFailed)) {
         return ExitCode_Init_TemperaturePollTimer;
     }
 
+    struct timespec statsPeriod = {.tv_sec = statsDumpIntervalSeconds, .tv_nsec = 0};
+    statsDumpTimer = CreateEventLoopPeriodicTimer(eventLoop, StatsTimerEventHandler, &statsPeriod);
+    if (statsDumpTimer == NULL) {
+        return ExitCode_Init_StatsTimer;
+    }
+
+    // Without an IoT hub the batches are still encoded, so their size can be seen in the log.
+    if (iotHubScopeId != NULL) {
+        TelemetryIotHubInit(iotHubScopeId);
+        TelemetryInit(telemetryMaxBatchAgeSeconds, TelemetryIotHubSend);
+    } else {
+        TelemetryInit(telemetryMaxBatchAgeSeconds, LogTelemetryBatch);
+    }
+
+    struct timespec telemetryPeriod = {.tv_sec = telemetryIntervalSeconds, .tv_nsec = 0};
+    telemetryTimer =
+        CreateEventLoopPeriodicTimer(eventLoop, TelemetryTimerEventHandler, &telemetryPeriod);
+    if (telemetryTimer == NULL) {
+        return ExitCode_Init_TelemetryTimer;
+    }
+
     return ExitCode_Success;
 }
 
@@ -354,7 +1394,10 @@ static void CloseFdAndPrintError(int fd, const char *fdName)
 /// </summary>
 static void ClosePeripheralsAndHandlers(void)
 {
-    DisposeEventLoopTimer(temperaturePollTimer);
+    DisposeEventLoopTimer(statsDumpTimer);
+    DisposeEventLoopTimer(telemetryTimer);
+    TelemetryIotHubClose();
+    OneWireSchedulerClose();
     EventLoop_Close(eventLoop);
 
     Log_Debug("Closing file descriptors.\n");
@@ -373,6 +1416,12 @@ static void ClosePeripheralsAndHandlers(void)
 int main(int argc, char *argv[])
 {
     Log_Debug("OneWire application starting.\n");
+    if (argc > 1) {
+        iotHubScopeId = argv[1];
+    } else {
+        Log_Debug("INFO: No IoT hub scope ID in CmdArgs, so the telemetry is only logged.\n");
+    }
+
     exitCode = InitPeripheralsAndHandlers();
 
     // Use event loop to wait for events and trigger handlers, until an error or SIGTERM happens
@@ -3,8 +3,10 @@
  
 #include "onewire.h"
 #include "onewireuart.h"
+#include "onewirehealth.h"
 #include "onewirerom.h"
 #include "onewiresearch.h"
+#include "onewirestats.h"
 #include "crc8.h"
 #include "sleep.h"
 
@@ -24,6 +26,48 @@
 #include <hw/sample_appliance.h>
 
 static bool OneWireSendByteOptionalPullup(uint8_t data, bool enableStrongPullup);
+static OneWireResetResponse OneWireUartTransportReset(void);
+static OneWireResetResponse OneWireResetPulse(bool expectPresence);
+static bool OneWireTransportTouchBits(const uint8_t *sendBits, uint8_t *receiveBits,
+                                      size_t bitCount, bool enableStrongPullup);
+static int OneWireGetHealthBus(void);
+static bool OneWireSetOverdrive(bool overdrive);
+
+_Static_assert(ONEWIRE_MAX_BUSES <= ONEWIRE_UART_MAX_BUSES,
+               "The UART layer must support every OneWire bus.");
+_Static_assert(ONEWIRE_NO_RESET_UART == ONEWIRE_UART_NO_RESET_UART,
+               "The OneWire and UART layers must use the same value for no reset UART.");
+_Static_assert(DevicePresent == (int)UartImplDevicePresent && NoDevices == (int)UartImplNoDevices &&
+                   NoData == (int)UartImplNoData && HardwareFailure == (int)UartImplHardwareFailure &&
+                   BusShorted == (int)UartImplBusShorted,
+               "The OneWire and UART reset responses must match.");
+
+/// <summary>
+/// The bus used by the OneWire operations.
+/// </summary>
+static int oneWireSelectedBus = -1;
+
+/// <summary>
+/// The transport that uses the UART and GPIO of the selected bus.
+/// </summary>
+static const OneWireTransport oneWireUartTransport = {
+    .reset = OneWireUartTransportReset,
+    .touchBits = OneWireUartTouchBits,
+    .disableStrongPullup = OneWireDisableStrongPullupGpio,
+    .setOverdrive = OneWireUartSetOverdrive,
+    .getPresence = OneWireUartGetPresence,
+};
+
+/// <summary>
+/// The transport used by all of the OneWire operations.
+/// </summary>
+static const OneWireTransport *oneWireTransport = &oneWireUartTransport;
+
+/// <summary>
+/// true while <see src="OneWireProbeOverdrive"/> checks a device, so its failures are not recorded
+/// in the health of the bus.
+/// </summary>
+static bool oneWireProbing = false;
 
 /// <summary>
 /// Initialize the UART and GPIO ports and resets the ROM search.
@@ -34,26 +78,179 @@ static bool OneWireSendByteOptionalPullup(uint8_t data, bool enableStrongPullup)
 bool OneWireInit(UART_Id uart, GPIO_Id gpio) 
 {
     OneWireResetSearch();
-    return OneWireUartInit(uart, gpio);
+    int bus = OneWireAddBus(uart, gpio);
+    return bus != -1 && OneWireSelectBus(bus);
+}
+
+/// <summary>
+/// Initialize the UART and GPIO ports for an additional OneWire bus.  All of the OneWire
+/// operations use the bus chosen with <see src="OneWireSelectBus"/>.
+/// </summary>
+/// <param name="uart">The UART port to use for communication.</param>
+/// <param name="gpio">The GPIO port to use for pullup.</param>
+/// <returns>The bus number, or -1 if the initialization failed.</returns>
+int OneWireAddBus(UART_Id uart, GPIO_Id gpio)
+{
+    return OneWireAddBusWithResetUart(uart, ONEWIRE_NO_RESET_UART, gpio);
+}
+
+/// <summary>
+/// Initialize the UART and GPIO ports for an additional OneWire bus that sends its reset pulses
+/// on a second UART, so neither UART has to be reopened to change its baud rate.  See
+/// <see src="OneWireUartAddBusWithResetUart"/> for how the reset UART must be connected.
+/// </summary>
+/// <param name="uart">The UART port to use for communication.</param>
+/// <param name="resetUart">The UART port to use for reset pulses, or ONEWIRE_NO_RESET_UART.</param>
+/// <param name="gpio">The GPIO port to use for pullup.</param>
+/// <returns>The bus number, or -1 if the initialization failed.</returns>
+int OneWireAddBusWithResetUart(UART_Id uart, UART_Id resetUart, GPIO_Id gpio)
+{
+    if (OneWireUartGetBusCount() >= ONEWIRE_MAX_BUSES) {
+        Log_Debug("PROGRAM ERROR: Only %d OneWire buses are supported.\n", ONEWIRE_MAX_BUSES);
+        return -1;
+    }
+
+    return OneWireUartAddBusWithResetUart(uart, resetUart, gpio);
+}
+
+/// <summary>
+/// Selects the bus used by all of the OneWire operations.
+/// </summary>
+/// <param name="bus">The bus number returned by <see src="OneWireAddBus"/>.</param>
+/// <returns>true if the bus was selected, otherwise false.</returns>
+bool OneWireSelectBus(int bus)
+{
+    if (bus == oneWireSelectedBus) {
+        return true;
+    }
+
+    if (!OneWireUartSelectBus(bus)) {
+        return false;
+    }
+
+    oneWireSelectedBus = bus;
+    return true;
+}
+
+/// <summary>
+/// Returns the bus used by the OneWire operations.
+/// </summary>
+/// <returns>The bus number, or -1 if no bus was selected.</returns>
+int OneWireGetSelectedBus(void)
+{
+    return oneWireSelectedBus;
+}
+
+/// <summary>
+/// Returns the number of OneWire buses that have been initialized.
+/// </summary>
+/// <returns>The number of buses.</returns>
+int OneWireGetBusCount(void)
+{
+    return OneWireUartGetBusCount();
 }
 
 /// <summary>
-/// Close the UART and GPIO ports.
+/// Close the UART and GPIO ports of every bus.
 /// </summary>
 void OneWireClose(void) 
 {
     OneWireUartClose();
+    oneWireSelectedBus = -1;
 }
 
 /// <summary>
 /// Sends a Reset pulse.  After sending a reset you should send a ROM command 
-/// (e.g. Search, Read, Match, Skip, Alarm, Verify)
+/// (e.g. Search, Read, Match, Skip, Alarm, Verify)  The reset pulse is always at standard speed,
+/// which also returns any devices in overdrive to standard speed.  While the bus has failed (see
+/// onewirehealth.h) this returns NoData without using the bus, except for a reset pulse every
+/// backoff period to probe the bus.
 /// </summary>
 /// <returns>DevicePresent if reset was successful and at least one device
 /// replied, otherwise an error value from the OneWireResetResponse enum.</returns>
 OneWireResetResponse OneWireReset(void) 
 {
-    return (OneWireResetResponse)OneWireUartPulseReset();
+    // Overdrive only lasts for a single transaction.
+    if (oneWireTransport->setOverdrive != NULL) {
+        oneWireTransport->setOverdrive(false);
+    }
+
+    return OneWireResetPulse(true);
+}
+
+/// <summary>
+/// Returns the shape of the presence pulses received by the last reset pulse at standard speed on
+/// the selected bus (the UART transport returns the byte received during the reset pulse.)  The
+/// devices on a bus release it at different times, so a change means a device may have been
+/// added or removed.
+/// </summary>
+/// <returns>The shape, or -1 if the transport cannot sample it or there has not been a presence
+/// pulse.</returns>
+int OneWireGetPresence(void)
+{
+    return oneWireTransport->getPresence != NULL ? oneWireTransport->getPresence() : -1;
+}
+
+/// <summary>
+/// Sends a reset pulse at the current speed of the bus, and records its statistics and the
+/// health of the bus.
+/// </summary>
+/// <param name="expectPresence">false if no presence pulse is a valid response (e.g. devices
+/// that are not in overdrive ignore an overdrive reset pulse.)</param>
+/// <returns>DevicePresent if at least one device replied, otherwise an error value from the
+/// OneWireResetResponse enum.</returns>
+static OneWireResetResponse OneWireResetPulse(bool expectPresence)
+{
+    int bus = OneWireGetHealthBus();
+    if (!OneWireHealthAllowReset(bus)) {
+        return NoData;
+    }
+
+    struct timespec start;
+    OneWireStatsStart(&start);
+    OneWireResetResponse response = oneWireTransport->reset();
+    OneWireStatsRecord(OneWireStatsOperation_Reset, &start,
+                       response == DevicePresent || response == NoDevices);
+    if (!oneWireProbing && (expectPresence || response != NoDevices)) {
+        OneWireHealthRecordReset(bus, response);
+    }
+    return response;
+}
+
+/// <summary>
+/// Sends a sequence of time slots with the transport, unless the bus has failed.  Failures in a
+/// row open the circuit breaker of the bus (see <see src="OneWireHealthRecordTransfer"/>), so the
+/// rest of the transaction fails without waiting for the UART of a bus that is not responding.
+/// </summary>
+/// <param name="sendBits">The bits to send.</param>
+/// <param name="receiveBits">Receives the bits sampled on the bus (can be NULL.)</param>
+/// <param name="bitCount">The number of time slots to send.</param>
+/// <param name="enableStrongPullup">true if the pullup should be enabled after the last
+/// bit.</param>
+/// <returns>true if successful, otherwise false.</returns>
+static bool OneWireTransportTouchBits(const uint8_t *sendBits, uint8_t *receiveBits,
+                                      size_t bitCount, bool enableStrongPullup)
+{
+    int bus = OneWireGetHealthBus();
+    if (!OneWireHealthAllowTransfer(bus)) {
+        return false;
+    }
+
+    bool status = oneWireTransport->touchBits(sendBits, receiveBits, bitCount, enableStrongPullup);
+    if (!oneWireProbing) {
+        OneWireHealthRecordTransfer(bus, status);
+    }
+    return status;
+}
+
+/// <summary>
+/// Returns the bus that the health of the OneWire operations is recorded for.  A transport that
+/// is used without selecting a bus (e.g. the simulated bus) is recorded as bus 0.
+/// </summary>
+/// <returns>The bus number.</returns>
+static int OneWireGetHealthBus(void)
+{
+    return oneWireSelectedBus < 0 ? 0 : oneWireSelectedBus;
 }
 
 /// <summary>
@@ -65,7 +262,14 @@ OneWireResetResponse OneWireReset(void)
 /// <returns>true if data was successfully sent on the bus, otherwise false.</returns>
 bool OneWireWriteBit(int bit, bool enableStrongPullup)
 {
-    return OneWireUartPulseWriteBit(bit, enableStrongPullup);
+    uint8_t sentBit = bit ? 1 : 0;
+    uint8_t receivedBit = 0;
+    if (!OneWireTransportTouchBits(&sentBit, &receivedBit, 1, enableStrongPullup)) {
+        return false;
+    }
+
+    // We should receive what we sent.
+    return receivedBit == sentBit;
 }
 
 /// <summary>
@@ -74,7 +278,14 @@ bool OneWireWriteBit(int bit, bool enableStrongPullup)
 /// <returns>-1 if there was an error, otherwsie the bit (0 or 1) value is returned.</returns>
 int OneWireReadBit(void)
 {
-    return OneWireUartPulseReadBit();
+    // A write 1 slot is also a read slot.
+    uint8_t sentBit = 1;
+    uint8_t receivedBit = 0;
+    if (!OneWireTransportTouchBits(&sentBit, &receivedBit, 1, false)) {
+        return -1;
+    }
+
+    return receivedBit;
 }
 
 /// <summary>
@@ -83,26 +294,50 @@ int OneWireReadBit(void)
 /// </summary>
 void OneWireDisableStrongPullup(void)
 {
-    OneWireDisableStrongPullupGpio();
+    oneWireTransport->disableStrongPullup();
+}
+
+/// <summary>
+/// Sets the transport used by all of the OneWire operations.  By default the UART and GPIO of
+/// the selected bus are used; a simulated bus (see onewiresim.h) can be used instead to run the
+/// OneWire code without hardware.  The health of every bus is reset.
+/// </summary>
+/// <param name="transport">The transport to use, or NULL to use the UART transport.</param>
+void OneWireSetTransport(const OneWireTransport *transport)
+{
+    oneWireTransport = (transport != NULL) ? transport : &oneWireUartTransport;
+    OneWireHealthReset();
+}
+
+/// <summary>
+/// Sends a reset pulse using the UART of the selected bus.
+/// </summary>
+/// <returns>The response from <see src="OneWireUartPulseReset"/>.</returns>
+static OneWireResetResponse OneWireUartTransportReset(void)
+{
+    return (OneWireResetResponse)OneWireUartPulseReset();
 }
 
 /// <summary>
 /// Sends a byte worth of data on the OneWire bus.  Each bit is transmitted
 /// using 1 byte of the UART (which determines the length of the pulse for a 0 or 1).
-/// Using the UART ensures the timing of the bit is always the correct duration.
+/// Using the UART ensures the timing of the bit is always the correct duration.  All 8
+/// bits are sent with a single batched UART transfer.
 /// </summary>
 /// <param name="data">The byte to send on the OneWire bus.</param>
-/// <param name="enableStrongPullup">Enables the pullup GPIO after each bit.</param>
+/// <param name="enableStrongPullup">Enables the pullup GPIO after the last bit.</param>
 /// <returns>true if the byte was successfully transmitted on the OneWire bus, otherwise
 /// false.</returns>
 static bool OneWireSendByteOptionalPullup(uint8_t data, bool enableStrongPullup)
 {
-    bool status = true;
-    for (int i = 0; i < 8; i++) {
-        status &= OneWireWriteBit(data & 1, enableStrongPullup);
-        data = data >> 1;
-    }
+    struct timespec start;
+    OneWireStatsStart(&start);
 
+    // We should receive what we sent.
+    uint8_t echo = 0;
+    bool status =
+        OneWireTransportTouchBits(&data, &echo, 8, enableStrongPullup) && (echo == data);
+    OneWireStatsRecord(OneWireStatsOperation_SendByte, &start, status);
     return status;
 }
 
@@ -133,20 +368,100 @@ bool OneWireSendByteWithPullup(uint8_t data)
 /// <returns>-1 if there was an error, otherwise the byte value is returned.</returns>
 int OneWireReceiveByte(void)
 {
-    int data = 0;
-    for (int i = 0; i < 8; i++) {
-        int bitValue = OneWireReadBit();
-        if (bitValue == -1) {
-            // Set all bits of the data to on.
-            data = -1;
-        } else if (bitValue == 1) {
-            data |= (1 << i);
-        }
+    // Sending all 1 bits generates 8 read slots.
+    struct timespec start;
+    OneWireStatsStart(&start);
+    uint8_t readSlots = 0xFF;
+    uint8_t data = 0;
+    bool status = OneWireTransportTouchBits(&readSlots, &data, 8, false);
+    OneWireStatsRecord(OneWireStatsOperation_ReceiveByte, &start, status);
+    if (!status) {
+        return -1;
     }
 
     return data;
 }
 
+/// <summary>
+/// Sends a block of data on the OneWire bus.  The whole block is sent using batched UART
+/// transfers rather than one transfer per byte.
+/// </summary>
+/// <param name="data">The data to send.</param>
+/// <param name="length">The number of bytes to send.</param>
+/// <returns>true if data was successfully sent on the bus, otherwise false.</returns>
+bool OneWireWriteBlock(const uint8_t *data, size_t length)
+{
+    uint8_t echo[16];
+    size_t offset = 0;
+    while (offset < length) {
+        size_t count = length - offset;
+        if (count > sizeof(echo)) {
+            count = sizeof(echo);
+        }
+
+        memcpy(echo, data + offset, count);
+        if (!OneWireTouchBlock(echo, count)) {
+            return false;
+        }
+
+        // We should receive what we sent.
+        if (memcmp(echo, data + offset, count) != 0) {
+            return false;
+        }
+
+        offset += count;
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Reads a block of data from the OneWire bus.
+/// </summary>
+/// <param name="buffer">Receives the data.</param>
+/// <param name="length">The number of bytes to read.</param>
+/// <returns>true if data was successfully read from the bus, otherwise false.</returns>
+bool OneWireReadBlock(uint8_t *buffer, size_t length)
+{
+    // Sending all 1 bits generates a read slot for every bit.
+    memset(buffer, 0xFF, length);
+    return OneWireTouchBlock(buffer, length);
+}
+
+/// <summary>
+/// Sends a block of data on the OneWire bus and replaces it with the data sampled on the bus.
+/// Bytes that should be read must be set to 0xFF (which creates read slots), so a single block
+/// can contain a command followed by the response (e.g. 0xBE followed by nine 0xFF bytes).
+/// </summary>
+/// <param name="buffer">The data to send, which is replaced with the data received.</param>
+/// <param name="length">The number of bytes to send and receive.</param>
+/// <returns>true if the block was transferred, otherwise false.</returns>
+bool OneWireTouchBlock(uint8_t *buffer, size_t length)
+{
+    struct timespec start;
+    OneWireStatsStart(&start);
+    bool status = OneWireTransportTouchBits(buffer, buffer, length * 8, false);
+    OneWireStatsRecord(OneWireStatsOperation_TouchBlock, &start, status);
+    return status;
+}
+
+/// <summary>
+/// Sends a sequence of time slots on the OneWire bus and replaces each bit with the value sampled
+/// during its slot, like <see src="OneWireTouchBlock"/> but for any number of bits (least
+/// significant bit of bits[0] first.)  A 1 bit creates a read slot.
+/// </summary>
+/// <param name="bits">The bits to send, which are replaced with the bits received.</param>
+/// <param name="bitCount">The number of time slots.</param>
+/// <returns>true if the slots were transferred, otherwise false.</returns>
+bool OneWireTouchBits(uint8_t *bits, size_t bitCount)
+{
+    struct timespec start;
+    OneWireStatsStart(&start);
+    bool status = OneWireTransportTouchBits(bits, bits, bitCount, false);
+    OneWireStatsRecord(OneWireStatsOperation_TouchBlock, &start, status);
+    return status;
+}
+
 /// <summary>
 /// Addresses the device with the current OneWireROM identifier.  The next command
 /// will only be performed by the device with the matched ROM.
@@ -154,13 +469,111 @@ int OneWireReceiveByte(void)
 /// <returns>true if the device was addressed, otherwise false.</returns>
 bool OneWireMatchROM(void)
 {
-    OneWireReset();
-    OneWireSendByte(0x55);
-    for (int i = 0; i < 8; i++) {
-        OneWireSendByte(OneWireROMGetByte(i));
+    return OneWireMatchRomId(OneWireROMGet());
+}
+
+/// <summary>
+/// Addresses the device with the specified ROM identifier.  The next command will only be
+/// performed by the device with the matched ROM.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>true if the device was addressed, otherwise false.</returns>
+bool OneWireMatchRomId(OneWireRomId rom)
+{
+    uint8_t frame[9];
+    frame[0] = 0x55;
+    OneWireRomIdToBytes(rom, &frame[1]);
+
+    if (OneWireReset() != DevicePresent) {
+        return false;
     }
 
-    return true;
+    return OneWireWriteBlock(frame, sizeof(frame));
+}
+
+/// <summary>
+/// Addresses the device with the ROM identifier using Overdrive Match ROM (0x69), which puts the
+/// device in overdrive: the ROM identifier and the rest of the transaction are sent at overdrive
+/// speed.  The next <see src="OneWireReset"/> returns the bus (and the device) to standard speed.
+/// Only some devices support overdrive (see <see src="OneWireProbeOverdrive"/>).
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>true if the command was successfully sent, otherwise false.</returns>
+bool OneWireOverdriveMatchRomId(OneWireRomId rom)
+{
+    uint8_t frame[8];
+    OneWireRomIdToBytes(rom, frame);
+
+    // The command is sent at standard speed; the device switches to overdrive after it.
+    if (OneWireReset() != DevicePresent || !OneWireSendByte(0x69) || !OneWireSetOverdrive(true)) {
+        return false;
+    }
+
+    return OneWireWriteBlock(frame, sizeof(frame));
+}
+
+/// <summary>
+/// Addresses all devices on the OneWire bus using Overdrive Skip ROM (0x3C).  The devices that
+/// support overdrive switch to overdrive speed, and the rest of the transaction is sent at
+/// overdrive speed; the devices that do not support overdrive ignore it.  The next
+/// <see src="OneWireReset"/> returns the bus (and the devices) to standard speed.
+/// </summary>
+/// <returns>true if the command was successfully sent, otherwise false.</returns>
+bool OneWireOverdriveSkipROM(void)
+{
+    return OneWireReset() == DevicePresent && OneWireSendByte(0x3C) && OneWireSetOverdrive(true);
+}
+
+/// <summary>
+/// Checks whether the device with the ROM identifier supports overdrive: the device is addressed
+/// with Overdrive Match ROM and must respond to a reset pulse at overdrive speed.  The bus is left
+/// at overdrive speed until the next <see src="OneWireReset"/>.  The bus is not used if it can not
+/// be used at overdrive speed (see <see src="OneWireCanUseOverdrive"/>), and failures during the
+/// check are not recorded in the health of the bus (see onewirehealth.h.)
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>true if the device supports overdrive, otherwise false.</returns>
+bool OneWireProbeOverdrive(OneWireRomId rom)
+{
+    if (!OneWireCanUseOverdrive()) {
+        return false;
+    }
+
+    // Devices at standard speed do not see the short overdrive reset pulse as a reset, so only a
+    // device that switched to overdrive sends a presence pulse.  The time slots at overdrive speed
+    // also fail on a bus that is too slow for overdrive, which must not take the bus offline.
+    oneWireProbing = true;
+    bool supported = OneWireOverdriveMatchRomId(rom) && OneWireResetPulse(false) == DevicePresent;
+    oneWireProbing = false;
+    return supported;
+}
+
+/// <summary>
+/// Returns true if the selected bus can be used at overdrive speed.  The transport may not support
+/// overdrive, or only on some buses (e.g. the UART transport keeps a bus with a reset UART at
+/// standard speed.)
+/// </summary>
+/// <returns>true if the bus can be used at overdrive speed, otherwise false.</returns>
+bool OneWireCanUseOverdrive(void)
+{
+    // The transport only changes the speed with the next time slot or reset pulse, so this does
+    // not use the bus.
+    return OneWireSetOverdrive(true) && OneWireSetOverdrive(false);
+}
+
+/// <summary>
+/// Switches the time slots and reset pulses of the transport to overdrive or standard speed.
+/// </summary>
+/// <param name="overdrive">true for overdrive speed, false for standard speed.</param>
+/// <returns>true if the speed was set, otherwise false (e.g. the transport does not support
+/// overdrive.)</returns>
+static bool OneWireSetOverdrive(bool overdrive)
+{
+    if (oneWireTransport->setOverdrive == NULL) {
+        return !overdrive;
+    }
+
+    return oneWireTransport->setOverdrive(overdrive);
 }
 
 /// <summary>
@@ -169,9 +582,7 @@ bool OneWireMatchROM(void)
 /// <returns>true if the command was successfully sent, otherwise false.</returns>
 bool OneWireSkipROM(void) 
 {
-    OneWireReset();
-    OneWireSendByte(0xCC);
-    return true;
+    return OneWireReset() == DevicePresent && OneWireSendByte(0xCC);
 }
 
 /// <summary>
@@ -181,30 +592,44 @@ bool OneWireSkipROM(void)
 /// <returns>true if the OneWire device was found, otherwise false.</returns>
 bool OneWireSingleReadROM(void)
 {
-    OneWireReset();
-    OneWireSendByte(0x33);
+    OneWireRomId rom;
+    if (!OneWireSingleReadRomId(&rom)) {
+        return false;
+    }
 
-    uint8_t rom[8];
-    ClearCrc8();
-    for (int i = 0; i < 8; i++) {
-        int b = OneWireReceiveByte();
-        if (b == -1) {
-            Log_Debug("ERROR: Failed reading OneWireROM[%d].\n", i);
-            return false;
-        }
-        DoCrc8((uint8_t)b);
-        rom[i] = (uint8_t)b;
+    OneWireROMSet(rom);
+    return true;
+}
+
+/// <summary>
+/// Reads the ROM identifer of the device on the OneWire bus.  This command can only be used when
+/// there is a single device on the bus.
+/// </summary>
+/// <param name="rom">Receives the ROM identifier of the device.</param>
+/// <returns>true if the OneWire device was found, otherwise false.</returns>
+bool OneWireSingleReadRomId(OneWireRomId *rom)
+{
+    if (OneWireReset() != DevicePresent) {
+        return false;
     }
 
-    if (GetCrc8() != 0) {
-        Log_Debug(
-            "ERROR: CRC did not match expected value. Ensure only one device is connected.\n");
+    // Send the Read ROM command followed by read slots for the 8 bytes of the ROM.
+    uint8_t frame[9];
+    memset(frame, 0xFF, sizeof(frame));
+    frame[0] = 0x33;
+    if (!OneWireTouchBlock(frame, sizeof(frame)) || frame[0] != 0x33) {
+        Log_Debug("ERROR: Failed reading OneWireROM.\n");
         return false;
     }
 
-    for (int i = 0; i < 8; i++) {
-        OneWireROMSetByte(i, rom[i]);
+    // The last byte of the ROM is the CRC of the first 7 bytes.
+    if (Crc8Compute(&frame[1], 8, 0) != 0) {
+        OneWireStatsAddCrcFailure();
+        Log_Debug(
+            "ERROR: CRC did not match expected value. Ensure only one device is connected.\n");
+        return false;
     }
 
+    *rom = OneWireRomIdFromBytes(&frame[1]);
     return true;
 }
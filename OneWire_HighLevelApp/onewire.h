@@ -4,14 +4,29 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "onewirerom.h"
+
 #include "applibs_versions.h"
 #include <applibs/gpio.h>
 #include <applibs/uart.h>
 
 /// <summary>
-/// Initialize the UART and GPIO ports and resets the ROM search.
+/// The maximum number of OneWire buses.
+/// </summary>
+#define ONEWIRE_MAX_BUSES 4
+
+/// <summary>
+/// Pass as the resetUart of <see src="OneWireAddBusWithResetUart"/> when the bus does not have
+/// a separate UART for reset pulses.
+/// </summary>
+#define ONEWIRE_NO_RESET_UART (-1)
+
+/// <summary>
+/// Initialize the UART and GPIO ports and resets the ROM search.  The bus is selected for all
+/// of the OneWire operations.
 /// </summary>
 /// <param name="uart">The UART port to use for communication.</param>
 /// <param name="gpio">The GPIO port to use for pullup.</param>
@@ -19,7 +34,46 @@
 bool OneWireInit(UART_Id uart, GPIO_Id gpio);
 
 /// <summary>
-/// Close the UART and GPIO ports.
+/// Initialize the UART and GPIO ports for an additional OneWire bus.  All of the OneWire
+/// operations use the bus chosen with <see src="OneWireSelectBus"/>.
+/// </summary>
+/// <param name="uart">The UART port to use for communication.</param>
+/// <param name="gpio">The GPIO port to use for pullup.</param>
+/// <returns>The bus number, or -1 if the initialization failed.</returns>
+int OneWireAddBus(UART_Id uart, GPIO_Id gpio);
+
+/// <summary>
+/// Initialize the UART and GPIO ports for an additional OneWire bus that sends its reset pulses
+/// on a second UART, so neither UART has to be reopened to change its baud rate.  See
+/// <see src="OneWireUartAddBusWithResetUart"/> for how the reset UART must be connected.
+/// </summary>
+/// <param name="uart">The UART port to use for communication.</param>
+/// <param name="resetUart">The UART port to use for reset pulses, or ONEWIRE_NO_RESET_UART.</param>
+/// <param name="gpio">The GPIO port to use for pullup.</param>
+/// <returns>The bus number, or -1 if the initialization failed.</returns>
+int OneWireAddBusWithResetUart(UART_Id uart, UART_Id resetUart, GPIO_Id gpio);
+
+/// <summary>
+/// Selects the bus used by all of the OneWire operations.
+/// </summary>
+/// <param name="bus">The bus number returned by <see src="OneWireAddBus"/>.</param>
+/// <returns>true if the bus was selected, otherwise false.</returns>
+bool OneWireSelectBus(int bus);
+
+/// <summary>
+/// Returns the bus used by the OneWire operations.
+/// </summary>
+/// <returns>The bus number, or -1 if no bus was selected.</returns>
+int OneWireGetSelectedBus(void);
+
+/// <summary>
+/// Returns the number of OneWire buses that have been initialized.
+/// </summary>
+/// <returns>The number of buses.</returns>
+int OneWireGetBusCount(void);
+
+/// <summary>
+/// Close the UART and GPIO ports of every bus.
 /// </summary>
 void OneWireClose(void);
 
@@ -28,16 +82,73 @@ typedef enum {
     NoDevices = 1,
     NoData = 2,
     HardwareFailure = 3,
+    BusShorted = 4,
 } OneWireResetResponse;
 
 /// <summary>
 /// Sends a Reset pulse.  After sending a reset you should send a ROM command
-/// (e.g. Search, Read, Match, Skip, Alarm, Verify)
+/// (e.g. Search, Read, Match, Skip, Alarm, Verify)  The reset pulse is always at standard speed,
+/// which also returns any devices in overdrive to standard speed.  While the bus has failed (see
+/// onewirehealth.h) this returns NoData without using the bus, except for a reset pulse every
+/// backoff period to probe the bus.
 /// </summary>
 /// <returns>DevicePresent if reset was successful and at least one device
 /// replied, otherwise an error value from the OneWireResetResponse enum.</returns>
 OneWireResetResponse OneWireReset(void);
 
+/// <summary>
+/// Returns the shape of the presence pulses received by the last reset pulse at standard speed on
+/// the selected bus (the UART transport returns the byte received during the reset pulse.)  The
+/// devices on a bus release it at different times, so a change means a device may have been
+/// added or removed.
+/// </summary>
+/// <returns>The shape, or -1 if the transport cannot sample it or there has not been a presence
+/// pulse.</returns>
+int OneWireGetPresence(void);
+
+/// <summary>
+/// The functions that generate the signals on a OneWire bus.  All of the OneWire operations
+/// (including the ROM search and the device commands) are built on these functions.
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// Sends a reset pulse and checks for presence pulses (see <see src="OneWireReset"/>).
+    /// </summary>
+    OneWireResetResponse (*reset)(void);
+
+    /// <summary>
+    /// Sends a sequence of time slots and samples the bus during each slot (see
+    /// <see src="OneWireUartTouchBits"/>).  receiveBits can be NULL.
+    /// </summary>
+    bool (*touchBits)(const uint8_t *sendBits, uint8_t *receiveBits, size_t bitCount,
+                      bool enableStrongPullup);
+
+    /// <summary>
+    /// Disables the strong pullup (see <see src="OneWireDisableStrongPullup"/>).
+    /// </summary>
+    void (*disableStrongPullup)(void);
+
+    /// <summary>
+    /// Switches the time slots and reset pulses between standard and overdrive speed (see
+    /// <see src="OneWireUartSetOverdrive"/>).  NULL if the transport only has standard speed.
+    /// </summary>
+    bool (*setOverdrive)(bool overdrive);
+
+    /// <summary>
+    /// Returns the shape of the presence pulses of the last reset pulse (see
+    /// <see src="OneWireGetPresence"/>).  NULL if the transport cannot sample it.
+    /// </summary>
+    int (*getPresence)(void);
+} OneWireTransport;
+
+/// <summary>
+/// Sets the transport used by all of the OneWire operations.  By default the UART and GPIO of
+/// the selected bus are used; a simulated bus (see onewiresim.h) can be used instead to run the
+/// OneWire code without hardware.  The health of every bus is reset.
+/// </summary>
+/// <param name="transport">The transport to use, or NULL to use the UART transport.</param>
+void OneWireSetTransport(const OneWireTransport *transport);
+
 /// <summary>
 /// Sents a bit of data on the OneWire bus.  Optionally enables the pullup for
 /// parasitic charging when complete.
@@ -80,6 +191,43 @@ bool OneWireSendByteWithPullup(uint8_t data);
 /// <returns>-1 if there was an error, otherwise the byte value is returned.</returns>
 int OneWireReceiveByte(void);
 
+/// <summary>
+/// Sends a block of data on the OneWire bus.  The whole block is sent using batched UART
+/// transfers rather than one transfer per byte.
+/// </summary>
+/// <param name="data">The data to send.</param>
+/// <param name="length">The number of bytes to send.</param>
+/// <returns>true if data was successfully sent on the bus, otherwise false.</returns>
+bool OneWireWriteBlock(const uint8_t *data, size_t length);
+
+/// <summary>
+/// Reads a block of data from the OneWire bus.
+/// </summary>
+/// <param name="buffer">Receives the data.</param>
+/// <param name="length">The number of bytes to read.</param>
+/// <returns>true if data was successfully read from the bus, otherwise false.</returns>
+bool OneWireReadBlock(uint8_t *buffer, size_t length);
+
+/// <summary>
+/// Sends a block of data on the OneWire bus and replaces it with the data sampled on the bus.
+/// Bytes that should be read must be set to 0xFF (which creates read slots), so a single block
+/// can contain a command followed by the response (e.g. 0xBE followed by nine 0xFF bytes).
+/// </summary>
+/// <param name="buffer">The data to send, which is replaced with the data received.</param>
+/// <param name="length">The number of bytes to send and receive.</param>
+/// <returns>true if the block was transferred, otherwise false.</returns>
+bool OneWireTouchBlock(uint8_t *buffer, size_t length);
+
+/// <summary>
+/// Sends a sequence of time slots on the OneWire bus and replaces each bit with the value sampled
+/// during its slot, like <see src="OneWireTouchBlock"/> but for any number of bits (least
+/// significant bit of bits[0] first.)  A 1 bit creates a read slot.
+/// </summary>
+/// <param name="bits">The bits to send, which are replaced with the bits received.</param>
+/// <param name="bitCount">The number of time slots.</param>
+/// <returns>true if the slots were transferred, otherwise false.</returns>
+bool OneWireTouchBits(uint8_t *bits, size_t bitCount);
+
 /// <summary>
 /// Addresses the device with the current OneWireROM identifier.  The next command
 /// will only be performed by the device with the matched ROM.
@@ -87,6 +235,52 @@ int OneWireReceiveByte(void);
 /// <returns>true if the device was addressed, otherwise false.</returns>
 bool OneWireMatchROM(void);
 
+/// <summary>
+/// Addresses the device with the specified ROM identifier.  The next command will only be
+/// performed by the device with the matched ROM.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>true if the device was addressed, otherwise false.</returns>
+bool OneWireMatchRomId(OneWireRomId rom);
+
+/// <summary>
+/// Addresses the device with the ROM identifier using Overdrive Match ROM (0x69), which puts the
+/// device in overdrive: the ROM identifier and the rest of the transaction are sent at overdrive
+/// speed.  The next <see src="OneWireReset"/> returns the bus (and the device) to standard speed.
+/// Only some devices support overdrive (see <see src="OneWireProbeOverdrive"/>).
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>true if the command was successfully sent, otherwise false.</returns>
+bool OneWireOverdriveMatchRomId(OneWireRomId rom);
+
+/// <summary>
+/// Addresses all devices on the OneWire bus using Overdrive Skip ROM (0x3C).  The devices that
+/// support overdrive switch to overdrive speed, and the rest of the transaction is sent at
+/// overdrive speed; the devices that do not support overdrive ignore it.  The next
+/// <see src="OneWireReset"/> returns the bus (and the devices) to standard speed.
+/// </summary>
+/// <returns>true if the command was successfully sent, otherwise false.</returns>
+bool OneWireOverdriveSkipROM(void);
+
+/// <summary>
+/// Checks whether the device with the ROM identifier supports overdrive: the device is addressed
+/// with Overdrive Match ROM and must respond to a reset pulse at overdrive speed.  The bus is left
+/// at overdrive speed until the next <see src="OneWireReset"/>.  The bus is not used if it can not
+/// be used at overdrive speed (see <see src="OneWireCanUseOverdrive"/>), and failures during the
+/// check are not recorded in the health of the bus (see onewirehealth.h.)
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>true if the device supports overdrive, otherwise false.</returns>
+bool OneWireProbeOverdrive(OneWireRomId rom);
+
+/// <summary>
+/// Returns true if the selected bus can be used at overdrive speed.  The transport may not support
+/// overdrive, or only on some buses (e.g. the UART transport keeps a bus with a reset UART at
+/// standard speed.)
+/// </summary>
+/// <returns>true if the bus can be used at overdrive speed, otherwise false.</returns>
+bool OneWireCanUseOverdrive(void);
+
 /// <summary>
 /// Addresses all devices on the OneWire bus.
 /// </summary>
@@ -98,4 +292,12 @@ bool OneWireSkipROM(void);
 /// only be used when there is a single device on the bus.
 /// </summary>
 /// <returns>true if the OneWire device was found, otherwise false.</returns>
-bool OneWireSingleReadROM(void);
\ No newline at end of file
+bool OneWireSingleReadROM(void);
+
+/// <summary>
+/// Reads the ROM identifer of the device on the OneWire bus.  This command can only be used when
+/// there is a single device on the bus.
+/// </summary>
+/// <param name="rom">Receives the ROM identifier of the device.</param>
+/// <returns>true if the OneWire device was found, otherwise false.</returns>
+bool OneWireSingleReadRomId(OneWireRomId *rom);
@@ -0,0 +1,320 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+//
+// The DS18S20 and DS1822 values are based on the following data sheets
+// https://datasheets.maximintegrated.com/en/ds/DS18S20.pdf
+// https://datasheets.maximintegrated.com/en/ds/DS1822.pdf
+//
+
+#include "onewiredriver.h"
+#include "ds18b20.h"
+#include "ds2438.h"
+#include "onewire.h"
+#include "onewirelog.h"
+
+#include <stddef.h>
+#include <string.h>
+
+_Static_assert(DS2438_PAGE_SIZE == DS18B20_SCRATCHPAD_SIZE,
+               "The DS2438 page must fit in a Ds18b20Scratchpad");
+
+/// <summary>
+/// The DS18S20 COUNT_PER_C register, which is always 16.
+/// </summary>
+#define DS18S20_COUNT_PER_C 16
+
+/// <summary>
+/// The temperature register (85C in 1/2 degrees) and COUNT_REMAIN register of a DS18S20 that has
+/// not completed a conversion since it was powered on.  A conversion that reads exactly 85C gives
+/// the same registers, so that reading is treated as a failure.
+/// </summary>
+#define DS18S20_POWER_ON_TEMPERATURE 0x00AA
+#define DS18S20_POWER_ON_COUNT_REMAIN 0x0C
+
+static bool OneWireDriverReadDs18b20Scratchpad(Ds18b20Scratchpad *scratchpad);
+static int OneWireDriverGetDs18s20ConversionTimeMilli(ThermometerResolution resolution);
+static ThermometerResolution OneWireDriverGetDs18s20Resolution(const Ds18b20Scratchpad *scratchpad);
+static bool OneWireDriverDecodeDs18s20Scratchpad(const Ds18b20Scratchpad *scratchpad, int16_t *raw);
+static bool OneWireDriverWriteDs18s20Alarms(int8_t tHigh, int8_t tLow,
+                                            ThermometerResolution resolution);
+static int OneWireDriverGetDs2438ConversionTimeMilli(ThermometerResolution resolution);
+static bool OneWireDriverReadDs2438Scratchpad(Ds18b20Scratchpad *scratchpad);
+static ThermometerResolution OneWireDriverGetDs2438Resolution(const Ds18b20Scratchpad *scratchpad);
+static bool OneWireDriverDecodeDs2438Scratchpad(const Ds18b20Scratchpad *scratchpad, int16_t *raw);
+
+/// <summary>
+/// The supported device families.
+/// </summary>
+static const OneWireDriver oneWireDrivers[] = {
+    {
+        // The DS18B20 programmable resolution thermometer.
+        .familyId = 0x28,
+        .name = "DS18B20",
+        .ds18b20Compatible = true,
+        .getConversionTimeMilli = Ds18b20GetConversionTimeMilli,
+        .readPowerSupplyVcc = Ds18b20ReadPowerSupplyVCC,
+        .recallScratchpad = NULL,
+        .readScratchpad = OneWireDriverReadDs18b20Scratchpad,
+        .getResolution = Ds18b20GetResolution,
+        .decodeScratchpad = Ds18b20DecodeScratchpad,
+        .writeAlarmThresholds = Ds18b20WriteScratchpad,
+    },
+    {
+        // The DS1822 is a DS18B20 with a lower accuracy, and has the same commands and registers.
+        .familyId = 0x22,
+        .name = "DS1822",
+        .ds18b20Compatible = true,
+        .getConversionTimeMilli = Ds18b20GetConversionTimeMilli,
+        .readPowerSupplyVcc = Ds18b20ReadPowerSupplyVCC,
+        .recallScratchpad = NULL,
+        .readScratchpad = OneWireDriverReadDs18b20Scratchpad,
+        .getResolution = Ds18b20GetResolution,
+        .decodeScratchpad = Ds18b20DecodeScratchpad,
+        .writeAlarmThresholds = Ds18b20WriteScratchpad,
+    },
+    {
+        // The DS18S20 has a fixed 9 bit resolution, which the count remaining register extends.
+        .familyId = 0x10,
+        .name = "DS18S20",
+        .ds18b20Compatible = false,
+        .getConversionTimeMilli = OneWireDriverGetDs18s20ConversionTimeMilli,
+        .readPowerSupplyVcc = Ds18b20ReadPowerSupplyVCC,
+        .recallScratchpad = NULL,
+        .readScratchpad = OneWireDriverReadDs18b20Scratchpad,
+        .getResolution = OneWireDriverGetDs18s20Resolution,
+        .decodeScratchpad = OneWireDriverDecodeDs18s20Scratchpad,
+        .writeAlarmThresholds = OneWireDriverWriteDs18s20Alarms,
+    },
+    {
+        // The DS2438 battery monitor; only its temperature is read.  It needs VCC for its
+        // converters, and has no temperature alarm.
+        .familyId = 0x26,
+        .name = "DS2438",
+        .ds18b20Compatible = false,
+        .getConversionTimeMilli = OneWireDriverGetDs2438ConversionTimeMilli,
+        .readPowerSupplyVcc = NULL,
+        .recallScratchpad = Ds2438RecallPage0,
+        .readScratchpad = OneWireDriverReadDs2438Scratchpad,
+        .getResolution = OneWireDriverGetDs2438Resolution,
+        .decodeScratchpad = OneWireDriverDecodeDs2438Scratchpad,
+        .writeAlarmThresholds = NULL,
+    },
+};
+
+_Static_assert(sizeof(oneWireDrivers) / sizeof(oneWireDrivers[0]) <= ONEWIRE_DRIVER_MAX_FAMILIES,
+               "Increase ONEWIRE_DRIVER_MAX_FAMILIES");
+
+/// <summary>
+/// Returns the driver of a device family.
+/// </summary>
+/// <param name="familyId">The family identifier.</param>
+/// <returns>The driver, or NULL if the family is not supported.</returns>
+const OneWireDriver *OneWireDriverFind(uint8_t familyId)
+{
+    for (size_t i = 0; i < sizeof(oneWireDrivers) / sizeof(oneWireDrivers[0]); i++) {
+        if (oneWireDrivers[i].familyId == familyId) {
+            return &oneWireDrivers[i];
+        }
+    }
+
+    return NULL;
+}
+
+/// <summary>
+/// Returns the driver of a device.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>The driver, or NULL if the family of the device is not supported.</returns>
+const OneWireDriver *OneWireDriverFindForRom(OneWireRomId rom)
+{
+    return OneWireDriverFind(OneWireRomIdGetFamily(rom));
+}
+
+/// <summary>
+/// Gets the family identifiers of every driver, e.g. to keep only the supported devices in the
+/// inventory.
+/// </summary>
+/// <param name="familyIds">Receives the family identifiers.</param>
+/// <param name="maxCount">The size of familyIds.</param>
+/// <returns>The number of family identifiers.</returns>
+int OneWireDriverGetFamilyIds(uint8_t *familyIds, int maxCount)
+{
+    int count = 0;
+    for (size_t i = 0; i < sizeof(oneWireDrivers) / sizeof(oneWireDrivers[0]) && count < maxCount;
+         i++) {
+        familyIds[count++] = oneWireDrivers[i].familyId;
+    }
+
+    return count;
+}
+
+/// <summary>
+/// Returns true if the scratchpad has the alarm thresholds, or the device has no temperature
+/// alarm.
+/// </summary>
+/// <param name="driver">The driver of the device.</param>
+/// <param name="scratchpad">The scratchpad read from the device.</param>
+/// <param name="tHigh">The high temperature in celsius.</param>
+/// <param name="tLow">The low temperature in celsius.</param>
+/// <returns>true if the thresholds do not need to be written, otherwise false.</returns>
+bool OneWireDriverHasAlarmThresholds(const OneWireDriver *driver,
+                                     const Ds18b20Scratchpad *scratchpad, int8_t tHigh,
+                                     int8_t tLow)
+{
+    // Every family with a temperature alarm has the thresholds in bytes 2 and 3.
+    return driver->writeAlarmThresholds == NULL ||
+           ((int8_t)scratchpad->bytes[2] == tHigh && (int8_t)scratchpad->bytes[3] == tLow);
+}
+
+/// <summary>
+/// Decodes the temperature of each scratchpad with the driver of its device, and classifies it
+/// against the thresholds, like <see src="Ds18b20DecodeScratchpads"/>.  The scratchpads must
+/// already have passed their CRC check.
+/// </summary>
+/// <param name="roms">The ROM identifier of the device each scratchpad was read from.</param>
+/// <param name="scratchpads">The scratchpads.</param>
+/// <param name="count">The number of scratchpads.</param>
+/// <param name="thresholds">The thresholds.</param>
+/// <param name="raw">Receives the temperature of each scratchpad in 1/16 degrees celsius.</param>
+/// <param name="classes">Receives the class of each temperature.</param>
+/// <returns>The number of temperatures that are not TemperatureClass_Invalid.</returns>
+int OneWireDriverDecodeScratchpads(const OneWireRomId *roms, const Ds18b20Scratchpad *scratchpads,
+                                   int count, const Ds18b20Thresholds *thresholds, int16_t *raw,
+                                   TemperatureClass *classes)
+{
+    int validCount = 0;
+    for (int i = 0; i < count; i++) {
+        const OneWireDriver *driver = OneWireDriverFindForRom(roms[i]);
+        if (driver == NULL || !driver->decodeScratchpad(&scratchpads[i], &raw[i])) {
+            raw[i] = 0;
+            classes[i] = TemperatureClass_Invalid;
+            continue;
+        }
+
+        classes[i] = Ds18b20ClassifyTemperature(raw[i], thresholds);
+        validCount++;
+    }
+
+    return validCount;
+}
+
+/// <summary>
+/// Reads the scratchpad of a DS18B20, DS1822 or DS18S20 (they have the same Read Scratchpad
+/// command and CRC.)
+/// </summary>
+/// <param name="scratchpad">Receives the scratchpad.</param>
+/// <returns>true if the scratchpad was read and passed its CRC check, otherwise false.</returns>
+static bool OneWireDriverReadDs18b20Scratchpad(Ds18b20Scratchpad *scratchpad)
+{
+    bool status = Ds18b20ReadScratchpad();
+    Ds18b20GetScratchpad(scratchpad);
+    return status;
+}
+
+/// <summary>
+/// Returns the maximum time a DS18S20 temperature conversion takes.
+/// </summary>
+/// <param name="resolution">Ignored; the DS18S20 always converts in the same time.</param>
+/// <returns>The conversion time in milliseconds.</returns>
+static int OneWireDriverGetDs18s20ConversionTimeMilli(ThermometerResolution resolution)
+{
+    return 750;
+}
+
+/// <summary>
+/// Returns the resolution of a DS18S20 scratchpad.  The count remaining register gives the
+/// temperature to 1/16 degrees, the same as a DS18B20 at 12 bits.
+/// </summary>
+/// <param name="scratchpad">The scratchpad.</param>
+/// <returns>ThermometerResolution12bits.</returns>
+static ThermometerResolution OneWireDriverGetDs18s20Resolution(const Ds18b20Scratchpad *scratchpad)
+{
+    return ThermometerResolution12bits;
+}
+
+/// <summary>
+/// Decodes the temperature of a DS18S20 scratchpad, using the count remaining register for the
+/// bits below 1/2 degree (see "Operation - Measuring Temperature" in DS18S20.pdf.)
+/// </summary>
+/// <param name="scratchpad">The scratchpad.</param>
+/// <param name="raw">Receives the temperature in 1/16 degrees celsius.</param>
+/// <returns>true if the temperature is within the -55C to 125C range of the device (and is not
+/// the power on value), otherwise false.</returns>
+static bool OneWireDriverDecodeDs18s20Scratchpad(const Ds18b20Scratchpad *scratchpad, int16_t *raw)
+{
+    // 0 - Temp LSB (1/2 degrees), 1 - Temp MSB (sign), 6 - COUNT_REMAIN, 7 - COUNT_PER_C.
+    const uint8_t *bytes = scratchpad->bytes;
+    int16_t halfDegrees = (int16_t)((bytes[1] << 8) | bytes[0]);
+    bool powerOn = halfDegrees == DS18S20_POWER_ON_TEMPERATURE &&
+                   bytes[6] == DS18S20_POWER_ON_COUNT_REMAIN;
+    if ((bytes[1] != 0x00 && bytes[1] != 0xFF) || halfDegrees < -55 * 2 || halfDegrees > 125 * 2 ||
+        powerOn || bytes[7] != DS18S20_COUNT_PER_C || bytes[6] > DS18S20_COUNT_PER_C) {
+        ONEWIRE_LOG_DEFER_WARN("WARN: Implausible temperature 0x%04x read.\n",
+                               (bytes[1] << 8) | bytes[0]);
+        return false;
+    }
+
+    // T = TEMP_READ - 0.25 + (COUNT_PER_C - COUNT_REMAIN) / COUNT_PER_C, where TEMP_READ is the
+    // temperature with the 1/2 degree bit dropped; COUNT_PER_C is 16, so this is exact in 1/16
+    // degrees.
+    *raw = (int16_t)((halfDegrees & ~1) * 8 - 4 + DS18S20_COUNT_PER_C - bytes[6]);
+    return true;
+}
+
+/// <summary>
+/// Writes the alarm thresholds to a DS18S20 scratchpad.  The DS18S20 has no configuration
+/// register, so only the 2 threshold bytes are written.
+/// </summary>
+/// <param name="tHigh">The high temperature in celsius.</param>
+/// <param name="tLow">The low temperature in celsius.</param>
+/// <param name="resolution">Ignored; the DS18S20 has a fixed resolution.</param>
+/// <returns>true if no error was detected, otherwise false.</returns>
+static bool OneWireDriverWriteDs18s20Alarms(int8_t tHigh, int8_t tLow,
+                                            ThermometerResolution resolution)
+{
+    uint8_t frame[3] = {0x4E, (uint8_t)tHigh, (uint8_t)tLow};
+    return OneWireWriteBlock(frame, sizeof(frame));
+}
+
+/// <summary>
+/// Returns the maximum time a DS2438 temperature conversion takes.
+/// </summary>
+/// <param name="resolution">Ignored; the DS2438 always converts in the same time.</param>
+/// <returns>The conversion time in milliseconds.</returns>
+static int OneWireDriverGetDs2438ConversionTimeMilli(ThermometerResolution resolution)
+{
+    return DS2438_CONVERSION_TIME_MILLI;
+}
+
+/// <summary>
+/// Reads page 0 of a DS2438 (after <see src="Ds2438RecallPage0"/>) into the scratchpad.
+/// </summary>
+/// <param name="scratchpad">Receives the page.</param>
+/// <returns>true if the page was read and passed its CRC check, otherwise false.</returns>
+static bool OneWireDriverReadDs2438Scratchpad(Ds18b20Scratchpad *scratchpad)
+{
+    return Ds2438ReadPage0(scratchpad->bytes);
+}
+
+/// <summary>
+/// Returns the resolution of a DS2438 page.  The temperature is decoded to 1/16 degrees, the same
+/// as a DS18B20 at 12 bits.
+/// </summary>
+/// <param name="scratchpad">The page.</param>
+/// <returns>ThermometerResolution12bits.</returns>
+static ThermometerResolution OneWireDriverGetDs2438Resolution(const Ds18b20Scratchpad *scratchpad)
+{
+    return ThermometerResolution12bits;
+}
+
+/// <summary>
+/// Decodes the temperature of a DS2438 page (see <see src="Ds2438DecodeTemperature"/>.)
+/// </summary>
+/// <param name="scratchpad">The page.</param>
+/// <param name="raw">Receives the temperature in 1/16 degrees celsius.</param>
+/// <returns>true if the temperature is plausible, otherwise false.</returns>
+static bool OneWireDriverDecodeDs2438Scratchpad(const Ds18b20Scratchpad *scratchpad, int16_t *raw)
+{
+    return Ds2438DecodeTemperature(scratchpad->bytes, raw);
+}
@@ -0,0 +1,135 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ds18b20.h"
+#include "onewirerom.h"
+
+// The drivers of the temperature device families that can share a bus.  Every family starts a
+// temperature conversion with Convert T (0x44), so a single Skip ROM and Convert T converts every
+// device on the bus, whatever its family; only the conversion time, and the commands to read and
+// decode the result, depend on the family.  Each family's result is read into a
+// Ds18b20Scratchpad (every family's result is 8 bytes and a CRC.)
+
+/// <summary>
+/// The maximum number of device families in the registry.
+/// </summary>
+#define ONEWIRE_DRIVER_MAX_FAMILIES 8
+
+/// <summary>
+/// The operations of a device family.  The device must be selected before each operation.
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// The family identifier (first 8 bits of the ROM ID).
+    /// </summary>
+    uint8_t familyId;
+
+    /// <summary>
+    /// The name of the device, for log messages.
+    /// </summary>
+    const char *name;
+
+    /// <summary>
+    /// true if the scratchpad has the DS18B20 temperature and configuration registers, so the
+    /// device can be read with Ds18b20ReadTemperatures and configured with Ds18b20Provision.
+    /// </summary>
+    bool ds18b20Compatible;
+
+    /// <summary>
+    /// Returns the maximum time a temperature conversion takes at the resolution, in
+    /// milliseconds.
+    /// </summary>
+    int (*getConversionTimeMilli)(ThermometerResolution resolution);
+
+    /// <summary>
+    /// Returns true if the device is VCC powered (see <see src="Ds18b20ReadPowerSupplyVCC"/>).
+    /// NULL if the device is always VCC powered.
+    /// </summary>
+    bool (*readPowerSupplyVcc)(void);
+
+    /// <summary>
+    /// Prepares the result of the conversion to be read (e.g. copies it from memory to the
+    /// scratchpad); the device must be selected again before it is read.  NULL if the result can
+    /// be read straight away.
+    /// </summary>
+    bool (*recallScratchpad)(void);
+
+    /// <summary>
+    /// Reads the result of the conversion, and checks its CRC.
+    /// </summary>
+    bool (*readScratchpad)(Ds18b20Scratchpad *scratchpad);
+
+    /// <summary>
+    /// Returns the resolution of a scratchpad that was read.
+    /// </summary>
+    ThermometerResolution (*getResolution)(const Ds18b20Scratchpad *scratchpad);
+
+    /// <summary>
+    /// Decodes the temperature of a scratchpad that was read into 1/16 degrees celsius, and
+    /// returns false if it is not plausible.
+    /// </summary>
+    bool (*decodeScratchpad)(const Ds18b20Scratchpad *scratchpad, int16_t *raw);
+
+    /// <summary>
+    /// Writes the alarm thresholds (in celsius) to the scratchpad, keeping the resolution.  NULL
+    /// if the device has no temperature alarm (it is not found by an alarm search.)
+    /// </summary>
+    bool (*writeAlarmThresholds)(int8_t tHigh, int8_t tLow, ThermometerResolution resolution);
+} OneWireDriver;
+
+/// <summary>
+/// Returns the driver of a device family.
+/// </summary>
+/// <param name="familyId">The family identifier.</param>
+/// <returns>The driver, or NULL if the family is not supported.</returns>
+const OneWireDriver *OneWireDriverFind(uint8_t familyId);
+
+/// <summary>
+/// Returns the driver of a device.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>The driver, or NULL if the family of the device is not supported.</returns>
+const OneWireDriver *OneWireDriverFindForRom(OneWireRomId rom);
+
+/// <summary>
+/// Gets the family identifiers of every driver, e.g. to keep only the supported devices in the
+/// inventory.
+/// </summary>
+/// <param name="familyIds">Receives the family identifiers.</param>
+/// <param name="maxCount">The size of familyIds.</param>
+/// <returns>The number of family identifiers.</returns>
+int OneWireDriverGetFamilyIds(uint8_t *familyIds, int maxCount);
+
+/// <summary>
+/// Returns true if the scratchpad has the alarm thresholds, or the device has no temperature
+/// alarm.
+/// </summary>
+/// <param name="driver">The driver of the device.</param>
+/// <param name="scratchpad">The scratchpad read from the device.</param>
+/// <param name="tHigh">The high temperature in celsius.</param>
+/// <param name="tLow">The low temperature in celsius.</param>
+/// <returns>true if the thresholds do not need to be written, otherwise false.</returns>
+bool OneWireDriverHasAlarmThresholds(const OneWireDriver *driver,
+                                     const Ds18b20Scratchpad *scratchpad, int8_t tHigh,
+                                     int8_t tLow);
+
+/// <summary>
+/// Decodes the temperature of each scratchpad with the driver of its device, and classifies it
+/// against the thresholds, like <see src="Ds18b20DecodeScratchpads"/>.  The scratchpads must
+/// already have passed their CRC check.
+/// </summary>
+/// <param name="roms">The ROM identifier of the device each scratchpad was read from.</param>
+/// <param name="scratchpads">The scratchpads.</param>
+/// <param name="count">The number of scratchpads.</param>
+/// <param name="thresholds">The thresholds.</param>
+/// <param name="raw">Receives the temperature of each scratchpad in 1/16 degrees celsius.</param>
+/// <param name="classes">Receives the class of each temperature.</param>
+/// <returns>The number of temperatures that are not TemperatureClass_Invalid.</returns>
+int OneWireDriverDecodeScratchpads(const OneWireRomId *roms, const Ds18b20Scratchpad *scratchpads,
+                                   int count, const Ds18b20Thresholds *thresholds, int16_t *raw,
+                                   TemperatureClass *classes);
@@ -0,0 +1,199 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "onewirehealth.h"
+#include "onewirelog.h"
+#include "sleep.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+/// <summary>
+/// The circuit breaker of one OneWire bus.
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// true once the bus has failed, until a reset pulse gets a presence pulse.
+    /// </summary>
+    bool open;
+
+    /// <summary>
+    /// The number of resets in a row without a presence pulse.
+    /// </summary>
+    int noPresenceCount;
+
+    /// <summary>
+    /// The number of transfers in a row that failed.
+    /// </summary>
+    int transferFailureCount;
+
+    /// <summary>
+    /// The number of probes that have failed since the bus failed.
+    /// </summary>
+    int failedProbes;
+
+    /// <summary>
+    /// The time to wait after the last failure before the bus is probed.
+    /// </summary>
+    int backoffMilli;
+
+    /// <summary>
+    /// The time of the last failure (from clock_gettime using CLOCK_MONOTONIC.)
+    /// </summary>
+    struct timespec failedAt;
+} OneWireHealthBus;
+
+static OneWireHealthBus *OneWireHealthGetBus(int bus);
+static void OneWireHealthFail(int bus, int reason);
+
+/// <summary>
+/// The circuit breaker of each bus.
+/// </summary>
+static OneWireHealthBus healthBuses[ONEWIRE_MAX_BUSES];
+
+/// <summary>
+/// Closes the circuit breaker of every bus, so the next operation on each bus uses the bus.
+/// </summary>
+void OneWireHealthReset(void)
+{
+    memset(healthBuses, 0, sizeof(healthBuses));
+}
+
+/// <summary>
+/// Returns true if a reset pulse can be sent on the bus: the bus is healthy, or it has failed and
+/// the backoff has elapsed (the reset pulse is a probe of the bus.)
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <returns>true if the reset pulse should be sent, false to fail without using the bus.</returns>
+bool OneWireHealthAllowReset(int bus)
+{
+    const OneWireHealthBus *health = OneWireHealthGetBus(bus);
+    return health == NULL || !health->open ||
+           ElapsedMilli(&health->failedAt) >= health->backoffMilli;
+}
+
+/// <summary>
+/// Returns true if time slots can be sent on the bus.  Once the bus has failed no time slots are
+/// sent until a reset pulse gets a presence pulse.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <returns>true if the time slots should be sent, false to fail without using the bus.</returns>
+bool OneWireHealthAllowTransfer(int bus)
+{
+    return !OneWireHealthIsOpen(bus);
+}
+
+/// <summary>
+/// Records the response to a reset pulse.  A presence pulse closes the circuit breaker.  A bus
+/// that is shorted, or has no data, opens the circuit breaker; so does a bus without a presence
+/// pulse for ONEWIRE_HEALTH_NO_PRESENCE_LIMIT resets.  A failed probe doubles the backoff.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <param name="response">The response to the reset pulse.</param>
+void OneWireHealthRecordReset(int bus, OneWireResetResponse response)
+{
+    OneWireHealthBus *health = OneWireHealthGetBus(bus);
+    if (health == NULL) {
+        return;
+    }
+
+    if (response == DevicePresent) {
+        // A presence pulse does not show the time slots are echoed, so the transfer failures are
+        // only forgotten when the bus recovers.
+        if (health->open) {
+            ONEWIRE_LOG_DEFER_INFO("INFO: OneWire bus %d recovered after %d failed probes.\n", bus,
+                                   health->failedProbes);
+            *health = (OneWireHealthBus){.open = false};
+        }
+        health->noPresenceCount = 0;
+        return;
+    }
+
+    // An empty bus is only a failure once it has stayed empty; a failed probe always is.
+    if (response == NoDevices && !health->open &&
+        ++health->noPresenceCount < ONEWIRE_HEALTH_NO_PRESENCE_LIMIT) {
+        return;
+    }
+
+    OneWireHealthFail(bus, (int)response);
+}
+
+/// <summary>
+/// Records time slots that were sent, or that could not be sent or were not echoed.  The circuit
+/// breaker opens once ONEWIRE_HEALTH_TRANSFER_FAILURE_LIMIT transfers in a row have failed, and
+/// the rest of the transaction then fails without using the bus.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <param name="succeeded">true if the time slots were sent and echoed, otherwise false.</param>
+void OneWireHealthRecordTransfer(int bus, bool succeeded)
+{
+    OneWireHealthBus *health = OneWireHealthGetBus(bus);
+    if (health == NULL) {
+        return;
+    }
+
+    if (succeeded) {
+        health->transferFailureCount = 0;
+        return;
+    }
+
+    if (++health->transferFailureCount >= ONEWIRE_HEALTH_TRANSFER_FAILURE_LIMIT) {
+        OneWireHealthFail(bus, -1);
+    }
+}
+
+/// <summary>
+/// Returns true if the circuit breaker of the bus is open: the bus has failed and has not
+/// responded to a reset pulse since.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <returns>true if the bus has failed, otherwise false.</returns>
+bool OneWireHealthIsOpen(int bus)
+{
+    const OneWireHealthBus *health = OneWireHealthGetBus(bus);
+    return health != NULL && health->open;
+}
+
+/// <summary>
+/// Returns the circuit breaker of a bus.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <returns>The circuit breaker, or NULL if the bus number is not valid.</returns>
+static OneWireHealthBus *OneWireHealthGetBus(int bus)
+{
+    if (bus < 0 || bus >= ONEWIRE_MAX_BUSES) {
+        return NULL;
+    }
+
+    return &healthBuses[bus];
+}
+
+/// <summary>
+/// Opens the circuit breaker of a bus, or doubles the backoff if it is already open (a probe
+/// failed.)  The backoff is measured from this failure.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <param name="reason">The reset response, or -1 for time slots that failed.</param>
+static void OneWireHealthFail(int bus, int reason)
+{
+    OneWireHealthBus *health = OneWireHealthGetBus(bus);
+    if (health == NULL) {
+        return;
+    }
+
+    if (!health->open) {
+        health->open = true;
+        health->backoffMilli = ONEWIRE_HEALTH_MIN_BACKOFF_MS;
+        ONEWIRE_LOG_DEFER_WARN("WARN: OneWire bus %d failed (%d), probing in %d ms.\n", bus,
+                               reason, health->backoffMilli);
+    } else {
+        health->failedProbes++;
+        health->backoffMilli *= 2;
+        if (health->backoffMilli > ONEWIRE_HEALTH_MAX_BACKOFF_MS) {
+            health->backoffMilli = ONEWIRE_HEALTH_MAX_BACKOFF_MS;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &health->failedAt);
+}
@@ -0,0 +1,79 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "onewire.h"
+
+/// <summary>
+/// The number of resets in a row without a presence pulse before the bus is considered
+/// disconnected.  A single missing presence pulse can be noise, or a device being replaced.
+/// </summary>
+#define ONEWIRE_HEALTH_NO_PRESENCE_LIMIT 3
+
+/// <summary>
+/// The number of transfers in a row that fail before the bus is considered failed.  A single
+/// time slot that is not echoed (e.g. a write 0 slot read back as a 1) is usually noise, and only
+/// fails its transaction; a UART that does not respond, or a bus that is shorted, also fails
+/// the next reset pulse.
+/// </summary>
+#define ONEWIRE_HEALTH_TRANSFER_FAILURE_LIMIT 3
+
+/// <summary>
+/// The time (in milliseconds) to wait after a bus fails before it is probed.
+/// </summary>
+#define ONEWIRE_HEALTH_MIN_BACKOFF_MS 1000
+
+/// <summary>
+/// The longest time (in milliseconds) between the probes of a bus that keeps failing.
+/// </summary>
+#define ONEWIRE_HEALTH_MAX_BACKOFF_MS 60000
+
+/// <summary>
+/// Closes the circuit breaker of every bus, so the next operation on each bus uses the bus.
+/// </summary>
+void OneWireHealthReset(void);
+
+/// <summary>
+/// Returns true if a reset pulse can be sent on the bus: the bus is healthy, or it has failed and
+/// the backoff has elapsed (the reset pulse is a probe of the bus.)
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <returns>true if the reset pulse should be sent, false to fail without using the bus.</returns>
+bool OneWireHealthAllowReset(int bus);
+
+/// <summary>
+/// Returns true if time slots can be sent on the bus.  Once the bus has failed no time slots are
+/// sent until a reset pulse gets a presence pulse.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <returns>true if the time slots should be sent, false to fail without using the bus.</returns>
+bool OneWireHealthAllowTransfer(int bus);
+
+/// <summary>
+/// Records the response to a reset pulse.  A presence pulse closes the circuit breaker.  A bus
+/// that is shorted, or has no data, opens the circuit breaker; so does a bus without a presence
+/// pulse for ONEWIRE_HEALTH_NO_PRESENCE_LIMIT resets.  A failed probe doubles the backoff.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <param name="response">The response to the reset pulse.</param>
+void OneWireHealthRecordReset(int bus, OneWireResetResponse response);
+
+/// <summary>
+/// Records time slots that were sent, or that could not be sent or were not echoed.  The circuit
+/// breaker opens once ONEWIRE_HEALTH_TRANSFER_FAILURE_LIMIT transfers in a row have failed, and
+/// the rest of the transaction then fails without using the bus.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <param name="succeeded">true if the time slots were sent and echoed, otherwise false.</param>
+void OneWireHealthRecordTransfer(int bus, bool succeeded);
+
+/// <summary>
+/// Returns true if the circuit breaker of the bus is open: the bus has failed and has not
+/// responded to a reset pulse since.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <returns>true if the bus has failed, otherwise false.</returns>
+bool OneWireHealthIsOpen(int bus);
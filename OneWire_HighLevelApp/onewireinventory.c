@@ -0,0 +1,714 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "onewireinventory.h"
+#include "crc16.h"
+#include "onewire.h"
+#include "onewirehealth.h"
+#include "onewiresearch.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "applibs_versions.h"
+#include <applibs/log.h>
+#include <applibs/storage.h>
+
+/// <summary>
+/// Identifies the inventory file in mutable storage ("OWI1").
+/// </summary>
+#define ONEWIRE_INVENTORY_FILE_MAGIC 0x3149574FU
+
+/// <summary>
+/// The version of the inventory file; increment it when OneWireInventoryFileRecord changes.
+/// </summary>
+#define ONEWIRE_INVENTORY_FILE_VERSION 1
+
+/// <summary>
+/// How often (in seconds) a bus with a single device is checked with Read ROM for another
+/// device, even if the shape of its presence pulses has not changed.
+/// </summary>
+#define ONEWIRE_INVENTORY_SINGLE_DEVICE_CHECK_SECONDS 60
+
+/// <summary>
+/// A device found by searching a OneWire bus.
+/// </summary>
+typedef struct {
+    OneWireRomId rom;
+    int bus;
+    int resolution;
+    OneWireInventoryPower power;
+    bool overdrive;
+} OneWireInventoryDevice;
+
+/// <summary>
+/// The start of the inventory file, followed by count OneWireInventoryFileRecord.
+/// </summary>
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint16_t crc;
+    uint16_t reserved;
+} OneWireInventoryFileHeader;
+
+/// <summary>
+/// A device in the inventory file.
+/// </summary>
+typedef struct {
+    OneWireRomId rom;
+    int8_t bus;
+    int8_t resolution;
+    uint8_t power;
+    uint8_t overdrive;
+    uint8_t reserved[4];
+} OneWireInventoryFileRecord;
+
+/// <summary>
+/// The inventory file, which is read and written with a single call.
+/// </summary>
+typedef struct {
+    OneWireInventoryFileHeader header;
+    OneWireInventoryFileRecord records[ONEWIRE_INVENTORY_MAX_DEVICES];
+} OneWireInventoryFile;
+
+/// <summary>
+/// The devices found by the last search of each bus.
+/// </summary>
+static OneWireInventoryDevice inventoryDevices[ONEWIRE_INVENTORY_MAX_DEVICES];
+
+/// <summary>
+/// The number of devices in inventoryDevices.
+/// </summary>
+static int inventoryCount = 0;
+
+/// <summary>
+/// The family identifiers of the devices to keep in the inventory.
+/// </summary>
+static uint8_t inventoryFamilyIds[ONEWIRE_INVENTORY_MAX_FAMILIES];
+
+/// <summary>
+/// The number of entries in inventoryFamilyIds (0 to keep all devices.)
+/// </summary>
+static int inventoryFamilyCount = 0;
+
+/// <summary>
+/// How often (in seconds) the bus is searched, even if no device failed.
+/// </summary>
+static int inventoryRefreshIntervalSeconds = 0;
+
+/// <summary>
+/// true if the bus needs to be searched before the inventory is used.
+/// </summary>
+static bool inventoryStale[ONEWIRE_MAX_BUSES];
+
+/// <summary>
+/// The time each bus was last searched.
+/// </summary>
+static struct timespec inventoryLastRefresh[ONEWIRE_MAX_BUSES];
+
+/// <summary>
+/// true if the bus has only one device (of any family), which is then addressed with Skip ROM.
+/// </summary>
+static bool inventorySingleDevice[ONEWIRE_MAX_BUSES];
+
+/// <summary>
+/// The shape of the presence pulses (see <see src="OneWireGetPresence"/>) and the time when each
+/// bus with a single device was last checked for another device.
+/// </summary>
+static int inventorySinglePresence[ONEWIRE_MAX_BUSES];
+static struct timespec inventorySingleChecked[ONEWIRE_MAX_BUSES];
+
+/// <summary>
+/// true if the inventory changed since it was last loaded or saved.
+/// </summary>
+static bool inventoryChanged = false;
+
+/// <summary>
+/// The buffer for reading and writing the inventory file.
+/// </summary>
+static OneWireInventoryFile inventoryFile;
+
+static int OneWireInventoryGetBusCount(int bus);
+static bool OneWireInventoryCheckSingleDevice(int bus);
+static bool OneWireInventoryRecheckSingleDevice(int index);
+static bool OneWireInventoryIsKeptFamily(OneWireRomId rom);
+static int OneWireInventoryFind(const OneWireInventoryDevice *devices, int count,
+                                OneWireRomId rom);
+
+/// <summary>
+/// Initializes the inventory of devices on the OneWire buses.  The inventory is empty until the
+/// first call to <see src="OneWireInventoryRefreshIfNeeded"/>.
+/// </summary>
+/// <param name="familyIds">The family identifiers of the devices to keep in the inventory (e.g.
+/// from <see src="OneWireDriverGetFamilyIds"/>), or NULL to keep all devices.</param>
+/// <param name="familyCount">The number of family identifiers (at most
+/// ONEWIRE_INVENTORY_MAX_FAMILIES.)</param>
+/// <param name="refreshIntervalSeconds">How often the OneWire bus is searched again for
+/// devices that were added or removed.</param>
+void OneWireInventoryInit(const uint8_t *familyIds, int familyCount, int refreshIntervalSeconds)
+{
+    if (familyIds == NULL || familyCount < 0) {
+        familyCount = 0;
+    } else if (familyCount > ONEWIRE_INVENTORY_MAX_FAMILIES) {
+        Log_Debug("PROGRAM ERROR: Only the first %d device families are kept.\n",
+                  ONEWIRE_INVENTORY_MAX_FAMILIES);
+        familyCount = ONEWIRE_INVENTORY_MAX_FAMILIES;
+    }
+    if (familyCount > 0) {
+        memcpy(inventoryFamilyIds, familyIds, (size_t)familyCount * sizeof(familyIds[0]));
+    }
+    inventoryFamilyCount = familyCount;
+    inventoryRefreshIntervalSeconds = refreshIntervalSeconds;
+    inventoryCount = 0;
+    inventoryChanged = false;
+    for (int bus = 0; bus < ONEWIRE_MAX_BUSES; bus++) {
+        inventoryStale[bus] = true;
+        inventorySingleDevice[bus] = false;
+    }
+}
+
+/// <summary>
+/// Searches the selected OneWire bus for devices if the inventory has no devices on the bus, the
+/// refresh interval has elapsed, or a device on the bus failed since the last search.  Otherwise
+/// the cached inventory is used.  A bus that has failed (see onewirehealth.h) is not searched
+/// until it recovers.
+/// </summary>
+/// <returns>true if the bus was searched, otherwise false.</returns>
+bool OneWireInventoryRefreshIfNeeded(void)
+{
+    int bus = OneWireGetSelectedBus();
+    if (bus < 0 || OneWireHealthIsOpen(bus)) {
+        return false;
+    }
+
+    if (!inventoryStale[bus] && OneWireInventoryGetBusCount(bus) > 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec - inventoryLastRefresh[bus].tv_sec < inventoryRefreshIntervalSeconds) {
+            return false;
+        }
+    }
+
+    OneWireInventoryRefresh();
+    return true;
+}
+
+/// <summary>
+/// Searches the selected OneWire bus and replaces the devices on that bus in the inventory with
+/// the devices that were found.  Devices on other buses are kept.  If any pass of the search
+/// fails the devices on the bus are kept, and the bus is searched again on the next call to
+/// <see src="OneWireInventoryRefreshIfNeeded"/>.
+/// </summary>
+/// <returns>The number of devices found.</returns>
+int OneWireInventoryRefresh(void)
+{
+    int bus = OneWireGetSelectedBus();
+    if (bus < 0) {
+        return 0;
+    }
+
+    // Remove the devices previously found on this bus, keeping them so that the resolution and
+    // power mode of the devices that are found again are not lost.
+    OneWireInventoryDevice previous[ONEWIRE_INVENTORY_MAX_DEVICES];
+    int previousCount = 0;
+    int count = 0;
+    for (int i = 0; i < inventoryCount; i++) {
+        if (inventoryDevices[i].bus != bus) {
+            inventoryDevices[count++] = inventoryDevices[i];
+        } else {
+            previous[previousCount++] = inventoryDevices[i];
+        }
+    }
+    inventoryCount = count;
+
+    // Each family is searched on its own, skipping any other device families that are on the
+    // OneWire bus, so the devices of the other families are never found and do not take up the
+    // space left in the inventory.  Without families every device is found in a single pass.  The
+    // devices found last time are passed to the search, so the parts of the search tree that have
+    // not changed are sent in one transfer per device.
+    OneWireRomId knownRoms[ONEWIRE_INVENTORY_MAX_DEVICES];
+    for (int i = 0; i < previousCount; i++) {
+        knownRoms[i] = previous[i].rom;
+    }
+
+    OneWireRomId roms[ONEWIRE_INVENTORY_MAX_DEVICES];
+    long slots = 0;
+    int found = 0;
+    bool searchFailed = false;
+    int searchCount = inventoryFamilyCount > 0 ? inventoryFamilyCount : 1;
+    for (int i = 0; i < searchCount && !searchFailed; i++) {
+        uint8_t familyId = inventoryFamilyCount > 0 ? inventoryFamilyIds[i] : 0;
+        long familySlots = 0;
+        int familyFound = OneWireSearchAll(familyId, false, knownRoms, previousCount,
+                                           &roms[found],
+                                           ONEWIRE_INVENTORY_MAX_DEVICES - inventoryCount - found,
+                                           &familySlots);
+        slots += familySlots;
+        searchFailed = familyFound < 0 || OneWireHealthIsOpen(bus);
+        if (!searchFailed) {
+            found += familyFound;
+        }
+    }
+
+    // A failed pass (even a single transfer error that does not open the circuit breaker) would
+    // remove the devices that were not reached, so the devices found by the previous search are
+    // kept and the bus is searched again on the next call to OneWireInventoryRefreshIfNeeded.
+    if (searchFailed) {
+        memcpy(&inventoryDevices[inventoryCount], previous, previousCount * sizeof(previous[0]));
+        inventoryCount += previousCount;
+        inventoryStale[bus] = true;
+        Log_Debug("WARN: Search of bus %d failed, keeping %d devices.\n", bus, previousCount);
+        return 0;
+    }
+
+    bool added[ONEWIRE_INVENTORY_MAX_DEVICES] = {false};
+    for (int i = 0; i < found; i++) {
+        int match = OneWireInventoryFind(previous, previousCount, roms[i]);
+        if (match >= 0) {
+            inventoryDevices[inventoryCount] = previous[match];
+        } else {
+            inventoryDevices[inventoryCount] = (OneWireInventoryDevice){
+                .rom = roms[i],
+                .bus = bus,
+                .resolution = ONEWIRE_INVENTORY_RESOLUTION_UNKNOWN,
+                .power = OneWireInventoryPower_Unknown,
+                .overdrive = false,
+            };
+            added[inventoryCount] = true;
+            inventoryChanged = true;
+        }
+        inventoryCount++;
+    }
+
+    if (found != previousCount) {
+        inventoryChanged = true;
+    }
+
+    // Check which of the new devices support overdrive, so they are addressed at overdrive speed.
+    // This is done after the search, as it resets the bus.
+    for (int i = count; i < inventoryCount; i++) {
+        if (added[i] && OneWireProbeOverdrive(inventoryDevices[i].rom)) {
+            Log_Debug("INFO: Device %016llx supports overdrive.\n",
+                      (unsigned long long)inventoryDevices[i].rom);
+            inventoryDevices[i].overdrive = true;
+        }
+    }
+
+    Log_Debug("INFO: Inventory found %d devices on bus %d (%ld time slots).\n", found, bus, slots);
+    inventorySingleDevice[bus] = OneWireInventoryCheckSingleDevice(bus);
+    clock_gettime(CLOCK_MONOTONIC, &inventoryLastRefresh[bus]);
+    inventoryStale[bus] = false;
+    return found;
+}
+
+/// <summary>
+/// Returns the number of devices in the inventory (on all buses.)
+/// </summary>
+/// <returns>The number of devices.</returns>
+int OneWireInventoryGetCount(void)
+{
+    return inventoryCount;
+}
+
+/// <summary>
+/// Returns the ROM identifier of the device in the inventory.
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <returns>The ROM identifier of the device.</returns>
+OneWireRomId OneWireInventoryGetRomId(int index)
+{
+    return inventoryDevices[index].rom;
+}
+
+/// <summary>
+/// Returns the index of the device in the inventory with the ROM identifier.
+/// </summary>
+/// <param name="rom">The ROM identifier.</param>
+/// <returns>The index of the device, or -1 if the device is not in the inventory.</returns>
+int OneWireInventoryGetIndex(OneWireRomId rom)
+{
+    return OneWireInventoryFind(inventoryDevices, inventoryCount, rom);
+}
+
+/// <summary>
+/// Returns the bus the device in the inventory is connected to.
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <returns>The bus number of the device.</returns>
+int OneWireInventoryGetBus(int index)
+{
+    return inventoryDevices[index].bus;
+}
+
+/// <summary>
+/// Returns the resolution last read from the device in the inventory (e.g. the DS18B20
+/// ThermometerResolution.)
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <returns>The resolution, or ONEWIRE_INVENTORY_RESOLUTION_UNKNOWN.</returns>
+int OneWireInventoryGetResolution(int index)
+{
+    return inventoryDevices[index].resolution;
+}
+
+/// <summary>
+/// Sets the resolution read from the device in the inventory.  The inventory is saved by the
+/// next call to <see src="OneWireInventorySave"/> if the resolution changed.
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <param name="resolution">The resolution.</param>
+void OneWireInventorySetResolution(int index, int resolution)
+{
+    if (inventoryDevices[index].resolution != resolution) {
+        inventoryDevices[index].resolution = resolution;
+        inventoryChanged = true;
+    }
+}
+
+/// <summary>
+/// Returns how the device in the inventory is powered.
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <returns>The power mode, or OneWireInventoryPower_Unknown if it has not been read yet.</returns>
+OneWireInventoryPower OneWireInventoryGetPower(int index)
+{
+    return inventoryDevices[index].power;
+}
+
+/// <summary>
+/// Sets how the device in the inventory is powered.  The inventory is saved by the next call to
+/// <see src="OneWireInventorySave"/> if the power mode changed.
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <param name="power">The power mode.</param>
+void OneWireInventorySetPower(int index, OneWireInventoryPower power)
+{
+    if (inventoryDevices[index].power != power) {
+        inventoryDevices[index].power = power;
+        inventoryChanged = true;
+    }
+}
+
+/// <summary>
+/// Returns true if the device in the inventory supports overdrive, in which case
+/// <see src="OneWireInventorySelect"/> addresses it with Overdrive Match ROM.
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <returns>true if the device supports overdrive, otherwise false.</returns>
+bool OneWireInventoryGetOverdrive(int index)
+{
+    return inventoryDevices[index].overdrive;
+}
+
+/// <summary>
+/// Selects the bus of the device in the inventory and addresses the device using
+/// <see src="OneWireMatchRomId"/> (or <see src="OneWireOverdriveMatchRomId"/> if the device
+/// supports overdrive.)  The next command will only be performed by that device.  If the device
+/// is the only device on the bus it is addressed with <see src="OneWireSkipROM"/> (or
+/// <see src="OneWireOverdriveSkipROM"/>) instead, which sends 8 time slots instead of 72; the
+/// bus is checked with Read ROM for another device when the shape of its presence pulses
+/// changes, and every minute.
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <returns>true if the device was addressed, otherwise false.</returns>
+bool OneWireInventorySelect(int index)
+{
+    if (index < 0 || index >= inventoryCount) {
+        Log_Debug("PROGRAM ERROR: Inventory index %d is out of range.\n", index);
+        return false;
+    }
+
+    if (!OneWireSelectBus(inventoryDevices[index].bus)) {
+        return false;
+    }
+
+    // Devices that support overdrive are addressed at overdrive speed for the rest of the
+    // transaction.  The only device on a bus does not need its ROM identifier to be sent.
+    if (inventorySingleDevice[inventoryDevices[index].bus] &&
+        OneWireInventoryRecheckSingleDevice(index)) {
+        return inventoryDevices[index].overdrive ? OneWireOverdriveSkipROM() : OneWireSkipROM();
+    }
+
+    if (inventoryDevices[index].overdrive) {
+        return OneWireOverdriveMatchRomId(inventoryDevices[index].rom);
+    }
+
+    return OneWireMatchRomId(inventoryDevices[index].rom);
+}
+
+/// <summary>
+/// Reports that a transaction with the device failed.  The bus will be searched again on the
+/// next call to <see src="OneWireInventoryRefreshIfNeeded"/>, in case the device was removed (or
+/// another device was added, which would corrupt the replies to Skip ROM.)  Until then the
+/// devices on the bus are addressed with Match ROM.
+/// </summary>
+/// <param name="index">The index of the device that failed.</param>
+void OneWireInventoryReportFailure(int index)
+{
+    if (index >= 0 && index < inventoryCount) {
+        inventoryStale[inventoryDevices[index].bus] = true;
+        inventorySingleDevice[inventoryDevices[index].bus] = false;
+    }
+}
+
+/// <summary>
+/// Loads the inventory saved by <see src="OneWireInventorySave"/> from mutable storage, and
+/// verifies each device is still on its bus with <see src="OneWireVerifyRomId"/>.  A bus where
+/// every saved device responded is not searched until the refresh interval elapses; any other
+/// bus is searched on the next call to <see src="OneWireInventoryRefreshIfNeeded"/>.  The buses
+/// must be added before the inventory is loaded.
+/// </summary>
+/// <returns>The number of devices that were loaded and verified.</returns>
+int OneWireInventoryLoad(void)
+{
+    int fd = Storage_OpenMutableFile();
+    if (fd == -1) {
+        Log_Debug("ERROR: Could not open the inventory file: %s (%d).\n", strerror(errno), errno);
+        return 0;
+    }
+
+    ssize_t length = read(fd, &inventoryFile, sizeof(inventoryFile));
+    close(fd);
+
+    const OneWireInventoryFileHeader *header = &inventoryFile.header;
+    if (length < (ssize_t)sizeof(*header) || header->magic != ONEWIRE_INVENTORY_FILE_MAGIC ||
+        header->version != ONEWIRE_INVENTORY_FILE_VERSION ||
+        header->count > ONEWIRE_INVENTORY_MAX_DEVICES ||
+        length < (ssize_t)(offsetof(OneWireInventoryFile, records) +
+                           header->count * sizeof(inventoryFile.records[0])) ||
+        header->crc != Crc16Compute((const uint8_t *)inventoryFile.records,
+                                    header->count * sizeof(inventoryFile.records[0]), 0)) {
+        Log_Debug("INFO: No saved inventory; the OneWire buses will be searched.\n");
+        return 0;
+    }
+
+    int savedCount[ONEWIRE_MAX_BUSES] = {0};
+    int verifiedCount[ONEWIRE_MAX_BUSES] = {0};
+    inventoryCount = 0;
+    for (int i = 0; i < header->count; i++) {
+        const OneWireInventoryFileRecord *record = &inventoryFile.records[i];
+        int bus = record->bus;
+        if (bus < 0 || bus >= OneWireGetBusCount() ||
+            !OneWireInventoryIsKeptFamily(record->rom)) {
+            continue;
+        }
+
+        savedCount[bus]++;
+        if (!OneWireSelectBus(bus) || !OneWireVerifyRomId(record->rom)) {
+            Log_Debug("WARN: Saved device %016llx did not respond on bus %d.\n",
+                      (unsigned long long)record->rom, bus);
+            continue;
+        }
+
+        // A device saved while its bus had no reset UART is addressed at standard speed.
+        inventoryDevices[inventoryCount++] = (OneWireInventoryDevice){
+            .rom = record->rom,
+            .bus = bus,
+            .resolution = record->resolution,
+            .power = (OneWireInventoryPower)record->power,
+            .overdrive = record->overdrive != 0 && OneWireCanUseOverdrive(),
+        };
+        verifiedCount[bus]++;
+    }
+
+    // A bus is only trusted if every saved device responded; otherwise it is searched again.
+    for (int bus = 0; bus < OneWireGetBusCount(); bus++) {
+        inventoryStale[bus] = savedCount[bus] == 0 || verifiedCount[bus] != savedCount[bus];
+        clock_gettime(CLOCK_MONOTONIC, &inventoryLastRefresh[bus]);
+        inventorySingleDevice[bus] =
+            !inventoryStale[bus] && OneWireSelectBus(bus) && OneWireInventoryCheckSingleDevice(bus);
+    }
+
+    inventoryChanged = false;
+    Log_Debug("INFO: Inventory loaded %d of %d saved devices.\n", inventoryCount, header->count);
+    return inventoryCount;
+}
+
+/// <summary>
+/// Saves the inventory (the ROM identifier, bus, resolution and power mode of each device) to
+/// mutable storage, if it changed since it was last loaded or saved.
+/// </summary>
+/// <returns>true if the saved inventory is up to date, false if it could not be written.</returns>
+bool OneWireInventorySave(void)
+{
+    if (!inventoryChanged) {
+        return true;
+    }
+
+    memset(&inventoryFile, 0, sizeof(inventoryFile));
+    for (int i = 0; i < inventoryCount; i++) {
+        inventoryFile.records[i].rom = inventoryDevices[i].rom;
+        inventoryFile.records[i].bus = (int8_t)inventoryDevices[i].bus;
+        inventoryFile.records[i].resolution = (int8_t)inventoryDevices[i].resolution;
+        inventoryFile.records[i].power = (uint8_t)inventoryDevices[i].power;
+        inventoryFile.records[i].overdrive = inventoryDevices[i].overdrive ? 1 : 0;
+    }
+
+    size_t recordsLength = (size_t)inventoryCount * sizeof(inventoryFile.records[0]);
+    inventoryFile.header.magic = ONEWIRE_INVENTORY_FILE_MAGIC;
+    inventoryFile.header.version = ONEWIRE_INVENTORY_FILE_VERSION;
+    inventoryFile.header.count = (uint16_t)inventoryCount;
+    inventoryFile.header.crc =
+        Crc16Compute((const uint8_t *)inventoryFile.records, recordsLength, 0);
+
+    int fd = Storage_OpenMutableFile();
+    if (fd == -1) {
+        Log_Debug("ERROR: Could not open the inventory file: %s (%d).\n", strerror(errno), errno);
+        return false;
+    }
+
+    // The records are aligned for the ROM identifiers, so they do not start straight after the
+    // header.
+    size_t length = offsetof(OneWireInventoryFile, records) + recordsLength;
+    bool status =
+        lseek(fd, 0, SEEK_SET) == 0 && write(fd, &inventoryFile, length) == (ssize_t)length;
+    if (!status) {
+        Log_Debug("ERROR: Could not write the inventory file: %s (%d).\n", strerror(errno), errno);
+    }
+    close(fd);
+
+    // The file is only written once per change, to limit the wear on the flash; a failed write is
+    // tried again on the next call.
+    if (status) {
+        inventoryChanged = false;
+    }
+    return status;
+}
+
+/// <summary>
+/// Returns the number of devices in the inventory that are connected to the bus.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <returns>The number of devices on the bus.</returns>
+static int OneWireInventoryGetBusCount(int bus)
+{
+    int count = 0;
+    for (int i = 0; i < inventoryCount; i++) {
+        if (inventoryDevices[i].bus == bus) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/// <summary>
+/// Returns true if the device in the inventory is the only device on the selected bus.  The
+/// inventory may only keep the devices of some families, so the whole bus is searched (with the
+/// device as the known topology, which is a single pass when no other device is present.)
+/// </summary>
+/// <param name="bus">The bus, which must be selected.</param>
+/// <returns>true if the bus has exactly one device, otherwise false.</returns>
+static bool OneWireInventoryCheckSingleDevice(int bus)
+{
+    int index = -1;
+    for (int i = 0; i < inventoryCount; i++) {
+        if (inventoryDevices[i].bus == bus) {
+            if (index >= 0) {
+                return false;
+            }
+            index = i;
+        }
+    }
+
+    if (index < 0) {
+        return false;
+    }
+
+    // A search that failed (-1) may have missed another device, so the bus uses Match ROM.
+    OneWireRomId roms[2];
+    int found = OneWireSearchAll(0, false, &inventoryDevices[index].rom, 1, roms, 2, NULL);
+    if (found != 1 || roms[0] != inventoryDevices[index].rom) {
+        if (found < 0) {
+            Log_Debug("WARN: Search of bus %d failed; using Match ROM.\n", bus);
+        }
+        return false;
+    }
+
+    Log_Debug("INFO: Device %016llx is the only device on bus %d; using Skip ROM.\n",
+              (unsigned long long)roms[0], bus);
+    inventorySinglePresence[bus] = OneWireGetPresence();
+    clock_gettime(CLOCK_MONOTONIC, &inventorySingleChecked[bus]);
+    return true;
+}
+
+/// <summary>
+/// Checks that the device is still the only device on its bus before it is addressed with Skip
+/// ROM.  Devices with the same scratchpad (e.g. at the same temperature) reply to Skip ROM
+/// without a CRC failure, so a transaction failure cannot be relied on to find a second device.
+/// If the shape of the presence pulses changed, or the check interval elapsed, Read ROM is sent:
+/// the ROM identifiers of several devices are combined on the bus, so the reply does not match
+/// the device.  If the check fails the bus is searched on the next call to
+/// <see src="OneWireInventoryRefreshIfNeeded"/>, and the devices are addressed with Match ROM.
+/// </summary>
+/// <param name="index">The index of the device, on a bus with a single device.</param>
+/// <returns>true if the device is still the only device on the bus, otherwise false.</returns>
+static bool OneWireInventoryRecheckSingleDevice(int index)
+{
+    int bus = inventoryDevices[index].bus;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (OneWireGetPresence() == inventorySinglePresence[bus] &&
+        now.tv_sec - inventorySingleChecked[bus].tv_sec <
+            ONEWIRE_INVENTORY_SINGLE_DEVICE_CHECK_SECONDS) {
+        return true;
+    }
+
+    OneWireRomId rom;
+    if (OneWireSingleReadRomId(&rom) && rom == inventoryDevices[index].rom) {
+        inventorySinglePresence[bus] = OneWireGetPresence();
+        inventorySingleChecked[bus] = now;
+        return true;
+    }
+
+    Log_Debug("WARN: Bus %d may have another device; using Match ROM.\n", bus);
+    inventoryStale[bus] = true;
+    inventorySingleDevice[bus] = false;
+    return false;
+}
+
+/// <summary>
+/// Returns true if the family of the device is kept in the inventory.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>true if the device is kept, otherwise false.</returns>
+static bool OneWireInventoryIsKeptFamily(OneWireRomId rom)
+{
+    if (inventoryFamilyCount == 0) {
+        return true;
+    }
+
+    uint8_t familyId = OneWireRomIdGetFamily(rom);
+    for (int i = 0; i < inventoryFamilyCount; i++) {
+        if (inventoryFamilyIds[i] == familyId) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/// <summary>
+/// Returns the index of the device with the ROM identifier.
+/// </summary>
+/// <param name="devices">The devices to search.</param>
+/// <param name="count">The number of devices.</param>
+/// <param name="rom">The ROM identifier.</param>
+/// <returns>The index of the device, or -1 if there is no device with the ROM identifier.</returns>
+static int OneWireInventoryFind(const OneWireInventoryDevice *devices, int count,
+                                OneWireRomId rom)
+{
+    for (int i = 0; i < count; i++) {
+        if (devices[i].rom == rom) {
+            return i;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,168 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "onewirerom.h"
+
+/// <summary>
+/// The maximum number of devices that can be held in the inventory.
+/// </summary>
+#define ONEWIRE_INVENTORY_MAX_DEVICES 64
+
+/// <summary>
+/// The maximum number of device families that can be kept in the inventory.
+/// </summary>
+#define ONEWIRE_INVENTORY_MAX_FAMILIES 8
+
+/// <summary>
+/// The resolution of a device in the inventory that has not been read yet.
+/// </summary>
+#define ONEWIRE_INVENTORY_RESOLUTION_UNKNOWN (-1)
+
+/// <summary>
+/// How a device in the inventory is powered.
+/// </summary>
+typedef enum {
+    OneWireInventoryPower_Unknown = 0,
+    OneWireInventoryPower_Vcc = 1,
+    OneWireInventoryPower_Parasitic = 2,
+} OneWireInventoryPower;
+
+/// <summary>
+/// Initializes the inventory of devices on the OneWire buses.  The inventory is empty until the
+/// first call to <see src="OneWireInventoryRefreshIfNeeded"/>.
+/// </summary>
+/// <param name="familyIds">The family identifiers of the devices to keep in the inventory (e.g.
+/// from <see src="OneWireDriverGetFamilyIds"/>), or NULL to keep all devices.</param>
+/// <param name="familyCount">The number of family identifiers (at most
+/// ONEWIRE_INVENTORY_MAX_FAMILIES.)</param>
+/// <param name="refreshIntervalSeconds">How often the OneWire bus is searched again for
+/// devices that were added or removed.</param>
+void OneWireInventoryInit(const uint8_t *familyIds, int familyCount, int refreshIntervalSeconds);
+
+/// <summary>
+/// Searches the selected OneWire bus for devices if the inventory has no devices on the bus, the
+/// refresh interval has elapsed, or a device on the bus failed since the last search.  Otherwise
+/// the cached inventory is used.  A bus that has failed (see onewirehealth.h) is not searched
+/// until it recovers.
+/// </summary>
+/// <returns>true if the bus was searched, otherwise false.</returns>
+bool OneWireInventoryRefreshIfNeeded(void);
+
+/// <summary>
+/// Searches the selected OneWire bus and replaces the devices on that bus in the inventory with
+/// the devices that were found.  Devices on other buses are kept.  If any pass of the search
+/// fails the devices on the bus are kept, and the bus is searched again on the next call to
+/// <see src="OneWireInventoryRefreshIfNeeded"/>.
+/// </summary>
+/// <returns>The number of devices found.</returns>
+int OneWireInventoryRefresh(void);
+
+/// <summary>
+/// Returns the number of devices in the inventory (on all buses.)
+/// </summary>
+/// <returns>The number of devices.</returns>
+int OneWireInventoryGetCount(void);
+
+/// <summary>
+/// Returns the ROM identifier of the device in the inventory.
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <returns>The ROM identifier of the device.</returns>
+OneWireRomId OneWireInventoryGetRomId(int index);
+
+/// <summary>
+/// Returns the index of the device in the inventory with the ROM identifier.
+/// </summary>
+/// <param name="rom">The ROM identifier.</param>
+/// <returns>The index of the device, or -1 if the device is not in the inventory.</returns>
+int OneWireInventoryGetIndex(OneWireRomId rom);
+
+/// <summary>
+/// Returns the bus the device in the inventory is connected to.
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <returns>The bus number of the device.</returns>
+int OneWireInventoryGetBus(int index);
+
+/// <summary>
+/// Returns the resolution last read from the device in the inventory (e.g. the DS18B20
+/// ThermometerResolution.)
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <returns>The resolution, or ONEWIRE_INVENTORY_RESOLUTION_UNKNOWN.</returns>
+int OneWireInventoryGetResolution(int index);
+
+/// <summary>
+/// Sets the resolution read from the device in the inventory.  The inventory is saved by the
+/// next call to <see src="OneWireInventorySave"/> if the resolution changed.
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <param name="resolution">The resolution.</param>
+void OneWireInventorySetResolution(int index, int resolution);
+
+/// <summary>
+/// Returns how the device in the inventory is powered.
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <returns>The power mode, or OneWireInventoryPower_Unknown if it has not been read yet.</returns>
+OneWireInventoryPower OneWireInventoryGetPower(int index);
+
+/// <summary>
+/// Sets how the device in the inventory is powered.  The inventory is saved by the next call to
+/// <see src="OneWireInventorySave"/> if the power mode changed.
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <param name="power">The power mode.</param>
+void OneWireInventorySetPower(int index, OneWireInventoryPower power);
+
+/// <summary>
+/// Returns true if the device in the inventory supports overdrive, in which case
+/// <see src="OneWireInventorySelect"/> addresses it with Overdrive Match ROM.
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <returns>true if the device supports overdrive, otherwise false.</returns>
+bool OneWireInventoryGetOverdrive(int index);
+
+/// <summary>
+/// Selects the bus of the device in the inventory and addresses the device using
+/// <see src="OneWireMatchRomId"/> (or <see src="OneWireOverdriveMatchRomId"/> if the device
+/// supports overdrive.)  The next command will only be performed by that device.  If the device
+/// is the only device on the bus it is addressed with <see src="OneWireSkipROM"/> (or
+/// <see src="OneWireOverdriveSkipROM"/>) instead, which sends 8 time slots instead of 72; the
+/// bus is checked with Read ROM for another device when the shape of its presence pulses
+/// changes, and every minute.
+/// </summary>
+/// <param name="index">The index of the device (0 to OneWireInventoryGetCount()-1).</param>
+/// <returns>true if the device was addressed, otherwise false.</returns>
+bool OneWireInventorySelect(int index);
+
+/// <summary>
+/// Reports that a transaction with the device failed.  The bus will be searched again on the
+/// next call to <see src="OneWireInventoryRefreshIfNeeded"/>, in case the device was removed (or
+/// another device was added, which would corrupt the replies to Skip ROM.)  Until then the
+/// devices on the bus are addressed with Match ROM.
+/// </summary>
+/// <param name="index">The index of the device that failed.</param>
+void OneWireInventoryReportFailure(int index);
+
+/// <summary>
+/// Loads the inventory saved by <see src="OneWireInventorySave"/> from mutable storage, and
+/// verifies each device is still on its bus with <see src="OneWireVerifyRomId"/>.  A bus where
+/// every saved device responded is not searched until the refresh interval elapses; any other
+/// bus is searched on the next call to <see src="OneWireInventoryRefreshIfNeeded"/>.  The buses
+/// must be added before the inventory is loaded.
+/// </summary>
+/// <returns>The number of devices that were loaded and verified.</returns>
+int OneWireInventoryLoad(void);
+
+/// <summary>
+/// Saves the inventory (the ROM identifier, bus, resolution and power mode of each device) to
+/// mutable storage, if it changed since it was last loaded or saved.
+/// </summary>
+/// <returns>true if the saved inventory is up to date, false if it could not be written.</returns>
+bool OneWireInventorySave(void);
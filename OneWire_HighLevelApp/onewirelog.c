@@ -0,0 +1,70 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "onewirelog.h"
+
+#include <stdint.h>
+
+/// <summary>
+/// A message recorded by <see src="OneWireLogDefer"/>.
+/// </summary>
+typedef struct {
+    const char *format;
+    int32_t args[3];
+} OneWireLogRecord;
+
+/// <summary>
+/// The messages waiting to be logged.
+/// </summary>
+static OneWireLogRecord logRecords[ONEWIRE_LOG_DEFERRED_CAPACITY];
+
+/// <summary>
+/// The number of messages in logRecords.
+/// </summary>
+static int logRecordCount = 0;
+
+/// <summary>
+/// The number of messages dropped since the last <see src="OneWireLogFlush"/>.
+/// </summary>
+static uint32_t logDropped = 0;
+
+/// <summary>
+/// Records a message to be logged by the next <see src="OneWireLogFlush"/>.  Use the
+/// ONEWIRE_LOG_DEFER_ macros instead of calling this directly.  If
+/// ONEWIRE_LOG_DEFERRED_CAPACITY messages are already waiting the message is dropped (and
+/// counted.)
+/// </summary>
+/// <param name="format">The printf format, with up to 3 %d, %u or %x conversions.</param>
+/// <param name="arg0">The first argument.</param>
+/// <param name="arg1">The second argument.</param>
+/// <param name="arg2">The third argument.</param>
+void OneWireLogDefer(const char *format, int32_t arg0, int32_t arg1, int32_t arg2)
+{
+    if (logRecordCount >= ONEWIRE_LOG_DEFERRED_CAPACITY) {
+        logDropped++;
+        return;
+    }
+
+    logRecords[logRecordCount++] = (OneWireLogRecord){
+        .format = format,
+        .args = {arg0, arg1, arg2},
+    };
+}
+
+/// <summary>
+/// Logs (with Log_Debug) the messages recorded by <see src="OneWireLogDefer"/>.  Call this
+/// outside of the OneWire transactions, e.g. once a bus has been read.
+/// </summary>
+void OneWireLogFlush(void)
+{
+    for (int i = 0; i < logRecordCount; i++) {
+        const OneWireLogRecord *record = &logRecords[i];
+        Log_Debug(record->format, record->args[0], record->args[1], record->args[2]);
+    }
+    logRecordCount = 0;
+
+    if (logDropped > 0) {
+        Log_Debug("WARN: %u log messages were dropped.\n", logDropped);
+        logDropped = 0;
+    }
+}
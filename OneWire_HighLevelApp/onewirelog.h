@@ -0,0 +1,108 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "applibs_versions.h"
+#include <applibs/log.h>
+
+/// <summary>
+/// The log levels.  The messages above ONEWIRE_LOG_LEVEL are compiled out (their arguments are
+/// not evaluated.)
+/// </summary>
+#define ONEWIRE_LOG_LEVEL_NONE 0
+#define ONEWIRE_LOG_LEVEL_ERROR 1
+#define ONEWIRE_LOG_LEVEL_WARN 2
+#define ONEWIRE_LOG_LEVEL_INFO 3
+#define ONEWIRE_LOG_LEVEL_DEBUG 4
+
+/// <summary>
+/// The highest level that is logged (set it in CMakeLists.txt to change it.)
+/// </summary>
+#ifndef ONEWIRE_LOG_LEVEL
+#define ONEWIRE_LOG_LEVEL ONEWIRE_LOG_LEVEL_INFO
+#endif
+
+/// <summary>
+/// The number of deferred messages that can be waiting for <see src="OneWireLogFlush"/>.
+/// </summary>
+#define ONEWIRE_LOG_DEFERRED_CAPACITY 64
+
+/// <summary>
+/// Logs a message immediately with Log_Debug, if its level is enabled.
+/// </summary>
+#if ONEWIRE_LOG_LEVEL >= ONEWIRE_LOG_LEVEL_ERROR
+#define ONEWIRE_LOG_ERROR(...) Log_Debug(__VA_ARGS__)
+#else
+#define ONEWIRE_LOG_ERROR(...) ((void)0)
+#endif
+
+#if ONEWIRE_LOG_LEVEL >= ONEWIRE_LOG_LEVEL_WARN
+#define ONEWIRE_LOG_WARN(...) Log_Debug(__VA_ARGS__)
+#else
+#define ONEWIRE_LOG_WARN(...) ((void)0)
+#endif
+
+#if ONEWIRE_LOG_LEVEL >= ONEWIRE_LOG_LEVEL_INFO
+#define ONEWIRE_LOG_INFO(...) Log_Debug(__VA_ARGS__)
+#else
+#define ONEWIRE_LOG_INFO(...) ((void)0)
+#endif
+
+#if ONEWIRE_LOG_LEVEL >= ONEWIRE_LOG_LEVEL_DEBUG
+#define ONEWIRE_LOG_DEBUG(...) Log_Debug(__VA_ARGS__)
+#else
+#define ONEWIRE_LOG_DEBUG(...) ((void)0)
+#endif
+
+/// <summary>
+/// Records a message to be logged by the next <see src="OneWireLogFlush"/>, if its level is
+/// enabled.  Only the format (which must be a string literal) and up to 3 integer arguments are
+/// stored, so this is safe to use in the middle of a OneWire transaction.
+/// </summary>
+#define ONEWIRE_LOG_DEFER_(format, a0, a1, a2, ...) \
+    OneWireLogDefer(format, (int32_t)(a0), (int32_t)(a1), (int32_t)(a2))
+
+#if ONEWIRE_LOG_LEVEL >= ONEWIRE_LOG_LEVEL_ERROR
+#define ONEWIRE_LOG_DEFER_ERROR(...) ONEWIRE_LOG_DEFER_(__VA_ARGS__, 0, 0, 0, 0)
+#else
+#define ONEWIRE_LOG_DEFER_ERROR(...) ((void)0)
+#endif
+
+#if ONEWIRE_LOG_LEVEL >= ONEWIRE_LOG_LEVEL_WARN
+#define ONEWIRE_LOG_DEFER_WARN(...) ONEWIRE_LOG_DEFER_(__VA_ARGS__, 0, 0, 0, 0)
+#else
+#define ONEWIRE_LOG_DEFER_WARN(...) ((void)0)
+#endif
+
+#if ONEWIRE_LOG_LEVEL >= ONEWIRE_LOG_LEVEL_INFO
+#define ONEWIRE_LOG_DEFER_INFO(...) ONEWIRE_LOG_DEFER_(__VA_ARGS__, 0, 0, 0, 0)
+#else
+#define ONEWIRE_LOG_DEFER_INFO(...) ((void)0)
+#endif
+
+#if ONEWIRE_LOG_LEVEL >= ONEWIRE_LOG_LEVEL_DEBUG
+#define ONEWIRE_LOG_DEFER_DEBUG(...) ONEWIRE_LOG_DEFER_(__VA_ARGS__, 0, 0, 0, 0)
+#else
+#define ONEWIRE_LOG_DEFER_DEBUG(...) ((void)0)
+#endif
+
+/// <summary>
+/// Records a message to be logged by the next <see src="OneWireLogFlush"/>.  Use the
+/// ONEWIRE_LOG_DEFER_ macros instead of calling this directly.  If
+/// ONEWIRE_LOG_DEFERRED_CAPACITY messages are already waiting the message is dropped (and
+/// counted.)
+/// </summary>
+/// <param name="format">The printf format, with up to 3 %d, %u or %x conversions.</param>
+/// <param name="arg0">The first argument.</param>
+/// <param name="arg1">The second argument.</param>
+/// <param name="arg2">The third argument.</param>
+void OneWireLogDefer(const char *format, int32_t arg0, int32_t arg1, int32_t arg2);
+
+/// <summary>
+/// Logs (with Log_Debug) the messages recorded by <see src="OneWireLogDefer"/>.  Call this
+/// outside of the OneWire transactions, e.g. once a bus has been read.
+/// </summary>
+void OneWireLogFlush(void);
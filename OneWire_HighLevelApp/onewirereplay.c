@@ -0,0 +1,499 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// A OneWire transport that answers from a recorded OneWire trace, for replaying a trace captured
+// on a device through the OneWire code on a host (see onewirereplay.h).
+
+#include "onewirereplay.h"
+#include "onewiretrace.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/// <summary>
+/// The UART bytes of the UART transport (see onewireuart.c).
+/// </summary>
+#define ONEWIRE_REPLAY_SLOT_ONE 0xFF
+#define ONEWIRE_REPLAY_SLOT_ZERO 0x00
+#define ONEWIRE_REPLAY_RESET_RELEASED_BIT 0x80
+
+/// <summary>
+/// A recorded time slot.
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// The time since the previous entry of the bus, in microseconds.
+    /// </summary>
+    uint32_t deltaMicro;
+
+    /// <summary>
+    /// The bit sent (1 for a read slot.)
+    /// </summary>
+    uint8_t sentBit;
+
+    /// <summary>
+    /// The UART byte read back.
+    /// </summary>
+    uint8_t echo;
+
+    /// <summary>
+    /// true if no data was received.
+    /// </summary>
+    bool noData;
+} OneWireReplaySlot;
+
+/// <summary>
+/// A recorded reset pulse and the time slots up to the next reset pulse.
+/// </summary>
+typedef struct {
+    int64_t resetMicro;
+    int64_t lastMicro;
+    int firstSlot;
+    int slotCount;
+    int trace;
+    uint8_t resetSent;
+    int16_t resetReceived;
+    bool overdrive;
+} OneWireReplayRecord;
+
+static OneWireResetResponse OneWireReplayReset(void);
+static bool OneWireReplayTouchBits(const uint8_t *sendBits, uint8_t *receiveBits,
+                                   size_t bitCount, bool enableStrongPullup);
+static void OneWireReplayDisableStrongPullup(void);
+static bool OneWireReplaySetOverdrive(bool overdrive);
+static const OneWireReplaySlot *OneWireReplayFindSlot(int position, uint8_t sentBit);
+static bool OneWireReplayMatchesHistory(const OneWireReplayRecord *record, int length);
+static OneWireResetResponse OneWireReplayDecodeReset(const OneWireReplayRecord *record);
+
+/// <summary>
+/// The recorded time slots of every transaction, in order.
+/// </summary>
+static OneWireReplaySlot replaySlots[ONEWIRE_REPLAY_MAX_SLOTS];
+
+/// <summary>
+/// The number of entries in replaySlots.
+/// </summary>
+static int replaySlotCount = 0;
+
+/// <summary>
+/// The recorded transactions, in order.
+/// </summary>
+static OneWireReplayRecord replayRecords[ONEWIRE_REPLAY_MAX_TRANSACTIONS];
+
+/// <summary>
+/// The number of entries in replayRecords.
+/// </summary>
+static int replayRecordCount = 0;
+
+/// <summary>
+/// The number of traces loaded.
+/// </summary>
+static int replayTraceCount = 0;
+
+/// <summary>
+/// The transaction the next reset pulse is answered from (the one after the last transaction
+/// answered from.)
+/// </summary>
+static int replayNext = 0;
+
+/// <summary>
+/// The transaction the current slots are answered from, or -1 if no recorded transaction was
+/// sent the slots sent since the reset pulse.
+/// </summary>
+static int replayCandidate = -1;
+
+/// <summary>
+/// The number of slots sent since the reset pulse.
+/// </summary>
+static int replayPosition = 0;
+
+/// <summary>
+/// The bits sent since the reset pulse (up to ONEWIRE_REPLAY_MAX_TRANSACTION_SLOTS.)
+/// </summary>
+static uint8_t replayHistory[ONEWIRE_REPLAY_MAX_TRANSACTION_SLOTS];
+
+/// <summary>
+/// true once the current transaction was counted in reorderedTransactions.
+/// </summary>
+static bool replayReordered = false;
+
+/// <summary>
+/// The operations answered since the replay was rewound.
+/// </summary>
+static OneWireReplayCounters replayCounters;
+
+/// <summary>
+/// The replay transport.  Overdrive is accepted, so the code takes the same path it took on the
+/// device; the recorded slots are answered the same at either speed.
+/// </summary>
+static const OneWireTransport replayTransport = {
+    .reset = OneWireReplayReset,
+    .touchBits = OneWireReplayTouchBits,
+    .disableStrongPullup = OneWireReplayDisableStrongPullup,
+    .setOverdrive = OneWireReplaySetOverdrive,
+};
+
+/// <summary>
+/// Removes the loaded traces.
+/// </summary>
+void OneWireReplayClear(void)
+{
+    replaySlotCount = 0;
+    replayRecordCount = 0;
+    replayTraceCount = 0;
+    OneWireReplayRewind();
+}
+
+/// <summary>
+/// Adds the transactions of a bus from an encoded trace (see onewiretrace.h) to the loaded
+/// traces, and rewinds the replay.  The slots recorded before the first reset pulse of the trace
+/// are skipped.
+/// </summary>
+/// <param name="trace">The encoded trace.</param>
+/// <param name="length">The length of the trace in bytes.</param>
+/// <param name="bus">The bus to replay.</param>
+/// <returns>true if the trace was decoded, false if it is not a valid trace (the transactions
+/// decoded before the error are kept) or the loaded traces are full.</returns>
+bool OneWireReplayLoad(const uint8_t *trace, size_t length, int bus)
+{
+    OneWireReplayRewind();
+    if (length < ONEWIRE_TRACE_HEADER_SIZE || memcmp(trace, "OWT", 3) != 0 ||
+        trace[3] != ONEWIRE_TRACE_VERSION) {
+        return false;
+    }
+
+    uint32_t entryCount = 0;
+    uint32_t firstMicro = 0;
+    for (int i = 3; i >= 0; i--) {
+        entryCount = (entryCount << 8) | trace[4 + i];
+        firstMicro = (firstMicro << 8) | trace[12 + i];
+    }
+
+    int traceIndex = replayTraceCount++;
+    int64_t nowMicro = firstMicro;
+    int64_t previousMicro = firstMicro;
+    OneWireReplayRecord *record = NULL;
+    size_t offset = ONEWIRE_TRACE_HEADER_SIZE;
+    for (uint32_t entry = 0; entry < entryCount; entry++) {
+        if (offset >= length) {
+            return false;
+        }
+
+        uint8_t event = trace[offset++];
+        uint32_t delta = 0;
+        for (int shift = 0;; shift += 7) {
+            if (offset >= length || shift > 28) {
+                return false;
+            }
+            uint8_t b = trace[offset++];
+            delta |= (uint32_t)(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) {
+                break;
+            }
+        }
+
+        bool noData = (event & ONEWIRE_TRACE_FLAG_NO_DATA) != 0;
+        if (offset + (noData ? 1 : 2) > length) {
+            return false;
+        }
+        uint8_t sent = trace[offset++];
+        uint8_t received = noData ? 0 : trace[offset++];
+
+        nowMicro += delta;
+        int entryBus = (event & ONEWIRE_TRACE_BUS_MASK) >> ONEWIRE_TRACE_BUS_SHIFT;
+        OneWireTraceEvent kind = (OneWireTraceEvent)(event & ONEWIRE_TRACE_EVENT_MASK);
+        if (kind > OneWireTraceEvent_PullupSlot) {
+            return false;
+        }
+        if (entryBus != bus) {
+            continue;
+        }
+
+        if (kind == OneWireTraceEvent_Reset) {
+            if (replayRecordCount == ONEWIRE_REPLAY_MAX_TRANSACTIONS) {
+                return false;
+            }
+            record = &replayRecords[replayRecordCount++];
+            *record = (OneWireReplayRecord){
+                .resetMicro = nowMicro,
+                .lastMicro = nowMicro,
+                .firstSlot = replaySlotCount,
+                .trace = traceIndex,
+                .resetSent = sent,
+                .resetReceived = noData ? -1 : received,
+                .overdrive = (event & ONEWIRE_TRACE_FLAG_OVERDRIVE) != 0,
+            };
+        } else if (record != NULL) {
+            if (replaySlotCount == ONEWIRE_REPLAY_MAX_SLOTS) {
+                return false;
+            }
+            replaySlots[replaySlotCount++] = (OneWireReplaySlot){
+                .deltaMicro = (uint32_t)(nowMicro - previousMicro),
+                .sentBit = sent == ONEWIRE_REPLAY_SLOT_ZERO ? 0 : 1,
+                .echo = received,
+                .noData = noData,
+            };
+            record->slotCount++;
+            record->lastMicro = nowMicro;
+        }
+        previousMicro = nowMicro;
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Returns the number of loaded transactions.
+/// </summary>
+/// <returns>The number of transactions.</returns>
+int OneWireReplayGetTransactionCount(void)
+{
+    return replayRecordCount;
+}
+
+/// <summary>
+/// Gets a loaded transaction.
+/// </summary>
+/// <param name="index">The index of the transaction (0 is the oldest.)</param>
+/// <param name="transaction">Receives the transaction.</param>
+/// <returns>true if the transaction exists, otherwise false.</returns>
+bool OneWireReplayGetTransaction(int index, OneWireReplayTransaction *transaction)
+{
+    if (index < 0 || index >= replayRecordCount) {
+        return false;
+    }
+
+    const OneWireReplayRecord *record = &replayRecords[index];
+    const OneWireReplaySlot *slots = &replaySlots[record->firstSlot];
+    *transaction = (OneWireReplayTransaction){
+        .reset = OneWireReplayDecodeReset(record),
+        .romCommand = -1,
+        .slotCount = record->slotCount,
+        .durationMicro = (long)(record->lastMicro - record->resetMicro),
+    };
+
+    if (index + 1 < replayRecordCount && replayRecords[index + 1].trace == record->trace) {
+        transaction->intervalMicro =
+            (long)(replayRecords[index + 1].resetMicro - record->resetMicro);
+    }
+
+    if (record->slotCount >= 8) {
+        transaction->romCommand = 0;
+        for (int i = 0; i < 8; i++) {
+            transaction->romCommand |= slots[i].sentBit << i;
+        }
+    }
+
+    for (int i = 0; i < record->slotCount; i++) {
+        if (slots[i].noData ||
+            (slots[i].sentBit == 0 && slots[i].echo != ONEWIRE_REPLAY_SLOT_ZERO)) {
+            transaction->failed = true;
+            break;
+        }
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Starts the replay again from the first loaded transaction, and clears the counters.
+/// </summary>
+void OneWireReplayRewind(void)
+{
+    replayNext = 0;
+    replayCandidate = -1;
+    replayPosition = 0;
+    replayReordered = false;
+    replayCounters = (OneWireReplayCounters){0};
+}
+
+/// <summary>
+/// Gets the operations answered since <see src="OneWireReplayRewind"/>.
+/// </summary>
+/// <param name="counters">Receives the counters.</param>
+void OneWireReplayGetCounters(OneWireReplayCounters *counters)
+{
+    *counters = replayCounters;
+}
+
+/// <summary>
+/// Returns the replay transport, to pass to <see src="OneWireSetTransport"/>.
+/// </summary>
+/// <returns>The transport.</returns>
+const OneWireTransport *OneWireReplayGetTransport(void)
+{
+    return &replayTransport;
+}
+
+/// <summary>
+/// Answers a reset pulse from the next recorded transaction.  Without a recorded transaction the
+/// bus has no devices.
+/// </summary>
+/// <returns>The recorded response.</returns>
+static OneWireResetResponse OneWireReplayReset(void)
+{
+    replayCounters.resets++;
+    replayCounters.transfers++;
+    replayPosition = 0;
+    replayReordered = false;
+    if (replayRecordCount == 0) {
+        replayCandidate = -1;
+        return NoDevices;
+    }
+
+    replayCandidate = replayNext % replayRecordCount;
+    replayNext = replayCandidate + 1;
+    return OneWireReplayDecodeReset(&replayRecords[replayCandidate]);
+}
+
+/// <summary>
+/// Answers time slots from the recorded transactions.  A slot that was not echoed, or a write 0
+/// slot that was not read back as 0, fails like it did on the UART transport.
+/// </summary>
+/// <param name="sendBits">The bits to send, least significant bit of the first byte first.</param>
+/// <param name="receiveBits">Receives the bits read back, or NULL.</param>
+/// <param name="bitCount">The number of bits.</param>
+/// <param name="enableStrongPullup">Not used: the pullup is not replayed.</param>
+/// <returns>true if the slots were answered without an error, otherwise false.</returns>
+static bool OneWireReplayTouchBits(const uint8_t *sendBits, uint8_t *receiveBits,
+                                   size_t bitCount, bool enableStrongPullup)
+{
+    replayCounters.transfers++;
+    for (size_t bit = 0; bit < bitCount; bit++) {
+        uint8_t sentBit = (sendBits[bit / 8] >> (bit % 8)) & 1;
+        const OneWireReplaySlot *slot = OneWireReplayFindSlot(replayPosition, sentBit);
+        replayPosition++;
+        replayCounters.slots++;
+
+        uint8_t echo = sentBit ? ONEWIRE_REPLAY_SLOT_ONE : ONEWIRE_REPLAY_SLOT_ZERO;
+        if (slot == NULL) {
+            replayCounters.unrecordedSlots++;
+        } else if (slot->noData) {
+            replayCounters.recordedMicro += slot->deltaMicro;
+            return false;
+        } else {
+            replayCounters.recordedMicro += slot->deltaMicro;
+            echo = slot->echo;
+        }
+
+        if (sentBit == 0 && echo != ONEWIRE_REPLAY_SLOT_ZERO) {
+            return false;
+        }
+
+        if (receiveBits != NULL) {
+            uint8_t mask = (uint8_t)(1 << (bit % 8));
+            if (echo == ONEWIRE_REPLAY_SLOT_ONE) {
+                receiveBits[bit / 8] |= mask;
+            } else {
+                receiveBits[bit / 8] &= (uint8_t)~mask;
+            }
+        }
+    }
+
+    return true;
+}
+
+/// <summary>
+/// The strong pullup is not replayed.
+/// </summary>
+static void OneWireReplayDisableStrongPullup(void) {}
+
+/// <summary>
+/// Accepts a change of speed.
+/// </summary>
+/// <param name="overdrive">true for overdrive speed, false for standard speed.</param>
+/// <returns>true.</returns>
+static bool OneWireReplaySetOverdrive(bool overdrive)
+{
+    return true;
+}
+
+/// <summary>
+/// Finds the recorded slot that answers a slot: the slot of the current transaction if it was
+/// sent the same bit, otherwise the slot of the first transaction after it that was sent the
+/// same bits since its reset pulse.
+/// </summary>
+/// <param name="position">The number of slots sent since the reset pulse.</param>
+/// <param name="sentBit">The bit sent.</param>
+/// <returns>The recorded slot, or NULL if no recorded transaction was sent the same bits.</returns>
+static const OneWireReplaySlot *OneWireReplayFindSlot(int position, uint8_t sentBit)
+{
+    bool inHistory = position < ONEWIRE_REPLAY_MAX_TRANSACTION_SLOTS;
+    if (inHistory) {
+        replayHistory[position] = sentBit;
+    }
+
+    if (replayCandidate >= 0) {
+        const OneWireReplayRecord *record = &replayRecords[replayCandidate];
+        if (position < record->slotCount &&
+            replaySlots[record->firstSlot + position].sentBit == sentBit) {
+            return &replaySlots[record->firstSlot + position];
+        }
+    } else if (position > 0) {
+        // An earlier slot of this transaction was not recorded, so neither is this one.
+        return NULL;
+    }
+
+    replayCandidate = -1;
+    if (!inHistory) {
+        return NULL;
+    }
+
+    for (int i = 0; i < replayRecordCount; i++) {
+        int index = (replayNext + i) % replayRecordCount;
+        if (OneWireReplayMatchesHistory(&replayRecords[index], position + 1)) {
+            replayCandidate = index;
+            replayNext = index + 1;
+            if (!replayReordered) {
+                replayReordered = true;
+                replayCounters.reorderedTransactions++;
+            }
+            return &replaySlots[replayRecords[index].firstSlot + position];
+        }
+    }
+
+    return NULL;
+}
+
+/// <summary>
+/// Checks whether a recorded transaction starts with the bits sent since the reset pulse.
+/// </summary>
+/// <param name="record">The recorded transaction.</param>
+/// <param name="length">The number of bits in replayHistory to compare.</param>
+/// <returns>true if the bits are the same, otherwise false.</returns>
+static bool OneWireReplayMatchesHistory(const OneWireReplayRecord *record, int length)
+{
+    if (record->slotCount < length) {
+        return false;
+    }
+
+    const OneWireReplaySlot *slots = &replaySlots[record->firstSlot];
+    for (int i = 0; i < length; i++) {
+        if (slots[i].sentBit != replayHistory[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Decodes a recorded reset pulse like the UART transport does.
+/// </summary>
+/// <param name="record">The recorded transaction.</param>
+/// <returns>The response to the reset pulse.</returns>
+static OneWireResetResponse OneWireReplayDecodeReset(const OneWireReplayRecord *record)
+{
+    uint8_t releasedMask = record->overdrive ? 0xFF : ONEWIRE_REPLAY_RESET_RELEASED_BIT;
+    if (record->resetReceived < 0) {
+        return NoData;
+    } else if ((record->resetReceived & releasedMask) == 0) {
+        return BusShorted;
+    } else if (record->resetReceived == record->resetSent) {
+        return NoDevices;
+    } else {
+        return DevicePresent;
+    }
+}
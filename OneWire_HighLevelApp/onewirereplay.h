@@ -0,0 +1,160 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "onewire.h"
+
+// The replay transport answers the OneWire operations from a trace recorded on a device (see
+// onewiretrace.h), so a search or read that was slow or failed in the field can be run again on
+// a host, through the same onewire.c, onewiresearch.c and ds18b20.c code.
+//
+// The trace is split into transactions (a reset pulse and the time slots up to the next reset.)
+// The devices answer each slot based only on the slots sent since the reset, so each slot is
+// answered from the next recorded transaction if it was sent the same slots; if it was not (the
+// code has changed, or runs the operations in a different order), it is answered from the first
+// recorded transaction after it that was.  Code that has not changed therefore gets exactly the
+// recorded answers, including any noise.  A slot that no recorded transaction was sent is
+// answered as an idle bus (a read slot reads 1) and counted as unrecorded.
+
+/// <summary>
+/// The maximum number of time slots in the loaded traces.
+/// </summary>
+#define ONEWIRE_REPLAY_MAX_SLOTS 1048576
+
+/// <summary>
+/// The maximum number of transactions in the loaded traces.
+/// </summary>
+#define ONEWIRE_REPLAY_MAX_TRANSACTIONS 65536
+
+/// <summary>
+/// The number of slots of each transaction that are compared with the recorded transactions;
+/// later slots are only answered from the same recorded transaction.
+/// </summary>
+#define ONEWIRE_REPLAY_MAX_TRANSACTION_SLOTS 4096
+
+/// <summary>
+/// A recorded transaction.
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// The response to the reset pulse.
+    /// </summary>
+    OneWireResetResponse reset;
+
+    /// <summary>
+    /// The ROM command (the first 8 slots), or -1 if the transaction has fewer slots.
+    /// </summary>
+    int romCommand;
+
+    /// <summary>
+    /// The number of time slots.
+    /// </summary>
+    int slotCount;
+
+    /// <summary>
+    /// The time from the reset pulse to the last slot, in microseconds.
+    /// </summary>
+    long durationMicro;
+
+    /// <summary>
+    /// The time from the reset pulse to the next reset pulse, in microseconds (0 for the last
+    /// transaction.)
+    /// </summary>
+    long intervalMicro;
+
+    /// <summary>
+    /// true if a slot was not echoed, or a write 0 slot was not read back as 0 (the UART
+    /// transport fails the transfer.)
+    /// </summary>
+    bool failed;
+} OneWireReplayTransaction;
+
+/// <summary>
+/// The operations answered by the replay transport since <see src="OneWireReplayRewind"/>.
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// The number of reset pulses.
+    /// </summary>
+    long resets;
+
+    /// <summary>
+    /// The number of time slots.
+    /// </summary>
+    long slots;
+
+    /// <summary>
+    /// The number of calls to the transport (on hardware, each call to the UART transport is at
+    /// least one UART write and one UART read.)
+    /// </summary>
+    long transfers;
+
+    /// <summary>
+    /// The number of slots that no recorded transaction was sent.
+    /// </summary>
+    long unrecordedSlots;
+
+    /// <summary>
+    /// The number of transactions answered (at least in part) from a recorded transaction other
+    /// than the next one.
+    /// </summary>
+    long reorderedTransactions;
+
+    /// <summary>
+    /// The time the answered slots took when they were recorded, in microseconds.
+    /// </summary>
+    long recordedMicro;
+} OneWireReplayCounters;
+
+/// <summary>
+/// Removes the loaded traces.
+/// </summary>
+void OneWireReplayClear(void);
+
+/// <summary>
+/// Adds the transactions of a bus from an encoded trace (see onewiretrace.h) to the loaded
+/// traces, and rewinds the replay.  The slots recorded before the first reset pulse of the trace
+/// are skipped.
+/// </summary>
+/// <param name="trace">The encoded trace.</param>
+/// <param name="length">The length of the trace in bytes.</param>
+/// <param name="bus">The bus to replay.</param>
+/// <returns>true if the trace was decoded, false if it is not a valid trace (the transactions
+/// decoded before the error are kept) or the loaded traces are full.</returns>
+bool OneWireReplayLoad(const uint8_t *trace, size_t length, int bus);
+
+/// <summary>
+/// Returns the number of loaded transactions.
+/// </summary>
+/// <returns>The number of transactions.</returns>
+int OneWireReplayGetTransactionCount(void);
+
+/// <summary>
+/// Gets a loaded transaction.
+/// </summary>
+/// <param name="index">The index of the transaction (0 is the oldest.)</param>
+/// <param name="transaction">Receives the transaction.</param>
+/// <returns>true if the transaction exists, otherwise false.</returns>
+bool OneWireReplayGetTransaction(int index, OneWireReplayTransaction *transaction);
+
+/// <summary>
+/// Starts the replay again from the first loaded transaction, and clears the counters.
+/// </summary>
+void OneWireReplayRewind(void);
+
+/// <summary>
+/// Gets the operations answered since <see src="OneWireReplayRewind"/>.
+/// </summary>
+/// <param name="counters">Receives the counters.</param>
+void OneWireReplayGetCounters(OneWireReplayCounters *counters);
+
+/// <summary>
+/// Returns the replay transport, to pass to <see src="OneWireSetTransport"/>.
+/// </summary>
+/// <returns>The transport.</returns>
+const OneWireTransport *OneWireReplayGetTransport(void);
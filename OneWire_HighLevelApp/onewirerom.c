@@ -31,14 +31,102 @@ void OneWireROMSetByte(int index, uint8_t data)
     OneWireROM[index] = data;
 }
 
+/// <summary>
+/// Returns the current OneWire ROM as a packed ROM identifier.
+/// </summary>
+/// <returns>The ROM identifier.</returns>
+OneWireRomId OneWireROMGet(void)
+{
+    return OneWireRomIdFromBytes(OneWireROM);
+}
+
+/// <summary>
+/// Sets the current OneWire ROM from a packed ROM identifier.
+/// </summary>
+/// <param name="rom">The ROM identifier.</param>
+void OneWireROMSet(OneWireRomId rom)
+{
+    OneWireRomIdToBytes(rom, OneWireROM);
+}
+
 /// <summary>
 /// Displays the current ROM information in the Log_Debug output.
 /// </summary>
 void OneWireDebugDumpROM(void)
+{
+    OneWireDebugDumpRomId(OneWireROMGet());
+}
+
+/// <summary>
+/// Returns the byte of the ROM identifier at the specified index.
+/// </summary>
+/// <param name="rom">The ROM identifier.</param>
+/// <param name="index">The index to read from (0 to 7).</param>
+/// <returns>The byte of the ROM identifier.</returns>
+uint8_t OneWireRomIdGetByte(OneWireRomId rom, int index)
+{
+    return (uint8_t)(rom >> (index * 8));
+}
+
+/// <summary>
+/// Returns the ROM identifier with the byte at the specified index replaced.
+/// </summary>
+/// <param name="rom">The ROM identifier.</param>
+/// <param name="index">The index to write to (0 to 7).</param>
+/// <param name="data">The byte of data to write.</param>
+/// <returns>The updated ROM identifier.</returns>
+OneWireRomId OneWireRomIdSetByte(OneWireRomId rom, int index, uint8_t data)
+{
+    rom &= ~((OneWireRomId)0xFF << (index * 8));
+    return rom | ((OneWireRomId)data << (index * 8));
+}
+
+/// <summary>
+/// Returns the family identifier (the first byte) of the ROM identifier.
+/// </summary>
+/// <param name="rom">The ROM identifier.</param>
+/// <returns>The family identifier.</returns>
+uint8_t OneWireRomIdGetFamily(OneWireRomId rom)
+{
+    return OneWireRomIdGetByte(rom, 0);
+}
+
+/// <summary>
+/// Copies the ROM identifier to 8 bytes, in the order they are sent on the OneWire bus.
+/// </summary>
+/// <param name="rom">The ROM identifier.</param>
+/// <param name="bytes">Receives the 8 bytes of the ROM identifier.</param>
+void OneWireRomIdToBytes(OneWireRomId rom, uint8_t *bytes)
+{
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = OneWireRomIdGetByte(rom, i);
+    }
+}
+
+/// <summary>
+/// Returns the ROM identifier for 8 bytes, in the order they are sent on the OneWire bus.
+/// </summary>
+/// <param name="bytes">The 8 bytes of the ROM identifier.</param>
+/// <returns>The ROM identifier.</returns>
+OneWireRomId OneWireRomIdFromBytes(const uint8_t *bytes)
+{
+    OneWireRomId rom = 0;
+    for (int i = 7; i >= 0; i--) {
+        rom = (rom << 8) | bytes[i];
+    }
+
+    return rom;
+}
+
+/// <summary>
+/// Displays the ROM identifier in the Log_Debug output.
+/// </summary>
+/// <param name="rom">The ROM identifier.</param>
+void OneWireDebugDumpRomId(OneWireRomId rom)
 {
     Log_Debug("ROM: ");
     for (int i = 0; i < 8; i++) {
-        Log_Debug("%02x ", OneWireROM[i]);
+        Log_Debug("%02x ", OneWireRomIdGetByte(rom, i));
     }
     Log_Debug("\n");
-}
\ No newline at end of file
+}
@@ -5,6 +5,13 @@
 
 #include <stdint.h>
 
+/// <summary>
+/// A OneWire ROM identifier packed into 64 bits.  Byte 0 (the family code) is the least
+/// significant byte, so bit n of the value is the nth bit sent on the OneWire bus.  Unlike the
+/// global OneWireROM, any number of these can be held (e.g. in an array of devices.)
+/// </summary>
+typedef uint64_t OneWireRomId;
+
 /// <summary>
 /// Returns the byte from the OneWire ROM at the specified index.
 /// </summary>
@@ -19,7 +26,63 @@ uint8_t OneWireROMGetByte(int index);
 /// <param name="data">The byte of data to write.</param>
 void OneWireROMSetByte(int index, uint8_t data);
 
+/// <summary>
+/// Returns the current OneWire ROM as a packed ROM identifier.
+/// </summary>
+/// <returns>The ROM identifier.</returns>
+OneWireRomId OneWireROMGet(void);
+
+/// <summary>
+/// Sets the current OneWire ROM from a packed ROM identifier.
+/// </summary>
+/// <param name="rom">The ROM identifier.</param>
+void OneWireROMSet(OneWireRomId rom);
+
 /// <summary>
 /// Displays the ROM information in the Log_Debug output.
 /// </summary>
-void OneWireDebugDumpROM(void);
\ No newline at end of file
+void OneWireDebugDumpROM(void);
+
+/// <summary>
+/// Returns the byte of the ROM identifier at the specified index.
+/// </summary>
+/// <param name="rom">The ROM identifier.</param>
+/// <param name="index">The index to read from (0 to 7).</param>
+/// <returns>The byte of the ROM identifier.</returns>
+uint8_t OneWireRomIdGetByte(OneWireRomId rom, int index);
+
+/// <summary>
+/// Returns the ROM identifier with the byte at the specified index replaced.
+/// </summary>
+/// <param name="rom">The ROM identifier.</param>
+/// <param name="index">The index to write to (0 to 7).</param>
+/// <param name="data">The byte of data to write.</param>
+/// <returns>The updated ROM identifier.</returns>
+OneWireRomId OneWireRomIdSetByte(OneWireRomId rom, int index, uint8_t data);
+
+/// <summary>
+/// Returns the family identifier (the first byte) of the ROM identifier.
+/// </summary>
+/// <param name="rom">The ROM identifier.</param>
+/// <returns>The family identifier.</returns>
+uint8_t OneWireRomIdGetFamily(OneWireRomId rom);
+
+/// <summary>
+/// Copies the ROM identifier to 8 bytes, in the order they are sent on the OneWire bus.
+/// </summary>
+/// <param name="rom">The ROM identifier.</param>
+/// <param name="bytes">Receives the 8 bytes of the ROM identifier.</param>
+void OneWireRomIdToBytes(OneWireRomId rom, uint8_t *bytes);
+
+/// <summary>
+/// Returns the ROM identifier for 8 bytes, in the order they are sent on the OneWire bus.
+/// </summary>
+/// <param name="bytes">The 8 bytes of the ROM identifier.</param>
+/// <returns>The ROM identifier.</returns>
+OneWireRomId OneWireRomIdFromBytes(const uint8_t *bytes);
+
+/// <summary>
+/// Displays the ROM identifier in the Log_Debug output.
+/// </summary>
+/// <param name="rom">The ROM identifier.</param>
+void OneWireDebugDumpRomId(OneWireRomId rom);
@@ -0,0 +1,286 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "onewirescheduler.h"
+#include "eventloop_timer_utilities.h"
+#include "onewire.h"
+#include "sleep.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "applibs_versions.h"
+#include <applibs/log.h>
+
+/// <summary>
+/// The states of the convert and read cycle of a group.
+/// </summary>
+typedef enum {
+    OneWireSchedulerState_Waiting = 0,
+    OneWireSchedulerState_Converting = 1,
+} OneWireSchedulerState;
+
+/// <summary>
+/// The convert and read cycle of one group of devices.  The next step of the cycle is due
+/// delayMicro after stepTime.
+/// </summary>
+typedef struct {
+    OneWireSchedulerState state;
+    struct timespec cycleStart;
+    struct timespec stepTime;
+    long delayMicro;
+} OneWireSchedulerGroup;
+
+/// <summary>
+/// The convert and read cycles of the groups on one bus.
+/// </summary>
+typedef struct {
+    EventLoopTimer *timer;
+    OneWireSchedulerGroup groups[ONEWIRE_SCHEDULER_MAX_GROUPS];
+
+    /// <summary>
+    /// The group whose conversion holds the bus until it is read, or -1.
+    /// </summary>
+    int holdingGroup;
+} OneWireSchedulerBus;
+
+static void OneWireSchedulerTimerEventHandler(EventLoopTimer *timer);
+static void OneWireSchedulerRunStep(int bus, int group);
+static int OneWireSchedulerGetNextGroup(const OneWireSchedulerBus *schedulerBus,
+                                        long *remainingMicro);
+static bool OneWireSchedulerArm(OneWireSchedulerBus *schedulerBus, long delayMicro);
+
+/// <summary>
+/// The cycles of each bus.
+/// </summary>
+static OneWireSchedulerBus schedulerBuses[ONEWIRE_MAX_BUSES];
+
+/// <summary>
+/// The number of entries in schedulerBuses.
+/// </summary>
+static int schedulerBusCount = 0;
+
+/// <summary>
+/// The number of groups on each bus.
+/// </summary>
+static int schedulerGroupCount = 1;
+
+/// <summary>
+/// How often (in microseconds) each group is converted and read.
+/// </summary>
+static long schedulerPeriodMicro = 0;
+
+/// <summary>
+/// Called to start a conversion on a bus.
+/// </summary>
+static OneWireSchedulerStartHandler schedulerStartHandler = NULL;
+
+/// <summary>
+/// Called to read the results from a bus.
+/// </summary>
+static OneWireSchedulerReadHandler schedulerReadHandler = NULL;
+
+/// <summary>
+/// Called if the scheduler stops because of an error.
+/// </summary>
+static OneWireSchedulerFailureHandler schedulerFailureHandler = NULL;
+
+/// <summary>
+/// Starts a convert and read cycle for each group of devices on every OneWire bus, repeating
+/// every period (or when the read handler asks for the next cycle.)  The cycles of the buses and
+/// groups are staggered across the period, so while one bus (or group) is converting the others
+/// can be read.  Each bus has its own event loop timer, so the event loop keeps running during
+/// the conversions, and the cycles of the groups on a bus never use the bus at the same time.
+/// </summary>
+/// <param name="eventLoop">Event loop to which the timers will be added.</param>
+/// <param name="period">How often each group is converted and read.</param>
+/// <param name="groupCount">The number of groups on each bus (1 to
+/// ONEWIRE_SCHEDULER_MAX_GROUPS.)</param>
+/// <param name="startHandler">Called to start a conversion on a bus.</param>
+/// <param name="readHandler">Called to read the results from a bus.</param>
+/// <param name="failureHandler">Called if the scheduler stops because of an error.</param>
+/// <returns>true if the scheduler was started, otherwise false.</returns>
+bool OneWireSchedulerInit(EventLoop *eventLoop, const struct timespec *period, int groupCount,
+                          OneWireSchedulerStartHandler startHandler,
+                          OneWireSchedulerReadHandler readHandler,
+                          OneWireSchedulerFailureHandler failureHandler)
+{
+    if (groupCount < 1 || groupCount > ONEWIRE_SCHEDULER_MAX_GROUPS) {
+        Log_Debug("PROGRAM ERROR: %d conversion groups are not supported.\n", groupCount);
+        return false;
+    }
+
+    schedulerPeriodMicro = period->tv_sec * 1000000L + period->tv_nsec / 1000L;
+    schedulerGroupCount = groupCount;
+    schedulerStartHandler = startHandler;
+    schedulerReadHandler = readHandler;
+    schedulerFailureHandler = failureHandler;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    schedulerBusCount = OneWireGetBusCount();
+    int cycleCount = schedulerBusCount * schedulerGroupCount;
+    for (int bus = 0; bus < schedulerBusCount; bus++) {
+        OneWireSchedulerBus *schedulerBus = &schedulerBuses[bus];
+        schedulerBus->holdingGroup = -1;
+        schedulerBus->timer =
+            CreateEventLoopDisarmedTimer(eventLoop, OneWireSchedulerTimerEventHandler);
+        if (schedulerBus->timer == NULL) {
+            return false;
+        }
+
+        // Spread the start of each cycle evenly across the period; the groups of a bus are
+        // interleaved with the other buses, so each bus has the most time between its groups.
+        for (int group = 0; group < schedulerGroupCount; group++) {
+            OneWireSchedulerGroup *schedulerGroup = &schedulerBus->groups[group];
+            schedulerGroup->state = OneWireSchedulerState_Waiting;
+            schedulerGroup->stepTime = now;
+            schedulerGroup->delayMicro =
+                schedulerPeriodMicro * (group * schedulerBusCount + bus) / cycleCount;
+        }
+
+        if (!OneWireSchedulerArm(schedulerBus, schedulerBus->groups[0].delayMicro)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Stops the scheduler and disposes of its timers.
+/// </summary>
+void OneWireSchedulerClose(void)
+{
+    for (int bus = 0; bus < schedulerBusCount; bus++) {
+        DisposeEventLoopTimer(schedulerBuses[bus].timer);
+        schedulerBuses[bus].timer = NULL;
+    }
+
+    schedulerBusCount = 0;
+}
+
+/// <summary>
+/// Runs the steps of the cycles that are due on the bus that owns the timer.
+/// </summary>
+/// <param name="timer">The timer that invoked the handler.</param>
+static void OneWireSchedulerTimerEventHandler(EventLoopTimer *timer)
+{
+    int bus = 0;
+    while (bus < schedulerBusCount && schedulerBuses[bus].timer != timer) {
+        bus++;
+    }
+
+    if (bus == schedulerBusCount || ConsumeEventLoopTimerEvent(timer) != 0) {
+        schedulerFailureHandler();
+        return;
+    }
+
+    OneWireSchedulerBus *schedulerBus = &schedulerBuses[bus];
+    OneWireSelectBus(bus);
+
+    // Each step schedules the next step of its cycle at least 1 millisecond later, so this only
+    // runs the steps that are already due.
+    long remainingMicro;
+    int group = OneWireSchedulerGetNextGroup(schedulerBus, &remainingMicro);
+    while (remainingMicro <= 0) {
+        OneWireSchedulerRunStep(bus, group);
+        group = OneWireSchedulerGetNextGroup(schedulerBus, &remainingMicro);
+    }
+
+    if (!OneWireSchedulerArm(schedulerBus, remainingMicro)) {
+        schedulerFailureHandler();
+    }
+}
+
+/// <summary>
+/// Starts or reads the conversion of a group, and schedules the next step of its cycle.
+/// </summary>
+/// <param name="bus">The bus number (the bus is already selected).</param>
+/// <param name="group">The group number.</param>
+static void OneWireSchedulerRunStep(int bus, int group)
+{
+    OneWireSchedulerBus *schedulerBus = &schedulerBuses[bus];
+    OneWireSchedulerGroup *schedulerGroup = &schedulerBus->groups[group];
+
+    long delayMicro;
+    if (schedulerGroup->state == OneWireSchedulerState_Waiting) {
+        clock_gettime(CLOCK_MONOTONIC, &schedulerGroup->cycleStart);
+        bool holdsBus = false;
+        int conversionMilli = schedulerStartHandler(bus, group, &holdsBus);
+        if (conversionMilli >= 0) {
+            // The group is in use until it is read; the bus as well if it is powered by the
+            // strong pullup.
+            schedulerGroup->state = OneWireSchedulerState_Converting;
+            schedulerBus->holdingGroup = holdsBus ? group : -1;
+            delayMicro = conversionMilli * 1000L;
+        } else {
+            Log_Debug("WARN: Could not start conversion on bus %d.\n", bus);
+            delayMicro = schedulerPeriodMicro;
+        }
+    } else {
+        OneWireDisableStrongPullup();
+        int nextMilli = schedulerReadHandler(bus, group);
+        schedulerGroup->state = OneWireSchedulerState_Waiting;
+        schedulerBus->holdingGroup = -1;
+
+        // Start the next cycle when the read handler asked for it, otherwise one period after
+        // this cycle started.
+        if (nextMilli >= 0) {
+            delayMicro = nextMilli * 1000L;
+        } else {
+            delayMicro = schedulerPeriodMicro - ElapsedMicro(&schedulerGroup->cycleStart);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &schedulerGroup->stepTime);
+    schedulerGroup->delayMicro = delayMicro < 1000 ? 1000 : delayMicro;
+}
+
+/// <summary>
+/// Finds the group whose next step is due first.  While a conversion holds the bus, only that
+/// group can run; the steps of the other groups that fall due are run once it is read.
+/// </summary>
+/// <param name="schedulerBus">The bus.</param>
+/// <param name="remainingMicro">Receives the time until the step is due (0 or less if it is
+/// due.)</param>
+/// <returns>The group number.</returns>
+static int OneWireSchedulerGetNextGroup(const OneWireSchedulerBus *schedulerBus,
+                                        long *remainingMicro)
+{
+    int next = -1;
+    *remainingMicro = 0;
+    for (int group = 0; group < schedulerGroupCount; group++) {
+        if (schedulerBus->holdingGroup >= 0 && group != schedulerBus->holdingGroup) {
+            continue;
+        }
+
+        const OneWireSchedulerGroup *schedulerGroup = &schedulerBus->groups[group];
+        long remaining = schedulerGroup->delayMicro - ElapsedMicro(&schedulerGroup->stepTime);
+        if (next < 0 || remaining < *remainingMicro) {
+            next = group;
+            *remainingMicro = remaining;
+        }
+    }
+
+    return next;
+}
+
+/// <summary>
+/// Arms the timer of a bus.
+/// </summary>
+/// <param name="schedulerBus">The bus to arm the timer for.</param>
+/// <param name="delayMicro">The time until the timer fires.</param>
+/// <returns>true if the timer was armed, otherwise false.</returns>
+static bool OneWireSchedulerArm(OneWireSchedulerBus *schedulerBus, long delayMicro)
+{
+    // A zero delay would disarm the timer, so always wait at least 1 millisecond.
+    if (delayMicro < 1000) {
+        delayMicro = 1000;
+    }
+
+    struct timespec delay = {.tv_sec = delayMicro / 1000000L,
+                             .tv_nsec = (delayMicro % 1000000L) * 1000L};
+    return SetEventLoopTimerOneShot(schedulerBus->timer, &delay) == 0;
+}
@@ -0,0 +1,69 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <time.h>
+
+#include <applibs/eventloop.h>
+
+/// <summary>
+/// The maximum number of conversion groups on each bus.
+/// </summary>
+#define ONEWIRE_SCHEDULER_MAX_GROUPS 8
+
+/// <summary>
+/// Applications implement a function with this signature to start a conversion of a group of
+/// devices on a bus.  The bus is already selected when the function is called.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <param name="group">The group number.</param>
+/// <param name="holdsBus">Set to true if the bus cannot be used until the conversion is read
+/// (e.g. it runs on the strong pullup), so the other groups on the bus wait; it is false when the
+/// function is called.</param>
+/// <returns>The time in milliseconds until the results can be read, or -1 if the conversion
+/// could not be started.</returns>
+typedef int (*OneWireSchedulerStartHandler)(int bus, int group, bool *holdsBus);
+
+/// <summary>
+/// Applications implement a function with this signature to read the results of a conversion
+/// of a group of devices on a bus.  The bus is already selected (and the strong pullup disabled)
+/// when the function is called.
+/// </summary>
+/// <param name="bus">The bus number.</param>
+/// <param name="group">The group number.</param>
+/// <returns>The time in milliseconds until the next conversion of the group should start, or -1
+/// to start it one period after this conversion started.</returns>
+typedef int (*OneWireSchedulerReadHandler)(int bus, int group);
+
+/// <summary>
+/// Applications implement a function with this signature to be notified when the scheduler
+/// can no longer run (e.g. a timer could not be consumed or armed.)
+/// </summary>
+typedef void (*OneWireSchedulerFailureHandler)(void);
+
+/// <summary>
+/// Starts a convert and read cycle for each group of devices on every OneWire bus, repeating
+/// every period (or when the read handler asks for the next cycle.)  The cycles of the buses and
+/// groups are staggered across the period, so while one bus (or group) is converting the others
+/// can be read.  Each bus has its own event loop timer, so the event loop keeps running during
+/// the conversions, and the cycles of the groups on a bus never use the bus at the same time.
+/// </summary>
+/// <param name="eventLoop">Event loop to which the timers will be added.</param>
+/// <param name="period">How often each group is converted and read.</param>
+/// <param name="groupCount">The number of groups on each bus (1 to
+/// ONEWIRE_SCHEDULER_MAX_GROUPS.)</param>
+/// <param name="startHandler">Called to start a conversion on a bus.</param>
+/// <param name="readHandler">Called to read the results from a bus.</param>
+/// <param name="failureHandler">Called if the scheduler stops because of an error.</param>
+/// <returns>true if the scheduler was started, otherwise false.</returns>
+bool OneWireSchedulerInit(EventLoop *eventLoop, const struct timespec *period, int groupCount,
+                          OneWireSchedulerStartHandler startHandler,
+                          OneWireSchedulerReadHandler readHandler,
+                          OneWireSchedulerFailureHandler failureHandler);
+
+/// <summary>
+/// Stops the scheduler and disposes of its timers.
+/// </summary>
+void OneWireSchedulerClose(void);
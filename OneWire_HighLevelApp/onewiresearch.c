@@ -17,26 +17,56 @@ used except as stated in the Dallas Semiconductor Branding Policy.
 #include "onewire.h"
 #include "onewirerom.h"
 #include "onewiresearch.h"
+#include "onewirestats.h"
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
+#include <time.h>
 
-// Flags used by the OneWireSearchROM routine.
-static uint8_t OneWireLastDeviceFlag = 0;
-static uint8_t OneWireLastDiscrepancy = 0;
-static uint8_t OneWireLastFamilyDiscrepancy = 0;
+#include "applibs_versions.h"
+#include <applibs/log.h>
+
+/// <summary>
+/// The number of bits in a ROM identifier.
+/// </summary>
+#define ONEWIRE_SEARCH_ROM_BITS 64
+
+/// <summary>
+/// The branches of the ROM tree still to be explored by OneWireSearchAll.  Each branch is the
+/// first length bits of a ROM identifier.  A pass only adds branches that are longer than the
+/// branch it explores, so the lengths on the stack are always increasing and there are at most
+/// ONEWIRE_SEARCH_ROM_BITS + 1 branches.
+/// </summary>
+typedef struct {
+    OneWireRomId path[ONEWIRE_SEARCH_ROM_BITS + 1];
+    uint8_t length[ONEWIRE_SEARCH_ROM_BITS + 1];
+    int count;
+} OneWireSearchBranches;
+
+// The search context used by the OneWireSearchROM routine.  The rom is kept in sync with the
+// global OneWireROM.
+static OneWireSearchContext OneWireDefaultSearch;
+
+static bool OneWireSearchPass(OneWireRomId path, int length, bool alarmSearch,
+                              const OneWireRomId *knownRoms, int knownCount,
+                              OneWireSearchBranches *branches, OneWireRomId *rom, long *slotCount,
+                              bool *failed);
+static int OneWireSearchPredict(OneWireRomId path, int length, const OneWireRomId *knownRoms,
+                                int knownCount, OneWireRomId *predicted);
+static void OneWireSearchPushBranch(OneWireSearchBranches *branches, OneWireRomId path,
+                                    int length);
+static OneWireRomId OneWireSearchMask(int bitCount);
+static int OneWireSearchGetSlot(const uint8_t *slots, int index);
+static void OneWireSearchSetSlot(uint8_t *slots, int index, int value);
 
 /// <summary>
 /// Resets the OneWireSearchROM data to search for all devices on the OneWire bus.
 /// </summary>
 void OneWireResetSearch(void)
 {
-    OneWireLastDeviceFlag = 0;
-    OneWireLastDiscrepancy = 0;
-    OneWireLastFamilyDiscrepancy = 0;
-    for (int i = 0; i < 8; i++) {
-        OneWireROMSetByte(i, 0);
-    }
+    OneWireSearchContextReset(&OneWireDefaultSearch);
+    OneWireROMSet(OneWireDefaultSearch.rom);
 }
 
 /// <summary>
@@ -46,10 +76,8 @@ void OneWireResetSearch(void)
 /// <param name="familyId">The family identifier (first 8 bits of the ROM ID).</param>
 void OneWireTargetSetup(uint8_t familyId)
 {
-    OneWireResetSearch();
-    OneWireROMSetByte(0, familyId);
-    // Set this to 0x40 per "Target Setup" section of Table 4 in application note 187.
-    OneWireLastDiscrepancy = 0x40;
+    OneWireSearchContextTargetSetup(&OneWireDefaultSearch, familyId);
+    OneWireROMSet(OneWireDefaultSearch.rom);
 }
 
 /// <summary>
@@ -58,41 +86,7 @@ void OneWireTargetSetup(uint8_t familyId)
 /// <returns>true if the device responsed, false otherwise.</returns>
 bool OneWireVerifyROM(void)
 {
-    // Save the previous state, so we can restore after verification.
-    uint8_t lastDeviceFlag = OneWireLastDeviceFlag;
-    uint8_t lastDiscrepancy = OneWireLastDiscrepancy;
-    uint8_t lastFamilyDiscrepancy = OneWireLastFamilyDiscrepancy;
-    uint8_t rom[8];
-    for (int i = 0; i < 8; i++) {
-        rom[i] = OneWireROMGetByte(i);
-    }
-
-    // Set this to 0x40 and 0x0 per "Verify" section of Table 4 in application note 187.
-    OneWireLastDiscrepancy = 0x40;
-    OneWireLastDeviceFlag = 0;
-
-    // NOTE: Table 4 says to set this to 0, but the "Verify" paragraph in application note 187 
-    // does not mention changing this flag.
-    OneWireLastFamilyDiscrepancy = 0; 
-
-    // Searching should return the same OneWireROM value.
-    bool isVerified = OneWireSearchROM(false);
-
-    // Restore the OneWireROM to the previous value before the search.  If it is not already the 
-    // same value set isVerified to false.
-    for (int i = 0; i < 8; i++) {
-        if (rom[i] != OneWireROMGetByte(i)) {
-            isVerified = false;
-            OneWireROMSetByte(i, rom[i]);
-        }
-    }
-
-    // Restore the flags to the previous values before the search.
-    OneWireLastDeviceFlag = lastDeviceFlag;
-    OneWireLastDiscrepancy = lastDiscrepancy;
-    OneWireLastFamilyDiscrepancy = lastFamilyDiscrepancy;
-
-    return isVerified;
+    return OneWireVerifyRomId(OneWireROMGet());
 }
 
 /// <summary>
@@ -108,46 +102,127 @@ bool OneWireVerifyROM(void)
 /// true if a matching OneWire device was found, false if no device found.
 /// </returns>
 bool OneWireSearchROM(bool alarmSearch)
+{
+    // The OneWireROM holds the search state between calls, so callers can change it.
+    OneWireDefaultSearch.rom = OneWireROMGet();
+    bool found = OneWireSearchNext(&OneWireDefaultSearch, alarmSearch);
+    OneWireROMSet(OneWireDefaultSearch.rom);
+    return found;
+}
+
+/// <summary>
+/// Resets the search context to search for all devices on the OneWire bus.
+/// </summary>
+/// <param name="context">The search context.</param>
+void OneWireSearchContextReset(OneWireSearchContext *context)
+{
+    context->rom = 0;
+    context->lastDeviceFlag = false;
+    context->lastDiscrepancy = 0;
+    context->lastFamilyDiscrepancy = 0;
+    context->error = false;
+}
+
+/// <summary>
+/// Resets the search context to search for all devices on the OneWire bus matching the
+/// specified family identifier.
+/// </summary>
+/// <param name="context">The search context.</param>
+/// <param name="familyId">The family identifier (first 8 bits of the ROM ID).</param>
+void OneWireSearchContextTargetSetup(OneWireSearchContext *context, uint8_t familyId)
+{
+    OneWireSearchContextReset(context);
+    context->rom = OneWireRomIdSetByte(context->rom, 0, familyId);
+    // Set this to 0x40 per "Target Setup" section of Table 4 in application note 187.
+    context->lastDiscrepancy = 0x40;
+}
+
+/// <summary>
+/// Verifies the device with the ROM identifier is responding on the OneWire bus.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>true if the device responsed, false otherwise.</returns>
+bool OneWireVerifyRomId(OneWireRomId rom)
+{
+    // Set this to 0x40 and 0x0 per "Verify" section of Table 4 in application note 187.
+    // NOTE: Table 4 says to set LastFamilyDiscrepancy to 0, but the "Verify" paragraph in
+    // application note 187 does not mention changing this flag.
+    OneWireSearchContext context = {.rom = rom,
+                                    .lastDiscrepancy = 0x40,
+                                    .lastFamilyDiscrepancy = 0,
+                                    .lastDeviceFlag = false,
+                                    .error = false};
+
+    // Searching should return the same ROM value.
+    return OneWireSearchNext(&context, false) && context.rom == rom;
+}
+
+/// <summary>
+/// Modified from https://www.maximintegrated.com/en/design/technical-documents/app-notes/1/187.html
+/// --
+/// Searches for the next OneWire device and sets context->rom to the matching device ROM
+/// identifier.
+/// </summary>
+/// <param name="context">The search context.</param>
+/// <param name="alarmSearch">
+/// When set to true, then search will be for devices in the alarm state only.  False will return
+/// all devices.
+/// </param>
+/// <returns>
+/// true if a matching OneWire device was found, false if no device found (context->error is
+/// set if the search failed.)
+/// </returns>
+bool OneWireSearchNext(OneWireSearchContext *context, bool alarmSearch)
 {
     uint8_t id_bit_number;
     int last_zero, rom_byte_number, search_result;
     int id_bit, cmp_id_bit;
-    uint8_t rom_byte_mask, search_direction;
+    uint8_t search_direction;
+    OneWireRomId rom_bit_mask;
+    uint8_t crc8;
 
     // initialize for search
     id_bit_number = 1;
     last_zero = 0;
     rom_byte_number = 0;
-    rom_byte_mask = 1;
+    rom_bit_mask = 1;
     search_result = 0;
-    ClearCrc8();
+    crc8 = 0;
+
+    struct timespec start;
+    OneWireStatsStart(&start);
+    context->error = false;
 
     // if the last call was not the last one
-    if (!OneWireLastDeviceFlag) {
-        // 1-Wire reset
-        if (OneWireReset() != DevicePresent) {
+    if (!context->lastDeviceFlag) {
+        // 1-Wire reset, then issue the search command
+        if (OneWireReset() != DevicePresent || !OneWireSendByte(alarmSearch ? 0xEC : 0xF0)) {
             // reset the search
-            OneWireLastDiscrepancy = 0;
-            OneWireLastDeviceFlag = 0;
-            OneWireLastFamilyDiscrepancy = 0;
+            context->lastDiscrepancy = 0;
+            context->lastDeviceFlag = false;
+            context->lastFamilyDiscrepancy = 0;
+            context->error = true;
+            OneWireStatsRecord(OneWireStatsOperation_Search, &start, false);
             return false;
         }
 
-        // issue the search command
-        OneWireSendByte(alarmSearch ? 0xEC : 0xF0);
-
         // loop to do the search
         do {
             // read a bit and its complement
             id_bit = OneWireReadBit();
             cmp_id_bit = OneWireReadBit();
 
-            if (id_bit == -1 || cmp_id_bit == -1)
+            if (id_bit == -1 || cmp_id_bit == -1) {
+                context->error = true;
                 break;
+            }
 
-            // check for no devices on 1-wire
-            if ((id_bit == 1) && (cmp_id_bit == 1))
+            // check for no devices on 1-wire; a device that stops responding part way through
+            // the ROM is a failed search
+            if ((id_bit == 1) && (cmp_id_bit == 1)) {
+                context->error = id_bit_number > 1;
                 break;
+            }
             else {
                 // all devices coupled have 0 or 1
                 if (id_bit != cmp_id_bit)
@@ -155,11 +230,11 @@ bool OneWireSearchROM(bool alarmSearch)
                 else {
                     // if this discrepancy if before the Last Discrepancy
                     // on a previous next then pick the same as last time
-                    if (id_bit_number < OneWireLastDiscrepancy)
-                        search_direction = ((OneWireROMGetByte(rom_byte_number) & rom_byte_mask) > 0);
+                    if (id_bit_number < context->lastDiscrepancy)
+                        search_direction = ((context->rom & rom_bit_mask) != 0);
                     else
                         // if equal to last pick 1, if not then pick 0
-                        search_direction = (id_bit_number == OneWireLastDiscrepancy);
+                        search_direction = (id_bit_number == context->lastDiscrepancy);
 
                     // if 0 was picked then record its position in LastZero
                     if (search_direction == 0) {
@@ -167,57 +242,362 @@ bool OneWireSearchROM(bool alarmSearch)
 
                         // check for Last discrepancy in family
                         if (last_zero < 9)
-                            OneWireLastFamilyDiscrepancy = last_zero;
+                            context->lastFamilyDiscrepancy = last_zero;
                     }
                 }
 
-                // set or clear the bit in the ROM byte rom_byte_number
-                // with mask rom_byte_mask
+                // set or clear the bit in the ROM with mask rom_bit_mask
                 if (search_direction == 1)
-                    OneWireROMSetByte(rom_byte_number,
-                                      OneWireROMGetByte(rom_byte_number) | rom_byte_mask);
+                    context->rom |= rom_bit_mask;
                 else
-                    OneWireROMSetByte(rom_byte_number,
-                                      OneWireROMGetByte(rom_byte_number) & ~rom_byte_mask);
+                    context->rom &= ~rom_bit_mask;
 
                 // serial number search direction write bit
-                if (!OneWireWriteBit(search_direction, false))
+                if (!OneWireWriteBit(search_direction, false)) {
+                    context->error = true;
                     break;
+                }
 
                 // increment the byte counter id_bit_number
-                // and shift the mask rom_byte_mask
+                // and shift the mask rom_bit_mask
                 id_bit_number++;
-                rom_byte_mask <<= 1;
+                rom_bit_mask <<= 1;
 
-                // if the mask is 0 then go to new SerialNum byte rom_byte_number and reset mask
-                if (rom_byte_mask == 0) {
-                    DoCrc8(OneWireROMGetByte(rom_byte_number)); // accumulate the CRC
+                // if a whole byte is complete then go to the next SerialNum byte rom_byte_number
+                if ((id_bit_number - 1) % 8 == 0) {
+                    uint8_t rom_byte = OneWireRomIdGetByte(context->rom, rom_byte_number);
+                    crc8 = Crc8Compute(&rom_byte, 1, crc8); // accumulate the CRC
                     rom_byte_number++;
-                    rom_byte_mask = 1;
                 }
             }
         } while (rom_byte_number < 8); // loop until through all ROM bytes 0-7
 
         // if the search was successful then
-        if (!((id_bit_number < 65) || (GetCrc8() != 0))) {
+        if (!((id_bit_number < 65) || (crc8 != 0))) {
             // search successful so set LastDiscrepancy,LastDeviceFlag,search_result
-            OneWireLastDiscrepancy = last_zero;
+            context->lastDiscrepancy = last_zero;
 
             // check for last device
-            if (OneWireLastDiscrepancy == 0)
-                OneWireLastDeviceFlag = 1;
+            if (context->lastDiscrepancy == 0)
+                context->lastDeviceFlag = true;
 
             search_result = true;
+        } else if (id_bit_number == 65) {
+            OneWireStatsAddCrcFailure();
+            context->error = true;
         }
     }
 
+    // A ROM of 0 passes the CRC check, but is read when the bus is held low.
+    if (search_result && !OneWireRomIdGetFamily(context->rom)) {
+        context->error = true;
+    }
+
     // if no device found then reset counters so next 'search' will be like a first
-    if (!search_result || !OneWireROMGetByte(0)) {
-        OneWireLastDiscrepancy = 0;
-        OneWireLastDeviceFlag = 0;
-        OneWireLastFamilyDiscrepancy = 0;
+    if (!search_result || !OneWireRomIdGetFamily(context->rom)) {
+        context->lastDiscrepancy = 0;
+        context->lastDeviceFlag = false;
+        context->lastFamilyDiscrepancy = 0;
         search_result = false;
     }
 
+    OneWireStatsRecord(OneWireStatsOperation_Search, &start, search_result);
     return search_result;
-}
\ No newline at end of file
+}
+
+/// <summary>
+/// Finds every device on the OneWire bus in a single call.  Like <see src="OneWireSearchNext"/>
+/// each pass starts with a reset and walks all 64 bits of the ROM tree (the protocol has no way
+/// to resume part way down the tree), but the bits of each pass that are already known are sent
+/// in a single transfer instead of one bit at a time:
+/// - the bits leading to the branch point the pass explores (found by an earlier pass); and
+/// - the bits of the devices in knownRoms (e.g. from the previous search.)
+/// The bits read back are still checked, so a branch that is no longer on the bus is dropped and
+/// a new branch (a device that was added) is explored bit by bit.
+/// </summary>
+/// <param name="familyId">The family identifier of the devices to find, or 0 for all
+/// devices.</param>
+/// <param name="alarmSearch">true to only find devices in the alarm state.</param>
+/// <param name="knownRoms">The devices found by a previous search, or NULL.</param>
+/// <param name="knownCount">The number of devices in knownRoms.</param>
+/// <param name="roms">Receives the ROM identifiers of the devices found.</param>
+/// <param name="maxCount">The maximum number of devices to find.</param>
+/// <param name="slotCount">Receives the number of time slots used (not counting the reset
+/// pulses), or NULL.</param>
+/// <returns>The number of devices found, or -1 if a pass failed (a transfer error or a CRC
+/// failure), in which case roms may hold only some of the devices.</returns>
+int OneWireSearchAll(uint8_t familyId, bool alarmSearch, const OneWireRomId *knownRoms,
+                     int knownCount, OneWireRomId *roms, int maxCount, long *slotCount)
+{
+    OneWireSearchBranches branches = {.count = 0};
+    OneWireSearchPushBranch(&branches, familyId, familyId != 0 ? 8 : 0);
+
+    long slots = 0;
+    int found = 0;
+    while (branches.count > 0 && found < maxCount) {
+        branches.count--;
+        OneWireRomId path = branches.path[branches.count];
+        int length = branches.length[branches.count];
+
+        struct timespec start;
+        OneWireStatsStart(&start);
+        OneWireRomId rom;
+        bool failed = false;
+        bool status = OneWireSearchPass(path, length, alarmSearch, knownRoms, knownCount,
+                                        &branches, &rom, &slots, &failed);
+        OneWireStatsRecord(OneWireStatsOperation_Search, &start, status);
+        if (failed) {
+            // The branches the pass would have found are unknown, so the devices found so far
+            // are not every device on the bus.
+            found = -1;
+            break;
+        }
+        if (status) {
+            roms[found++] = rom;
+        }
+    }
+
+    if (slotCount != NULL) {
+        *slotCount = slots;
+    }
+
+    return found;
+}
+
+/// <summary>
+/// Walks the ROM tree from the root to a device, taking the bits of path for the first length
+/// bits.  Every branch point found after that is added to the branches, and the 0 branch is
+/// taken.
+/// </summary>
+/// <param name="path">The bits of the branch to explore.</param>
+/// <param name="length">The number of bits of path to take.</param>
+/// <param name="alarmSearch">true to only find devices in the alarm state.</param>
+/// <param name="knownRoms">The devices found by a previous search, or NULL.</param>
+/// <param name="knownCount">The number of devices in knownRoms.</param>
+/// <param name="branches">The branches still to explore.</param>
+/// <param name="rom">Receives the ROM identifier of the device found.</param>
+/// <param name="slotCount">The number of time slots sent is added to this.</param>
+/// <param name="failed">Set to true if the pass failed (a transfer error, a CRC failure, or a
+/// device that stopped responding part way through the ROM), rather than finding no device on
+/// the branch.</param>
+/// <returns>true if a device was found, otherwise false.</returns>
+static bool OneWireSearchPass(OneWireRomId path, int length, bool alarmSearch,
+                              const OneWireRomId *knownRoms, int knownCount,
+                              OneWireSearchBranches *branches, OneWireRomId *rom, long *slotCount,
+                              bool *failed)
+{
+    // A bus without a presence pulse has no devices; any other failure is an error.
+    OneWireResetResponse response = OneWireReset();
+    if (response != DevicePresent) {
+        *failed = response != NoDevices;
+        return false;
+    }
+
+    // Each bit of the ROM is a triplet: read the bit, read its complement, write the direction.
+    // The direction of the predicted bits is already known, so the command and the triplets of
+    // those bits are sent in one transfer.
+    OneWireRomId predicted;
+    int predictedBits = OneWireSearchPredict(path, length, knownRoms, knownCount, &predicted);
+    uint8_t command = alarmSearch ? 0xEC : 0xF0;
+    uint8_t slots[(8 + ONEWIRE_SEARCH_ROM_BITS * 3 + 7) / 8];
+    memset(slots, 0, sizeof(slots));
+    slots[0] = command;
+    for (int bit = 0; bit < predictedBits; bit++) {
+        OneWireSearchSetSlot(slots, 8 + bit * 3, 1);
+        OneWireSearchSetSlot(slots, 8 + bit * 3 + 1, 1);
+        OneWireSearchSetSlot(slots, 8 + bit * 3 + 2, (int)((predicted >> bit) & 1));
+    }
+
+    int slotTotal = 8 + predictedBits * 3;
+    *slotCount += slotTotal;
+    if (!OneWireTouchBits(slots, (size_t)slotTotal) || slots[0] != command) {
+        *failed = true;
+        return false;
+    }
+
+    OneWireRomId result = 0;
+    for (int bit = 0; bit < predictedBits; bit++) {
+        int idBit = OneWireSearchGetSlot(slots, 8 + bit * 3);
+        int cmpIdBit = OneWireSearchGetSlot(slots, 8 + bit * 3 + 1);
+        int direction = (int)((predicted >> bit) & 1);
+        if (idBit == 1 && cmpIdBit == 1) {
+            // No device responded.  Before the first bit this is a bus (or an alarm search)
+            // without devices; after it, a device stopped responding part way through.
+            *failed = bit > 0;
+            return false;
+        }
+
+        if (idBit != cmpIdBit && idBit != direction) {
+            // Only devices on the other branch responded, and writing the direction deselected
+            // them; they are found by another pass.
+            if (bit >= length) {
+                OneWireSearchPushBranch(branches, result | ((OneWireRomId)idBit << bit), bit + 1);
+            }
+            return false;
+        }
+
+        if (idBit == 0 && cmpIdBit == 0 && bit >= length) {
+            OneWireSearchPushBranch(branches, result | ((OneWireRomId)(direction ^ 1) << bit),
+                                    bit + 1);
+        }
+
+        result |= (OneWireRomId)direction << bit;
+    }
+
+    // The direction of the remaining bits depends on the bits read, so they are sent one triplet
+    // at a time; the direction of each bit is written in the same transfer as the reads of the
+    // next bit.
+    int bit = predictedBits;
+    int pendingDirection = -1;
+    for (;;) {
+        uint8_t triplet = 0;
+        int count = 0;
+        if (pendingDirection >= 0) {
+            triplet = (uint8_t)pendingDirection;
+            count = 1;
+        }
+        if (bit < ONEWIRE_SEARCH_ROM_BITS) {
+            triplet |= (uint8_t)(0b11 << count);
+            count += 2;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        *slotCount += count;
+        if (!OneWireTouchBits(&triplet, (size_t)count)) {
+            *failed = true;
+            return false;
+        }
+        if (bit == ONEWIRE_SEARCH_ROM_BITS) {
+            break;
+        }
+
+        int idBit = (triplet >> (count - 2)) & 1;
+        int cmpIdBit = (triplet >> (count - 1)) & 1;
+        if (idBit == 1 && cmpIdBit == 1) {
+            *failed = bit > 0;
+            return false;
+        }
+
+        if (idBit == 0 && cmpIdBit == 0) {
+            OneWireSearchPushBranch(branches, result | ((OneWireRomId)1 << bit), bit + 1);
+            pendingDirection = 0;
+        } else {
+            pendingDirection = idBit;
+        }
+
+        result |= (OneWireRomId)pendingDirection << bit;
+        bit++;
+    }
+
+    uint8_t bytes[8];
+    OneWireRomIdToBytes(result, bytes);
+    if (Crc8Compute(bytes, sizeof(bytes), 0) != 0) {
+        OneWireStatsAddCrcFailure();
+        *failed = true;
+        return false;
+    }
+
+    // A ROM of 0 passes the CRC check, but is read when the bus is held low.
+    *rom = result;
+    *failed = OneWireRomIdGetFamily(result) == 0;
+    return !*failed;
+}
+
+/// <summary>
+/// Predicts the bits of the device a pass will find: the first length bits of path, followed by
+/// the bits the known devices that share those bits have (taking 0 first, like the search.)
+/// </summary>
+/// <param name="path">The bits of the branch to explore.</param>
+/// <param name="length">The number of bits of path to take.</param>
+/// <param name="knownRoms">The devices found by a previous search, or NULL.</param>
+/// <param name="knownCount">The number of devices in knownRoms.</param>
+/// <param name="predicted">Receives the predicted bits.</param>
+/// <returns>The number of bits predicted (at least length.)</returns>
+static int OneWireSearchPredict(OneWireRomId path, int length, const OneWireRomId *knownRoms,
+                                int knownCount, OneWireRomId *predicted)
+{
+    OneWireRomId rom = path & OneWireSearchMask(length);
+    int bit = length;
+    for (; bit < ONEWIRE_SEARCH_ROM_BITS; bit++) {
+        OneWireRomId prefixMask = OneWireSearchMask(bit);
+        bool hasZero = false;
+        bool hasOne = false;
+        for (int i = 0; i < knownCount; i++) {
+            if (((knownRoms[i] ^ rom) & prefixMask) == 0) {
+                if ((knownRoms[i] >> bit) & 1) {
+                    hasOne = true;
+                } else {
+                    hasZero = true;
+                }
+            }
+        }
+
+        if (!hasZero && !hasOne) {
+            break;
+        }
+        if (!hasZero) {
+            rom |= (OneWireRomId)1 << bit;
+        }
+    }
+
+    *predicted = rom;
+    return bit;
+}
+
+/// <summary>
+/// Adds a branch to explore.
+/// </summary>
+/// <param name="branches">The branches still to explore.</param>
+/// <param name="path">The bits of the branch.</param>
+/// <param name="length">The number of bits of path to take.</param>
+static void OneWireSearchPushBranch(OneWireSearchBranches *branches, OneWireRomId path,
+                                    int length)
+{
+    if (branches->count > ONEWIRE_SEARCH_ROM_BITS) {
+        Log_Debug("PROGRAM ERROR: Too many OneWire search branches.\n");
+        return;
+    }
+
+    branches->path[branches->count] = path;
+    branches->length[branches->count] = (uint8_t)length;
+    branches->count++;
+}
+
+/// <summary>
+/// Returns a mask of the lowest bits of a ROM identifier.
+/// </summary>
+/// <param name="bitCount">The number of bits (0 to ONEWIRE_SEARCH_ROM_BITS.)</param>
+/// <returns>The mask.</returns>
+static OneWireRomId OneWireSearchMask(int bitCount)
+{
+    return bitCount >= ONEWIRE_SEARCH_ROM_BITS ? ~(OneWireRomId)0
+                                               : ((OneWireRomId)1 << bitCount) - 1;
+}
+
+/// <summary>
+/// Returns a time slot from a buffer of slots (least significant bit of slots[0] first.)
+/// </summary>
+/// <param name="slots">The slots.</param>
+/// <param name="index">The index of the slot.</param>
+/// <returns>The value of the slot (0 or 1).</returns>
+static int OneWireSearchGetSlot(const uint8_t *slots, int index)
+{
+    return (slots[index / 8] >> (index % 8)) & 1;
+}
+
+/// <summary>
+/// Sets a time slot in a buffer of slots (least significant bit of slots[0] first.)
+/// </summary>
+/// <param name="slots">The slots.</param>
+/// <param name="index">The index of the slot.</param>
+/// <param name="value">The value of the slot (0 or 1).</param>
+static void OneWireSearchSetSlot(uint8_t *slots, int index, int value)
+{
+    if (value) {
+        slots[index / 8] |= (uint8_t)(1 << (index % 8));
+    } else {
+        slots[index / 8] &= (uint8_t)~(1 << (index % 8));
+    }
+}
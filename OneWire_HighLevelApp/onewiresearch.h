@@ -6,6 +6,82 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "onewirerom.h"
+
+/// <summary>
+/// The state of a search for devices on the OneWire bus.  The rom holds the device found by the
+/// last call to <see src="OneWireSearchNext"/>, and error is true if that call failed (a
+/// transfer error, a CRC failure, or no presence pulse) rather than finding no more devices.
+/// Each caller can own a separate context, so searches do not change the global OneWireROM.
+/// </summary>
+typedef struct {
+    OneWireRomId rom;
+    uint8_t lastDiscrepancy;
+    uint8_t lastFamilyDiscrepancy;
+    bool lastDeviceFlag;
+    bool error;
+} OneWireSearchContext;
+
+/// <summary>
+/// Resets the search context to search for all devices on the OneWire bus.
+/// </summary>
+/// <param name="context">The search context.</param>
+void OneWireSearchContextReset(OneWireSearchContext *context);
+
+/// <summary>
+/// Resets the search context to search for all devices on the OneWire bus matching the
+/// specified family identifier.
+/// </summary>
+/// <param name="context">The search context.</param>
+/// <param name="familyId">The family identifier (first 8 bits of the ROM ID).</param>
+void OneWireSearchContextTargetSetup(OneWireSearchContext *context, uint8_t familyId);
+
+/// <summary>
+/// Searches for the next OneWire device and sets context->rom to the matching device ROM
+/// identifier.
+/// </summary>
+/// <param name="context">The search context.</param>
+/// <param name="alarmSearch">
+/// When set to true, then search will be for devices in the alarm state only.  False will return
+/// all devices.
+/// </param>
+/// <returns>
+/// true if a matching OneWire device was found, false if no device found (context->error is
+/// set if the search failed.)
+/// </returns>
+bool OneWireSearchNext(OneWireSearchContext *context, bool alarmSearch);
+
+/// <summary>
+/// Finds every device on the OneWire bus in a single call.  Like <see src="OneWireSearchNext"/>
+/// each pass starts with a reset and walks all 64 bits of the ROM tree (the protocol has no way
+/// to resume part way down the tree), but the bits of each pass that are already known are sent
+/// in a single transfer instead of one bit at a time:
+/// - the bits leading to the branch point the pass explores (found by an earlier pass); and
+/// - the bits of the devices in knownRoms (e.g. from the previous search.)
+/// The bits read back are still checked, so a branch that is no longer on the bus is dropped and
+/// a new branch (a device that was added) is explored bit by bit.
+/// </summary>
+/// <param name="familyId">The family identifier of the devices to find, or 0 for all
+/// devices.</param>
+/// <param name="alarmSearch">true to only find devices in the alarm state.</param>
+/// <param name="knownRoms">The devices found by a previous search, or NULL.</param>
+/// <param name="knownCount">The number of devices in knownRoms.</param>
+/// <param name="roms">Receives the ROM identifiers of the devices found.</param>
+/// <param name="maxCount">The maximum number of devices to find.</param>
+/// <param name="slotCount">Receives the number of time slots used (not counting the reset
+/// pulses), or NULL.</param>
+/// <returns>The number of devices found, or -1 if a pass failed (a transfer error or a CRC
+/// failure), in which case roms may hold only some of the devices.</returns>
+int OneWireSearchAll(uint8_t familyId, bool alarmSearch, const OneWireRomId *knownRoms,
+                     int knownCount, OneWireRomId *roms, int maxCount, long *slotCount);
+
+/// <summary>
+/// Verifies the device with the ROM identifier is responding on the OneWire bus.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <returns>true if the device responsed, false otherwise.</returns>
+bool OneWireVerifyRomId(OneWireRomId rom);
+
 /// <summary>
 /// Resets the OneWireSearchROM data to search for all devices on the OneWire bus.
 /// </summary>
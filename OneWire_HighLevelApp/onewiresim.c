@@ -0,0 +1,533 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// A software OneWire bus with simulated DS18B20 devices.  Each time slot is simulated for every
+// device (like the devices on a real bus, which all watch every slot), so the simulated bus runs
+// exactly the same slots as the UART transport would generate.
+
+#include "onewiresim.h"
+#include "crc8.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/// <summary>
+/// The states of a simulated device.  A reset pulse always moves a device to
+/// OneWireSimState_RomCommand.
+/// </summary>
+typedef enum {
+    OneWireSimState_Idle = 0,
+    OneWireSimState_RomCommand = 1,
+    OneWireSimState_ReadRom = 2,
+    OneWireSimState_MatchRom = 3,
+    OneWireSimState_SearchRom = 4,
+    OneWireSimState_FunctionCommand = 5,
+    OneWireSimState_Transmit = 6,
+    OneWireSimState_Receive = 7,
+    OneWireSimState_Converting = 8,
+} OneWireSimState;
+
+/// <summary>
+/// The size of the DS18B20 scratchpad.
+/// </summary>
+#define ONEWIRE_SIM_SCRATCHPAD_SIZE 9
+
+/// <summary>
+/// A simulated DS18B20 device.
+/// </summary>
+typedef struct {
+    OneWireSimDeviceConfig config;
+    OneWireSimState state;
+    int bitIndex;
+    uint8_t command;
+    uint8_t scratchpad[ONEWIRE_SIM_SCRATCHPAD_SIZE];
+    uint8_t eeprom[3];
+    uint8_t transmit[ONEWIRE_SIM_SCRATCHPAD_SIZE];
+    int transmitBits;
+    uint8_t receive[3];
+    int receiveBits;
+    int searchSlot;
+    bool converting;
+    struct timespec conversionDone;
+} OneWireSimDevice;
+
+static OneWireResetResponse OneWireSimReset(void);
+static bool OneWireSimTouchBits(const uint8_t *sendBits, uint8_t *receiveBits, size_t bitCount,
+                                bool enableStrongPullup);
+static void OneWireSimDisableStrongPullup(void);
+static int OneWireSimSlot(int masterBit);
+static int OneWireSimDeviceSlot(OneWireSimDevice *device, int masterBit);
+static void OneWireSimStartFunction(OneWireSimDevice *device);
+static void OneWireSimStartTransmit(OneWireSimDevice *device, const uint8_t *data, int length);
+static void OneWireSimUpdateConversion(OneWireSimDevice *device);
+static void OneWireSimUpdateScratchpadCrc(OneWireSimDevice *device);
+static bool OneWireSimIsAlarmed(const OneWireSimDevice *device);
+static uint32_t OneWireSimRandom(void);
+
+/// <summary>
+/// The devices on the simulated bus.
+/// </summary>
+static OneWireSimDevice simDevices[ONEWIRE_SIM_MAX_DEVICES];
+
+/// <summary>
+/// The number of entries in simDevices.
+/// </summary>
+static int simDeviceCount = 0;
+
+/// <summary>
+/// The signals generated on the simulated bus.
+/// </summary>
+static OneWireSimCounters simCounters;
+
+/// <summary>
+/// The number of corrupted read slots per million read slots.
+/// </summary>
+static int simNoiseErrorsPerMillion = 0;
+
+/// <summary>
+/// The state of the pseudo random numbers used for the simulated noise.
+/// </summary>
+static uint32_t simNoiseState = 1;
+
+/// <summary>
+/// The transport for the simulated bus.
+/// </summary>
+static const OneWireTransport simTransport = {
+    .reset = OneWireSimReset,
+    .touchBits = OneWireSimTouchBits,
+    .disableStrongPullup = OneWireSimDisableStrongPullup,
+};
+
+/// <summary>
+/// Removes all of the devices from the simulated OneWire bus and clears the counters.
+/// </summary>
+/// <param name="seed">The seed used for the simulated noise.</param>
+void OneWireSimInit(unsigned int seed)
+{
+    simDeviceCount = 0;
+    simNoiseErrorsPerMillion = 0;
+    simNoiseState = seed != 0 ? seed : 1;
+    memset(&simCounters, 0, sizeof(simCounters));
+}
+
+/// <summary>
+/// Adds a DS18B20 device to the simulated OneWire bus.  The device has the default scratchpad
+/// (tHigh 75, tLow 70, 12 bit resolution.)
+/// </summary>
+/// <param name="config">The configuration of the device.</param>
+/// <returns>The index of the device, or -1 if the bus already has ONEWIRE_SIM_MAX_DEVICES.</returns>
+int OneWireSimAddDevice(const OneWireSimDeviceConfig *config)
+{
+    if (simDeviceCount >= ONEWIRE_SIM_MAX_DEVICES) {
+        return -1;
+    }
+
+    OneWireSimDevice *device = &simDevices[simDeviceCount];
+    memset(device, 0, sizeof(*device));
+    device->config = *config;
+    device->state = OneWireSimState_Idle;
+
+    // The power on value of the temperature is 85C.
+    const uint8_t powerOnScratchpad[] = {0x50, 0x05, 75, 70, 0x7F, 0xFF, 0x0C, 0x10};
+    memcpy(device->scratchpad, powerOnScratchpad, sizeof(powerOnScratchpad));
+    memcpy(device->eeprom, &device->scratchpad[2], sizeof(device->eeprom));
+    OneWireSimUpdateScratchpadCrc(device);
+
+    return simDeviceCount++;
+}
+
+/// <summary>
+/// Sets the temperature reported by a simulated device.
+/// </summary>
+/// <param name="index">The index returned by <see src="OneWireSimAddDevice"/>.</param>
+/// <param name="temperature">The temperature, in 1/16 degrees Celsius.</param>
+void OneWireSimSetTemperature(int index, int16_t temperature)
+{
+    if (index >= 0 && index < simDeviceCount) {
+        simDevices[index].config.temperature = temperature;
+    }
+}
+
+/// <summary>
+/// Sets how often a read slot is corrupted (the bus is sampled with the opposite value.)
+/// </summary>
+/// <param name="errorsPerMillion">The number of corrupted read slots per million read
+/// slots.</param>
+void OneWireSimSetNoise(int errorsPerMillion)
+{
+    simNoiseErrorsPerMillion = errorsPerMillion;
+}
+
+/// <summary>
+/// Returns a ROM identifier with the specified family and serial number, and a valid CRC.
+/// </summary>
+/// <param name="familyId">The family identifier (e.g. 0x28 for a DS18B20.)</param>
+/// <param name="serialNumber">The serial number (the lower 48 bits are used.)</param>
+/// <returns>The ROM identifier.</returns>
+OneWireRomId OneWireSimMakeRomId(uint8_t familyId, uint64_t serialNumber)
+{
+    uint8_t bytes[8];
+    bytes[0] = familyId;
+    for (int i = 1; i < 7; i++) {
+        bytes[i] = (uint8_t)(serialNumber >> (8 * (i - 1)));
+    }
+    bytes[7] = Crc8Compute(bytes, 7, 0);
+
+    return OneWireRomIdFromBytes(bytes);
+}
+
+/// <summary>
+/// Gets the signals generated on the simulated OneWire bus since <see src="OneWireSimInit"/>.
+/// </summary>
+/// <param name="counters">Receives the counters.</param>
+void OneWireSimGetCounters(OneWireSimCounters *counters)
+{
+    *counters = simCounters;
+}
+
+/// <summary>
+/// Returns the transport for the simulated OneWire bus, to pass to
+/// <see src="OneWireSetTransport"/>.
+/// </summary>
+/// <returns>The transport.</returns>
+const OneWireTransport *OneWireSimGetTransport(void)
+{
+    return &simTransport;
+}
+
+/// <summary>
+/// Sends a reset pulse on the simulated bus.  Every device responds with a presence pulse and
+/// waits for a ROM command.
+/// </summary>
+/// <returns>DevicePresent if there are devices on the bus, otherwise NoDevices.</returns>
+static OneWireResetResponse OneWireSimReset(void)
+{
+    simCounters.resets++;
+    simCounters.transfers++;
+    for (int i = 0; i < simDeviceCount; i++) {
+        OneWireSimDevice *device = &simDevices[i];
+        OneWireSimUpdateConversion(device);
+        device->state = OneWireSimState_RomCommand;
+        device->bitIndex = 0;
+        device->command = 0;
+    }
+
+    return simDeviceCount > 0 ? DevicePresent : NoDevices;
+}
+
+/// <summary>
+/// Sends a sequence of time slots on the simulated bus (see <see src="OneWireUartTouchBits"/>).
+/// </summary>
+/// <param name="sendBits">The bits to send, least significant bit of sendBits[0] first.</param>
+/// <param name="receiveBits">Receives the bits sampled on the bus (same packing as sendBits).
+/// This can be NULL if the received bits are not needed.</param>
+/// <param name="bitCount">The number of time slots to send.</param>
+/// <param name="enableStrongPullup">Ignored, the simulated devices do not need power.</param>
+/// <returns>true.</returns>
+static bool OneWireSimTouchBits(const uint8_t *sendBits, uint8_t *receiveBits, size_t bitCount,
+                                bool enableStrongPullup)
+{
+    simCounters.transfers++;
+    for (size_t bit = 0; bit < bitCount; bit++) {
+        int masterBit = (sendBits[bit / 8] >> (bit % 8)) & 1;
+        int busBit = OneWireSimSlot(masterBit);
+        if (receiveBits != NULL) {
+            uint8_t mask = (uint8_t)(1 << (bit % 8));
+            if (busBit) {
+                receiveBits[bit / 8] |= mask;
+            } else {
+                receiveBits[bit / 8] &= (uint8_t)~mask;
+            }
+        }
+    }
+
+    return true;
+}
+
+/// <summary>
+/// The simulated bus has no strong pullup.
+/// </summary>
+static void OneWireSimDisableStrongPullup(void)
+{
+}
+
+/// <summary>
+/// Simulates a time slot on every device.  The bus is low if the master sends a 0 or any device
+/// pulls the bus low during a read slot.
+/// </summary>
+/// <param name="masterBit">The bit sent by the master (1 is also a read slot.)</param>
+/// <returns>The value sampled on the bus.</returns>
+static int OneWireSimSlot(int masterBit)
+{
+    simCounters.slots++;
+
+    int busBit = masterBit;
+    for (int i = 0; i < simDeviceCount; i++) {
+        if (OneWireSimDeviceSlot(&simDevices[i], masterBit) == 0) {
+            busBit = 0;
+        }
+    }
+
+    if (masterBit == 1 && simNoiseErrorsPerMillion > 0 &&
+        OneWireSimRandom() % 1000000 < (uint32_t)simNoiseErrorsPerMillion) {
+        simCounters.noiseErrors++;
+        busBit = !busBit;
+    }
+
+    return busBit;
+}
+
+/// <summary>
+/// Simulates a time slot on a device.
+/// </summary>
+/// <param name="device">The device.</param>
+/// <param name="masterBit">The bit sent by the master.</param>
+/// <returns>0 if the device pulls the bus low, otherwise 1.</returns>
+static int OneWireSimDeviceSlot(OneWireSimDevice *device, int masterBit)
+{
+    int romBit = device->bitIndex < 64 ? (int)((device->config.rom >> device->bitIndex) & 1) : 1;
+    int output = 1;
+
+    switch (device->state) {
+    case OneWireSimState_RomCommand:
+        device->command |= (uint8_t)(masterBit << device->bitIndex);
+        if (++device->bitIndex < 8) {
+            break;
+        }
+
+        device->bitIndex = 0;
+        if (device->command == 0x33) {
+            device->state = OneWireSimState_ReadRom;
+        } else if (device->command == 0x55) {
+            device->state = OneWireSimState_MatchRom;
+        } else if (device->command == 0xCC) {
+            device->state = OneWireSimState_FunctionCommand;
+            device->command = 0;
+        } else if (device->command == 0xF0 ||
+                   (device->command == 0xEC && OneWireSimIsAlarmed(device))) {
+            device->state = OneWireSimState_SearchRom;
+            device->searchSlot = 0;
+        } else {
+            device->state = OneWireSimState_Idle;
+        }
+        break;
+
+    case OneWireSimState_ReadRom:
+        output = romBit;
+        if (++device->bitIndex == 64) {
+            device->state = OneWireSimState_FunctionCommand;
+            device->bitIndex = 0;
+            device->command = 0;
+        }
+        break;
+
+    case OneWireSimState_MatchRom:
+        if (masterBit != romBit) {
+            device->state = OneWireSimState_Idle;
+        } else if (++device->bitIndex == 64) {
+            device->state = OneWireSimState_FunctionCommand;
+            device->bitIndex = 0;
+            device->command = 0;
+        }
+        break;
+
+    case OneWireSimState_SearchRom:
+        // Each ROM bit uses three slots: the bit, its complement, then the direction chosen by
+        // the master.  Devices that don't match the direction stop taking part in the search.
+        if (device->searchSlot == 0) {
+            output = romBit;
+            device->searchSlot = 1;
+        } else if (device->searchSlot == 1) {
+            output = !romBit;
+            device->searchSlot = 2;
+        } else {
+            device->searchSlot = 0;
+            if (masterBit != romBit) {
+                device->state = OneWireSimState_Idle;
+            } else if (++device->bitIndex == 64) {
+                device->state = OneWireSimState_FunctionCommand;
+                device->bitIndex = 0;
+                device->command = 0;
+            }
+        }
+        break;
+
+    case OneWireSimState_FunctionCommand:
+        device->command |= (uint8_t)(masterBit << device->bitIndex);
+        if (++device->bitIndex == 8) {
+            device->bitIndex = 0;
+            OneWireSimStartFunction(device);
+        }
+        break;
+
+    case OneWireSimState_Transmit:
+        output = (device->transmit[device->bitIndex / 8] >> (device->bitIndex % 8)) & 1;
+        if (++device->bitIndex == device->transmitBits) {
+            device->state = OneWireSimState_Idle;
+        }
+        break;
+
+    case OneWireSimState_Receive:
+        if (masterBit) {
+            device->receive[device->receiveBits / 8] |= (uint8_t)(1 << (device->receiveBits % 8));
+        }
+        if (++device->receiveBits == 24) {
+            device->scratchpad[2] = device->receive[0];
+            device->scratchpad[3] = device->receive[1];
+            device->scratchpad[4] = (uint8_t)((device->receive[2] & 0x60) | 0x1F);
+            OneWireSimUpdateScratchpadCrc(device);
+            device->state = OneWireSimState_Idle;
+        }
+        break;
+
+    case OneWireSimState_Converting:
+        // A VCC powered device holds the bus low until the conversion has completed.  A parasitic
+        // powered device can't, so the bus always reads 1.
+        OneWireSimUpdateConversion(device);
+        if (device->converting && device->config.vccPowered) {
+            output = 0;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return output;
+}
+
+/// <summary>
+/// Starts the DS18B20 function command that was received.
+/// </summary>
+/// <param name="device">The device.</param>
+static void OneWireSimStartFunction(OneWireSimDevice *device)
+{
+    switch (device->command) {
+    case 0x44: {
+        // Convert T
+        struct timespec *done = &device->conversionDone;
+        clock_gettime(CLOCK_MONOTONIC, done);
+        done->tv_sec += device->config.conversionTimeMilli / 1000;
+        done->tv_nsec += (device->config.conversionTimeMilli % 1000) * 1000000L;
+        if (done->tv_nsec >= 1000000000L) {
+            done->tv_sec++;
+            done->tv_nsec -= 1000000000L;
+        }
+        device->converting = true;
+        device->state = OneWireSimState_Converting;
+        break;
+    }
+
+    case 0xBE:
+        // Read Scratchpad
+        OneWireSimStartTransmit(device, device->scratchpad, ONEWIRE_SIM_SCRATCHPAD_SIZE);
+        break;
+
+    case 0x4E:
+        // Write Scratchpad
+        memset(device->receive, 0, sizeof(device->receive));
+        device->receiveBits = 0;
+        device->state = OneWireSimState_Receive;
+        break;
+
+    case 0x48:
+        // Copy Scratchpad
+        memcpy(device->eeprom, &device->scratchpad[2], sizeof(device->eeprom));
+        device->state = OneWireSimState_Idle;
+        break;
+
+    case 0xB8:
+        // Recall E2
+        memcpy(&device->scratchpad[2], device->eeprom, sizeof(device->eeprom));
+        OneWireSimUpdateScratchpadCrc(device);
+        device->state = OneWireSimState_Idle;
+        break;
+
+    case 0xB4: {
+        // Read Power Supply (a parasitic powered device pulls the bus low.)
+        uint8_t power = device->config.vccPowered ? 0xFF : 0x00;
+        OneWireSimStartTransmit(device, &power, 1);
+        break;
+    }
+
+    default:
+        device->state = OneWireSimState_Idle;
+        break;
+    }
+}
+
+/// <summary>
+/// Starts sending data to the master in the following read slots.
+/// </summary>
+/// <param name="device">The device.</param>
+/// <param name="data">The data to send.</param>
+/// <param name="length">The number of bytes to send.</param>
+static void OneWireSimStartTransmit(OneWireSimDevice *device, const uint8_t *data, int length)
+{
+    memcpy(device->transmit, data, (size_t)length);
+    device->transmitBits = length * 8;
+    device->bitIndex = 0;
+    device->state = OneWireSimState_Transmit;
+}
+
+/// <summary>
+/// Completes the temperature conversion of a device if the conversion time has elapsed.  A
+/// conversion keeps running if the master sends a reset pulse.
+/// </summary>
+/// <param name="device">The device.</param>
+static void OneWireSimUpdateConversion(OneWireSimDevice *device)
+{
+    if (!device->converting) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec < device->conversionDone.tv_sec ||
+        (now.tv_sec == device->conversionDone.tv_sec &&
+         now.tv_nsec < device->conversionDone.tv_nsec)) {
+        return;
+    }
+
+    device->scratchpad[0] = (uint8_t)(device->config.temperature & 0xFF);
+    device->scratchpad[1] = (uint8_t)((device->config.temperature >> 8) & 0xFF);
+    // A conversion also replaces the power on value of byte 6 (see DS18B20_POWER_ON_BYTE6.)
+    device->scratchpad[6] = (uint8_t)(0x10 - (device->config.temperature & 0x0F));
+    OneWireSimUpdateScratchpadCrc(device);
+    device->converting = false;
+}
+
+/// <summary>
+/// Sets the CRC byte of the scratchpad after the scratchpad has changed.
+/// </summary>
+/// <param name="device">The device.</param>
+static void OneWireSimUpdateScratchpadCrc(OneWireSimDevice *device)
+{
+    device->scratchpad[8] = Crc8Compute(device->scratchpad, 8, 0);
+}
+
+/// <summary>
+/// Returns true if the temperature of the device is at or above tHigh, or at or below tLow.
+/// </summary>
+/// <param name="device">The device.</param>
+/// <returns>true if the device is in the alarm state, otherwise false.</returns>
+static bool OneWireSimIsAlarmed(const OneWireSimDevice *device)
+{
+    int16_t temperature = (int16_t)(device->scratchpad[0] | (device->scratchpad[1] << 8));
+    int degrees = temperature / 16;
+    return degrees >= (int8_t)device->scratchpad[2] || degrees <= (int8_t)device->scratchpad[3];
+}
+
+/// <summary>
+/// Returns the next pseudo random number (xorshift32) for the simulated noise.
+/// </summary>
+/// <returns>The random number.</returns>
+static uint32_t OneWireSimRandom(void)
+{
+    simNoiseState ^= simNoiseState << 13;
+    simNoiseState ^= simNoiseState >> 17;
+    simNoiseState ^= simNoiseState << 5;
+    return simNoiseState;
+}
@@ -0,0 +1,115 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "onewire.h"
+#include "onewirerom.h"
+
+/// <summary>
+/// The maximum number of devices on the simulated OneWire bus.
+/// </summary>
+#define ONEWIRE_SIM_MAX_DEVICES 128
+
+/// <summary>
+/// The configuration of a simulated DS18B20 device.
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// The ROM identifier of the device (see <see src="OneWireSimMakeRomId"/>.)
+    /// </summary>
+    OneWireRomId rom;
+
+    /// <summary>
+    /// true if the device has VCC connected, false if it uses parasitic power.
+    /// </summary>
+    bool vccPowered;
+
+    /// <summary>
+    /// The temperature reported by the device, in 1/16 degrees Celsius.
+    /// </summary>
+    int16_t temperature;
+
+    /// <summary>
+    /// The time (in milliseconds) the device takes to convert the temperature.
+    /// </summary>
+    int conversionTimeMilli;
+} OneWireSimDeviceConfig;
+
+/// <summary>
+/// The signals generated on the simulated OneWire bus since <see src="OneWireSimInit"/>.
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// The number of reset pulses.
+    /// </summary>
+    long resets;
+
+    /// <summary>
+    /// The number of time slots.
+    /// </summary>
+    long slots;
+
+    /// <summary>
+    /// The number of calls to the transport (on hardware, each call to the UART transport is at
+    /// least one UART write and one UART read.)
+    /// </summary>
+    long transfers;
+
+    /// <summary>
+    /// The number of read slots that were corrupted by the simulated noise.
+    /// </summary>
+    long noiseErrors;
+} OneWireSimCounters;
+
+/// <summary>
+/// Removes all of the devices from the simulated OneWire bus and clears the counters.
+/// </summary>
+/// <param name="seed">The seed used for the simulated noise.</param>
+void OneWireSimInit(unsigned int seed);
+
+/// <summary>
+/// Adds a DS18B20 device to the simulated OneWire bus.  The device has the default scratchpad
+/// (tHigh 75, tLow 70, 12 bit resolution.)
+/// </summary>
+/// <param name="config">The configuration of the device.</param>
+/// <returns>The index of the device, or -1 if the bus already has ONEWIRE_SIM_MAX_DEVICES.</returns>
+int OneWireSimAddDevice(const OneWireSimDeviceConfig *config);
+
+/// <summary>
+/// Sets the temperature reported by a simulated device.
+/// </summary>
+/// <param name="index">The index returned by <see src="OneWireSimAddDevice"/>.</param>
+/// <param name="temperature">The temperature, in 1/16 degrees Celsius.</param>
+void OneWireSimSetTemperature(int index, int16_t temperature);
+
+/// <summary>
+/// Sets how often a read slot is corrupted (the bus is sampled with the opposite value.)
+/// </summary>
+/// <param name="errorsPerMillion">The number of corrupted read slots per million read
+/// slots.</param>
+void OneWireSimSetNoise(int errorsPerMillion);
+
+/// <summary>
+/// Returns a ROM identifier with the specified family and serial number, and a valid CRC.
+/// </summary>
+/// <param name="familyId">The family identifier (e.g. 0x28 for a DS18B20.)</param>
+/// <param name="serialNumber">The serial number (the lower 48 bits are used.)</param>
+/// <returns>The ROM identifier.</returns>
+OneWireRomId OneWireSimMakeRomId(uint8_t familyId, uint64_t serialNumber);
+
+/// <summary>
+/// Gets the signals generated on the simulated OneWire bus since <see src="OneWireSimInit"/>.
+/// </summary>
+/// <param name="counters">Receives the counters.</param>
+void OneWireSimGetCounters(OneWireSimCounters *counters);
+
+/// <summary>
+/// Returns the transport for the simulated OneWire bus, to pass to
+/// <see src="OneWireSetTransport"/>.
+/// </summary>
+/// <returns>The transport.</returns>
+const OneWireTransport *OneWireSimGetTransport(void);
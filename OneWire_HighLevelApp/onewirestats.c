@@ -0,0 +1,202 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "onewirestats.h"
+#include "sleep.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "applibs_versions.h"
+#include <applibs/log.h>
+
+/// <summary>
+/// The number of histogram buckets for each power of 2 microseconds.  With 4 buckets the p99
+/// is reported within 25% of the actual value.
+/// </summary>
+#define ONEWIRE_STATS_SUB_BUCKETS 4
+
+/// <summary>
+/// The number of histogram buckets, which covers latencies up to 2^31 microseconds.
+/// </summary>
+#define ONEWIRE_STATS_BUCKETS (ONEWIRE_STATS_SUB_BUCKETS * 32)
+
+/// <summary>
+/// The statistics of one OneWire operation.
+/// </summary>
+typedef struct {
+    uint32_t count;
+    uint32_t failures;
+    uint32_t retries;
+    uint64_t totalMicro;
+    long minMicro;
+    long maxMicro;
+    uint32_t histogram[ONEWIRE_STATS_BUCKETS];
+} OneWireStatsEntry;
+
+static int OneWireStatsGetBucket(long micro);
+static long OneWireStatsGetBucketLimit(int bucket);
+static long OneWireStatsGetPercentile(const OneWireStatsEntry *entry, int percent);
+
+/// <summary>
+/// The statistics of each operation.
+/// </summary>
+static OneWireStatsEntry statsEntries[OneWireStatsOperation_Count];
+
+/// <summary>
+/// The number of CRC failures.
+/// </summary>
+static uint32_t statsCrcFailures = 0;
+
+/// <summary>
+/// The names of the operations, used by <see src="OneWireStatsDump"/>.
+/// </summary>
+static const char *const statsOperationNames[OneWireStatsOperation_Count] = {
+    "Reset", "SendByte", "ReceiveByte", "TouchBlock", "Search", "UartRead",
+};
+
+/// <summary>
+/// Gets the start time of an operation, to pass to <see src="OneWireStatsRecord"/>.
+/// </summary>
+/// <param name="start">Receives the start time.</param>
+void OneWireStatsStart(struct timespec *start)
+{
+    clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+/// <summary>
+/// Records an operation that has completed: the count, whether it failed, and its latency.
+/// </summary>
+/// <param name="operation">The operation that was performed.</param>
+/// <param name="start">The start time from <see src="OneWireStatsStart"/>.</param>
+/// <param name="success">true if the operation was successful, otherwise false.</param>
+void OneWireStatsRecord(OneWireStatsOperation operation, const struct timespec *start,
+                        bool success)
+{
+    long micro = ElapsedMicro(start);
+    OneWireStatsEntry *entry = &statsEntries[operation];
+    if (entry->count == 0 || micro < entry->minMicro) {
+        entry->minMicro = micro;
+    }
+    if (entry->count == 0 || micro > entry->maxMicro) {
+        entry->maxMicro = micro;
+    }
+
+    entry->count++;
+    entry->totalMicro += (uint64_t)micro;
+    entry->histogram[OneWireStatsGetBucket(micro)]++;
+    if (!success) {
+        entry->failures++;
+    }
+}
+
+/// <summary>
+/// Records the number of times an operation had to wait and try again (e.g. the UART read
+/// loop waiting for more echo data.)
+/// </summary>
+/// <param name="operation">The operation that was retried.</param>
+/// <param name="retries">The number of retries.</param>
+void OneWireStatsAddRetries(OneWireStatsOperation operation, int retries)
+{
+    statsEntries[operation].retries += (uint32_t)retries;
+}
+
+/// <summary>
+/// Records data read from the OneWire bus that did not match its CRC.
+/// </summary>
+void OneWireStatsAddCrcFailure(void)
+{
+    statsCrcFailures++;
+}
+
+/// <summary>
+/// Clears all of the statistics.
+/// </summary>
+void OneWireStatsReset(void)
+{
+    memset(statsEntries, 0, sizeof(statsEntries));
+    statsCrcFailures = 0;
+}
+
+/// <summary>
+/// Logs the statistics of every operation that has been performed: the count, failures, retries,
+/// and the min/avg/max/p99 latency in microseconds.
+/// </summary>
+void OneWireStatsDump(void)
+{
+    Log_Debug("INFO: OneWire statistics (latency in us):\n");
+    for (int operation = 0; operation < OneWireStatsOperation_Count; operation++) {
+        const OneWireStatsEntry *entry = &statsEntries[operation];
+        if (entry->count == 0) {
+            continue;
+        }
+
+        Log_Debug("INFO:   %-11s count=%u failures=%u retries=%u min=%ld avg=%ld max=%ld p99=%ld\n",
+                  statsOperationNames[operation], entry->count, entry->failures, entry->retries,
+                  entry->minMicro, (long)(entry->totalMicro / entry->count), entry->maxMicro,
+                  OneWireStatsGetPercentile(entry, 99));
+    }
+
+    Log_Debug("INFO:   CRC failures=%u\n", statsCrcFailures);
+}
+
+/// <summary>
+/// Returns the histogram bucket for a latency.  Latencies below 4us have a bucket each, after
+/// that each power of 2 is split into ONEWIRE_STATS_SUB_BUCKETS buckets.
+/// </summary>
+/// <param name="micro">The latency in microseconds.</param>
+/// <returns>The bucket index.</returns>
+static int OneWireStatsGetBucket(long micro)
+{
+    if (micro < ONEWIRE_STATS_SUB_BUCKETS) {
+        return micro < 0 ? 0 : (int)micro;
+    }
+
+    int log2 = 0;
+    while (log2 < 31 && (micro >> (log2 + 1)) != 0) {
+        log2++;
+    }
+
+    int subBucket = (int)((micro >> (log2 - 2)) & (ONEWIRE_STATS_SUB_BUCKETS - 1));
+    return (log2 - 1) * ONEWIRE_STATS_SUB_BUCKETS + subBucket;
+}
+
+/// <summary>
+/// Returns the largest latency that is counted in a histogram bucket.
+/// </summary>
+/// <param name="bucket">The bucket index.</param>
+/// <returns>The latency in microseconds.</returns>
+static long OneWireStatsGetBucketLimit(int bucket)
+{
+    if (bucket < ONEWIRE_STATS_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    int log2 = bucket / ONEWIRE_STATS_SUB_BUCKETS + 1;
+    long subBucket = bucket % ONEWIRE_STATS_SUB_BUCKETS;
+    return ((ONEWIRE_STATS_SUB_BUCKETS + subBucket + 1) << (log2 - 2)) - 1;
+}
+
+/// <summary>
+/// Returns the latency that the specified percent of the operations completed within.  The value
+/// is the upper limit of the histogram bucket (but never more than the maximum latency.)
+/// </summary>
+/// <param name="entry">The statistics of the operation.</param>
+/// <param name="percent">The percentile (e.g. 99).</param>
+/// <returns>The latency in microseconds.</returns>
+static long OneWireStatsGetPercentile(const OneWireStatsEntry *entry, int percent)
+{
+    uint64_t rank = ((uint64_t)entry->count * (uint64_t)percent + 99) / 100;
+    uint64_t total = 0;
+    for (int bucket = 0; bucket < ONEWIRE_STATS_BUCKETS; bucket++) {
+        total += entry->histogram[bucket];
+        if (total >= rank) {
+            long limit = OneWireStatsGetBucketLimit(bucket);
+            return limit < entry->maxMicro ? limit : entry->maxMicro;
+        }
+    }
+
+    return entry->maxMicro;
+}
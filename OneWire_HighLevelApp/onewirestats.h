@@ -0,0 +1,59 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <time.h>
+
+/// <summary>
+/// The OneWire operations that are timed.
+/// </summary>
+typedef enum {
+    OneWireStatsOperation_Reset = 0,
+    OneWireStatsOperation_SendByte = 1,
+    OneWireStatsOperation_ReceiveByte = 2,
+    OneWireStatsOperation_TouchBlock = 3,
+    OneWireStatsOperation_Search = 4,
+    OneWireStatsOperation_UartRead = 5,
+    OneWireStatsOperation_Count = 6,
+} OneWireStatsOperation;
+
+/// <summary>
+/// Gets the start time of an operation, to pass to <see src="OneWireStatsRecord"/>.
+/// </summary>
+/// <param name="start">Receives the start time.</param>
+void OneWireStatsStart(struct timespec *start);
+
+/// <summary>
+/// Records an operation that has completed: the count, whether it failed, and its latency.
+/// </summary>
+/// <param name="operation">The operation that was performed.</param>
+/// <param name="start">The start time from <see src="OneWireStatsStart"/>.</param>
+/// <param name="success">true if the operation was successful, otherwise false.</param>
+void OneWireStatsRecord(OneWireStatsOperation operation, const struct timespec *start,
+                        bool success);
+
+/// <summary>
+/// Records the number of times an operation had to wait and try again (e.g. the UART read
+/// loop waiting for more echo data.)
+/// </summary>
+/// <param name="operation">The operation that was retried.</param>
+/// <param name="retries">The number of retries.</param>
+void OneWireStatsAddRetries(OneWireStatsOperation operation, int retries);
+
+/// <summary>
+/// Records data read from the OneWire bus that did not match its CRC.
+/// </summary>
+void OneWireStatsAddCrcFailure(void);
+
+/// <summary>
+/// Clears all of the statistics.
+/// </summary>
+void OneWireStatsReset(void);
+
+/// <summary>
+/// Logs the statistics of every operation that has been performed: the count, failures, retries,
+/// and the min/avg/max/p99 latency in microseconds.
+/// </summary>
+void OneWireStatsDump(void);
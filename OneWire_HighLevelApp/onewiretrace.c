@@ -0,0 +1,282 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "onewiretrace.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "applibs_versions.h"
+#include <applibs/log.h>
+
+/// <summary>
+/// The number of trace bytes on each line logged by OneWireTraceLog.
+/// </summary>
+#define ONEWIRE_TRACE_LOG_LINE_BYTES 32
+
+/// <summary>
+/// The most bytes one encoded entry uses: the event, a 5 byte time delta, and the bytes sent and
+/// received.
+/// </summary>
+#define ONEWIRE_TRACE_MAX_ENTRY_BYTES 8
+
+/// <summary>
+/// The size of the entry array (which has an unused entry when the trace is disabled.)
+/// </summary>
+#define ONEWIRE_TRACE_ENTRIES (ONEWIRE_TRACE_CAPACITY > 0 ? ONEWIRE_TRACE_CAPACITY : 1)
+
+/// <summary>
+/// A recorded reset pulse or time slot.
+/// </summary>
+typedef struct {
+    uint32_t timestampMicro;
+    uint8_t event;
+    uint8_t sent;
+    uint8_t received;
+} OneWireTraceEntry;
+
+static size_t OneWireTraceEncodeHeader(uint8_t *buffer);
+static size_t OneWireTraceEncodeEntry(int index, uint32_t previousMicro, uint8_t *buffer);
+static void OneWireTraceLogBytes(uint8_t *line, size_t *lineLength, const uint8_t *data,
+                                 size_t length);
+static void OneWireTraceLogLine(const uint8_t *line, size_t length);
+static void OneWireTracePutLittleEndian(uint8_t *buffer, uint32_t value);
+
+/// <summary>
+/// The trace entries, oldest first from traceHead.  The trace is only used from the event loop
+/// thread.
+/// </summary>
+static OneWireTraceEntry traceEntries[ONEWIRE_TRACE_ENTRIES];
+
+/// <summary>
+/// The index of the oldest entry.
+/// </summary>
+static int traceHead = 0;
+
+/// <summary>
+/// The number of entries.
+/// </summary>
+static int traceCount = 0;
+
+/// <summary>
+/// The number of entries overwritten since the trace was last cleared.
+/// </summary>
+static uint32_t traceOverwritten = 0;
+
+/// <summary>
+/// Records a trace entry, overwriting the oldest entry if the trace is full.  Use the
+/// ONEWIRE_TRACE_ADD macro instead of calling this directly.
+/// </summary>
+/// <param name="event">The kind of entry.</param>
+/// <param name="bus">The bus number.</param>
+/// <param name="overdrive">true if the bus is at overdrive speed.</param>
+/// <param name="sent">The byte written to the UART.</param>
+/// <param name="received">The byte read from the UART, or -1 if no data was received.</param>
+void OneWireTraceAdd(OneWireTraceEvent event, int bus, bool overdrive, uint8_t sent,
+                     int received)
+{
+    if (ONEWIRE_TRACE_CAPACITY <= 0) {
+        return;
+    }
+
+    int index;
+    if (traceCount < ONEWIRE_TRACE_ENTRIES) {
+        index = (traceHead + traceCount++) % ONEWIRE_TRACE_ENTRIES;
+    } else {
+        index = traceHead;
+        traceHead = (traceHead + 1) % ONEWIRE_TRACE_ENTRIES;
+        traceOverwritten++;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    OneWireTraceEntry *entry = &traceEntries[index];
+    entry->timestampMicro =
+        (uint32_t)((uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000);
+    entry->event = (uint8_t)((event & ONEWIRE_TRACE_EVENT_MASK) |
+                             ((bus << ONEWIRE_TRACE_BUS_SHIFT) & ONEWIRE_TRACE_BUS_MASK) |
+                             (overdrive ? ONEWIRE_TRACE_FLAG_OVERDRIVE : 0) |
+                             (received < 0 ? ONEWIRE_TRACE_FLAG_NO_DATA : 0));
+    entry->sent = sent;
+    entry->received = received < 0 ? 0 : (uint8_t)received;
+}
+
+/// <summary>
+/// Returns the number of entries in the trace.
+/// </summary>
+/// <returns>The number of entries.</returns>
+int OneWireTraceGetCount(void)
+{
+    return traceCount;
+}
+
+/// <summary>
+/// Encodes the trace (see the format in onewiretrace.h.)
+/// </summary>
+/// <param name="buffer">Receives the encoded trace.</param>
+/// <param name="size">The size of the buffer; up to ONEWIRE_TRACE_HEADER_SIZE plus 8 bytes
+/// per entry are needed.</param>
+/// <returns>The length of the encoded trace, or 0 if the buffer is too small.</returns>
+size_t OneWireTraceEncode(uint8_t *buffer, size_t size)
+{
+    if (size < ONEWIRE_TRACE_HEADER_SIZE) {
+        return 0;
+    }
+
+    size_t length = OneWireTraceEncodeHeader(buffer);
+    uint32_t previousMicro = traceCount > 0 ? traceEntries[traceHead].timestampMicro : 0;
+    for (int i = 0; i < traceCount; i++) {
+        uint8_t entry[ONEWIRE_TRACE_MAX_ENTRY_BYTES];
+        size_t entryLength = OneWireTraceEncodeEntry(i, previousMicro, entry);
+        if (length + entryLength > size) {
+            return 0;
+        }
+
+        memcpy(&buffer[length], entry, entryLength);
+        length += entryLength;
+        previousMicro = traceEntries[(traceHead + i) % ONEWIRE_TRACE_ENTRIES].timestampMicro;
+    }
+
+    return length;
+}
+
+/// <summary>
+/// Logs the encoded trace in hexadecimal, on lines that start with "TRACE: " (the replay tool
+/// reads them from a copy of the device output), and then clears the trace.  Nothing is logged
+/// if the trace is empty.
+/// </summary>
+void OneWireTraceLog(void)
+{
+    if (traceCount == 0) {
+        return;
+    }
+
+    Log_Debug("INFO: OneWire trace of %d entries (%u overwritten):\n", traceCount,
+              traceOverwritten);
+
+    // The entries are encoded one at a time, so the trace does not need a second buffer.
+    uint8_t line[ONEWIRE_TRACE_LOG_LINE_BYTES];
+    size_t lineLength = 0;
+    uint8_t encoded[ONEWIRE_TRACE_HEADER_SIZE];
+    size_t length = OneWireTraceEncodeHeader(encoded);
+    OneWireTraceLogBytes(line, &lineLength, encoded, length);
+
+    uint32_t previousMicro = traceEntries[traceHead].timestampMicro;
+    for (int i = 0; i < traceCount; i++) {
+        length = OneWireTraceEncodeEntry(i, previousMicro, encoded);
+        OneWireTraceLogBytes(line, &lineLength, encoded, length);
+        previousMicro = traceEntries[(traceHead + i) % ONEWIRE_TRACE_ENTRIES].timestampMicro;
+    }
+    OneWireTraceLogLine(line, lineLength);
+
+    OneWireTraceClear();
+}
+
+/// <summary>
+/// Removes every entry from the trace.
+/// </summary>
+void OneWireTraceClear(void)
+{
+    traceHead = 0;
+    traceCount = 0;
+    traceOverwritten = 0;
+}
+
+/// <summary>
+/// Writes the encoded trace header.
+/// </summary>
+/// <param name="buffer">Receives the header (ONEWIRE_TRACE_HEADER_SIZE bytes.)</param>
+/// <returns>The length of the header.</returns>
+static size_t OneWireTraceEncodeHeader(uint8_t *buffer)
+{
+    buffer[0] = 'O';
+    buffer[1] = 'W';
+    buffer[2] = 'T';
+    buffer[3] = ONEWIRE_TRACE_VERSION;
+    OneWireTracePutLittleEndian(&buffer[4], (uint32_t)traceCount);
+    OneWireTracePutLittleEndian(&buffer[8], traceOverwritten);
+    OneWireTracePutLittleEndian(&buffer[12],
+                                traceCount > 0 ? traceEntries[traceHead].timestampMicro : 0);
+    return ONEWIRE_TRACE_HEADER_SIZE;
+}
+
+/// <summary>
+/// Writes an encoded trace entry.
+/// </summary>
+/// <param name="index">The index of the entry (0 is the oldest.)</param>
+/// <param name="previousMicro">The time of the previous entry.</param>
+/// <param name="buffer">Receives the entry (up to ONEWIRE_TRACE_MAX_ENTRY_BYTES.)</param>
+/// <returns>The length of the entry.</returns>
+static size_t OneWireTraceEncodeEntry(int index, uint32_t previousMicro, uint8_t *buffer)
+{
+    const OneWireTraceEntry *entry = &traceEntries[(traceHead + index) % ONEWIRE_TRACE_ENTRIES];
+    size_t length = 0;
+    buffer[length++] = entry->event;
+
+    uint32_t delta = entry->timestampMicro - previousMicro;
+    while (delta >= 0x80) {
+        buffer[length++] = (uint8_t)(delta | 0x80);
+        delta >>= 7;
+    }
+    buffer[length++] = (uint8_t)delta;
+
+    buffer[length++] = entry->sent;
+    if ((entry->event & ONEWIRE_TRACE_FLAG_NO_DATA) == 0) {
+        buffer[length++] = entry->received;
+    }
+
+    return length;
+}
+
+/// <summary>
+/// Adds bytes to the line being logged, logging each line once it is full.
+/// </summary>
+/// <param name="line">The line being logged (ONEWIRE_TRACE_LOG_LINE_BYTES.)</param>
+/// <param name="lineLength">The number of bytes in the line.</param>
+/// <param name="data">The bytes to add.</param>
+/// <param name="length">The number of bytes to add.</param>
+static void OneWireTraceLogBytes(uint8_t *line, size_t *lineLength, const uint8_t *data,
+                                 size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        line[(*lineLength)++] = data[i];
+        if (*lineLength == ONEWIRE_TRACE_LOG_LINE_BYTES) {
+            OneWireTraceLogLine(line, *lineLength);
+            *lineLength = 0;
+        }
+    }
+}
+
+/// <summary>
+/// Logs a line of the trace in hexadecimal.
+/// </summary>
+/// <param name="line">The bytes of the line.</param>
+/// <param name="length">The number of bytes (nothing is logged if it is 0.)</param>
+static void OneWireTraceLogLine(const uint8_t *line, size_t length)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    char text[ONEWIRE_TRACE_LOG_LINE_BYTES * 2 + 1];
+    for (size_t i = 0; i < length; i++) {
+        text[2 * i] = hexDigits[line[i] >> 4];
+        text[2 * i + 1] = hexDigits[line[i] & 0x0F];
+    }
+    text[2 * length] = '\0';
+
+    if (length > 0) {
+        Log_Debug("TRACE: %s\n", text);
+    }
+}
+
+/// <summary>
+/// Writes a 32 bit little endian value.
+/// </summary>
+/// <param name="buffer">Receives the value.</param>
+/// <param name="value">The value.</param>
+static void OneWireTracePutLittleEndian(uint8_t *buffer, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        buffer[i] = (uint8_t)(value >> (8 * i));
+    }
+}
@@ -0,0 +1,121 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The OneWire trace records every reset pulse and time slot sent by the UART transport, with
+// the byte written to the UART and the byte read back, so that a problem seen in the field can
+// be replayed on a host (see onewirereplay.h).  An encoded trace is little endian:
+//   char[3] "OWT", uint8 version (ONEWIRE_TRACE_VERSION)
+//   uint32 entry count
+//   uint32 number of entries overwritten before the first entry
+//   uint32 time of the first entry, in microseconds (CLOCK_MONOTONIC)
+//   for each entry:
+//     uint8  OneWireTraceEvent (bits 0 to 3), bus (bits 4 and 5), overdrive (bit 6) and no data
+//            received (bit 7)
+//     varint microseconds since the previous entry
+//     uint8  byte written to the UART
+//     uint8  byte read from the UART, only if data was received
+// A varint has 7 bits per byte, least significant first, with bit 7 set on every byte but the
+// last.
+
+/// <summary>
+/// The number of entries the trace keeps; once it is full the oldest entries are overwritten.
+/// Each entry uses 8 bytes.  Set it in CMakeLists.txt to record a trace; the default of 0 does
+/// not record anything (the calls in the UART transport are compiled out.)
+/// </summary>
+#ifndef ONEWIRE_TRACE_CAPACITY
+#define ONEWIRE_TRACE_CAPACITY 0
+#endif
+
+/// <summary>
+/// The version of the encoded trace format.
+/// </summary>
+#define ONEWIRE_TRACE_VERSION 1
+
+/// <summary>
+/// The size of the encoded trace header.
+/// </summary>
+#define ONEWIRE_TRACE_HEADER_SIZE 16
+
+/// <summary>
+/// Bits of the event byte of an encoded entry.
+/// </summary>
+#define ONEWIRE_TRACE_EVENT_MASK 0x0F
+#define ONEWIRE_TRACE_BUS_SHIFT 4
+#define ONEWIRE_TRACE_BUS_MASK 0x30
+#define ONEWIRE_TRACE_FLAG_OVERDRIVE 0x40
+#define ONEWIRE_TRACE_FLAG_NO_DATA 0x80
+
+/// <summary>
+/// The kinds of trace entries.
+/// </summary>
+typedef enum {
+    /// <summary>
+    /// A reset pulse: the reset byte and the byte read back (which has the presence pulse.)
+    /// </summary>
+    OneWireTraceEvent_Reset = 0,
+
+    /// <summary>
+    /// A time slot: the slot byte and its echo.
+    /// </summary>
+    OneWireTraceEvent_Slot = 1,
+
+    /// <summary>
+    /// A time slot after which the strong pullup was enabled.
+    /// </summary>
+    OneWireTraceEvent_PullupSlot = 2,
+} OneWireTraceEvent;
+
+/// <summary>
+/// Records a trace entry, if the trace is enabled (ONEWIRE_TRACE_CAPACITY.)  The arguments are
+/// not evaluated when it is not.
+/// </summary>
+#if ONEWIRE_TRACE_CAPACITY > 0
+#define ONEWIRE_TRACE_ADD(...) OneWireTraceAdd(__VA_ARGS__)
+#else
+#define ONEWIRE_TRACE_ADD(...) ((void)0)
+#endif
+
+/// <summary>
+/// Records a trace entry, overwriting the oldest entry if the trace is full.  Use the
+/// ONEWIRE_TRACE_ADD macro instead of calling this directly.
+/// </summary>
+/// <param name="event">The kind of entry.</param>
+/// <param name="bus">The bus number.</param>
+/// <param name="overdrive">true if the bus is at overdrive speed.</param>
+/// <param name="sent">The byte written to the UART.</param>
+/// <param name="received">The byte read from the UART, or -1 if no data was received.</param>
+void OneWireTraceAdd(OneWireTraceEvent event, int bus, bool overdrive, uint8_t sent,
+                     int received);
+
+/// <summary>
+/// Returns the number of entries in the trace.
+/// </summary>
+/// <returns>The number of entries.</returns>
+int OneWireTraceGetCount(void);
+
+/// <summary>
+/// Encodes the trace (see the format above.)
+/// </summary>
+/// <param name="buffer">Receives the encoded trace.</param>
+/// <param name="size">The size of the buffer; up to ONEWIRE_TRACE_HEADER_SIZE plus 8 bytes
+/// per entry are needed.</param>
+/// <returns>The length of the encoded trace, or 0 if the buffer is too small.</returns>
+size_t OneWireTraceEncode(uint8_t *buffer, size_t size);
+
+/// <summary>
+/// Logs the encoded trace in hexadecimal, on lines that start with "TRACE: " (the replay tool
+/// reads them from a copy of the device output), and then clears the trace.  Nothing is logged
+/// if the trace is empty.
+/// </summary>
+void OneWireTraceLog(void);
+
+/// <summary>
+/// Removes every entry from the trace.
+/// </summary>
+void OneWireTraceClear(void);
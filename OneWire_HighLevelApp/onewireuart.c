@@ -11,10 +11,15 @@ Copyright (C) 2020 Derek Jamison (@CodeAllNight), All Rights Reserved.
 // https://www.maximintegrated.com/en/design/technical-documents/tutorials/2/214.html
 
 #include "onewireuart.h"
+#include "onewirelog.h"
+#include "onewirestats.h"
+#include "onewiretrace.h"
 #include "sleep.h"
 
 #include <errno.h>
+#include <poll.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "applibs_versions.h"
@@ -22,93 +27,346 @@ Copyright (C) 2020 Derek Jamison (@CodeAllNight), All Rights Reserved.
 
 static void OneWireEnableStrongPullupGpio(void);
 static bool OneWireUartSetSpeed(UART_BaudRate_Type baud);
-static bool OneWireUartWriteByte(uint8_t data, bool enableStrongPullup);
-static int OneWireUartReadByte(void);
+static int OneWireUartOpen(UART_Id uart, UART_BaudRate_Type baud);
+static bool OneWireUartWriteByte(int fd, uint8_t data, bool enableStrongPullup);
+static int OneWireUartReadByte(int fd, UART_BaudRate_Type baud);
+static bool OneWireUartTransferSlots(const uint8_t *slots, uint8_t *echoes, size_t count,
+                                     bool enableStrongPullup);
+static bool OneWireUartReadBytes(int fd, UART_BaudRate_Type baud, uint8_t *buffer, size_t count);
+static void OneWireUartTraceSlots(const uint8_t *slots, const uint8_t *echoes, size_t count,
+                                  bool enableStrongPullup);
+static void OneWireUartDiscardInput(int fd);
 
 /// <summary>
-/// The file descriptor used to access the pin used for pullup GPIO.  This must
-/// always be set LOW (open) before sending any data on UART.  When it is set HIGH
-/// then it's output will be on the OneWire bus.
+/// The maximum number of time slots sent in a single UART write.  Each slot is one byte on the
+/// UART, so this also limits how many echo bytes need to be buffered by the UART before we read
+/// them back.
 /// </summary>
-static int gpioPullupFd = -1;
+#define ONEWIRE_UART_MAX_SLOTS_PER_TRANSFER 64
 
 /// <summary>
-/// The file descriptor used to access the UART for sending and receiving data.
+/// The UART byte used for a write 1 (or read) time slot.  Only the start bit pulls the line low.
 /// </summary>
-static int uartFd = -1;
+#define ONEWIRE_UART_SLOT_ONE 0b11111111
 
 /// <summary>
-/// The UART port to use for communication.
+/// The UART byte used for a write 0 time slot.  The start bit and all data bits pull the line low.
 /// </summary>
-static int uartId = -1;
+#define ONEWIRE_UART_SLOT_ZERO 0b00000000
 
 /// <summary>
-/// The current baud rate for the UART.  Reset pulses use 9600 baud.  Read/write 
-/// operations use 115200 baud.
+/// The UART byte used for a reset pulse at standard speed (9600 baud.)  The start bit and 4 data
+/// bits pull the line low for 521us.
 /// </summary>
-static UART_BaudRate_Type uartBaud = 0;
+#define ONEWIRE_UART_RESET 0b11110000
 
 /// <summary>
-/// Initialize the UART and GPIO ports.
+/// The UART byte used for a reset pulse at overdrive speed (115200 baud.)  The start bit and 5
+/// data bits pull the line low for 52us (the overdrive reset low time is 48us to 80us.)
+/// </summary>
+#define ONEWIRE_UART_OVERDRIVE_RESET 0b11100000
+
+/// <summary>
+/// The last data bit of the reset byte at standard speed, which starts 833us after the reset
+/// pulse.  A presence pulse has always ended by then (the latest is 300us after the 521us reset
+/// pulse), so the bit is only received as 0 when the bus is held low.
+/// </summary>
+#define ONEWIRE_UART_RESET_RELEASED_BIT 0b10000000
+
+/// <summary>
+/// The baud rate used for the time slots at overdrive speed.  A write 1 (or read) slot is low for
+/// 1us and a write 0 slot is low for 9us, within the overdrive slot timing.
+/// </summary>
+#define ONEWIRE_UART_OVERDRIVE_BAUD 1000000
+
+/// <summary>
+/// The time (in microseconds) to wait for echo data, in addition to the time the UART needs to
+/// send the data.  This covers the scheduling latency before the echo is readable.
+/// </summary>
+#define ONEWIRE_UART_READ_MARGIN_US 10000
+
+/// <summary>
+/// The time (in milliseconds) without any data arriving before the input of a UART is
+/// considered discarded.  This covers the latency before data received by the UART is readable.
+/// </summary>
+#define ONEWIRE_UART_DISCARD_QUIET_MS 1
+
+/// <summary>
+/// The state of one OneWire bus (a UART and a pullup GPIO.)
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// The file descriptor used to access the pin used for pullup GPIO.  This must
+    /// always be set LOW (open) before sending any data on UART.  When it is set HIGH
+    /// then it's output will be on the OneWire bus.
+    /// </summary>
+    int gpioPullupFd;
+
+    /// <summary>
+    /// The file descriptor used to access the UART for sending and receiving data.
+    /// </summary>
+    int uartFd;
+
+    /// <summary>
+    /// The UART port to use for communication.
+    /// </summary>
+    int uartId;
+
+    /// <summary>
+    /// The current baud rate for the UART.  Reset pulses use 9600 baud.  Read/write
+    /// operations use 115200 baud (ONEWIRE_UART_OVERDRIVE_BAUD at overdrive speed.)
+    /// </summary>
+    UART_BaudRate_Type uartBaud;
+
+    /// <summary>
+    /// The file descriptor of the UART used for reset pulses (always at 9600 baud), or -1 if the
+    /// bus changes the baud rate of uartFd for reset pulses.  When this is used, uartFd stays
+    /// at 115200 baud.
+    /// </summary>
+    int resetUartFd;
+
+    /// <summary>
+    /// true if the time slots and reset pulses are sent at overdrive speed.  Set by
+    /// OneWireUartSetOverdrive.
+    /// </summary>
+    bool overdrive;
+
+    /// <summary>
+    /// The byte received during the last reset pulse at standard speed that got a presence
+    /// pulse, which depends on the shape of the presence pulses; or -1 if there has not been one.
+    /// </summary>
+    int presence;
+} OneWireUartBus;
+
+/// <summary>
+/// The OneWire buses that have been initialized.
+/// </summary>
+static OneWireUartBus uartBuses[ONEWIRE_UART_MAX_BUSES];
+
+/// <summary>
+/// The number of entries in uartBuses that have been initialized.
+/// </summary>
+static int uartBusCount = 0;
+
+/// <summary>
+/// The bus used by all of the OneWire operations.  Set by OneWireUartSelectBus.
+/// </summary>
+static OneWireUartBus *uartBus = NULL;
+
+/// <summary>
+/// Initialize the UART and GPIO ports, and select the bus for the OneWire operations.
 /// </summary>
 /// <param name="uart">The UART port to use for communication.</param>
 /// <param name="gpio">The GPIO port to use for pullup.</param>
-/// <returns></returns>
+/// <returns>true if the initialization was succesful, otherwise false.</returns>
 bool OneWireUartInit(UART_Id uart, GPIO_Id gpio)
 {
-    // We use OpenSource, so a LOW value is disconnected (high impedance) and a HIGH value is 
+    int bus = OneWireUartAddBus(uart, gpio);
+    return bus != -1 && OneWireUartSelectBus(bus);
+}
+
+/// <summary>
+/// Initialize the UART and GPIO ports for another OneWire bus.  Use
+/// <see src="OneWireUartSelectBus"/> to choose the bus used by the OneWire operations.
+/// </summary>
+/// <param name="uart">The UART port to use for communication.</param>
+/// <param name="gpio">The GPIO port to use for pullup.</param>
+/// <returns>The bus number, or -1 if the initialization failed.</returns>
+int OneWireUartAddBus(UART_Id uart, GPIO_Id gpio)
+{
+    return OneWireUartAddBusWithResetUart(uart, ONEWIRE_UART_NO_RESET_UART, gpio);
+}
+
+/// <summary>
+/// Initialize the UART and GPIO ports for another OneWire bus that uses a second UART for the
+/// reset pulses.  A reset pulse needs a long low (9600 baud) and a time slot needs a short low
+/// (115200 baud), so a bus with a single UART closes and reopens the UART to change the baud
+/// rate twice for every reset.  With a reset UART both UARTs stay open: the reset UART at 9600
+/// baud and the data UART at 115200 baud.  The TX of the reset UART must also be able to pull
+/// the OneWire bus low (e.g. with its own pair of transistors, in parallel with the data UART's
+/// transistor) and its RX must be connected to the OneWire bus.
+/// </summary>
+/// <param name="uart">The UART port to use for the time slots.</param>
+/// <param name="resetUart">The UART port to use for reset pulses, or ONEWIRE_UART_NO_RESET_UART
+/// to change the baud rate of the data UART for the reset pulses.</param>
+/// <param name="gpio">The GPIO port to use for pullup.</param>
+/// <returns>The bus number, or -1 if the initialization failed.</returns>
+int OneWireUartAddBusWithResetUart(UART_Id uart, UART_Id resetUart, GPIO_Id gpio)
+{
+    if (uartBusCount >= ONEWIRE_UART_MAX_BUSES) {
+        Log_Debug("PROGRAM ERROR: Only %d OneWire buses are supported.\n", ONEWIRE_UART_MAX_BUSES);
+        return -1;
+    }
+
+    OneWireUartBus *bus = &uartBuses[uartBusCount];
+    bus->uartFd = -1;
+    bus->uartBaud = 0;
+    bus->resetUartFd = -1;
+    bus->overdrive = false;
+    bus->presence = -1;
+
+    // We use OpenSource, so a LOW value is disconnected (high impedance) and a HIGH value is
     // current source that will be applied to the output pin.  We set the initial state to
     // high impedance.
-    gpioPullupFd = GPIO_OpenAsOutput(gpio, GPIO_OutputMode_OpenSource, GPIO_Value_Low);
-    if (gpioPullupFd == -1) {
+    bus->gpioPullupFd = GPIO_OpenAsOutput(gpio, GPIO_OutputMode_OpenSource, GPIO_Value_Low);
+    if (bus->gpioPullupFd == -1) {
         Log_Debug("ERROR: Could not open pullup [%d] GPIO: %s (%d).\n", gpio, strerror(errno),
                   errno);
-        return false;
+        return -1;
     }
 
     // Store the UART port, since we will end up needing it everytime we change the baud.
-    uartId = uart;
+    bus->uartId = uart;
+
+    // A bus with a reset UART keeps the data UART at 115200 baud (the reset UART stays at 9600
+    // baud.)  Otherwise initialize the baud to 9600 so we are ready to send the reset pulse.
+    UART_BaudRate_Type baud = 9600;
+    if (resetUart != ONEWIRE_UART_NO_RESET_UART) {
+        bus->resetUartFd = OneWireUartOpen(resetUart, 9600);
+        if (bus->resetUartFd == -1) {
+            close(bus->gpioPullupFd);
+            bus->gpioPullupFd = -1;
+            return -1;
+        }
+        baud = 115200;
+    }
 
-    // Initialize the baud to 9600 so we are ready to send the reset pulse.
-    return OneWireUartSetSpeed(9600);
+    OneWireUartBus *previousBus = uartBus;
+    uartBus = bus;
+    bool status = OneWireUartSetSpeed(baud);
+    uartBus = previousBus;
+    if (!status) {
+        if (bus->resetUartFd != -1) {
+            close(bus->resetUartFd);
+            bus->resetUartFd = -1;
+        }
+        close(bus->gpioPullupFd);
+        bus->gpioPullupFd = -1;
+        return -1;
+    }
+
+    return uartBusCount++;
+}
+
+/// <summary>
+/// Selects the bus used by all of the OneWire operations.
+/// </summary>
+/// <param name="bus">The bus number returned by <see src="OneWireUartAddBus"/>.</param>
+/// <returns>true if the bus was selected, otherwise false.</returns>
+bool OneWireUartSelectBus(int bus)
+{
+    if (bus < 0 || bus >= uartBusCount) {
+        Log_Debug("PROGRAM ERROR: OneWire bus %d has not been initialized.\n", bus);
+        return false;
+    }
+
+    uartBus = &uartBuses[bus];
+    return true;
+}
+
+/// <summary>
+/// Returns the number of OneWire buses that have been initialized.
+/// </summary>
+/// <returns>The number of buses.</returns>
+int OneWireUartGetBusCount(void)
+{
+    return uartBusCount;
+}
+
+/// <summary>
+/// Returns the byte received during the last reset pulse at standard speed on the selected bus
+/// that got a presence pulse.  The devices on the bus release it at different times, so the byte
+/// can change when a device is added or removed.
+/// </summary>
+/// <returns>The byte, or -1 if no bus is selected or there has not been a presence pulse.</returns>
+int OneWireUartGetPresence(void)
+{
+    return uartBus != NULL ? uartBus->presence : -1;
+}
+
+/// <summary>
+/// Sets the speed of the time slots and reset pulses on the selected bus.  At overdrive speed the
+/// time slots are sent at 1000000 baud and the reset pulses at 115200 baud, on the data UART.
+/// Only the devices that were put in overdrive (e.g. with Overdrive Match ROM) respond; a reset
+/// pulse at standard speed returns every device to standard speed.  A bus with a reset UART is
+/// kept at standard speed, so its data UART is never reopened.
+/// </summary>
+/// <param name="overdrive">true for overdrive speed, false for standard speed.</param>
+/// <returns>true if the speed was set, otherwise false (e.g. overdrive on a bus with a reset
+/// UART.)</returns>
+bool OneWireUartSetOverdrive(bool overdrive)
+{
+    if (uartBus == NULL) {
+        Log_Debug("ERROR: uartId was not set.  Call OneWireInit method to set value.\n");
+        return false;
+    }
+
+    // An overdrive transaction needs the data UART at 115200 baud (for the command at standard
+    // speed and the overdrive reset pulses) and at 1000000 baud (for the time slots), and the
+    // reset UART at 9600 baud can send neither, so overdrive would reopen the data UART twice for
+    // every transaction.  At standard speed both UARTs stay open at a fixed baud rate.
+    if (overdrive && uartBus->resetUartFd >= 0) {
+        return false;
+    }
+
+    // The baud rate is changed with the next time slot or reset pulse.
+    uartBus->overdrive = overdrive;
+    return true;
 }
 
 /// <summary>
 /// Sets the UART to the specified baud rate.
 /// </summary>
-/// <param name="baud">The baud rate (9600 or 115200).</param>
+/// <param name="baud">The baud rate (9600, 115200 or ONEWIRE_UART_OVERDRIVE_BAUD).</param>
 /// <returns>true if successfully set the baud rate, otherwise false.</returns>
 static bool OneWireUartSetSpeed(UART_BaudRate_Type baud)
 {
-    // Return an error if the uartId is not set with the UART port to use.
-    if (uartId == -1) {
+    // Return an error if the bus has not been set with the UART port to use.
+    if (uartBus == NULL) {
         Log_Debug("ERROR: uartId was not set.  Call OneWireInit method to set value.\n");
         return false;
     }
 
     // If the UART is already at the specified rate, return true.
-    if (uartBaud == baud) {
+    if (uartBus->uartBaud == baud) {
         return true;
     }
 
     // Make sure the baud rate is one of the expected values for this library.
-    if (baud != 9600 && baud != 115200) {
-        Log_Debug("PROGRAM ERROR: The only supported speeds are 9600 and 115200, not %d.\n", baud);
+    if (baud != 9600 && baud != 115200 && baud != ONEWIRE_UART_OVERDRIVE_BAUD) {
+        Log_Debug("PROGRAM ERROR: The only supported speeds are 9600, 115200 and %d, not %d.\n",
+                  ONEWIRE_UART_OVERDRIVE_BAUD, baud);
         return false;
     }
 
     // Close the existing OneWire UART port.
-    if (uartFd >= 0) {
-        int result = close(uartFd);
-        uartFd = -1;
-        uartBaud = 0;
+    if (uartBus->uartFd >= 0) {
+        int result = close(uartBus->uartFd);
+        uartBus->uartFd = -1;
+        uartBus->uartBaud = 0;
         if (result != 0) {
             Log_Debug("ERROR: Could not close UART fd: %s (%d).\n", strerror(errno), errno);
             return false;
         }
     }
 
-    // Open the UART port using <baud>N81.
+    uartBus->uartFd = OneWireUartOpen(uartBus->uartId, baud);
+    if (uartBus->uartFd == -1) {
+        return false;
+    }
+
+    uartBus->uartBaud = baud;
+    return true;
+}
+
+/// <summary>
+/// Opens a UART port using <baud>N81.
+/// </summary>
+/// <param name="uart">The UART port to open.</param>
+/// <param name="baud">The baud rate.</param>
+/// <returns>The file descriptor of the UART, or -1 if the UART could not be opened.</returns>
+static int OneWireUartOpen(UART_Id uart, UART_BaudRate_Type baud)
+{
     UART_Config uartConfig;
     UART_InitConfig(&uartConfig);
     uartConfig.flowControl = UART_FlowControl_None;
@@ -116,37 +374,50 @@ static bool OneWireUartSetSpeed(UART_BaudRate_Type baud)
     uartConfig.parity = UART_Parity_None;
     uartConfig.dataBits = UART_DataBits_Eight;
     uartConfig.stopBits = UART_StopBits_One;
-    uartFd = UART_Open(uartId, &uartConfig);
-    if (uartFd == -1) {
-        Log_Debug("ERROR: Could not open UART: %s (%d).\n", strerror(errno), errno);
-        return false;
+    int fd = UART_Open(uart, &uartConfig);
+    if (fd == -1) {
+        Log_Debug("ERROR: Could not open UART [%d]: %s (%d).\n", uart, strerror(errno), errno);
     }
 
-    uartBaud = baud;
-    return true;
+    return fd;
 }
 
 /// <summary>
-/// Close the UART and GPIO ports.
+/// Close the UART and GPIO ports of every bus.
 /// </summary>
 void OneWireUartClose(void)
 {
-    if (uartFd >= 0) {
-        int result = close(uartFd);
-        if (result != 0) {
-            Log_Debug("ERROR: Could not close UART fd: %s (%d).\n", strerror(errno), errno);
+    for (int i = 0; i < uartBusCount; i++) {
+        OneWireUartBus *bus = &uartBuses[i];
+        if (bus->uartFd >= 0) {
+            int result = close(bus->uartFd);
+            if (result != 0) {
+                Log_Debug("ERROR: Could not close UART fd: %s (%d).\n", strerror(errno), errno);
+            }
+            bus->uartFd = -1;
+            bus->uartBaud = 0;
         }
-        uartFd = -1;
-        uartBaud = 0;
-    }
 
-    if (gpioPullupFd >= 0) {
-        int result = close(gpioPullupFd);
-        if (result != 0) {
-            Log_Debug("ERROR: Could not close pullup fd: %s (%d).\n", strerror(errno), errno);
+        if (bus->resetUartFd >= 0) {
+            int result = close(bus->resetUartFd);
+            if (result != 0) {
+                Log_Debug("ERROR: Could not close reset UART fd: %s (%d).\n", strerror(errno),
+                          errno);
+            }
+            bus->resetUartFd = -1;
+        }
+
+        if (bus->gpioPullupFd >= 0) {
+            int result = close(bus->gpioPullupFd);
+            if (result != 0) {
+                Log_Debug("ERROR: Could not close pullup fd: %s (%d).\n", strerror(errno), errno);
+            }
+            bus->gpioPullupFd = -1;
         }
-        gpioPullupFd = -1;
     }
+
+    uartBusCount = 0;
+    uartBus = NULL;
 }
 
 /// <summary>
@@ -155,21 +426,43 @@ void OneWireUartClose(void)
 /// </summary>
 /// <returns>returns UartImplDevicePresent if one or more devices responded,
 /// UartImplNoDevices is no devices responsed, UartImplNoData if there was
-/// an error during communication.
+/// an error during communication, UartImplBusShorted if the bus stayed low.
 /// </returns>
 OneWireUartResetResponse OneWireUartPulseReset(void)
 {
     OneWireUartResetResponse response;
 
-    // A reset pulse is long, so slow the speed to 9600 baud.
-    if (!OneWireUartSetSpeed(9600)) {
+    // A reset pulse is long, so it is sent at 9600 baud.  A single low of at least 480us is
+    // needed; at 115200 baud even a 0x00 byte only stays low for 78us, and the stop bit between
+    // bytes releases the line, so a run of 0x00 bytes would be a run of write 0 time slots.
+    // At overdrive speed (only on a bus without a reset UART, see OneWireUartSetOverdrive) the
+    // reset pulse is sent at 115200 baud on the data UART.
+    int resetFd;
+    UART_BaudRate_Type resetBaud = 9600;
+    uint8_t resetByte = ONEWIRE_UART_RESET;
+    if (uartBus != NULL && uartBus->overdrive) {
+        if (!OneWireUartSetSpeed(115200)) {
+            return UartImplHardwareFailure;
+        }
+        resetFd = uartBus->uartFd;
+        resetBaud = 115200;
+        resetByte = ONEWIRE_UART_OVERDRIVE_RESET;
+    } else if (uartBus != NULL && uartBus->resetUartFd >= 0) {
+        // The reset UART also received the time slots sent since the last reset.
+        resetFd = uartBus->resetUartFd;
+        OneWireUartDiscardInput(resetFd);
+    } else if (OneWireUartSetSpeed(9600)) {
+        // Without a reset UART the data UART is reopened at 9600 baud, and reopened again at
+        // 115200 baud for the next time slot; UART_Open is the only way to change the baud rate.
+        resetFd = uartBus->uartFd;
+    } else {
         return UartImplHardwareFailure;
     }
 
     // We write out data from least significant to most significant.
     // So this will send a low pulse of 1 start bit+4 data bits = 5bits x 9600baud 
     // which is 521us (the acutal measured time was 517us.)
-    OneWireUartWriteByte(0b11110000, false);
+    OneWireUartWriteByte(resetFd, resetByte, false);
     
     // If a device is present, then it should pull the line low 
     // so we should read at least one more bit on.  If no devices
@@ -178,15 +471,32 @@ OneWireUartResetResponse OneWireUartPulseReset(void)
     // went high for 32uS and then went low for 132uS; this resulted
     // in the data being read as 0b11000000; e.g. the next two bits
     // significant bits were low.)
-    int b = OneWireUartReadByte();
+    // A bus that is shorted to ground (or a device stuck holding it low) is read as 0 for the
+    // whole byte.  At overdrive speed a presence pulse can last until the last data bit, so only
+    // a byte of 0 is a shorted bus.
+    int b = OneWireUartReadByte(resetFd, resetBaud);
+    ONEWIRE_TRACE_ADD(OneWireTraceEvent_Reset, (int)(uartBus - uartBuses), uartBus->overdrive,
+                      resetByte, b);
+    uint8_t releasedMask = (resetBaud == 9600) ? ONEWIRE_UART_RESET_RELEASED_BIT : 0xFF;
     if (b == -1) {
-        Log_Debug("ERROR: No data during reset pulse.\n");
+        ONEWIRE_LOG_DEFER_ERROR("ERROR: No data during reset pulse.\n");
         response = UartImplNoData;
-    } else if (b == 0b11110000) {
-        Log_Debug("WARN: No devices detected.\n");
+    } else if ((b & releasedMask) == 0) {
+        ONEWIRE_LOG_DEFER_ERROR("ERROR: OneWire bus is held low (0x%02x).\n", b);
+        response = UartImplBusShorted;
+    } else if (b == resetByte) {
+        ONEWIRE_LOG_DEFER_WARN("WARN: No devices detected.\n");
         response = UartImplNoDevices;
     } else {
         response = UartImplDevicePresent;
+        if (resetBaud == 9600 && uartBus != NULL) {
+            uartBus->presence = b;
+        }
+    }
+
+    if (resetFd != uartBus->uartFd) {
+        // The data UART received the reset and presence pulses as (framing error) bytes.
+        OneWireUartDiscardInput(uartBus->uartFd);
     }
 
     return response;
@@ -202,25 +512,15 @@ OneWireUartResetResponse OneWireUartPulseReset(void)
 /// <returns>true if successful, otherwise false.</returns>
 bool OneWireUartPulseWriteBit(int bit, bool enableStrongPullup)
 {
-    // A bit is a small pulse, so set baud rate to 115200.
-    if (!OneWireUartSetSpeed(115200)) {
+    uint8_t sentBit = bit ? 1 : 0;
+    uint8_t receivedBit = 0;
+    if (!OneWireUartTouchBits(&sentBit, &receivedBit, 1, enableStrongPullup)) {
         return false;
     }
 
-    // 1 start bit+8 data bits = 9bits x 115200baud = 78.1us 
-    // (measured at 75.1us)
-    // 1 start bit+0 data bits = 1bits x 115200baud = 8.68uS
-    // (measured at 5.5us)
-    int sentData = bit ? 0b11111111 : 0b00000000;
-    OneWireUartWriteByte(sentData, enableStrongPullup);
-
     // We should receive what we sent.
-    int receivedData = OneWireUartReadByte();
-    if (receivedData == -1) {
-        Log_Debug("ERROR: No data.\n");
-        return false;
-    } else if (receivedData != sentData) {
-        Log_Debug("ERROR: Received 0x%02x instead of 0x%02x.\n", receivedData, sentData);
+    if (receivedBit != sentBit) {
+        ONEWIRE_LOG_DEFER_ERROR("ERROR: Received %d instead of %d.\n", receivedBit, sentBit);
         return false;
     }
 
@@ -234,31 +534,96 @@ bool OneWireUartPulseWriteBit(int bit, bool enableStrongPullup)
 /// <returns>returns -1 if error, otherwise returns the bit (0 or 1) value.</returns>
 int OneWireUartPulseReadBit(void)
 {
-    // A bit is a small pulse, so set baud rate to 115200.
-    int data = -1;
-    if (!OneWireUartSetSpeed(115200)) {
-        return data;
+    uint8_t sentBit = 1;
+    uint8_t receivedBit = 0;
+    if (!OneWireUartTouchBits(&sentBit, &receivedBit, 1, false)) {
+        return -1;
     }
 
-    // 1 start bit+0 data bits = 1bits x 115200baud = 8.68uS
-    // (measured pulse at 5.5us.)
-    OneWireUartWriteByte(0b11111111, false);
+    return receivedBit;
+}
 
-    // When OneWire device sent a high (high impedance) the
-    // measured pulse was 5.5us and the UART was 0b11111111.
-    // When the OneWire device pulled line low (sent a low) 
-    // the measured pulse was extended so it lasted a total 
-    // of 31.8uS (the value returned by the UART was 0b11111000.)
-    int b = OneWireUartReadByte();
-    if (b == -1) {
-        Log_Debug("ERROR: No data during read bit.\n");
-    } else if (b == 0b11111111) {
-        data = 1;
-    } else {
-        data = 0;
+/// <summary>
+/// Sends a sequence of time slots on the OneWire bus and returns the value of the bus sampled
+/// during each slot.  A 0 bit generates a write 0 slot.  A 1 bit generates a write 1 slot, which
+/// is also how a read slot is generated; if a device pulls the line low during the slot then a 0
+/// is received.  The slots are batched so that up to ONEWIRE_UART_MAX_SLOTS_PER_TRANSFER slots
+/// use a single UART write and read.
+/// </summary>
+/// <param name="sendBits">The bits to send, least significant bit of sendBits[0] first.</param>
+/// <param name="receiveBits">Receives the bits sampled on the bus (same packing as sendBits).
+/// This can be NULL if the received bits are not needed.</param>
+/// <param name="bitCount">The number of time slots to send.</param>
+/// <param name="enableStrongPullup">true if the pullup should be enabled after sending the
+/// last bit.</param>
+/// <returns>true if successful, otherwise false.</returns>
+bool OneWireUartTouchBits(const uint8_t *sendBits, uint8_t *receiveBits, size_t bitCount,
+                          bool enableStrongPullup)
+{
+    // A bit is a small pulse, so set baud rate to 115200 (or the overdrive baud rate.)
+    if (!OneWireUartSetSpeed(uartBus != NULL && uartBus->overdrive ? ONEWIRE_UART_OVERDRIVE_BAUD
+                                                                    : 115200)) {
+        return false;
     }
 
-    return data;
+    uint8_t slots[ONEWIRE_UART_MAX_SLOTS_PER_TRANSFER];
+    uint8_t echoes[ONEWIRE_UART_MAX_SLOTS_PER_TRANSFER];
+    size_t bitIndex = 0;
+    while (bitIndex < bitCount) {
+        size_t count = bitCount - bitIndex;
+        if (count > ONEWIRE_UART_MAX_SLOTS_PER_TRANSFER) {
+            count = ONEWIRE_UART_MAX_SLOTS_PER_TRANSFER;
+        }
+
+        // The pullup must only be enabled after the last slot, so when it is requested the last
+        // slot is sent on its own.  This keeps the pullup timing the same as a single bit write.
+        bool lastTransfer = (bitIndex + count == bitCount);
+        if (enableStrongPullup && lastTransfer && count > 1) {
+            count--;
+            lastTransfer = false;
+        }
+
+        // 1 start bit+8 data bits = 9bits x 115200baud = 78.1us
+        // (measured at 75.1us)
+        // 1 start bit+0 data bits = 1bits x 115200baud = 8.68uS
+        // (measured at 5.5us)
+        for (size_t i = 0; i < count; i++) {
+            size_t bit = bitIndex + i;
+            slots[i] = ((sendBits[bit / 8] >> (bit % 8)) & 1) ? ONEWIRE_UART_SLOT_ONE
+                                                               : ONEWIRE_UART_SLOT_ZERO;
+        }
+
+        if (!OneWireUartTransferSlots(slots, echoes, count, enableStrongPullup && lastTransfer)) {
+            return false;
+        }
+
+        // When OneWire device sent a high (high impedance) the
+        // measured pulse was 5.5us and the UART was 0b11111111.
+        // When the OneWire device pulled line low (sent a low)
+        // the measured pulse was extended so it lasted a total
+        // of 31.8uS (the value returned by the UART was 0b11111000.)
+        for (size_t i = 0; i < count; i++) {
+            size_t bit = bitIndex + i;
+            if (slots[i] == ONEWIRE_UART_SLOT_ZERO && echoes[i] != ONEWIRE_UART_SLOT_ZERO) {
+                ONEWIRE_LOG_DEFER_ERROR("ERROR: Received 0x%02x instead of 0x%02x.\n", echoes[i],
+                                        slots[i]);
+                return false;
+            }
+
+            if (receiveBits != NULL) {
+                uint8_t mask = (uint8_t)(1 << (bit % 8));
+                if (echoes[i] == ONEWIRE_UART_SLOT_ONE) {
+                    receiveBits[bit / 8] |= mask;
+                } else {
+                    receiveBits[bit / 8] &= (uint8_t)~mask;
+                }
+            }
+        }
+
+        bitIndex += count;
+    }
+
+    return true;
 }
 
 /// <summary>
@@ -268,7 +633,11 @@ int OneWireUartPulseReadBit(void)
 /// </summary>
 void OneWireDisableStrongPullupGpio(void)
 {
-    GPIO_SetValue(gpioPullupFd, GPIO_Value_Low);
+    if (uartBus == NULL) {
+        return;
+    }
+
+    GPIO_SetValue(uartBus->gpioPullupFd, GPIO_Value_Low);
 }
 
 /// <summary>
@@ -276,17 +645,18 @@ void OneWireDisableStrongPullupGpio(void)
 /// The length of the pulse is the start bit + the data bits.  Each bit
 /// lasts (1/baud) seconds.
 /// </summary>
+/// <param name="fd">The file descriptor of the UART.</param>
 /// <param name="data">The data to send.</param>
 /// <param name="enableStrongPullup">set to true to enable the GPIO pullup
 /// after sending the data.</param>
 /// <returns>true if the data we sent, otherwise false.</returns>
-static bool OneWireUartWriteByte(uint8_t data, bool enableStrongPullup)
+static bool OneWireUartWriteByte(int fd, uint8_t data, bool enableStrongPullup)
 {
     uint8_t buf[1] = {data};
 
     // Always disable the GPIO before sending data on the OneWire bus.
     OneWireDisableStrongPullupGpio();
-    int bytesSent = write(uartFd, buf, 1);
+    int bytesSent = write(fd, buf, 1);
     if (enableStrongPullup) {
         // NOTE: Ideally we would like the pullup to get enabled within 10us
         // *after* the OneWire line went high (which would vary depending on
@@ -306,26 +676,156 @@ static bool OneWireUartWriteByte(uint8_t data, bool enableStrongPullup)
 /// one of the devices pulled the OneWire bus low, in which case it will read back a
 /// different value.
 /// </summary>
+/// <param name="fd">The file descriptor of the UART.</param>
+/// <param name="baud">The baud rate of the UART.</param>
 /// <returns>
 /// The byte that was received or -1 if there was an error.
 /// </returns>
-static int OneWireUartReadByte(void)
+static int OneWireUartReadByte(int fd, UART_BaudRate_Type baud)
 {
-    int retryCount = 100;
-    int data = -1;
-    uint8_t receiveBuffer[2];
-    while (data == -1 && retryCount--) {
-        int bytesRead = read(uartFd, receiveBuffer, 1);
-        if (bytesRead == 1) {
-            data = receiveBuffer[0];
-        } else {
-            SleepMilli(1);
-        }
+    uint8_t data;
+    if (!OneWireUartReadBytes(fd, baud, &data, 1)) {
+        return -1;
     }
 
     return data;
 }
 
+/// <summary>
+/// Writes a batch of time slots on the UART and reads back the echo of every slot.  Each slot is
+/// one byte of data on the UART (see OneWireUartWriteByte).
+/// </summary>
+/// <param name="slots">The UART bytes to send, one per time slot.</param>
+/// <param name="echoes">Receives the UART byte read back for each time slot.</param>
+/// <param name="count">The number of slots (1 to ONEWIRE_UART_MAX_SLOTS_PER_TRANSFER).</param>
+/// <param name="enableStrongPullup">set to true to enable the GPIO pullup
+/// after sending the data.</param>
+/// <returns>true if all of the slots were sent and echoed, otherwise false.</returns>
+static bool OneWireUartTransferSlots(const uint8_t *slots, uint8_t *echoes, size_t count,
+                                     bool enableStrongPullup)
+{
+    // Always disable the GPIO before sending data on the OneWire bus.
+    OneWireDisableStrongPullupGpio();
+    ssize_t bytesSent = write(uartBus->uartFd, slots, count);
+    if (enableStrongPullup) {
+        // See the note in OneWireUartWriteByte about enabling the pullup while the
+        // UART is still sending.
+        OneWireEnableStrongPullupGpio();
+    }
+
+    // We should receive one byte for every slot we sent.
+    bool received = bytesSent == (ssize_t)count &&
+                    OneWireUartReadBytes(uartBus->uartFd, uartBus->uartBaud, echoes, count);
+    OneWireUartTraceSlots(slots, received ? echoes : NULL, count, enableStrongPullup);
+    if (bytesSent != (ssize_t)count) {
+        ONEWIRE_LOG_DEFER_ERROR("ERROR: Only sent %d of %d slots.\n", bytesSent, count);
+        return false;
+    }
+
+    if (!received) {
+        ONEWIRE_LOG_DEFER_ERROR("ERROR: No data.\n");
+        return false;
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Records a batch of time slots in the OneWire trace (see onewiretrace.h), if it is enabled.
+/// </summary>
+/// <param name="slots">The UART bytes sent, one per time slot.</param>
+/// <param name="echoes">The UART byte read back for each time slot, or NULL if the echoes were
+/// not received.</param>
+/// <param name="count">The number of slots.</param>
+/// <param name="enableStrongPullup">true if the pullup was enabled after the last slot.</param>
+static void OneWireUartTraceSlots(const uint8_t *slots, const uint8_t *echoes, size_t count,
+                                  bool enableStrongPullup)
+{
+#if ONEWIRE_TRACE_CAPACITY > 0
+    for (size_t i = 0; i < count; i++) {
+        OneWireTraceEvent event = (enableStrongPullup && i + 1 == count)
+                                      ? OneWireTraceEvent_PullupSlot
+                                      : OneWireTraceEvent_Slot;
+        OneWireTraceAdd(event, (int)(uartBus - uartBuses), uartBus->overdrive, slots[i],
+                        echoes != NULL ? echoes[i] : -1);
+    }
+#endif
+}
+
+/// <summary>
+/// Reads the specified number of bytes from the UART.  The bytes may arrive over multiple
+/// reads, so this waits on the UART with poll() until all of the data is received or the
+/// time needed to send the data (plus ONEWIRE_UART_READ_MARGIN_US) has elapsed.  The read
+/// completes as soon as the echo data arrives.
+/// </summary>
+/// <param name="fd">The file descriptor of the UART.</param>
+/// <param name="baud">The baud rate of the UART.</param>
+/// <param name="buffer">Receives the data.</param>
+/// <param name="count">The number of bytes to read.</param>
+/// <returns>true if all of the bytes were received, otherwise false.</returns>
+static bool OneWireUartReadBytes(int fd, UART_BaudRate_Type baud, uint8_t *buffer, size_t count)
+{
+    // Each byte on the UART is 10 bits (1 start bit + 8 data bits + 1 stop bit).
+    long timeoutUs = (long)((count * 10 * 1000000ULL) / baud) + ONEWIRE_UART_READ_MARGIN_US;
+    struct timespec start;
+    OneWireStatsStart(&start);
+
+    int retries = 0;
+    size_t received = 0;
+    while (received < count) {
+        ssize_t bytesRead = read(fd, buffer + received, count - received);
+        if (bytesRead > 0) {
+            received += (size_t)bytesRead;
+            continue;
+        }
+
+        if (bytesRead == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            Log_Debug("ERROR: Could not read UART: %s (%d).\n", strerror(errno), errno);
+            OneWireStatsAddRetries(OneWireStatsOperation_UartRead, retries);
+            OneWireStatsRecord(OneWireStatsOperation_UartRead, &start, false);
+            return false;
+        }
+
+        long remainingUs = timeoutUs - ElapsedMicro(&start);
+        if (remainingUs <= 0) {
+            OneWireStatsAddRetries(OneWireStatsOperation_UartRead, retries);
+            OneWireStatsRecord(OneWireStatsOperation_UartRead, &start, false);
+            return false;
+        }
+
+        // Wait for more data to arrive (poll uses milliseconds, so round up).
+        struct pollfd uartPollFd = {.fd = fd, .events = POLLIN, .revents = 0};
+        retries++;
+        if (poll(&uartPollFd, 1, (int)((remainingUs + 999) / 1000)) == -1 && errno != EINTR) {
+            Log_Debug("ERROR: Could not poll UART: %s (%d).\n", strerror(errno), errno);
+            OneWireStatsAddRetries(OneWireStatsOperation_UartRead, retries);
+            OneWireStatsRecord(OneWireStatsOperation_UartRead, &start, false);
+            return false;
+        }
+    }
+
+    OneWireStatsAddRetries(OneWireStatsOperation_UartRead, retries);
+    OneWireStatsRecord(OneWireStatsOperation_UartRead, &start, true);
+    return true;
+}
+
+/// <summary>
+/// Reads and discards any data received by the UART, until no data has arrived for
+/// ONEWIRE_UART_DISCARD_QUIET_MS.  A bus with a reset UART has two receivers on the same
+/// OneWire bus, so each UART receives the pulses sent by the other UART.
+/// </summary>
+/// <param name="fd">The file descriptor of the UART.</param>
+static void OneWireUartDiscardInput(int fd)
+{
+    uint8_t buffer[ONEWIRE_UART_MAX_SLOTS_PER_TRANSFER];
+    struct pollfd uartPollFd = {.fd = fd, .events = POLLIN, .revents = 0};
+    while (poll(&uartPollFd, 1, ONEWIRE_UART_DISCARD_QUIET_MS) > 0) {
+        if (read(fd, buffer, sizeof(buffer)) <= 0) {
+            break;
+        }
+    }
+}
+
 /// <summary>
 /// Enables the strong pullup on the OneWire bus, to help with parasitic charging.
 /// The pullup should be connected via a 680 ohm resistor, so max current provided 
@@ -333,5 +833,5 @@ static int OneWireUartReadByte(void)
 /// </summary>
 static void OneWireEnableStrongPullupGpio(void)
 {
-    GPIO_SetValue(gpioPullupFd, GPIO_Value_High);
+    GPIO_SetValue(uartBus->gpioPullupFd, GPIO_Value_High);
 }
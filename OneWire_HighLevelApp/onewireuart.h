@@ -4,6 +4,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "applibs_versions.h"
@@ -11,15 +12,72 @@
 #include <applibs/uart.h>
 
 /// <summary>
-/// Initialize the UART and GPIO ports.
+/// The maximum number of OneWire buses (each with its own UART and pullup GPIO.)
+/// </summary>
+#define ONEWIRE_UART_MAX_BUSES 4
+
+/// <summary>
+/// Pass as the resetUart of <see src="OneWireUartAddBusWithResetUart"/> when the bus does not
+/// have a separate UART for reset pulses.
+/// </summary>
+#define ONEWIRE_UART_NO_RESET_UART (-1)
+
+/// <summary>
+/// Initialize the UART and GPIO ports, and select the bus for the OneWire operations.
 /// </summary>
 /// <param name="uart">The UART port to use for communication.</param>
 /// <param name="gpio">The GPIO port to use for pullup.</param>
-/// <returns></returns>
+/// <returns>true if the initialization was succesful, otherwise false.</returns>
 bool OneWireUartInit(UART_Id uart, GPIO_Id gpio);
 
 /// <summary>
-/// Close the UART and GPIO ports.
+/// Initialize the UART and GPIO ports for another OneWire bus.  Use
+/// <see src="OneWireUartSelectBus"/> to choose the bus used by the OneWire operations.
+/// </summary>
+/// <param name="uart">The UART port to use for communication.</param>
+/// <param name="gpio">The GPIO port to use for pullup.</param>
+/// <returns>The bus number, or -1 if the initialization failed.</returns>
+int OneWireUartAddBus(UART_Id uart, GPIO_Id gpio);
+
+/// <summary>
+/// Initialize the UART and GPIO ports for another OneWire bus that uses a second UART for the
+/// reset pulses.  A reset pulse needs a long low (9600 baud) and a time slot needs a short low
+/// (115200 baud), so a bus with a single UART closes and reopens the UART to change the baud
+/// rate twice for every reset.  With a reset UART both UARTs stay open: the reset UART at 9600
+/// baud and the data UART at 115200 baud.  The TX of the reset UART must also be able to pull
+/// the OneWire bus low (e.g. with its own pair of transistors, in parallel with the data UART's
+/// transistor) and its RX must be connected to the OneWire bus.
+/// </summary>
+/// <param name="uart">The UART port to use for the time slots.</param>
+/// <param name="resetUart">The UART port to use for reset pulses, or ONEWIRE_UART_NO_RESET_UART
+/// to change the baud rate of the data UART for the reset pulses.</param>
+/// <param name="gpio">The GPIO port to use for pullup.</param>
+/// <returns>The bus number, or -1 if the initialization failed.</returns>
+int OneWireUartAddBusWithResetUart(UART_Id uart, UART_Id resetUart, GPIO_Id gpio);
+
+/// <summary>
+/// Selects the bus used by all of the OneWire operations.
+/// </summary>
+/// <param name="bus">The bus number returned by <see src="OneWireUartAddBus"/>.</param>
+/// <returns>true if the bus was selected, otherwise false.</returns>
+bool OneWireUartSelectBus(int bus);
+
+/// <summary>
+/// Returns the number of OneWire buses that have been initialized.
+/// </summary>
+/// <returns>The number of buses.</returns>
+int OneWireUartGetBusCount(void);
+
+/// <summary>
+/// Returns the byte received during the last reset pulse at standard speed on the selected bus
+/// that got a presence pulse.  The devices on the bus release it at different times, so the byte
+/// can change when a device is added or removed.
+/// </summary>
+/// <returns>The byte, or -1 if no bus is selected or there has not been a presence pulse.</returns>
+int OneWireUartGetPresence(void);
+
+/// <summary>
+/// Close the UART and GPIO ports of every bus.
 /// </summary>
 void OneWireUartClose(void);
 
@@ -28,6 +86,7 @@ typedef enum {
     UartImplNoDevices = 1,
     UartImplNoData = 2,
     UartImplHardwareFailure = 3,
+    UartImplBusShorted = 4,
 } OneWireUartResetResponse;
 
 /// <summary>
@@ -36,10 +95,22 @@ typedef enum {
 /// </summary>
 /// <returns>returns UartImplDevicePresent if one or more devices responded,
 /// UartImplNoDevices is no devices responsed, UartImplNoData if there was
-/// an error during communication.
+/// an error during communication, UartImplBusShorted if the bus stayed low.
 /// </returns>
 OneWireUartResetResponse OneWireUartPulseReset(void);
 
+/// <summary>
+/// Sets the speed of the time slots and reset pulses on the selected bus.  At overdrive speed the
+/// time slots are sent at 1000000 baud and the reset pulses at 115200 baud, on the data UART.
+/// Only the devices that were put in overdrive (e.g. with Overdrive Match ROM) respond; a reset
+/// pulse at standard speed returns every device to standard speed.  A bus with a reset UART is
+/// kept at standard speed, so its data UART is never reopened.
+/// </summary>
+/// <param name="overdrive">true for overdrive speed, false for standard speed.</param>
+/// <returns>true if the speed was set, otherwise false (e.g. overdrive on a bus with a reset
+/// UART.)</returns>
+bool OneWireUartSetOverdrive(bool overdrive);
+
 /// <summary>
 /// Sends a data bit on the OneWire bus.  After sending
 /// the bit the strong pullup can be enabled to help with parasitic charging.
@@ -57,6 +128,22 @@ bool OneWireUartPulseWriteBit(int bit, bool enableStrongPullup);
 /// <returns>returns -1 if error, otherwise returns the bit (0 or 1) value.</returns>
 int OneWireUartPulseReadBit(void);
 
+/// <summary>
+/// Sends a sequence of time slots on the OneWire bus and returns the value of the bus sampled
+/// during each slot.  A 0 bit generates a write 0 slot.  A 1 bit generates a write 1 slot, which
+/// is also how a read slot is generated; if a device pulls the line low during the slot then a 0
+/// is received.  The slots are batched so many slots use a single UART write and read.
+/// </summary>
+/// <param name="sendBits">The bits to send, least significant bit of sendBits[0] first.</param>
+/// <param name="receiveBits">Receives the bits sampled on the bus (same packing as sendBits).
+/// This can be NULL if the received bits are not needed.</param>
+/// <param name="bitCount">The number of time slots to send.</param>
+/// <param name="enableStrongPullup">true if the pullup should be enabled after sending the
+/// last bit.</param>
+/// <returns>true if successful, otherwise false.</returns>
+bool OneWireUartTouchBits(const uint8_t *sendBits, uint8_t *receiveBits, size_t bitCount,
+                          bool enableStrongPullup);
+
 /// <summary>
 /// Disables the pullup GPIO on the OneWire bus.  This should be disabled if the OneWire
 /// bus might get pulled to ground.  The pullup should be connected via a 680 ohm
@@ -0,0 +1,128 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "readingbuffer.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "applibs_versions.h"
+#include <applibs/log.h>
+
+/// <summary>
+/// The readings.  A reading is at readingBuffer[index % READING_BUFFER_CAPACITY].
+/// </summary>
+static Reading readingBuffer[READING_BUFFER_CAPACITY];
+
+/// <summary>
+/// The index of the next reading to add.  Only the producer changes it; the release store makes
+/// the reading visible to the consumer before the index.
+/// </summary>
+static atomic_uint readingHead = 0;
+
+/// <summary>
+/// The index of the oldest reading.  Only the consumer changes it; the release store tells the
+/// producer the slots before it can be reused.
+/// </summary>
+static atomic_uint readingTail = 0;
+
+/// <summary>
+/// The number of readings dropped because the buffer was full (only changed by the producer.)
+/// </summary>
+static atomic_uint readingDropped = 0;
+
+/// <summary>
+/// Adds a reading to the buffer, timestamped with the current time.  This must only be called by
+/// one thread (the producer.)  If the buffer is full the reading is dropped, so the readings that
+/// have not been consumed are never overwritten.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <param name="bus">The bus the device is on.</param>
+/// <param name="raw">The temperature in 1/16 degrees Celsius.</param>
+/// <param name="status">The result of reading the device.</param>
+/// <returns>true if the reading was added, false if the buffer is full.</returns>
+bool ReadingBufferAdd(OneWireRomId rom, int bus, int16_t raw, ReadingStatus status)
+{
+    unsigned int head = atomic_load_explicit(&readingHead, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&readingTail, memory_order_acquire);
+    if (head - tail >= READING_BUFFER_CAPACITY) {
+        atomic_fetch_add_explicit(&readingDropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    Reading *reading = &readingBuffer[head % READING_BUFFER_CAPACITY];
+    reading->rom = rom;
+    reading->timestampMilli =
+        (uint32_t)((uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000);
+    reading->raw = status == ReadingStatus_Ok ? raw : 0;
+    reading->bus = (uint8_t)bus;
+    reading->status = (uint8_t)status;
+
+    atomic_store_explicit(&readingHead, head + 1, memory_order_release);
+    return true;
+}
+
+/// <summary>
+/// Returns the oldest readings in the buffer without copying them.  The readings stay in the
+/// buffer until <see src="ReadingBufferRelease"/> is called.  This must only be called by one
+/// thread (the consumer.)  As the buffer wraps around, a second call after releasing the
+/// readings may return more readings.
+/// </summary>
+/// <param name="readings">Receives a pointer to the oldest reading.</param>
+/// <returns>The number of consecutive readings at *readings (0 if the buffer is empty.)</returns>
+int ReadingBufferPeek(const Reading **readings)
+{
+    unsigned int tail = atomic_load_explicit(&readingTail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&readingHead, memory_order_acquire);
+    unsigned int count = head - tail;
+    unsigned int start = tail % READING_BUFFER_CAPACITY;
+    if (count > READING_BUFFER_CAPACITY - start) {
+        count = READING_BUFFER_CAPACITY - start;
+    }
+
+    *readings = &readingBuffer[start];
+    return (int)count;
+}
+
+/// <summary>
+/// Removes the oldest readings from the buffer, once the consumer has finished with them.
+/// </summary>
+/// <param name="count">The number of readings to remove (at most the count returned by
+/// <see src="ReadingBufferPeek"/>.)</param>
+void ReadingBufferRelease(int count)
+{
+    unsigned int tail = atomic_load_explicit(&readingTail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&readingHead, memory_order_acquire);
+    if (count < 0 || (unsigned int)count > head - tail) {
+        Log_Debug("PROGRAM ERROR: Released %d readings, but only %u are buffered.\n", count,
+                  head - tail);
+        return;
+    }
+
+    atomic_store_explicit(&readingTail, tail + (unsigned int)count, memory_order_release);
+}
+
+/// <summary>
+/// Returns the number of readings in the buffer.
+/// </summary>
+/// <returns>The number of readings.</returns>
+int ReadingBufferGetCount(void)
+{
+    unsigned int tail = atomic_load_explicit(&readingTail, memory_order_acquire);
+    unsigned int head = atomic_load_explicit(&readingHead, memory_order_acquire);
+    return (int)(head - tail);
+}
+
+/// <summary>
+/// Returns the number of readings dropped because the buffer was full.
+/// </summary>
+/// <returns>The number of readings dropped since the application started.</returns>
+uint32_t ReadingBufferGetDropped(void)
+{
+    return atomic_load_explicit(&readingDropped, memory_order_relaxed);
+}
@@ -0,0 +1,107 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "onewirerom.h"
+
+/// <summary>
+/// The number of readings the buffer holds (a power of 2.)
+/// </summary>
+#define READING_BUFFER_CAPACITY 256
+
+/// <summary>
+/// The result of reading a device.
+/// </summary>
+typedef enum {
+    /// <summary>
+    /// The temperature was read.
+    /// </summary>
+    ReadingStatus_Ok = 0,
+
+    /// <summary>
+    /// The device did not respond, or the data failed its CRC or range check.
+    /// </summary>
+    ReadingStatus_Failed = 1,
+
+    /// <summary>
+    /// The device was read before its conversion had time to complete.
+    /// </summary>
+    ReadingStatus_Incomplete = 2,
+} ReadingStatus;
+
+/// <summary>
+/// A reading of one device (16 bytes, so 4 readings fit in a cache line.)
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// The ROM identifier of the device.
+    /// </summary>
+    OneWireRomId rom;
+
+    /// <summary>
+    /// The CLOCK_MONOTONIC time of the reading in milliseconds.  It wraps after 49 days, so
+    /// compare timestamps by subtracting them.
+    /// </summary>
+    uint32_t timestampMilli;
+
+    /// <summary>
+    /// The temperature in 1/16 degrees Celsius (the DS18B20 temperature register), or 0 if the
+    /// status is not ReadingStatus_Ok.
+    /// </summary>
+    int16_t raw;
+
+    /// <summary>
+    /// The bus the device is on.
+    /// </summary>
+    uint8_t bus;
+
+    /// <summary>
+    /// The ReadingStatus of the reading.
+    /// </summary>
+    uint8_t status;
+} Reading;
+
+/// <summary>
+/// Adds a reading to the buffer, timestamped with the current time.  This must only be called by
+/// one thread (the producer.)  If the buffer is full the reading is dropped, so the readings that
+/// have not been consumed are never overwritten.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <param name="bus">The bus the device is on.</param>
+/// <param name="raw">The temperature in 1/16 degrees Celsius.</param>
+/// <param name="status">The result of reading the device.</param>
+/// <returns>true if the reading was added, false if the buffer is full.</returns>
+bool ReadingBufferAdd(OneWireRomId rom, int bus, int16_t raw, ReadingStatus status);
+
+/// <summary>
+/// Returns the oldest readings in the buffer without copying them.  The readings stay in the
+/// buffer until <see src="ReadingBufferRelease"/> is called.  This must only be called by one
+/// thread (the consumer.)  As the buffer wraps around, a second call after releasing the
+/// readings may return more readings.
+/// </summary>
+/// <param name="readings">Receives a pointer to the oldest reading.</param>
+/// <returns>The number of consecutive readings at *readings (0 if the buffer is empty.)</returns>
+int ReadingBufferPeek(const Reading **readings);
+
+/// <summary>
+/// Removes the oldest readings from the buffer, once the consumer has finished with them.
+/// </summary>
+/// <param name="count">The number of readings to remove (at most the count returned by
+/// <see src="ReadingBufferPeek"/>.)</param>
+void ReadingBufferRelease(int count);
+
+/// <summary>
+/// Returns the number of readings in the buffer.
+/// </summary>
+/// <returns>The number of readings.</returns>
+int ReadingBufferGetCount(void);
+
+/// <summary>
+/// Returns the number of readings dropped because the buffer was full.
+/// </summary>
+/// <returns>The number of readings dropped since the application started.</returns>
+uint32_t ReadingBufferGetDropped(void);
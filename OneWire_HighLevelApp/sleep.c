@@ -15,3 +15,30 @@ void SleepMilli(long durationMs)
     const struct timespec sleepTime = {.tv_sec = durationSec, .tv_nsec = durationMs * 1000000};
     nanosleep(&sleepTime, NULL);
 }
+
+
+/// <summary>
+/// Returns the number of microseconds elapsed since the start time.
+/// </summary>
+/// <param name="start">The start time (from clock_gettime using CLOCK_MONOTONIC).</param>
+/// <returns>The elapsed time in microseconds.</returns>
+long ElapsedMicro(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000L + (now.tv_nsec - start->tv_nsec) / 1000L;
+}
+
+/// <summary>
+/// Returns the number of milliseconds elapsed since the start time.  Unlike
+/// <see src="ElapsedMicro"/> the result does not overflow a 32-bit long after 35 minutes.
+/// </summary>
+/// <param name="start">The start time (from clock_gettime using CLOCK_MONOTONIC).</param>
+/// <returns>The elapsed time in milliseconds.</returns>
+long long ElapsedMilli(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)(now.tv_sec - start->tv_sec) * 1000LL +
+           (now.tv_nsec - start->tv_nsec) / 1000000L;
+}
@@ -3,4 +3,25 @@
 
 #pragma once
 
-void SleepMilli(long durationMs);
\ No newline at end of file
+#include <time.h>
+
+/// <summary>
+/// Suspends the thread for the specified number of milliseconds.
+/// </summary>
+/// <param name="durationMs">The duration to sleep for.</param>
+void SleepMilli(long durationMs);
+
+/// <summary>
+/// Returns the number of microseconds elapsed since the start time.
+/// </summary>
+/// <param name="start">The start time (from clock_gettime using CLOCK_MONOTONIC).</param>
+/// <returns>The elapsed time in microseconds.</returns>
+long ElapsedMicro(const struct timespec *start);
+
+/// <summary>
+/// Returns the number of milliseconds elapsed since the start time.  Unlike
+/// <see src="ElapsedMicro"/> the result does not overflow a 32-bit long after 35 minutes.
+/// </summary>
+/// <param name="start">The start time (from clock_gettime using CLOCK_MONOTONIC).</param>
+/// <returns>The elapsed time in milliseconds.</returns>
+long long ElapsedMilli(const struct timespec *start);
@@ -0,0 +1,368 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "telemetry.h"
+#include "readingbuffer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "applibs_versions.h"
+#include <applibs/log.h>
+
+/// <summary>
+/// The size of the batch header (version, device count, reading count and start time.)
+/// </summary>
+#define TELEMETRY_HEADER_BYTES 12
+
+/// <summary>
+/// The size of each device in a batch (ROM identifier and bus.)
+/// </summary>
+#define TELEMETRY_DEVICE_BYTES 9
+
+/// <summary>
+/// The most bytes one reading uses: a 5 byte time delta, the device index and status, and a 3
+/// byte temperature delta.
+/// </summary>
+#define TELEMETRY_MAX_READING_BYTES 9
+
+/// <summary>
+/// A batch in the outbox.
+/// </summary>
+typedef struct {
+    size_t length;
+    uint16_t readingCount;
+    uint8_t data[TELEMETRY_MAX_BATCH_BYTES];
+} TelemetryBatch;
+
+/// <summary>
+/// The batch collecting readings.  The readings are encoded as they arrive; the header and
+/// devices are written in front of them when the batch is moved to the outbox.
+/// </summary>
+typedef struct {
+    int deviceCount;
+    OneWireRomId roms[TELEMETRY_MAX_BATCH_DEVICES];
+    uint8_t buses[TELEMETRY_MAX_BATCH_DEVICES];
+    int16_t lastRaw[TELEMETRY_MAX_BATCH_DEVICES];
+    uint16_t readingCount;
+    uint32_t firstMilli;
+    uint32_t lastMilli;
+    int64_t startUnixMilli;
+    size_t length;
+    uint8_t readings[TELEMETRY_MAX_BATCH_BYTES - TELEMETRY_HEADER_BYTES];
+} TelemetryOpenBatch;
+
+static bool TelemetryAddReading(const Reading *reading);
+static bool TelemetrySealBatch(void);
+static int TelemetryFindDevice(OneWireRomId rom, uint8_t bus);
+static uint32_t TelemetryGetMilli(void);
+static int64_t TelemetryGetUnixMilli(uint32_t timestampMilli);
+static size_t TelemetryPutVarint(uint8_t *buffer, uint32_t value);
+static void TelemetryPutLittleEndian(uint8_t *buffer, uint64_t value, int bytes);
+
+/// <summary>
+/// How long (in milliseconds) a batch collects readings before it is sent.
+/// </summary>
+static uint32_t telemetryMaxBatchAgeMilli = 0;
+
+/// <summary>
+/// Sends the batches.
+/// </summary>
+static TelemetrySendHandler telemetrySendHandler = NULL;
+
+/// <summary>
+/// The batch collecting readings.
+/// </summary>
+static TelemetryOpenBatch telemetryOpenBatch;
+
+/// <summary>
+/// The batches waiting to be sent, oldest first from telemetryOutboxHead.
+/// </summary>
+static TelemetryBatch telemetryOutbox[TELEMETRY_OUTBOX_BATCHES];
+
+/// <summary>
+/// The index of the oldest batch in the outbox.
+/// </summary>
+static int telemetryOutboxHead = 0;
+
+/// <summary>
+/// The number of batches in the outbox.
+/// </summary>
+static int telemetryOutboxCount = 0;
+
+/// <summary>
+/// true while the oldest batch is being sent.
+/// </summary>
+static bool telemetryInFlight = false;
+
+/// <summary>
+/// The totals since TelemetryInit.
+/// </summary>
+static TelemetryCounters telemetryCounters;
+
+/// <summary>
+/// Initializes the telemetry.  The outbox is empty.
+/// </summary>
+/// <param name="maxBatchAgeSeconds">How long a batch collects readings before it is sent, unless
+/// it fills up first.</param>
+/// <param name="sendHandler">Sends the batches.</param>
+void TelemetryInit(int maxBatchAgeSeconds, TelemetrySendHandler sendHandler)
+{
+    telemetryMaxBatchAgeMilli = (uint32_t)maxBatchAgeSeconds * 1000u;
+    telemetrySendHandler = sendHandler;
+    telemetryOpenBatch.deviceCount = 0;
+    telemetryOpenBatch.readingCount = 0;
+    telemetryOpenBatch.length = 0;
+    telemetryOutboxHead = 0;
+    telemetryOutboxCount = 0;
+    telemetryInFlight = false;
+    memset(&telemetryCounters, 0, sizeof(telemetryCounters));
+}
+
+/// <summary>
+/// Moves the readings from the reading buffer into the open batch.  A batch that is full, or
+/// whose first reading is maxBatchAgeSeconds old, is moved to the outbox.  If the outbox is full
+/// the readings are left in the reading buffer.
+/// </summary>
+/// <returns>The number of readings moved.</returns>
+int TelemetryCollect(void)
+{
+    int moved = 0;
+    const Reading *readings;
+    int count;
+    while ((count = ReadingBufferPeek(&readings)) > 0) {
+        int added = 0;
+        while (added < count && TelemetryAddReading(&readings[added])) {
+            added++;
+        }
+
+        ReadingBufferRelease(added);
+        moved += added;
+        if (added < count) {
+            break;
+        }
+    }
+
+    if (telemetryOpenBatch.readingCount > 0 &&
+        TelemetryGetMilli() - telemetryOpenBatch.firstMilli >= telemetryMaxBatchAgeMilli) {
+        TelemetrySealBatch();
+    }
+
+    return moved;
+}
+
+/// <summary>
+/// Sends the oldest batch in the outbox, unless a batch is already being sent.
+/// </summary>
+void TelemetrySendNext(void)
+{
+    if (telemetryInFlight || telemetryOutboxCount == 0 || telemetrySendHandler == NULL) {
+        return;
+    }
+
+    // The handler may confirm the batch before it returns.
+    const TelemetryBatch *batch = &telemetryOutbox[telemetryOutboxHead];
+    telemetryInFlight = true;
+    if (!telemetrySendHandler(batch->data, batch->length)) {
+        telemetryInFlight = false;
+    }
+}
+
+/// <summary>
+/// Called by the sender when the batch being sent was delivered (it is removed from the outbox)
+/// or failed to send (it is sent again by the next <see src="TelemetrySendNext"/>.)
+/// </summary>
+/// <param name="delivered">true if the batch was delivered, otherwise false.</param>
+void TelemetryConfirm(bool delivered)
+{
+    if (!telemetryInFlight) {
+        Log_Debug("PROGRAM ERROR: No telemetry batch is being sent.\n");
+        return;
+    }
+
+    telemetryInFlight = false;
+    if (!delivered) {
+        telemetryCounters.sendFailures++;
+        return;
+    }
+
+    const TelemetryBatch *batch = &telemetryOutbox[telemetryOutboxHead];
+    telemetryCounters.readingsSent += batch->readingCount;
+    telemetryCounters.batchesSent++;
+    telemetryCounters.bytesSent += (uint32_t)batch->length;
+    telemetryOutboxHead = (telemetryOutboxHead + 1) % TELEMETRY_OUTBOX_BATCHES;
+    telemetryOutboxCount--;
+}
+
+/// <summary>
+/// Gets the totals since <see src="TelemetryInit"/>.
+/// </summary>
+/// <param name="counters">Receives the totals.</param>
+void TelemetryGetCounters(TelemetryCounters *counters)
+{
+    *counters = telemetryCounters;
+    counters->pendingBatches = telemetryOutboxCount;
+}
+
+/// <summary>
+/// Encodes a reading into the open batch.  If the reading does not fit, the open batch is moved
+/// to the outbox first.
+/// </summary>
+/// <param name="reading">The reading.</param>
+/// <returns>true if the reading was added, false if the outbox is full.</returns>
+static bool TelemetryAddReading(const Reading *reading)
+{
+    TelemetryOpenBatch *open = &telemetryOpenBatch;
+    int device = TelemetryFindDevice(reading->rom, reading->bus);
+    int deviceCount = open->deviceCount + (device < 0 ? 1 : 0);
+    if (open->readingCount > 0 &&
+        (deviceCount > TELEMETRY_MAX_BATCH_DEVICES || open->readingCount == UINT16_MAX ||
+         TELEMETRY_HEADER_BYTES + deviceCount * TELEMETRY_DEVICE_BYTES + open->length +
+                 TELEMETRY_MAX_READING_BYTES >
+             TELEMETRY_MAX_BATCH_BYTES)) {
+        if (!TelemetrySealBatch()) {
+            return false;
+        }
+        device = -1;
+    }
+
+    if (open->readingCount == 0) {
+        open->firstMilli = reading->timestampMilli;
+        open->lastMilli = reading->timestampMilli;
+        open->startUnixMilli = TelemetryGetUnixMilli(reading->timestampMilli);
+    }
+
+    if (device < 0) {
+        device = open->deviceCount++;
+        open->roms[device] = reading->rom;
+        open->buses[device] = reading->bus;
+        open->lastRaw[device] = 0;
+    }
+
+    uint8_t *data = &open->readings[open->length];
+    size_t length = TelemetryPutVarint(data, reading->timestampMilli - open->lastMilli);
+    data[length++] = (uint8_t)(device | (reading->status << 6));
+    if (reading->status == ReadingStatus_Ok) {
+        // Zigzag encoding keeps small negative changes in a single byte.
+        int32_t delta = (int32_t)reading->raw - open->lastRaw[device];
+        uint32_t zigzag = ((uint32_t)delta << 1) ^ (delta < 0 ? UINT32_MAX : 0u);
+        length += TelemetryPutVarint(&data[length], zigzag);
+        open->lastRaw[device] = reading->raw;
+    }
+
+    open->length += length;
+    open->lastMilli = reading->timestampMilli;
+    open->readingCount++;
+    return true;
+}
+
+/// <summary>
+/// Writes the open batch, with its header and devices, to the outbox and starts a new batch.
+/// </summary>
+/// <returns>true if the batch was moved, false if the outbox is full.</returns>
+static bool TelemetrySealBatch(void)
+{
+    TelemetryOpenBatch *open = &telemetryOpenBatch;
+    if (telemetryOutboxCount == TELEMETRY_OUTBOX_BATCHES) {
+        return false;
+    }
+
+    TelemetryBatch *batch =
+        &telemetryOutbox[(telemetryOutboxHead + telemetryOutboxCount) % TELEMETRY_OUTBOX_BATCHES];
+    uint8_t *data = batch->data;
+    data[0] = TELEMETRY_BATCH_VERSION;
+    data[1] = (uint8_t)open->deviceCount;
+    TelemetryPutLittleEndian(&data[2], open->readingCount, 2);
+    TelemetryPutLittleEndian(&data[4], (uint64_t)open->startUnixMilli, 8);
+    size_t length = TELEMETRY_HEADER_BYTES;
+    for (int device = 0; device < open->deviceCount; device++) {
+        TelemetryPutLittleEndian(&data[length], open->roms[device], 8);
+        data[length + 8] = open->buses[device];
+        length += TELEMETRY_DEVICE_BYTES;
+    }
+    memcpy(&data[length], open->readings, open->length);
+
+    batch->length = length + open->length;
+    batch->readingCount = open->readingCount;
+    telemetryOutboxCount++;
+
+    open->deviceCount = 0;
+    open->readingCount = 0;
+    open->length = 0;
+    return true;
+}
+
+/// <summary>
+/// Returns the index of a device in the open batch.
+/// </summary>
+/// <param name="rom">The ROM identifier of the device.</param>
+/// <param name="bus">The bus the device is on.</param>
+/// <returns>The index, or -1 if the device is not in the batch.</returns>
+static int TelemetryFindDevice(OneWireRomId rom, uint8_t bus)
+{
+    for (int device = 0; device < telemetryOpenBatch.deviceCount; device++) {
+        if (telemetryOpenBatch.roms[device] == rom && telemetryOpenBatch.buses[device] == bus) {
+            return device;
+        }
+    }
+
+    return -1;
+}
+
+/// <summary>
+/// Returns the current CLOCK_MONOTONIC time in milliseconds, like the timestamp of a reading.
+/// </summary>
+/// <returns>The time in milliseconds.</returns>
+static uint32_t TelemetryGetMilli(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000);
+}
+
+/// <summary>
+/// Converts the timestamp of a reading to the time since 1970-01-01 UTC.
+/// </summary>
+/// <param name="timestampMilli">The CLOCK_MONOTONIC time in milliseconds.</param>
+/// <returns>The time in milliseconds since 1970-01-01 UTC.</returns>
+static int64_t TelemetryGetUnixMilli(uint32_t timestampMilli)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t nowUnixMilli = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    return nowUnixMilli - (int64_t)(uint32_t)(TelemetryGetMilli() - timestampMilli);
+}
+
+/// <summary>
+/// Writes a varint: 7 bits per byte, least significant first, with bit 7 set on every byte but
+/// the last.
+/// </summary>
+/// <param name="buffer">Receives the varint (up to 5 bytes.)</param>
+/// <param name="value">The value.</param>
+/// <returns>The number of bytes written.</returns>
+static size_t TelemetryPutVarint(uint8_t *buffer, uint32_t value)
+{
+    size_t length = 0;
+    while (value >= 0x80) {
+        buffer[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+
+    buffer[length++] = (uint8_t)value;
+    return length;
+}
+
+/// <summary>
+/// Writes a little endian value.
+/// </summary>
+/// <param name="buffer">Receives the value.</param>
+/// <param name="value">The value.</param>
+/// <param name="bytes">The number of bytes to write.</param>
+static void TelemetryPutLittleEndian(uint8_t *buffer, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        buffer[i] = (uint8_t)(value >> (8 * i));
+    }
+}
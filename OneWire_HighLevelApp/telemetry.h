@@ -0,0 +1,119 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The readings are uploaded in batches.  A batch is little endian:
+//   uint8  version (TELEMETRY_BATCH_VERSION)
+//   uint8  device count
+//   uint16 reading count
+//   int64  time of the first reading, in milliseconds since 1970-01-01 UTC
+//   for each device (the first device in the batch is index 0):
+//     uint64 ROM identifier
+//     uint8  bus
+//   for each reading:
+//     varint      milliseconds since the previous reading (0 for the first reading)
+//     uint8       device index (bits 0 to 5) and ReadingStatus (bits 6 and 7)
+//     zigzag varint, only for ReadingStatus_Ok: the temperature in 1/16 degrees Celsius, minus
+//                 the previous temperature of the device in the batch (0 for its first reading)
+// A varint has 7 bits per byte, least significant first, with bit 7 set on every byte but the
+// last.  A reading is usually 3 or 4 bytes, instead of the 16 bytes of a Reading.
+
+/// <summary>
+/// The version of the batch format.
+/// </summary>
+#define TELEMETRY_BATCH_VERSION 1
+
+/// <summary>
+/// The largest batch in bytes.
+/// </summary>
+#define TELEMETRY_MAX_BATCH_BYTES 1024
+
+/// <summary>
+/// The most devices in a batch (the device index has 6 bits.)
+/// </summary>
+#define TELEMETRY_MAX_BATCH_DEVICES 64
+
+/// <summary>
+/// The number of batches kept while they cannot be sent (e.g. while offline.)  Once they are all
+/// waiting, the readings stay in the reading buffer until a batch is delivered.
+/// </summary>
+#define TELEMETRY_OUTBOX_BATCHES 8
+
+/// <summary>
+/// Sends a batch.  The sender calls <see src="TelemetryConfirm"/> once it knows whether the batch
+/// was delivered; the batch must not be used after that.
+/// </summary>
+/// <param name="batch">The encoded batch.</param>
+/// <param name="length">The length of the batch in bytes.</param>
+/// <returns>true if the batch is being sent, false if it cannot be sent now (it is sent again
+/// later.)</returns>
+typedef bool (*TelemetrySendHandler)(const uint8_t *batch, size_t length);
+
+/// <summary>
+/// The totals since <see src="TelemetryInit"/>.
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// The number of readings in the batches that were delivered.
+    /// </summary>
+    uint32_t readingsSent;
+
+    /// <summary>
+    /// The number of batches that were delivered.
+    /// </summary>
+    uint32_t batchesSent;
+
+    /// <summary>
+    /// The number of bytes in the batches that were delivered.
+    /// </summary>
+    uint32_t bytesSent;
+
+    /// <summary>
+    /// The number of times a batch failed to send.
+    /// </summary>
+    uint32_t sendFailures;
+
+    /// <summary>
+    /// The number of batches waiting to be sent.
+    /// </summary>
+    int pendingBatches;
+} TelemetryCounters;
+
+/// <summary>
+/// Initializes the telemetry.  The outbox is empty.
+/// </summary>
+/// <param name="maxBatchAgeSeconds">How long a batch collects readings before it is sent, unless
+/// it fills up first.</param>
+/// <param name="sendHandler">Sends the batches.</param>
+void TelemetryInit(int maxBatchAgeSeconds, TelemetrySendHandler sendHandler);
+
+/// <summary>
+/// Moves the readings from the reading buffer into the open batch.  A batch that is full, or
+/// whose first reading is maxBatchAgeSeconds old, is moved to the outbox.  If the outbox is full
+/// the readings are left in the reading buffer.
+/// </summary>
+/// <returns>The number of readings moved.</returns>
+int TelemetryCollect(void);
+
+/// <summary>
+/// Sends the oldest batch in the outbox, unless a batch is already being sent.
+/// </summary>
+void TelemetrySendNext(void);
+
+/// <summary>
+/// Called by the sender when the batch being sent was delivered (it is removed from the outbox)
+/// or failed to send (it is sent again by the next <see src="TelemetrySendNext"/>.)
+/// </summary>
+/// <param name="delivered">true if the batch was delivered, otherwise false.</param>
+void TelemetryConfirm(bool delivered);
+
+/// <summary>
+/// Gets the totals since <see src="TelemetryInit"/>.
+/// </summary>
+/// <param name="counters">Receives the totals.</param>
+void TelemetryGetCounters(TelemetryCounters *counters);
@@ -0,0 +1,246 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "telemetryiothub.h"
+#include "telemetry.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "applibs_versions.h"
+#include <applibs/log.h>
+#include <applibs/networking.h>
+
+#include <azureiot/iothub_client_options.h>
+#include <azureiot/iothub_device_client_ll.h>
+#include <azure_sphere_provisioning.h>
+
+/// <summary>
+/// The time (in milliseconds) to wait for the Device Provisioning Service.
+/// </summary>
+#define TELEMETRY_IOTHUB_PROVISIONING_TIMEOUT_MS 10000
+
+/// <summary>
+/// The time (in seconds) to wait before connecting again after a failure.
+/// </summary>
+#define TELEMETRY_IOTHUB_MIN_RETRY_SECONDS 10
+
+/// <summary>
+/// The longest time (in seconds) between connection attempts while the IoT hub cannot be reached.
+/// </summary>
+#define TELEMETRY_IOTHUB_MAX_RETRY_SECONDS 300
+
+/// <summary>
+/// How often (in seconds) the MQTT connection sends a keep alive.
+/// </summary>
+#define TELEMETRY_IOTHUB_KEEP_ALIVE_SECONDS 120
+
+static bool TelemetryIotHubConnect(void);
+static void TelemetryIotHubDisconnect(void);
+static void TelemetryIotHubConnectionStatusCallback(IOTHUB_CLIENT_CONNECTION_STATUS result,
+                                                    IOTHUB_CLIENT_CONNECTION_STATUS_REASON reason,
+                                                    void *context);
+static void TelemetryIotHubSendCallback(IOTHUB_CLIENT_CONFIRMATION_RESULT result, void *context);
+
+/// <summary>
+/// The ID scope of the Device Provisioning Service, or NULL if the IoT hub is not used.
+/// </summary>
+static const char *iothubScopeId = NULL;
+
+/// <summary>
+/// The IoT Hub client, or NULL if it is not connected.
+/// </summary>
+static IOTHUB_DEVICE_CLIENT_LL_HANDLE iothubClient = NULL;
+
+/// <summary>
+/// true once the IoT Hub client is authenticated.
+/// </summary>
+static bool iothubAuthenticated = false;
+
+/// <summary>
+/// true if the connection failed, so the client is destroyed and connected again (the client
+/// cannot be destroyed from its callbacks.)
+/// </summary>
+static bool iothubReconnect = false;
+
+/// <summary>
+/// The time to wait after the last failed connection attempt.
+/// </summary>
+static int iothubRetrySeconds = 0;
+
+/// <summary>
+/// The time of the last connection attempt (from clock_gettime using CLOCK_MONOTONIC.)
+/// </summary>
+static struct timespec iothubLastAttempt;
+
+/// <summary>
+/// Sets up sending the telemetry batches to Azure IoT Hub.  The device is provisioned with the
+/// Azure IoT Hub Device Provisioning Service using its Azure Sphere certificate; the connection
+/// is made by <see src="TelemetryIotHubDoWork"/> once the network is ready.
+/// </summary>
+/// <param name="scopeId">The ID scope of the Device Provisioning Service.</param>
+void TelemetryIotHubInit(const char *scopeId)
+{
+    iothubScopeId = scopeId;
+    iothubRetrySeconds = 0;
+}
+
+/// <summary>
+/// Connects to the IoT hub if it is not connected (retrying with a backoff), and lets the IoT
+/// Hub client send its messages and report their delivery.  Call it about once a second.
+/// </summary>
+void TelemetryIotHubDoWork(void)
+{
+    if (iothubReconnect) {
+        TelemetryIotHubDisconnect();
+    }
+
+    if (iothubClient == NULL && !TelemetryIotHubConnect()) {
+        return;
+    }
+
+    IoTHubDeviceClient_LL_DoWork(iothubClient);
+}
+
+/// <summary>
+/// Sends a telemetry batch to the IoT hub (a <see src="TelemetrySendHandler"/>); its delivery is
+/// reported with <see src="TelemetryConfirm"/>.
+/// </summary>
+/// <param name="batch">The encoded batch.</param>
+/// <param name="length">The length of the batch in bytes.</param>
+/// <returns>true if the batch is being sent, false if the IoT hub is not connected.</returns>
+bool TelemetryIotHubSend(const uint8_t *batch, size_t length)
+{
+    if (iothubClient == NULL || !iothubAuthenticated) {
+        return false;
+    }
+
+    IOTHUB_MESSAGE_HANDLE message = IoTHubMessage_CreateFromByteArray(batch, length);
+    if (message == NULL) {
+        Log_Debug("ERROR: Could not create the telemetry message.\n");
+        return false;
+    }
+
+    // The client copies the message, so it is destroyed straight away.
+    IoTHubMessage_SetContentTypeSystemProperty(message, "application/octet-stream");
+    IOTHUB_CLIENT_RESULT result = IoTHubDeviceClient_LL_SendEventAsync(
+        iothubClient, message, TelemetryIotHubSendCallback, NULL);
+    IoTHubMessage_Destroy(message);
+    if (result != IOTHUB_CLIENT_OK) {
+        Log_Debug("WARN: Could not send the telemetry message (%d).\n", result);
+        return false;
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Disconnects from the IoT hub.
+/// </summary>
+void TelemetryIotHubClose(void)
+{
+    TelemetryIotHubDisconnect();
+    iothubScopeId = NULL;
+}
+
+/// <summary>
+/// Provisions the device and creates the IoT Hub client, if the network is ready and the retry
+/// time since the last failed attempt has elapsed.
+/// </summary>
+/// <returns>true if the client was created, otherwise false.</returns>
+static bool TelemetryIotHubConnect(void)
+{
+    if (iothubScopeId == NULL) {
+        return false;
+    }
+
+    // The elapsed time is compared in seconds: in microseconds it overflows a 32 bit long after
+    // about 35 minutes, which would stop the retries.
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (iothubRetrySeconds > 0 && now.tv_sec - iothubLastAttempt.tv_sec < iothubRetrySeconds) {
+        return false;
+    }
+
+    bool networkReady = false;
+    if (Networking_IsNetworkingReady(&networkReady) == -1 || !networkReady) {
+        return false;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &iothubLastAttempt);
+    AZURE_SPHERE_PROV_RETURN_VALUE provisioning =
+        IoTHubDeviceClient_LL_CreateWithAzureSphereDeviceAuthProvisioning(
+            iothubScopeId, TELEMETRY_IOTHUB_PROVISIONING_TIMEOUT_MS, &iothubClient);
+    if (provisioning.result != AZURE_SPHERE_PROV_RESULT_OK) {
+        iothubClient = NULL;
+        iothubRetrySeconds = iothubRetrySeconds == 0 ? TELEMETRY_IOTHUB_MIN_RETRY_SECONDS
+                                                     : iothubRetrySeconds * 2;
+        if (iothubRetrySeconds > TELEMETRY_IOTHUB_MAX_RETRY_SECONDS) {
+            iothubRetrySeconds = TELEMETRY_IOTHUB_MAX_RETRY_SECONDS;
+        }
+        Log_Debug("WARN: Could not provision the IoT hub connection (%d), retrying in %d s.\n",
+                  provisioning.result, iothubRetrySeconds);
+        return false;
+    }
+
+    iothubRetrySeconds = 0;
+    int keepAliveSeconds = TELEMETRY_IOTHUB_KEEP_ALIVE_SECONDS;
+    IoTHubDeviceClient_LL_SetOption(iothubClient, OPTION_KEEP_ALIVE, &keepAliveSeconds);
+    IoTHubDeviceClient_LL_SetConnectionStatusCallback(
+        iothubClient, TelemetryIotHubConnectionStatusCallback, NULL);
+    return true;
+}
+
+/// <summary>
+/// Destroys the IoT Hub client.  A batch that is being sent is reported as not delivered.
+/// </summary>
+static void TelemetryIotHubDisconnect(void)
+{
+    if (iothubClient != NULL) {
+        IoTHubDeviceClient_LL_Destroy(iothubClient);
+        iothubClient = NULL;
+    }
+
+    iothubAuthenticated = false;
+    iothubReconnect = false;
+}
+
+/// <summary>
+/// Called by the IoT Hub client when the connection is authenticated or lost.
+/// </summary>
+/// <param name="result">The status of the connection.</param>
+/// <param name="reason">Why the status changed.</param>
+/// <param name="context">Not used.</param>
+static void TelemetryIotHubConnectionStatusCallback(IOTHUB_CLIENT_CONNECTION_STATUS result,
+                                                    IOTHUB_CLIENT_CONNECTION_STATUS_REASON reason,
+                                                    void *context)
+{
+    iothubAuthenticated = (result == IOTHUB_CLIENT_CONNECTION_AUTHENTICATED);
+    if (iothubAuthenticated) {
+        Log_Debug("INFO: Connected to the IoT hub.\n");
+        return;
+    }
+
+    // The client reconnects by itself when the network comes back; any other failure (e.g. an
+    // expired token) needs the device to be provisioned again.
+    Log_Debug("WARN: Disconnected from the IoT hub (%d).\n", reason);
+    if (reason != IOTHUB_CLIENT_CONNECTION_NO_NETWORK) {
+        iothubReconnect = true;
+    }
+}
+
+/// <summary>
+/// Called by the IoT Hub client when a batch was delivered or failed.
+/// </summary>
+/// <param name="result">The result of sending the batch.</param>
+/// <param name="context">Not used.</param>
+static void TelemetryIotHubSendCallback(IOTHUB_CLIENT_CONFIRMATION_RESULT result, void *context)
+{
+    if (result != IOTHUB_CLIENT_CONFIRMATION_OK) {
+        Log_Debug("WARN: The telemetry batch was not delivered (%d).\n", result);
+    }
+
+    TelemetryConfirm(result == IOTHUB_CLIENT_CONFIRMATION_OK);
+}
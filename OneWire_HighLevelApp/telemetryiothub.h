@@ -0,0 +1,36 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// <summary>
+/// Sets up sending the telemetry batches to Azure IoT Hub.  The device is provisioned with the
+/// Azure IoT Hub Device Provisioning Service using its Azure Sphere certificate; the connection
+/// is made by <see src="TelemetryIotHubDoWork"/> once the network is ready.
+/// </summary>
+/// <param name="scopeId">The ID scope of the Device Provisioning Service.</param>
+void TelemetryIotHubInit(const char *scopeId);
+
+/// <summary>
+/// Connects to the IoT hub if it is not connected (retrying with a backoff), and lets the IoT
+/// Hub client send its messages and report their delivery.  Call it about once a second.
+/// </summary>
+void TelemetryIotHubDoWork(void);
+
+/// <summary>
+/// Sends a telemetry batch to the IoT hub (a <see src="TelemetrySendHandler"/>); its delivery is
+/// reported with <see src="TelemetryConfirm"/>.
+/// </summary>
+/// <param name="batch">The encoded batch.</param>
+/// <param name="length">The length of the batch in bytes.</param>
+/// <returns>true if the batch is being sent, false if the IoT hub is not connected.</returns>
+bool TelemetryIotHubSend(const uint8_t *batch, size_t length);
+
+/// <summary>
+/// Disconnects from the IoT hub.
+/// </summary>
+void TelemetryIotHubClose(void);